@@ -0,0 +1,544 @@
+/////////////////////////////////////////////////////////////////////////////////
+// AlarmScheduler.cpp
+//
+// This file implements the AlarmScheduler class.  See AlarmScheduler.h for
+// details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "AlarmScheduler.h"     // For AlarmScheduler class.
+#include "TimeMath.h"           // For TimeMath::FloorDiv().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+//
+// Arguments:
+//   rClock - The clock that gives UTC time.
+//   rZone  - The published zone that gives local time offsets.
+//
+/////////////////////////////////////////////////////////////////////////////
+AlarmScheduler::AlarmScheduler(const PrecisionClock &rClock, const Rcu<Zone> &rZone) :
+                               m_rClock(rClock), m_rZone(rZone), m_Slots(), m_Heap(),
+                               m_Count(0), m_Firing(NO_SLOT), m_NextId(1), m_HeapGen(0),
+                               m_Timer(NULL)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+
+    esp_timer_create_args_t args = {};
+    args.callback        = OnTimer;
+    args.arg             = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name            = "WTM Alarm";
+    if (esp_timer_create(&args, &m_Timer) != ESP_OK)
+    {
+        m_Timer = NULL;
+    }
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// AddAt()
+//
+// Adds an alarm that runs once at the specified UTC time.  A time that
+// has already passed runs right away.
+//
+// Arguments:
+//   utc   - The UTC time at which to run.
+//   func  - The function to run.
+//
+// Returns:
+//   Returns the alarm's ID (greater than 0), or 0 if there is no room.
+//
+/////////////////////////////////////////////////////////////////////////////
+int32_t AlarmScheduler::AddAt(time_t utc, AlarmFunc_t func)
+{
+    return Add((int64_t)utc * USECS_PER_SEC, -1, func);
+} // End AddAt().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// AddDaily()
+//
+// Adds an alarm that runs every day at the specified local time, until it
+// is cancelled.
+//
+// Arguments:
+//   daySec - The local time, in seconds after midnight (0 - 86399).
+//   func   - The function to run.
+//
+// Returns:
+//   Returns the alarm's ID (greater than 0), or 0 if there is no room or
+//   daySec is out of range.
+//
+/////////////////////////////////////////////////////////////////////////////
+int32_t AlarmScheduler::AddDaily(int32_t daySec, AlarmFunc_t func)
+{
+    if ((daySec < 0) || (daySec >= SECS_PER_DAY))
+    {
+        return 0;
+    }
+    return Add(0, daySec, func);
+} // End AddDaily().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Cancel()
+//
+// Cancels an alarm.  If the alarm is running, it finishes, but a daily
+// alarm does not run again.
+//
+// Arguments:
+//   id - The alarm's ID.
+//
+// Returns:
+//   Returns true if the alarm was pending, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool AlarmScheduler::Cancel(int32_t id)
+{
+    if (id <= 0)
+    {
+        return false;
+    }
+
+    size_t slot = NO_SLOT;
+    bool   free = false;
+    portENTER_CRITICAL(&m_Mux);
+    for (size_t pos = 0; pos < m_Count; pos++)
+    {
+        if (m_Slots[m_Heap[pos]].m_Id == id)
+        {
+            slot = m_Heap[pos];
+            RemoveAt(pos);
+            m_Slots[slot].m_Id = 0;
+
+            // A running alarm is freed by OnTimer() once it returns.
+            free = slot != m_Firing;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_Mux);
+
+    if (slot == NO_SLOT)
+    {
+        return false;
+    }
+    Arm();
+    if (free)
+    {
+        Free(slot);
+    }
+    return true;
+} // End Cancel().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetNext()
+//
+// Returns the UTC time of the next alarm.
+//
+// Arguments:
+//   pUtc - Pointer to where the time is returned.
+//
+// Returns:
+//   Returns true if an alarm is pending, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool AlarmScheduler::GetNext(time_t *pUtc) const
+{
+    bool pending = false;
+    portENTER_CRITICAL(&m_Mux);
+    if (m_Count != 0)
+    {
+        *pUtc = (time_t)TimeMath::FloorDiv(m_Slots[m_Heap[0]].m_DueUs, USECS_PER_SEC);
+        pending = true;
+    }
+    portEXIT_CRITICAL(&m_Mux);
+    return pending;
+} // End GetNext().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Recompute()
+//
+// Recomputes the deadlines of the daily alarms.  Must be called after the
+// timezone changes.  The deadlines are worked out outside of the critical
+// section, and only stored for alarms that weren't cancelled meanwhile.
+//
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::Recompute()
+{
+    // Note the daily alarms.
+    size_t  slots[MAX_ALARMS];
+    int32_t ids[MAX_ALARMS];
+    int32_t daySecs[MAX_ALARMS];
+    int64_t dueUs[MAX_ALARMS];
+    size_t  count = 0;
+    portENTER_CRITICAL(&m_Mux);
+    for (size_t pos = 0; pos < m_Count; pos++)
+    {
+        const Slot &rSlot = m_Slots[m_Heap[pos]];
+        if (rSlot.m_DaySec >= 0)
+        {
+            slots[count]     = m_Heap[pos];
+            ids[count]       = rSlot.m_Id;
+            daySecs[count++] = rSlot.m_DaySec;
+        }
+    }
+    portEXIT_CRITICAL(&m_Mux);
+
+    int64_t nowUs = m_rClock.GetUtcMicros();
+    for (size_t i = 0; i < count; i++)
+    {
+        dueUs[i] = NextDailyUs(nowUs, daySecs[i]);
+    }
+
+    // Store them, and restore the heap order.
+    portENTER_CRITICAL(&m_Mux);
+    for (size_t i = 0; i < count; i++)
+    {
+        Slot &rSlot = m_Slots[slots[i]];
+        if (rSlot.m_Queued && (rSlot.m_Id == ids[i]))
+        {
+            rSlot.m_DueUs = dueUs[i];
+        }
+    }
+    for (size_t pos = m_Count / 2; pos-- > 0; )
+    {
+        SiftDown(pos);
+    }
+    m_HeapGen++;
+    portEXIT_CRITICAL(&m_Mux);
+
+    Arm();
+} // End Recompute().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Rearm()
+//
+// Rearms the timer for the earliest deadline.  Must be called after the
+// clock is corrected.
+//
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::Rearm()
+{
+    Arm();
+} // End Rearm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Add()
+//
+// Reserves a slot for an alarm and queues it.  The function is moved into
+// the slot, and a daily deadline worked out, outside of the critical
+// section, since the first may allocate and the second takes a while.
+//
+// Arguments:
+//   dueUs  - The UTC deadline in microseconds, for one shot alarms.
+//   daySec - The local time for daily alarms, or -1.
+//   rFunc  - The function to run.  It is moved from.
+//
+// Returns:
+//   Returns the alarm's ID (greater than 0), or 0 if there is no room.
+//
+/////////////////////////////////////////////////////////////////////////////
+int32_t AlarmScheduler::Add(int64_t dueUs, int32_t daySec, AlarmFunc_t &rFunc)
+{
+    if ((m_Timer == NULL) || !rFunc)
+    {
+        return 0;
+    }
+
+    // Reserve a slot.
+    size_t slot = NO_SLOT;
+    portENTER_CRITICAL(&m_Mux);
+    for (size_t i = 0; i < MAX_ALARMS; i++)
+    {
+        if (!m_Slots[i].m_InUse)
+        {
+            slot = i;
+            m_Slots[i].m_InUse = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&m_Mux);
+    if (slot == NO_SLOT)
+    {
+        return 0;
+    }
+
+    Slot &rSlot = m_Slots[slot];
+    rSlot.m_Func   = std::move(rFunc);
+    rSlot.m_DaySec = daySec;
+    if (daySec >= 0)
+    {
+        dueUs = NextDailyUs(m_rClock.GetUtcMicros(), daySec);
+    }
+
+    // Queue it.
+    portENTER_CRITICAL(&m_Mux);
+    int32_t id = m_NextId;
+    m_NextId = m_NextId == INT32_MAX ? 1 : m_NextId + 1;
+    rSlot.m_Id    = id;
+    rSlot.m_DueUs = dueUs;
+    Push(slot);
+    portEXIT_CRITICAL(&m_Mux);
+
+    Arm();
+    return id;
+} // End Add().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Free()
+//
+// Frees a slot that is no longer queued.  Called outside of the critical
+// section, since destroying the function may free memory.
+//
+// Arguments:
+//   slot - The slot to free.
+//
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::Free(size_t slot)
+{
+    m_Slots[slot].m_Func = nullptr;
+    portENTER_CRITICAL(&m_Mux);
+    m_Slots[slot].m_InUse = false;
+    portEXIT_CRITICAL(&m_Mux);
+} // End Free().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// NextDailyUs()
+//
+// Returns the first UTC deadline after nowUs at which the local time is
+// daySec seconds after midnight.  A local time skipped by the start of DST
+// maps to the start of DST, and a local time repeated by the end of DST maps
+// to its first occurrence.
+//
+// Arguments:
+//   nowUs  - The current UTC time in microseconds.
+//   daySec - The local time, in seconds after midnight.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t AlarmScheduler::NextDailyUs(int64_t nowUs, int32_t daySec) const
+{
+    Rcu<Zone>::ReadGuard zone(m_rZone);
+    const DstTable &rTable = zone->GetTable();
+    int64_t now   = TimeMath::FloorDiv(nowUs, USECS_PER_SEC);
+    int64_t today = TimeMath::FloorDiv(now + 60 * rTable.GetOffset(now), SECS_PER_DAY);
+
+    for (int64_t day = today; day <= today + 2; day++)
+    {
+        int64_t utc = rTable.LocalToUtc(day * SECS_PER_DAY + daySec);
+        if (utc > now)
+        {
+            return utc * USECS_PER_SEC;
+        }
+    }
+
+    // Not reached, but be safe.
+    return (now + SECS_PER_DAY) * USECS_PER_SEC;
+} // End NextDailyUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Push()
+//
+// Adds a slot to the heap.
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::Push(size_t slot)
+{
+    m_Heap[m_Count] = (uint8_t)slot;
+    m_Slots[slot].m_Queued = true;
+    SiftUp(m_Count++);
+    m_HeapGen++;
+} // End Push().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// RemoveAt()
+//
+// Removes the slot at the specified heap position.
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::RemoveAt(size_t pos)
+{
+    m_Slots[m_Heap[pos]].m_Queued = false;
+    m_HeapGen++;
+    if (pos != --m_Count)
+    {
+        m_Heap[pos] = m_Heap[m_Count];
+        SiftDown(pos);
+        SiftUp(pos);
+    }
+} // End RemoveAt().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SiftUp()
+//
+// Moves the slot at the specified heap position up into place.
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::SiftUp(size_t pos)
+{
+    while ((pos > 0) && Before(pos, (pos - 1) / 2))
+    {
+        Swap(pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+} // End SiftUp().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SiftDown()
+//
+// Moves the slot at the specified heap position down into place.
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::SiftDown(size_t pos)
+{
+    for (;;)
+    {
+        size_t least = pos;
+        size_t left  = 2 * pos + 1;
+        size_t right = left + 1;
+        if ((left < m_Count) && Before(left, least))
+        {
+            least = left;
+        }
+        if ((right < m_Count) && Before(right, least))
+        {
+            least = right;
+        }
+        if (least == pos)
+        {
+            return;
+        }
+        Swap(pos, least);
+        pos = least;
+    }
+} // End SiftDown().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Arm()
+//
+// Arms the timer for the earliest deadline, or stops it if there are no
+// alarms.  Called outside of the critical section.  If the heap changed
+// while the timer was being set, the timer may have been set for a stale
+// deadline, so it is set again.
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::Arm()
+{
+    if (m_Timer == NULL)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        portENTER_CRITICAL(&m_Mux);
+        uint32_t gen   = m_HeapGen;
+        bool     any   = m_Count != 0;
+        int64_t  dueUs = any ? m_Slots[m_Heap[0]].m_DueUs : 0;
+        portEXIT_CRITICAL(&m_Mux);
+
+        esp_timer_stop(m_Timer);
+        if (any)
+        {
+            int64_t waitUs = dueUs - m_rClock.GetUtcMicros();
+            waitUs = waitUs < 1 ? 1 : waitUs > MAX_WAIT_US ? MAX_WAIT_US : waitUs;
+            esp_timer_start_once(m_Timer, (uint64_t)waitUs);
+        }
+
+        portENTER_CRITICAL(&m_Mux);
+        bool same = gen == m_HeapGen;
+        portEXIT_CRITICAL(&m_Mux);
+        if (same)
+        {
+            return;
+        }
+    }
+} // End Arm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// OnTimer()
+//
+// The timer callback.  Runs every alarm that is due, then rearms the timer
+// for the next one.  The timer may fire a little early if the clock was
+// slewed in the meantime, in which case it is simply rearmed.  A daily
+// alarm's next deadline is worked out outside of the critical section, and
+// if the earliest alarm changed meanwhile, the step is simply retried.
+//
+// Arguments:
+//   pArg - Pointer to the AlarmScheduler.
+//
+/////////////////////////////////////////////////////////////////////////////
+void AlarmScheduler::OnTimer(void *pArg)
+{
+    AlarmScheduler *pAs = static_cast<AlarmScheduler *>(pArg);
+
+    for (;;)
+    {
+        // Find the earliest alarm, if it is due.
+        int64_t nowUs = pAs->m_rClock.GetUtcMicros();
+        portENTER_CRITICAL(&pAs->m_Mux);
+        if ((pAs->m_Count == 0) || (pAs->m_Slots[pAs->m_Heap[0]].m_DueUs > nowUs))
+        {
+            portEXIT_CRITICAL(&pAs->m_Mux);
+            pAs->Arm();
+            return;
+        }
+        uint32_t gen    = pAs->m_HeapGen;
+        size_t   slot   = pAs->m_Heap[0];
+        Slot    &rSlot  = pAs->m_Slots[slot];
+        int32_t  daySec = rSlot.m_DaySec;
+        portEXIT_CRITICAL(&pAs->m_Mux);
+
+        int64_t nextUs = daySec >= 0 ? pAs->NextDailyUs(nowUs, daySec) : 0;
+
+        // Requeue a daily alarm for tomorrow before running it, so that it
+        // may cancel itself.
+        portENTER_CRITICAL(&pAs->m_Mux);
+        if (gen != pAs->m_HeapGen)
+        {
+            portEXIT_CRITICAL(&pAs->m_Mux);
+            continue;
+        }
+        int32_t id  = rSlot.m_Id;
+        bool    run = true;
+        if (daySec >= 0)
+        {
+            run = nowUs - rSlot.m_DueUs <= LATE_LIMIT_SEC * USECS_PER_SEC;
+            rSlot.m_DueUs = nextUs;
+            pAs->SiftDown(0);
+            pAs->m_HeapGen++;
+        }
+        else
+        {
+            pAs->RemoveAt(0);
+        }
+        pAs->m_Firing = slot;
+        portEXIT_CRITICAL(&pAs->m_Mux);
+
+        if (run)
+        {
+            rSlot.m_Func(id);
+        }
+
+        // Free the slot if it is done with, or was cancelled while running.
+        portENTER_CRITICAL(&pAs->m_Mux);
+        pAs->m_Firing = NO_SLOT;
+        bool done = !rSlot.m_Queued;
+        portEXIT_CRITICAL(&pAs->m_Mux);
+        if (done)
+        {
+            pAs->Free(slot);
+        }
+    }
+} // End OnTimer().
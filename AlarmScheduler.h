@@ -0,0 +1,216 @@
+/////////////////////////////////////////////////////////////////////////////////
+// AlarmScheduler.h
+//
+// This file implements the AlarmScheduler class.  An AlarmScheduler calls
+// user functions at given UTC times, or every day at a given local time,
+// without any polling.  The pending alarms are kept in a min-heap ordered by
+// their UTC deadlines, and a single one shot esp_timer is armed for the
+// earliest one.  Between alarms, nothing runs.
+//
+// Daily alarms are converted to UTC deadlines with the current Zone, so a 06:30
+// alarm fires at 06:30 local time on both sides of a DST change.  On the day
+// DST starts, a local time that doesn't exist (e.g. 02:30 in the US) fires
+// when DST starts instead.  On the day DST ends, a local time that happens
+// twice fires the first time only.  Recompute() must be called whenever the
+// timezone changes, and Rearm() whenever the clock is corrected, since the
+// esp_timer counts in time since boot rather than UTC.
+//
+// Alarms run from the esp_timer task, so they should be short and must not
+// block.  Longer work should be handed off to another task (e.g. with a
+// queue or task notification).  An alarm may add or cancel alarms, including
+// itself.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined ALARMSCHEDULER_H
+#define ALARMSCHEDULER_H
+
+#include <functional>           // For std::function.
+#include <esp_timer.h>          // For esp_timer.
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include "PrecisionClock.h"     // For UTC time.
+#include "Zone.h"               // For local time offsets.
+#include "Rcu.h"                // For the published zone.
+
+
+class AlarmScheduler
+{
+public:
+    // The most alarms that may be pending at once.
+    static const size_t MAX_ALARMS = 16;
+
+    // Daily alarms that are missed by more than this, in seconds (e.g.
+    // because the clock was stepped forward), are skipped rather than run
+    // late.
+    static const int32_t LATE_LIMIT_SEC = 60;
+
+    // The longest the timer is armed for, in microseconds.  Bounds the error
+    // from clock corrections that Rearm() wasn't told about.
+    static const int64_t MAX_WAIT_US = 3600LL * 1000000;
+
+    // The function called for an alarm.  It is passed the alarm's ID.
+    typedef std::function<void(int32_t id)> AlarmFunc_t;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rClock - The clock that gives UTC time.
+    //   rZone  - The published zone that gives local time offsets.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    AlarmScheduler(const PrecisionClock &rClock, const Rcu<Zone> &rZone);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AddAt()
+    //
+    // Adds an alarm that runs once at the specified UTC time.  A time that
+    // has already passed runs right away.
+    //
+    // Arguments:
+    //   utc   - The UTC time at which to run.
+    //   func  - The function to run.
+    //
+    // Returns:
+    //   Returns the alarm's ID (greater than 0), or 0 if there is no room.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t AddAt(time_t utc, AlarmFunc_t func);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AddDaily()
+    //
+    // Adds an alarm that runs every day at the specified local time, until it
+    // is cancelled.
+    //
+    // Arguments:
+    //   daySec - The local time, in seconds after midnight (0 - 86399).
+    //   func   - The function to run.
+    //
+    // Returns:
+    //   Returns the alarm's ID (greater than 0), or 0 if there is no room or
+    //   daySec is out of range.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t AddDaily(int32_t daySec, AlarmFunc_t func);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Cancel()
+    //
+    // Cancels an alarm.  If the alarm is running, it finishes, but a daily
+    // alarm does not run again.
+    //
+    // Arguments:
+    //   id - The alarm's ID.
+    //
+    // Returns:
+    //   Returns true if the alarm was pending, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Cancel(int32_t id);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetNext()
+    //
+    // Returns the UTC time of the next alarm.
+    //
+    // Arguments:
+    //   pUtc - Pointer to where the time is returned.
+    //
+    // Returns:
+    //   Returns true if an alarm is pending, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetNext(time_t *pUtc) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Recompute()
+    //
+    // Recomputes the deadlines of the daily alarms.  Must be called after the
+    // timezone changes.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Recompute();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Rearm()
+    //
+    // Rearms the timer for the earliest deadline.  Must be called after the
+    // clock is corrected.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Rearm();
+
+
+private:
+    // Unimplemented methods.  Copying a scheduler makes no sense.
+    AlarmScheduler(const AlarmScheduler &rAs);
+    AlarmScheduler &operator=(const AlarmScheduler &rAs);
+
+    // One alarm.  Slots stay put, and the heap orders their indices, so that
+    // the functions are never copied.
+    struct Slot
+    {
+        AlarmFunc_t m_Func;     // The function to run.
+        int64_t     m_DueUs;    // UTC deadline in microseconds.
+        int32_t     m_Id;       // ID, or 0 if cancelled.
+        int32_t     m_DaySec;   // Local time for daily alarms, or -1.
+        bool        m_InUse;    // true if the slot is taken.
+        bool        m_Queued;   // true if the slot is in the heap.
+    };
+
+    static const int64_t USECS_PER_SEC = 1000000;
+    static const int64_t SECS_PER_DAY  = 86400;
+    static const size_t  NO_SLOT       = MAX_ALARMS;
+
+    // Reserves a slot and queues it.
+    int32_t Add(int64_t dueUs, int32_t daySec, AlarmFunc_t &rFunc);
+
+    // Frees a slot.  Called outside of the critical section.
+    void Free(size_t slot);
+
+    // Returns the next UTC deadline, in microseconds, of a daily alarm.
+    int64_t NextDailyUs(int64_t nowUs, int32_t daySec) const;
+
+    // Heap operations.  Called in the critical section.  Push() and
+    // RemoveAt() bump m_HeapGen.
+    void Push(size_t slot);
+    void RemoveAt(size_t pos);
+    void SiftUp(size_t pos);
+    void SiftDown(size_t pos);
+    bool Before(size_t posA, size_t posB) const
+        { return m_Slots[m_Heap[posA]].m_DueUs < m_Slots[m_Heap[posB]].m_DueUs; }
+    void Swap(size_t posA, size_t posB)
+        { uint8_t t = m_Heap[posA]; m_Heap[posA] = m_Heap[posB]; m_Heap[posB] = t; }
+
+    // Arms the timer for the earliest deadline.  Called outside of the
+    // critical section.
+    void Arm();
+
+    // The timer callback.
+    static void OnTimer(void *pArg);
+
+    const PrecisionClock &m_rClock;     // Gives UTC time.
+    const Rcu<Zone>     &m_rZone;       // Gives local time offsets.
+    Slot          m_Slots[MAX_ALARMS];  // The alarms.
+    uint8_t       m_Heap[MAX_ALARMS];   // Queued slots, earliest first.
+    size_t        m_Count;              // Number of queued slots.
+    size_t        m_Firing;             // Slot being run, or NO_SLOT.
+    int32_t       m_NextId;             // ID of the next alarm added.
+    uint32_t      m_HeapGen;            // Bumped whenever the heap changes.
+    esp_timer_handle_t m_Timer;         // Fires at the earliest deadline.
+    mutable portMUX_TYPE m_Mux;         // Guards all of the above.
+
+}; // End class AlarmScheduler.
+
+
+#endif // ALARMSCHEDULER_H
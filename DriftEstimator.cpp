@@ -0,0 +1,204 @@
+/////////////////////////////////////////////////////////////////////////////////
+// DriftEstimator.cpp
+//
+// This file implements the DriftEstimator class.  See DriftEstimator.h for
+// details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "DriftEstimator.h"     // For DriftEstimator class.
+#include <math.h>               // For sqrtf() and fabsf().
+
+
+// Enough to follow the few ppm that a crystal moves over a day's temperature
+// swing.
+const float DriftEstimator::PROCESS_NOISE_PPM2_PER_HOUR = 0.1f;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+/////////////////////////////////////////////////////////////////////////////
+DriftEstimator::DriftEstimator() : m_HaveRef(false), m_RefUtcUs(0), m_RefMonoUs(0),
+                                   m_RefErrUs(0), m_LastMonoUs(0), m_LastErrUs(0),
+                                   m_DriftPpm(0.0f),
+                                   m_VarPpm2((float)INITIAL_UNCERTAINTY_PPM *
+                                             INITIAL_UNCERTAINTY_PPM),
+                                   m_Samples(0), m_ErrorKnown(false)
+{
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// AddSample()
+//
+// Adds a sync sample.
+//
+// Arguments:
+//   utcUs  - The UTC time, in microseconds, received from the time source.
+//   monoUs - The esp_timer time, in microseconds, at which utcUs was true.
+//   errUs  - The expected error of utcUs, in microseconds (e.g. the NTP
+//            synchronization distance).
+//
+/////////////////////////////////////////////////////////////////////////////
+void DriftEstimator::AddSample(int64_t utcUs, int64_t monoUs, uint32_t errUs)
+{
+    // The clock was just corrected, so its error starts over.
+    m_LastMonoUs = monoUs;
+    m_LastErrUs  = errUs;
+    m_ErrorKnown = true;
+
+    int64_t elapsedUs = monoUs - m_RefMonoUs;
+    if (m_HaveRef && (elapsedUs < (int64_t)MIN_BASELINE_SEC * 1000000))
+    {
+        return;
+    }
+
+    if (m_HaveRef)
+    {
+        // The drift seen over the baseline, and its variance.  Note that
+        // microseconds per second are ppm.  The difference is taken in
+        // integers, since a float can't hold microseconds over hours.
+        float elapsedSec = (float)elapsedUs / 1000000.0f;
+        float utcSec     = (float)(utcUs - m_RefUtcUs) / 1000000.0f;
+        float measPpm    = (float)(elapsedUs - (utcUs - m_RefUtcUs)) / utcSec;
+        float measErrPpm = (float)(m_RefErrUs + errUs) / elapsedSec;
+        float measVar    = measErrPpm * measErrPpm;
+
+        // Skip nonsense, such as a time source that jumped.
+        if ((utcSec > 0.0f) && (fabsf(measPpm) < 1000.0f))
+        {
+            // Kalman update.
+            m_VarPpm2 += PROCESS_NOISE_PPM2_PER_HOUR * elapsedSec / 3600.0f;
+            float gain = m_VarPpm2 / (m_VarPpm2 + measVar);
+            m_DriftPpm += gain * (measPpm - m_DriftPpm);
+            m_VarPpm2  *= 1.0f - gain;
+            m_Samples++;
+        }
+    }
+
+    m_HaveRef   = true;
+    m_RefUtcUs  = utcUs;
+    m_RefMonoUs = monoUs;
+    m_RefErrUs  = errUs;
+} // End AddSample().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUncertaintyPpm()
+//
+// Returns the uncertainty (one standard deviation), in parts per million,
+// of the drift estimate.
+/////////////////////////////////////////////////////////////////////////////
+float DriftEstimator::GetUncertaintyPpm() const
+{
+    return sqrtf(m_VarPpm2);
+} // End GetUncertaintyPpm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetExpectedErrorUs()
+//
+// Returns the expected error, in microseconds, of the local clock at the
+// specified esp_timer time if it is not corrected for drift.  This is the
+// error of the last sync plus the drift (and its uncertainty) times the
+// time since the last sync.
+//
+// Arguments:
+//   monoUs - The esp_timer time of interest.
+//
+/////////////////////////////////////////////////////////////////////////////
+uint32_t DriftEstimator::GetExpectedErrorUs(int64_t monoUs) const
+{
+    float sinceSec = (float)(monoUs - m_LastMonoUs) / 1000000.0f;
+    float errUs = (float)m_LastErrUs + GetWorstPpm() * (sinceSec > 0.0f ? sinceSec : 0.0f);
+    return errUs < 4.0e9f ? (uint32_t)errUs : UINT32_MAX;
+} // End GetExpectedErrorUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetIntervalSec()
+//
+// Returns the time, in seconds, that the local clock takes to reach the
+// specified error after a sync.
+//
+// Arguments:
+//   targetUs - The error bound, in microseconds, to be held.
+//   minSec   - The shortest interval that may be returned.
+//   maxSec   - The longest interval that may be returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+uint32_t DriftEstimator::GetIntervalSec(uint32_t targetUs, uint32_t minSec,
+                                        uint32_t maxSec) const
+{
+    if (targetUs <= m_LastErrUs)
+    {
+        return minSec;
+    }
+    float sec = (float)(targetUs - m_LastErrUs) / GetWorstPpm();
+    return sec <= (float)minSec ? minSec :
+           sec >= (float)maxSec ? maxSec : (uint32_t)sec;
+} // End GetIntervalSec().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetState()
+//
+// Returns the drift estimate so that it may be kept across a deep sleep.
+//
+// Arguments:
+//   pState - Pointer to where the state is returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+void DriftEstimator::GetState(State *pState) const
+{
+    pState->m_DriftPpm = m_DriftPpm;
+    pState->m_VarPpm2  = m_VarPpm2;
+    pState->m_Samples  = m_Samples;
+} // End GetState().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Restore()
+//
+// Restores a drift estimate saved by GetState() before a deep sleep.  The
+// esp_timer starts over after a deep sleep, so the reference sample is
+// dropped, and the next sample becomes the new reference.
+//
+// Arguments:
+//   rState - The saved state.
+//   monoUs - The esp_timer time at which errUs is true.
+//   errUs  - The expected error of the clock at monoUs (e.g. the error
+//            when the sleep started plus the error from the sleep).
+//
+/////////////////////////////////////////////////////////////////////////////
+void DriftEstimator::Restore(const State &rState, int64_t monoUs, uint32_t errUs)
+{
+    m_HaveRef    = false;
+    m_LastMonoUs = monoUs;
+    m_LastErrUs  = errUs;
+    m_ErrorKnown = true;
+
+    // Skip nonsense rather than let it stretch the poll interval.
+    if ((rState.m_VarPpm2 > 0.0f) && (fabsf(rState.m_DriftPpm) < 1000.0f))
+    {
+        m_DriftPpm = rState.m_DriftPpm;
+        m_VarPpm2  = rState.m_VarPpm2;
+        m_Samples  = rState.m_Samples;
+    }
+} // End Restore().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetWorstPpm()
+//
+// Returns the worst drift rate, in ppm, that we expect to see.  This is the
+// drift estimate plus one standard deviation, with a small floor so that a
+// lucky estimate near zero doesn't stretch the interval forever.
+/////////////////////////////////////////////////////////////////////////////
+float DriftEstimator::GetWorstPpm() const
+{
+    float ppm = fabsf(m_DriftPpm) + GetUncertaintyPpm();
+    return ppm > 0.1f ? ppm : 0.1f;
+} // End GetWorstPpm().
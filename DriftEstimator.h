@@ -0,0 +1,193 @@
+/////////////////////////////////////////////////////////////////////////////////
+// DriftEstimator.h
+//
+// This file implements the DriftEstimator class.  A DriftEstimator estimates
+// how fast or slow the local oscillator (the ESP32 esp_timer) runs, from the
+// UTC times of successive NTP syncs and the esp_timer times at which they
+// arrived.  From that, it can predict how far the local clock will have
+// wandered by a given time since the last sync, and how long the next NTP
+// poll may be put off while holding a target error bound.
+//
+// The drift and its uncertainty are tracked with a one state Kalman filter.
+// Each sample pair measures the drift with an uncertainty of the two syncs'
+// errors divided by the time between them, so short baselines count for
+// little, and long ones for a lot.  A small amount of process noise lets the
+// estimate follow temperature changes.
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined DRIFTESTIMATOR_H
+#define DRIFTESTIMATOR_H
+
+#include <stdint.h>             // For integer types.
+
+
+class DriftEstimator
+{
+public:
+    // The drift uncertainty, in ppm, before any samples have been taken.
+    // Typical of an uncalibrated ESP32 crystal.
+    static const int32_t INITIAL_UNCERTAINTY_PPM = 50;
+
+    // Samples closer together than this, in seconds, are too noisy to use.
+    // The earlier sample is kept as the reference for the next one.
+    static const int32_t MIN_BASELINE_SEC = 60;
+
+    // The part of the estimate that outlives a deep sleep.  See GetState()
+    // and Restore().
+    struct State
+    {
+        float    m_DriftPpm;    // Drift estimate.
+        float    m_VarPpm2;     // Variance of the drift estimate.
+        uint32_t m_Samples;     // Number of samples used.
+    };
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    /////////////////////////////////////////////////////////////////////////////
+    DriftEstimator();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AddSample()
+    //
+    // Adds a sync sample.
+    //
+    // Arguments:
+    //   utcUs  - The UTC time, in microseconds, received from the time source.
+    //   monoUs - The esp_timer time, in microseconds, at which utcUs was true.
+    //   errUs  - The expected error of utcUs, in microseconds (e.g. the NTP
+    //            synchronization distance).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void AddSample(int64_t utcUs, int64_t monoUs, uint32_t errUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetDriftPpm()
+    //
+    // Returns the estimated drift in parts per million.  Positive values mean
+    // that the local oscillator runs fast.
+    /////////////////////////////////////////////////////////////////////////////
+    float GetDriftPpm() const { return m_DriftPpm; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUncertaintyPpm()
+    //
+    // Returns the uncertainty (one standard deviation), in parts per million,
+    // of the drift estimate.
+    /////////////////////////////////////////////////////////////////////////////
+    float GetUncertaintyPpm() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetWorstPpm()
+    //
+    // Returns the worst drift rate, in ppm, that we expect to see.  This is the
+    // drift estimate plus one standard deviation, with a small floor.
+    /////////////////////////////////////////////////////////////////////////////
+    float GetWorstPpm() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetExpectedErrorUs()
+    //
+    // Returns the expected error, in microseconds, of the local clock at the
+    // specified esp_timer time if it is not corrected for drift.  This is the
+    // error of the last sync plus the drift (and its uncertainty) times the
+    // time since the last sync.
+    //
+    // Arguments:
+    //   monoUs - The esp_timer time of interest.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetExpectedErrorUs(int64_t monoUs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetIntervalSec()
+    //
+    // Returns the time, in seconds, that the local clock takes to reach the
+    // specified error after a sync.
+    //
+    // Arguments:
+    //   targetUs - The error bound, in microseconds, to be held.
+    //   minSec   - The shortest interval that may be returned.
+    //   maxSec   - The longest interval that may be returned.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetIntervalSec(uint32_t targetUs, uint32_t minSec, uint32_t maxSec) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetSampleCount()
+    //
+    // Returns the number of samples that have updated the estimate.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetSampleCount() const { return m_Samples; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsErrorKnown()
+    //
+    // Returns true once GetExpectedErrorUs() is based on a sync, either from
+    // AddSample() or Restore().
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsErrorKnown() const { return m_ErrorKnown; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetState()
+    //
+    // Returns the drift estimate so that it may be kept across a deep sleep.
+    //
+    // Arguments:
+    //   pState - Pointer to where the state is returned.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void GetState(State *pState) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Restore()
+    //
+    // Restores a drift estimate saved by GetState() before a deep sleep.  The
+    // esp_timer starts over after a deep sleep, so the reference sample is
+    // dropped, and the next sample becomes the new reference.
+    //
+    // Arguments:
+    //   rState - The saved state.
+    //   monoUs - The esp_timer time at which errUs is true.
+    //   errUs  - The expected error of the clock at monoUs (e.g. the error
+    //            when the sleep started plus the error from the sleep).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Restore(const State &rState, int64_t monoUs, uint32_t errUs);
+
+
+private:
+    // Process noise, in ppm squared per hour.
+    static const float PROCESS_NOISE_PPM2_PER_HOUR;
+
+
+    bool     m_HaveRef;       // true once a reference sample is held.
+    int64_t  m_RefUtcUs;      // UTC time of the reference sample.
+    int64_t  m_RefMonoUs;     // esp_timer time of the reference sample.
+    uint32_t m_RefErrUs;      // Error of the reference sample.
+    int64_t  m_LastMonoUs;    // esp_timer time of the latest sample.
+    uint32_t m_LastErrUs;     // Error of the latest sample.
+    float    m_DriftPpm;      // Drift estimate.
+    float    m_VarPpm2;       // Variance of the drift estimate.
+    uint32_t m_Samples;       // Number of samples used.
+    bool     m_ErrorKnown;    // true once m_LastErrUs is based on a sync.
+
+}; // End class DriftEstimator.
+
+
+#endif // DRIFTESTIMATOR_H
@@ -0,0 +1,291 @@
+/////////////////////////////////////////////////////////////////////////////////
+// DstTable.cpp
+//
+// This file implements the DstTable class.  See DstTable.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "DstTable.h"           // For DstTable class.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Build()
+//
+// Computes the transitions for NUM_YEARS years starting with firstYear.
+//
+// Arguments:
+//   stdOfst   - Standard time offset from UTC in minutes.
+//   useDst    - true if DST is observed.
+//   dstOfst   - DST offset from UTC in minutes (e.g. stdOfst + 60).
+//   rStart    - Rule for starting DST, in standard local time.
+//   rEnd      - Rule for ending DST, in DST local time.
+//   firstYear - First year (e.g. 2023) to hold in the table.
+//
+/////////////////////////////////////////////////////////////////////////////
+void DstTable::Build(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                     const DstRule &rStart, const DstRule &rEnd, int32_t firstYear)
+{
+    m_StdOfst   = stdOfst;
+    m_DstOfst   = dstOfst;
+    m_UseDst    = useDst;
+    m_StartRule = rStart;
+    m_EndRule   = rEnd;
+    m_pExtTransitions = NULL;
+    m_Count     = 0;
+
+    // Without DST there is nothing more to do.  The standard offset is always
+    // in effect.
+    if (!m_UseDst)
+    {
+        return;
+    }
+
+    // Each year's transitions come out in time order, and every transition of
+    // a year precedes those of the next year, so the table ends up sorted.
+    for (int32_t year = firstYear; year < firstYear + NUM_YEARS; year++)
+    {
+        m_Count += BuildYear(year, &m_Transitions[m_Count]);
+    }
+} // End Build().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Attach()
+//
+// Same as Build(), except that the transitions have already been computed
+// (e.g. at compile time by FixedZone) and are used in place rather than
+// copied.
+//
+// Arguments:
+//   stdOfst      - Standard time offset from UTC in minutes.
+//   useDst       - true if DST is observed.
+//   dstOfst      - DST offset from UTC in minutes (e.g. stdOfst + 60).
+//   rStart       - Rule for starting DST, in standard local time.
+//   rEnd         - Rule for ending DST, in DST local time.
+//   pTransitions - Pointer to the transitions, in time order.  Must remain
+//                  valid for as long as the table is used.
+//   count        - The number of transitions pointed to by pTransitions.
+//
+/////////////////////////////////////////////////////////////////////////////
+void DstTable::Attach(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                      const DstRule &rStart, const DstRule &rEnd,
+                      const DstTransition *pTransitions, size_t count)
+{
+    m_StdOfst   = stdOfst;
+    m_DstOfst   = dstOfst;
+    m_UseDst    = useDst;
+    m_StartRule = rStart;
+    m_EndRule   = rEnd;
+    m_pExtTransitions = pTransitions;
+    m_Count     = useDst ? count : 0;
+} // End Attach().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetOffset()
+//
+// Returns the offset from UTC, in minutes, in effect at the specified time.
+//
+// Arguments:
+//   utc    - The UTC time of interest.
+//   pIsDst - If not NULL, receives true if DST is in effect at utc.
+//
+/////////////////////////////////////////////////////////////////////////////
+int32_t DstTable::GetOffset(int64_t utc, bool *pIsDst) const
+{
+    const DstTransition *pTable = Table();
+    size_t count = m_Count;
+    DstTransition local[6];
+
+    // If the time is not bracketed by the table, then evaluate the rules for
+    // the surrounding years instead.
+    if (m_UseDst && ((count == 0) || (utc < pTable[0].m_Utc) ||
+                     (utc >= pTable[count - 1].m_Utc)))
+    {
+        int32_t year = TimeMath::YearOf(utc + (int64_t)m_StdOfst * TimeMath::SECS_PER_MIN);
+        count = 0;
+        for (int32_t y = year - 1; y <= year + 1; y++)
+        {
+            count += BuildYear(y, &local[count]);
+        }
+        pTable = local;
+    }
+
+    int32_t index = Search(pTable, count, utc);
+    bool isDst = (index >= 0) && pTable[index].m_IsDst;
+    if (pIsDst != NULL)
+    {
+        *pIsDst = isDst;
+    }
+    return (index >= 0) ? pTable[index].m_Ofst : m_StdOfst;
+} // End GetOffset().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetNextTransition()
+//
+// Returns the first transition that takes effect after the specified time.
+//
+// Arguments:
+//   utc   - The UTC time of interest.
+//   pNext - Pointer to where the transition is returned.
+//
+// Returns:
+//   Returns true if a transition was found, or false if DST is not
+//   observed.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool DstTable::GetNextTransition(int64_t utc, DstTransition *pNext) const
+{
+    if (!m_UseDst)
+    {
+        return false;
+    }
+
+    // Use the table if it holds a later transition.
+    const DstTransition *pTable = Table();
+    if ((m_Count > 0) && (utc >= pTable[0].m_Utc) &&
+        (utc < pTable[m_Count - 1].m_Utc))
+    {
+        *pNext = pTable[Search(pTable, m_Count, utc) + 1];
+        return true;
+    }
+
+    // Otherwise, evaluate the rules for this year and the next.
+    DstTransition local[4];
+    int32_t year = TimeMath::YearOf(utc + (int64_t)m_StdOfst * TimeMath::SECS_PER_MIN);
+    size_t count = BuildYear(year, local);
+    count += BuildYear(year + 1, &local[count]);
+    size_t index = (size_t)(Search(local, count, utc) + 1);
+    if (index >= count)
+    {
+        return false;
+    }
+    *pNext = local[index];
+    return true;
+} // End GetNextTransition().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// LocalToUtc()
+//
+// Converts a local time to UTC.  A local time skipped by the start of DST
+// maps to the start of DST, and a local time repeated by the end of DST
+// maps to its first occurrence.
+//
+// Arguments:
+//   local - The local time, in seconds since January 1, 1970.
+//
+// Returns:
+//   Returns the UTC time in seconds since January 1, 1970.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t DstTable::LocalToUtc(int64_t local) const
+{
+    // Within a day either way there is at most one transition, so the offset
+    // at this local time is one of these two.
+    int32_t ofst[2] = { GetOffset(local - TimeMath::SECS_PER_DAY),
+                        GetOffset(local + TimeMath::SECS_PER_DAY) };
+    bool    valid = false;
+    int64_t best  = 0;
+    for (size_t i = 0; i < 2; i++)
+    {
+        int64_t utc = local - (int64_t)ofst[i] * TimeMath::SECS_PER_MIN;
+        if ((utc + (int64_t)GetOffset(utc) * TimeMath::SECS_PER_MIN == local) &&
+            (!valid || (utc < best)))
+        {
+            valid = true;
+            best  = utc;
+        }
+    }
+
+    // Neither works if the local time falls in the gap at the start of DST.
+    // Use the start of DST.
+    DstTransition next;
+    if (!valid)
+    {
+        int32_t hi = ofst[0] > ofst[1] ? ofst[0] : ofst[1];
+        best = GetNextTransition(local - (int64_t)hi * TimeMath::SECS_PER_MIN, &next) ?
+               next.m_Utc : local - (int64_t)ofst[0] * TimeMath::SECS_PER_MIN;
+    }
+    return best;
+} // End LocalToUtc().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// BuildYear()
+//
+// Fills in the transitions of the specified year in time order.  Note that
+// the DST start rule is expressed in standard time, and the end rule is
+// expressed in DST, just like POSIX TZ rules.
+//
+// Arguments:
+//   year - The year (e.g. 2023) of interest.
+//   pOut - Pointer to room for at least two transitions.
+//
+// Returns:
+//   Returns the number of transitions filled in.  Returns 0 if the start and
+//   end rules coincide, since DST is then never in effect.
+//
+/////////////////////////////////////////////////////////////////////////////
+size_t DstTable::BuildYear(int32_t year, DstTransition *pOut) const
+{
+    DstTransition start;
+    start.m_Utc   = TimeMath::RuleUtc(year, m_StartRule.month, m_StartRule.week,
+                                      m_StartRule.dow, m_StartRule.hour, m_StdOfst);
+    start.m_Ofst  = m_DstOfst;
+    start.m_IsDst = true;
+
+    DstTransition end;
+    end.m_Utc     = TimeMath::RuleUtc(year, m_EndRule.month, m_EndRule.week,
+                                      m_EndRule.dow, m_EndRule.hour, m_DstOfst);
+    end.m_Ofst    = m_StdOfst;
+    end.m_IsDst   = false;
+
+    if (start.m_Utc == end.m_Utc)
+    {
+        return 0;
+    }
+
+    // Northern hemisphere zones start DST first.  Southern hemisphere zones
+    // end it first.
+    pOut[0] = (start.m_Utc < end.m_Utc) ? start : end;
+    pOut[1] = (start.m_Utc < end.m_Utc) ? end : start;
+    return 2;
+} // End BuildYear().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Search()
+//
+// Binary search for the last transition at or before the specified time.
+//
+// Arguments:
+//   pTable - Pointer to the transitions, in time order.
+//   count  - The number of transitions pointed to by pTable.
+//   utc    - The UTC time of interest.
+//
+// Returns:
+//   Returns the index of the transition, or -1 if utc precedes them all.
+//
+/////////////////////////////////////////////////////////////////////////////
+int32_t DstTable::Search(const DstTransition *pTable, size_t count, int64_t utc)
+{
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pTable[mid].m_Utc <= utc)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return (int32_t)lo - 1;
+} // End Search().
@@ -0,0 +1,204 @@
+/////////////////////////////////////////////////////////////////////////////////
+// DstTable.h
+//
+// This file implements the DstTable class.  A DstTable holds the UTC instants
+// of the DST transitions of a set of POSIX style timezone rules for a range of
+// years.  The table is computed once whenever the rules change, after which
+// converting UTC to local time is just a binary search plus an add, and the
+// next transition can be looked up in order to schedule work around it.
+//
+// Times falling outside of the range of years held in the table are handled
+// by evaluating the rules directly, so results are always correct, just a bit
+// slower.
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined DSTTABLE_H
+#define DSTTABLE_H
+
+#include <stdint.h>             // For integer types.
+#include <stddef.h>             // For size_t.
+#include "TimeMath.h"           // For calendar calculations.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// DstRule structure
+//
+// The date and local time at which a DST transition occurs.  Same meaning as
+// the POSIX "Mm.w.d/h" rule format.
+/////////////////////////////////////////////////////////////////////////////////
+struct DstRule
+{
+    uint8_t month;        // 1=Jan, 2=Feb, ... 12=Dec
+    uint8_t week;         // 1 - 4, or 5 for the last week of the month.
+    uint8_t dow;          // day of week, 0 = Sun, 1 = Mon, ... 6 = Sat.
+    uint8_t hour;         // 0-23
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// DstTransition structure
+//
+// A single timezone transition.
+/////////////////////////////////////////////////////////////////////////////////
+struct DstTransition
+{
+    int64_t m_Utc;        // UTC time at which the transition takes effect.
+    int32_t m_Ofst;       // Offset from UTC, in minutes, from then on.
+    bool    m_IsDst;      // true if DST is in effect from then on.
+};
+
+
+class DstTable
+{
+public:
+    // The number of years held in the table.
+    static const int32_t NUM_YEARS = 12;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // The table starts out empty, which represents UTC with no DST.
+    /////////////////////////////////////////////////////////////////////////////
+    DstTable() : m_StdOfst(0), m_DstOfst(0), m_UseDst(false),
+                 m_StartRule(), m_EndRule(), m_pExtTransitions(NULL), m_Count(0) {}
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Build()
+    //
+    // Computes the transitions for NUM_YEARS years starting with firstYear.
+    //
+    // Arguments:
+    //   stdOfst   - Standard time offset from UTC in minutes.
+    //   useDst    - true if DST is observed.
+    //   dstOfst   - DST offset from UTC in minutes (e.g. stdOfst + 60).
+    //   rStart    - Rule for starting DST, in standard local time.
+    //   rEnd      - Rule for ending DST, in DST local time.
+    //   firstYear - First year (e.g. 2023) to hold in the table.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Build(int32_t stdOfst, bool useDst, int32_t dstOfst,
+               const DstRule &rStart, const DstRule &rEnd, int32_t firstYear);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Attach()
+    //
+    // Same as Build(), except that the transitions have already been computed
+    // (e.g. at compile time by FixedZone) and are used in place rather than
+    // copied.
+    //
+    // Arguments:
+    //   stdOfst      - Standard time offset from UTC in minutes.
+    //   useDst       - true if DST is observed.
+    //   dstOfst      - DST offset from UTC in minutes (e.g. stdOfst + 60).
+    //   rStart       - Rule for starting DST, in standard local time.
+    //   rEnd         - Rule for ending DST, in DST local time.
+    //   pTransitions - Pointer to the transitions, in time order.  Must remain
+    //                  valid for as long as the table is used.
+    //   count        - The number of transitions pointed to by pTransitions.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Attach(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                const DstRule &rStart, const DstRule &rEnd,
+                const DstTransition *pTransitions, size_t count);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetOffset()
+    //
+    // Returns the offset from UTC, in minutes, in effect at the specified time.
+    //
+    // Arguments:
+    //   utc    - The UTC time of interest.
+    //   pIsDst - If not NULL, receives true if DST is in effect at utc.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetOffset(int64_t utc, bool *pIsDst = NULL) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetNextTransition()
+    //
+    // Returns the first transition that takes effect after the specified time.
+    //
+    // Arguments:
+    //   utc   - The UTC time of interest.
+    //   pNext - Pointer to where the transition is returned.
+    //
+    // Returns:
+    //   Returns true if a transition was found, or false if DST is not
+    //   observed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetNextTransition(int64_t utc, DstTransition *pNext) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // LocalToUtc()
+    //
+    // Converts a local time to UTC.  A local time skipped by the start of DST
+    // maps to the start of DST, and a local time repeated by the end of DST
+    // maps to its first occurrence.
+    //
+    // Arguments:
+    //   local - The local time, in seconds since January 1, 1970.
+    //
+    // Returns:
+    //   Returns the UTC time in seconds since January 1, 1970.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t LocalToUtc(int64_t local) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetCount()
+    //
+    // Returns the number of transitions held in the table.
+    /////////////////////////////////////////////////////////////////////////////
+    size_t GetCount() const { return m_Count; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetStdOfst(), GetDstOfst()
+    //
+    // Return the standard time and DST offsets from UTC, in minutes.
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetStdOfst() const { return m_StdOfst; }
+    int32_t GetDstOfst() const { return m_DstOfst; }
+
+
+private:
+    // Maximum number of transitions.  Each year has one start and one end.
+    static const size_t MAX_TRANSITIONS = 2 * NUM_YEARS;
+
+    // Fill in the (up to two) transitions of a year in time order.
+    size_t BuildYear(int32_t year, DstTransition *pOut) const;
+
+    // Find the last transition at or before utc.
+    static int32_t Search(const DstTransition *pTable, size_t count, int64_t utc);
+
+    // Returns the transitions in use.
+    const DstTransition *Table() const
+        { return m_pExtTransitions != NULL ? m_pExtTransitions : m_Transitions; }
+
+    int32_t       m_StdOfst;               // Standard time offset in minutes.
+    int32_t       m_DstOfst;               // DST offset in minutes.
+    bool          m_UseDst;                // true if DST is observed.
+    DstRule       m_StartRule;             // Rule for starting DST.
+    DstRule       m_EndRule;               // Rule for ending DST.
+    const DstTransition *m_pExtTransitions;// Attached transitions, if any.
+    size_t        m_Count;                 // Number of transitions in the table.
+    DstTransition m_Transitions[MAX_TRANSITIONS];
+                                           // The transitions in time order.
+
+}; // End class DstTable.
+
+
+#endif // DSTTABLE_H
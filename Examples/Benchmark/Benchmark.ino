@@ -0,0 +1,373 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Benchmark.ino
+//
+// This file measures and checks the time conversion path of the WiFiTimeManager
+// library ( https://github.com/regnaDkciN/WiFiTimeManager ).  No network
+// connection is needed.  It does the following:
+//   1. Initialize the WiFiTimeManager and set the Cleveland, Ohio timezone
+//      (without saving it to NVS).
+//   2. Time many calls to each of the conversion methods, and print the
+//      number of calls per second, the time per call, and the number of heap
+//      blocks left allocated per call.
+//   3. Sweep the DST transitions of the next 100 years, checking that each one
+//      changes the offset and DST flag as expected.
+//   4. Sweep every hour of the years 2023 through 2037, comparing UtcToLocal()
+//      against the C library's localtime_r(), which uses the TZ string that
+//      WiFiTimeManager sets.
+//   5. Sweep every day of the same years, comparing GetDateTimeString(),
+//      which uses a TimeFormat, against the strftime() call that it replaced.
+//
+// The sweeps take simulated time straight from the loops rather than the
+// clock, so years of transitions are covered in milliseconds, unlike the
+// DstTest example which watches them happen in real time.  Run this before
+// and after a change to see its effect.
+//
+// This is the on-device companion of the host harness in Tools/HostTest,
+// which runs the same checks (and the Setup page decode) on a desktop computer
+// with "make -C Tools/HostTest test".  Only this sketch gives real timings.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+/////////////////////////////////////////////////////////////////////////////////
+
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+#include <esp_heap_caps.h>      // For heap_caps_get_info().
+#include <esp_timer.h>          // For esp_timer_get_time().
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const time_t UTC_2023 = 1672531200;  // Jan 1, 2023 00:00:00 UTC.
+static const time_t UTC_2038 = 2145916800;  // Jan 1, 2038 00:00:00 UTC.
+static const time_t SECS_PER_HOUR = 3600;
+static const time_t SECS_PER_YEAR = 31556952; // Average Gregorian year.
+
+static volatile uint32_t gSink; // Keeps the compiler from dropping results.
+static time_t gUtc;             // Simulated time used by the benchmarks.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SetTimezone()
+//
+// Sets the timezone to Cleveland, Ohio time (EST+5:0EDT+4:0,M3.2.0/2,M11.1.0/2)
+// using the WiFiTimeManager timezone setters.  The new settings are not saved
+// to NVS.
+/////////////////////////////////////////////////////////////////////////////////
+void SetTimezone()
+{
+    gpWtm->BeginUpdate();
+    gpWtm->SetTzOfst(-300);
+    gpWtm->SetTzAbbrev("EST");
+    gpWtm->SetUseDst(true);
+    gpWtm->SetDstOfst(60);
+    gpWtm->SetDstAbbrev("EDT");
+    gpWtm->SetDstStartWk(wkSecond);
+    gpWtm->SetDstStartDow(dowSun);
+    gpWtm->SetDstStartMonth(mMar);
+    gpWtm->SetDstStartHour(2);
+    gpWtm->SetDstStartOfst(-300 + 60);
+    gpWtm->SetDstEndWk(wkFirst);
+    gpWtm->SetDstEndDow(dowSun);
+    gpWtm->SetDstEndMonth(mNov);
+    gpWtm->SetDstEndHour(2);
+    gpWtm->SetDstEndOfst(-300);
+    gpWtm->CommitUpdate(false);
+} // End SetTimezone().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// HeapBlocks()
+//
+// Returns the number of blocks currently allocated from the heap.
+/////////////////////////////////////////////////////////////////////////////////
+size_t HeapBlocks()
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    return info.allocated_blocks;
+} // End HeapBlocks().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Bench()
+//
+// Times a number of calls to a function and prints the results.
+//
+// Arguments:
+//   - pName - The name to print.
+//   - pFunc - The function to call.  It is passed the call number.
+//   - count - The number of calls to make.
+//
+/////////////////////////////////////////////////////////////////////////////////
+void Bench(const char *pName, void (*pFunc)(uint32_t), uint32_t count)
+{
+    // Warm up caches and any lazy setup first.
+    pFunc(0);
+
+    size_t  blocks  = HeapBlocks();
+    int64_t startUs = esp_timer_get_time();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pFunc(i);
+    }
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+    int32_t heldBlocks = (int32_t)(HeapBlocks() - blocks);
+
+    float nsPerCall = (float)elapsedUs * 1000.0f / count;
+    Serial.printf("  %-32s %9.0f calls/s %9.1f ns/call %6.2f blocks/call\n", pName,
+                  1.0e9f / nsPerCall, nsPerCall, (float)heldBlocks / count);
+} // End Bench().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The benchmarked operations.
+/////////////////////////////////////////////////////////////////////////////////
+void LocalSameSecond(uint32_t)
+    { tm t; gSink = gpWtm->UtcToLocal(gUtc, &t)->tm_sec; }
+void LocalSameMinute(uint32_t i)
+    { tm t; gSink = gpWtm->UtcToLocal(gUtc + i % 60, &t)->tm_sec; }
+void LocalEachHour(uint32_t i)
+    { tm t; gSink = gpWtm->UtcToLocal(gUtc + (time_t)i * SECS_PER_HOUR, &t)->tm_hour; }
+void LocalFarFuture(uint32_t i)
+    { tm t; gSink = gpWtm->UtcToLocal(gUtc + 60 * SECS_PER_YEAR + (time_t)i * SECS_PER_HOUR, &t)->tm_hour; }
+void LibcEachHour(uint32_t i)
+    { tm t; time_t u = gUtc + (time_t)i * SECS_PER_HOUR; gSink = localtime_r(&u, &t)->tm_hour; }
+void UtcTimeT(uint32_t)
+    { gSink = (uint32_t)gpWtm->GetUtcTimeT(); }
+void UtcMicros(uint32_t)
+    { gSink = (uint32_t)gpWtm->GetUtcMicros(); }
+void LocalTime(uint32_t)
+    { tm t; gSink = gpWtm->GetLocalTime(&t)->tm_sec; }
+void DateTimeString(uint32_t i)
+{
+    tm t;
+    char buf[64];
+    gpWtm->UtcToLocal(gUtc + (time_t)i * SECS_PER_HOUR, &t);
+    gSink = gpWtm->GetDateTimeString(buf, sizeof(buf), &t);
+}
+void StrftimeString(uint32_t i)
+{
+    tm t;
+    char buf[64];
+    gpWtm->UtcToLocal(gUtc + (time_t)i * SECS_PER_HOUR, &t);
+    gSink = strftime(buf, sizeof(buf), TimeFormat::DATE_TIME, &t);
+}
+void Iso8601String(uint32_t i)
+{
+    static const TimeFormat iso(TimeFormat::ISO_8601);
+    tm t;
+    char buf[32];
+    gpWtm->UtcToLocal(gUtc + (time_t)i * SECS_PER_HOUR, &t);
+    gSink = iso.Format(buf, sizeof(buf), &t);
+}
+void StrftimeIso8601(uint32_t i)
+{
+    tm t;
+    char buf[32];
+    gpWtm->UtcToLocal(gUtc + (time_t)i * SECS_PER_HOUR, &t);
+    gSink = strftime(buf, sizeof(buf), TimeFormat::ISO_8601, &t);
+}
+void Rfc3339Now(uint32_t)
+{
+    static const TimeFormat rfc(TimeFormat::RFC_3339_MS);
+    char buf[32];
+    gSink = gpWtm->FormatTime(rfc, buf, sizeof(buf));
+}
+void LogStampNow(uint32_t)
+{
+    static const TimeFormat stamp(TimeFormat::LOG_STAMP);
+    char buf[24];
+    gSink = gpWtm->FormatTime(stamp, buf, sizeof(buf));
+}
+void NextTransition(uint32_t i)
+    { DstTransition next; gSink = gpWtm->GetNextTransition(gUtc + (time_t)i * SECS_PER_HOUR, &next); }
+void UnchangedCommit(uint32_t)
+    { gpWtm->BeginUpdate(); gpWtm->SetTzOfst(-300); gSink = gpWtm->CommitUpdate(false); }
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SameLocal()
+//
+// Returns true if two broken-down times are the same, including DST flags.
+/////////////////////////////////////////////////////////////////////////////////
+bool SameLocal(const tm &rA, const tm &rB)
+{
+    return (rA.tm_year == rB.tm_year) && (rA.tm_mon == rB.tm_mon) &&
+           (rA.tm_mday == rB.tm_mday) && (rA.tm_hour == rB.tm_hour) &&
+           (rA.tm_min == rB.tm_min) && (rA.tm_sec == rB.tm_sec) &&
+           (rA.tm_isdst == rB.tm_isdst) && (rA.tm_wday == rB.tm_wday) &&
+           (rA.tm_yday == rB.tm_yday);
+} // End SameLocal().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SweepTransitions()
+//
+// Walks the DST transitions of the next 100 years.  Each one must flip the
+// DST flag, and move the local time by the change in offset.
+/////////////////////////////////////////////////////////////////////////////////
+void SweepTransitions()
+{
+    uint32_t count  = 0;
+    uint32_t errors = 0;
+    int64_t  startUs = esp_timer_get_time();
+    DstTransition next;
+    time_t utc = UTC_2023;
+    while ((utc < UTC_2023 + 100 * SECS_PER_YEAR) && gpWtm->GetNextTransition(utc, &next))
+    {
+        tm before;
+        tm after;
+        gpWtm->UtcToLocal((time_t)next.m_Utc - 1, &before);
+        gpWtm->UtcToLocal((time_t)next.m_Utc, &after);
+
+        int32_t beforeMin = before.tm_hour * 60 + before.tm_min;
+        int32_t afterMin  = after.tm_hour * 60 + after.tm_min;
+        int32_t jumpMin   = next.m_IsDst ? 60 : -60;
+        if ((before.tm_isdst == after.tm_isdst) || (after.tm_isdst != (int)next.m_IsDst) ||
+            (before.tm_sec != 59) || (after.tm_sec != 0) ||
+            (((afterMin - beforeMin - 1 - jumpMin) % (24 * 60)) != 0))
+        {
+            Serial.printf("  *** Bad transition at %lld.\n", (long long)next.m_Utc);
+            errors++;
+        }
+        count++;
+        utc = (time_t)next.m_Utc;
+    }
+    Serial.printf("  %u transitions checked in %lld ms, %u errors.\n", count,
+                  (long long)(esp_timer_get_time() - startUs) / 1000, errors);
+} // End SweepTransitions().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SweepHours()
+//
+// Compares UtcToLocal() against localtime_r() for every hour (and the minute
+// before it) from 2023 through 2037.
+/////////////////////////////////////////////////////////////////////////////////
+void SweepHours()
+{
+    uint32_t count  = 0;
+    uint32_t errors = 0;
+    int64_t  startUs = esp_timer_get_time();
+    for (time_t utc = UTC_2023; utc < UTC_2038; utc += SECS_PER_HOUR)
+    {
+        for (time_t t = utc - 60; t <= utc; t += 60)
+        {
+            tm ours;
+            tm libc;
+            gpWtm->UtcToLocal(t, &ours);
+            localtime_r(&t, &libc);
+            if (!SameLocal(ours, libc))
+            {
+                if (errors < 10)
+                {
+                    Serial.printf("  *** Mismatch at %lld.\n", (long long)t);
+                }
+                errors++;
+            }
+            count++;
+        }
+    }
+    Serial.printf("  %u times checked in %lld ms, %u errors.\n", count,
+                  (long long)(esp_timer_get_time() - startUs) / 1000, errors);
+} // End SweepHours().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SweepFormats()
+//
+// Compares GetDateTimeString() against strftime() with the same format, for
+// each day (at a varying hour) from 2023 through 2037.
+/////////////////////////////////////////////////////////////////////////////////
+void SweepFormats()
+{
+    uint32_t count  = 0;
+    uint32_t errors = 0;
+    int64_t  startUs = esp_timer_get_time();
+    for (time_t t = UTC_2023; t < UTC_2038; t += 24 * SECS_PER_HOUR + 7 * 60 + 1)
+    {
+        tm local;
+        char ours[64];
+        char libc[64];
+        localtime_r(&t, &local);
+        gpWtm->GetDateTimeString(ours, sizeof(ours), &local);
+        strftime(libc, sizeof(libc), TimeFormat::DATE_TIME, &local);
+        if (strcmp(ours, libc) != 0)
+        {
+            if (errors < 10)
+            {
+                Serial.printf("  *** Mismatch at %lld: %s\n", (long long)t, ours);
+            }
+            errors++;
+        }
+        count++;
+    }
+    Serial.printf("  %u times checked in %lld ms, %u errors.\n", count,
+                  (long long)(esp_timer_get_time() - startUs) / 1000, errors);
+} // End SweepFormats().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  Runs everything once.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    // Get the Serial class ready for use.
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n Starting");
+
+    // Set up the WiFiTimeManager.  It is never connected.
+    gpWtm = WiFiTimeManager::Instance();
+    gpWtm->SetPrintLevel(WiFiTimeManager::PL_NONE);
+    gpWtm->Init(AP_NAME);
+    SetTimezone();
+
+    // Start the simulated time in the middle of the table.
+    gUtc = UTC_2023 + 3 * SECS_PER_YEAR;
+
+    Serial.println("Conversions:");
+    Bench("UtcToLocal() same second",   LocalSameSecond, 100000);
+    Bench("UtcToLocal() same minute",   LocalSameMinute, 100000);
+    Bench("UtcToLocal() each hour",     LocalEachHour,   100000);
+    Bench("UtcToLocal() after table",   LocalFarFuture,  100000);
+    Bench("localtime_r() each hour",    LibcEachHour,    100000);
+    Bench("GetUtcTimeT()",              UtcTimeT,        100000);
+    Bench("GetUtcMicros()",             UtcMicros,       100000);
+    Bench("GetLocalTime()",             LocalTime,       100000);
+    Bench("GetDateTimeString()",        DateTimeString,  20000);
+    Bench("strftime() same format",     StrftimeString,  20000);
+    Bench("TimeFormat ISO 8601",        Iso8601String,   20000);
+    Bench("strftime() ISO 8601",        StrftimeIso8601, 20000);
+    Bench("FormatTime() RFC 3339 ms",   Rfc3339Now,      20000);
+    Bench("FormatTime() log stamp",     LogStampNow,     20000);
+    Bench("GetNextTransition()",        NextTransition,  100000);
+    Bench("CommitUpdate() unchanged",   UnchangedCommit, 20000);
+
+    Serial.println("DST transitions, 2023 - 2122:");
+    SweepTransitions();
+
+    Serial.println("Hourly against localtime_r(), 2023 - 2037:");
+    SweepHours();
+
+    Serial.println("Daily GetDateTimeString() against strftime(), 2023 - 2037:");
+    SweepFormats();
+
+    Serial.println("Done.");
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Nothing to do.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    delay(1000);
+} // End loop().
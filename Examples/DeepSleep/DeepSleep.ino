@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////////////////////
+// DeepSleep.ino
+//
+// This file contains example code demonstrating the use of the WiFiTimeManager
+// library on a battery powered device that spends most of its time in deep
+// sleep.
+//
+// The device wakes at the top of each hour, local time, prints the time, and
+// goes back to sleep.  The timezone, NTP settings, and drift estimate are kept
+// in RTC memory across the sleep, so most wakes need no WiFi at all.  WiFi is
+// only brought up when the clock's expected error has grown past MAX_ERR_MS.
+// Note that waking repeatedly from deep sleep runs setup() each time, and
+// that loop() is never reached.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const char *AP_PWD  = NULL;
+                                // AP password.  NULL == no password.
+static const uint32_t MAX_ERR_MS  = 500;
+                                // Largest acceptable clock error.
+static const uint32_t SYNC_WAIT_MS = 15000;
+                                // Longest wait for an NTP sync.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  Runs on every wake.  Syncs the clock if
+// needed, prints the time, and sleeps until the next hour.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("\n Starting");
+
+    // Init a pointer to our WiFiTimeManager instance.
+    gpWtm = WiFiTimeManager::Instance();
+
+    // Initialize the WiFiTimeManager class with our AP name.  After a deep
+    // sleep, this restores our state from RTC memory.
+    gpWtm->Init(AP_NAME, AP_PWD);
+    Serial.printf("%s, expected error %u us.\n",
+                  gpWtm->WokeFromSleep() ? "Woke from sleep" : "Powered up",
+                  gpWtm->GetExpectedErrorUs());
+
+    // Only connect to the network when the clock needs it.
+    if (gpWtm->IsResyncNeeded(MAX_ERR_MS))
+    {
+        // Don't sit in the config portal forever on a battery.
+        gpWtm->setConfigPortalTimeout(180);
+        if (!gpWtm->autoConnect())
+        {
+            Serial.println("Failed to connect or hit timeout");
+        }
+        else
+        {
+            // Wait for the NTP sync.
+            uint32_t start = millis();
+            while (!gpWtm->UsingNetworkTime() && (millis() - start < SYNC_WAIT_MS))
+            {
+                gpWtm->GetUtcTimeT();
+                delay(100);
+            }
+        }
+    }
+
+    // Display the time.
+    tm localTime;
+    gpWtm->GetLocalTime(&localTime);
+    gpWtm->PrintDateTime(&localTime);
+
+    // Sleep until the top of the next hour.  DST changes are handled by
+    // SleepUntilLocal().
+    localTime.tm_hour++;
+    localTime.tm_min = 0;
+    localTime.tm_sec = 0;
+    Serial.flush();
+    gpWtm->SleepUntilLocal(&localTime);
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Not reached, since setup() always sleeps.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    delay(1000);
+} // End loop().
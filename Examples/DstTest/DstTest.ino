@@ -113,17 +113,32 @@ bool CompareTimes(int yr, int month, int mday, int hr, int minute, int sec,
 /////////////////////////////////////////////////////////////////////////////////
 // SetTimezone()
 //
-// Sets the timezone based on the input TZ string.  pTimezone is a pointer to
-// the NULL terminated timezone string.  See
-// https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html
-// for details of forming the timezone string.
+// Sets the timezone to Cleveland, Ohio time (EST+5:0EDT+4:0,M3.2.0/2,M11.1.0/2)
+// using the WiFiTimeManager timezone setters.  The WiFiTimeManager converts
+// local time from its own settings, so they must be changed via the setters
+// followed by UpdateTimezoneRules(), rather than by setting the TZ environment
+// variable.  The new settings are not saved to NVS.
 /////////////////////////////////////////////////////////////////////////////////
-void SetTimezone(const char *pTimezone)
+void SetTimezone()
 {
-    Serial.printf("  Setting Timezone to %s\n", pTimezone);
+    Serial.println("  Setting Timezone to EST+5:0EDT+4:0,M3.2.0/2,M11.1.0/2");
     // Adjust the TZ.  Clock settings are adjusted to show the new local time.
-    setenv("TZ", pTimezone, 1);
-    tzset();
+    gpWtm->SetTzOfst(-300);
+    gpWtm->SetTzAbbrev((char *)"EST");
+    gpWtm->SetUseDst(true);
+    gpWtm->SetDstOfst(60);
+    gpWtm->SetDstAbbrev((char *)"EDT");
+    gpWtm->SetDstStartWk(wkSecond);
+    gpWtm->SetDstStartDow(dowSun);
+    gpWtm->SetDstStartMonth(mMar);
+    gpWtm->SetDstStartHour(2);
+    gpWtm->SetDstStartOfst(-300 + 60);
+    gpWtm->SetDstEndWk(wkFirst);
+    gpWtm->SetDstEndDow(dowSun);
+    gpWtm->SetDstEndMonth(mNov);
+    gpWtm->SetDstEndHour(2);
+    gpWtm->SetDstEndOfst(-300);
+    gpWtm->UpdateTimezoneRules();
 } // End SetTimezone().
 
 
@@ -240,7 +255,7 @@ void setup()
     }
 
     // Set the timezone to Cleveland, Ohio time.
-    SetTimezone("EST+5:0EDT+4:0,M3.2.0/2,M11.1.0/2");
+    SetTimezone();
 } // End setup().
 
 
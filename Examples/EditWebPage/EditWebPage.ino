@@ -5,7 +5,9 @@
 // library in the polled (non-blocking) mode.  It also demonstrates the ease
 // of adding a user defined input field to the Setup page.
 //
-// A simple dummy data field is added to the Setup web page.
+// A simple dummy data field is added to the Setup web page.  The Setup page is
+// streamed directly from flash (see WiFiTimeManager::SetWebPageMode()), and the
+// field is inserted by a stream web page callback as the page is sent.
 //
 // In non-blocking mode, if a network connection cannot be made at power-up, the
 // system starts the config portal and continues execution so that the user code
@@ -109,17 +111,21 @@ void PreOtaUpdateCallback()
 
 
 /////////////////////////////////////////////////////////////////////////////////
-// UpdateWebPageCallback()
+// StreamWebPageCallback()
 //
-// This callback is invoked when the web page needs to be updated.  This is
-// demonstration code to show how one might add an entry to the Setup web page.
+// This callback is invoked at each marker comment as the web page is sent.
+// This is demonstration code to show how one might add an entry to the Setup
+// web page.  Anything written to rOut is inserted just before the marker.
 /////////////////////////////////////////////////////////////////////////////////
-void UpdateWebPageCallback(String &rWebPage, uint32_t maxSize)
+void StreamWebPageCallback(const char *pMarker, Print &rOut)
 {
-    Serial.println("UpdateWebPageCallback");
-    // Replace the HTML END marker with our demonstration code.
-    rWebPage.replace("<!-- HTML END -->", EDIT_TEST_STR);
-} // End UpdateWebPageCallback().
+    // Insert our demonstration code just before the HTML END marker.
+    if (!strcmp(pMarker, "<!-- HTML END -->"))
+    {
+        Serial.println("StreamWebPageCallback");
+        rOut.print(EDIT_TEST_STR);
+    }
+} // End StreamWebPageCallback().
 
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -127,7 +133,7 @@ void UpdateWebPageCallback(String &rWebPage, uint32_t maxSize)
 //
 // This callback is invoked when the user saves the Setup web page.  This is
 // demonstration code to show how one might retrieve the value of an entry
-// that was added via the UpdateWebPageCallback().
+// that was added via the StreamWebPageCallback().
 /////////////////////////////////////////////////////////////////////////////////
 void SaveParamsCallback()
 {
@@ -228,10 +234,11 @@ void setup()
     // initializes a default time that the RTC may want to override.
     gpWtm = WiFiTimeManager::Instance();
 
-    // The web page is updated in Init(), so setup our callbacks before
-    // WiFiTimeManager::Init() is called.  In this case, we have added some
+    // The web page mode is used in Init(), so setup our mode and callbacks
+    // before WiFiTimeManager::Init() is called.  In this case, we have added some
     // demonstration code above to illustrate how to add fields to the web page.
-    gpWtm->SetUpdateWebPageCallback(UpdateWebPageCallback);
+    gpWtm->SetWebPageMode(wpmStreamed);
+    gpWtm->SetStreamWebPageCallback(StreamWebPageCallback);
     gpWtm->SetSaveParamsCallback(SaveParamsCallback);
 
     // Initialize the WiFiTimeManager class with our AP and button selections.
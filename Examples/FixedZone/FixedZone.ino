@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////////////
+// FixedZone.ino
+//
+// This file contains example code demonstrating the use of the WiFiTimeManager
+// library with a timezone that is fixed at compile time.
+//
+// Headless devices that always run in the same timezone don't need the
+// timezone fields of the Setup page, or the NVS storage that goes with them.
+// Here the timezone is described by a FixedZone type, whose TZ string and DST
+// transitions are computed by the compiler.  The config portal is still used
+// to enter WiFi credentials, but it has no Setup button.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const char *AP_PWD  = NULL;
+                                // AP password.  NULL == no password.
+
+// US Eastern time.  UTC-5 standard time, UTC-4 DST.  DST starts the 2nd Sunday
+// of March at 2 AM and ends the 1st Sunday of November at 2 AM.
+typedef FixedZone<-300, -240,
+                  ZoneRule<mMar, wkSecond, dowSun, 2>,
+                  ZoneRule<mNov, wkFirst,  dowSun, 2> > EasternZone;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  This function initializes the WiFiTimeManager
+// class with our fixed zone, and connects to the network.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n Starting");
+
+    // Init a pointer to our WiFiTimeManager instance.
+    gpWtm = WiFiTimeManager::Instance();
+
+    // Fix the timezone before calling Init().  No timezone data is read from
+    // or written to NVS, and there is no Setup page.
+    gpWtm->SetFixedZone<EasternZone>();
+    Serial.printf("Using TZ %s\n", EasternZone::GetTzString());
+
+    // Initialize the WiFiTimeManager class with our AP name.
+    gpWtm->Init(AP_NAME, AP_PWD);
+
+    // Attempt to connect to the network.  Blocks until connected.
+    gpWtm->setConfigPortalTimeout(0);
+    if(!gpWtm->autoConnect())
+    {
+        Serial.println("Failed to connect or hit timeout");
+    }
+    else
+    {
+        //if you get here you have connected to the WiFi
+        Serial.println("connected...yeey :)");
+        gpWtm->GetUtcTimeT();
+    }
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Periodically displays local time and the time
+// of the next DST change.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    // Read the time every 10 seconds.
+    static uint32_t lastTime = millis();
+    uint32_t thisTime = millis();
+    static const uint32_t updateTime = 10000;   // 10 seconds between reading time
+    if (thisTime - lastTime >= updateTime)
+    {
+        // Read the time and display the results.
+        lastTime = thisTime;
+        tm localTime;
+        gpWtm->GetLocalTime(&localTime);
+        gpWtm->PrintDateTime(&localTime);
+
+        // Show when the next DST change happens.
+        DstTransition next;
+        if (gpWtm->GetNextTransition(&next))
+        {
+            time_t when = (time_t)next.m_Utc;
+            gpWtm->UtcToLocal(when, &localTime);
+            Serial.printf("DST %s at ", next.m_IsDst ? "starts" : "ends");
+            gpWtm->PrintDateTime(&localTime);
+        }
+        Serial.println();
+    }
+
+    delay(1);
+
+} // End loop().
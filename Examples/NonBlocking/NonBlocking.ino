@@ -202,6 +202,7 @@ void loop()
         gpWtm->PrintDateTime(&localTime);
         gpWtm->GetLocalTime(&localTime);
         gpWtm->PrintDateTime(&localTime);
+        Serial.printf("Longest process() call: %u usec\n", gpWtm->GetMaxProcessMicros());
         Serial.println();
     }
 
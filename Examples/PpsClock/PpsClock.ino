@@ -0,0 +1,87 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PpsClock.ino
+//
+// This file contains example code demonstrating the use of the WiFiTimeManager
+// library with a one pulse per second (PPS) signal for microsecond class
+// timestamps.
+//
+// NTP gets the clock to within a fraction of a second, then the PPS signal
+// takes over.  Once locked, the clock no longer needs the network, and NTP is
+// only polled once a day.  Every few seconds, the sketch prints a timestamp
+// along with the lock state, the clock's error at recent PPS edges, and the
+// measured esp_timer rate error.
+//
+// This example includes the following:
+//   - A GPS module with its PPS output connected to GPIO 4.  The PPS pulse
+//     starts on its rising edge.  For a DS3231's SQW pin (with a pull up),
+//     use FALLING instead.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+
+#define PPS_PIN         4       // GPIO pin for the PPS signal.
+#define PPS_EDGE        RISING  // Edge that starts each second.
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const char *AP_PWD  = NULL;
+                                // AP password.  NULL == no password.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  This function sets up the PPS source and
+// initializes the WiFiTimeManager class.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("\n Starting");
+
+    // Init a pointer to our WiFiTimeManager instance.
+    gpWtm = WiFiTimeManager::Instance();
+
+    // The PPS source must be set before WiFiTimeManager::Init() is called.
+    gpWtm->SetPpsSource(PPS_PIN, PPS_EDGE);
+
+    // Initialize the WiFiTimeManager class with our AP name, and connect.
+    gpWtm->Init(AP_NAME, AP_PWD);
+    if (!gpWtm->autoConnect())
+    {
+        Serial.println("Failed to connect or hit timeout");
+    }
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Prints a microsecond timestamp and the PPS
+// status every 5 seconds.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    static uint32_t lastTime = millis();
+    uint32_t thisTime = millis();
+    static const uint32_t updateTime = 5000;
+    if (thisTime - lastTime >= updateTime)
+    {
+        lastTime = thisTime;
+        timespec ts;
+        gpWtm->GetUtcTimespec(&ts);
+        const PpsDiscipline &rPps = gpWtm->GetPps();
+        Serial.printf("%ld.%06ld  %s  error %u us  rate %ld ppb\n",
+                      (long)ts.tv_sec, ts.tv_nsec / 1000,
+                      rPps.IsLocked() ? "locked" : "unlocked",
+                      rPps.GetErrorUs(), (long)rPps.GetRatePpb());
+    }
+    delay(1);
+} // End loop().
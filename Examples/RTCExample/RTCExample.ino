@@ -23,7 +23,10 @@
 //   - An LED connected to GPIO 12 that lights when NTP time is being used.
 //   - An LED connected to GPIO 27 that lights when the local clock is supplying
 //     time data.
-//   - A DS3231 RTC connected to the ESP32 I2C SCL and SDA pins.
+//   - A DS3231 RTC connected to the ESP32 I2C SCL and SDA pins, with its
+//     INT/SQW pin connected to GPIO 4 (with a pull up).  The library's
+//     Ds3231Rtc driver is used, so no other RTC library is needed.  For a
+//     PCF8563, use Pcf8563Rtc instead, with its CLKOUT pin on GPIO 4.
 //
 // The latest version of WiFiTimeManager code with documentation and examples
 // can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
@@ -45,17 +48,17 @@
 #include <String>               // For String class.
 
 #if defined USE_RTC
-    #include <DS323x_Generic.h> // https://github.com/khoih-prog/DS323x_Generic
+    #include <Wire.h>           // For the I2C bus.
 #endif
-
 #include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
 
 #define RESET_PIN       14      // GPIO pin for the reset button.
 #define NTP_CLOCK_PIN   12      // GPIO pin for the NTP clock LED.
 #define LOCAL_CLOCK_PIN 27      // GPIO pin for the local clock LED.
+#define RTC_SQW_PIN     4       // GPIO pin for the RTC 1 Hz output.
 
 #if defined USE_RTC
-    static DS323x gRtc;         // The DS3231 instance.
+    static Ds3231Rtc gRtc;      // The DS3231 driver.
 #endif
 static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
 static const bool SETUP_BUTTON  = true;
@@ -116,43 +119,6 @@ void PreOtaUpdateCallback()
 }
 
 
-/////////////////////////////////////////////////////////////////////////////////
-// Special RTC code.
-/////////////////////////////////////////////////////////////////////////////////
-#if defined USE_RTC
-    /////////////////////////////////////////////////////////////////////////////
-    // UtcGetCallback()
-    //
-    // This callback is invoked when NTP time is not called, and is used to
-    // supply current time_t time.  In this case we read the current time from
-    // the RTC, convert it to time_t, and return it.
-    /////////////////////////////////////////////////////////////////////////////
-    time_t UtcGetCallback()
-    {
-        Serial.println("UtcGetCallback");
-        DateTime t = gRtc.now();
-        return t.get_time_t();
-    } // End UtcGetCallback().
-
-    /////////////////////////////////////////////////////////////////////////////
-    // UtcSetCallback()
-    //
-    // This callback is invoked after NTP time is received from the NTP server.
-    // It converts the time_t value to a DateTime value and sets the RTC.
-    /////////////////////////////////////////////////////////////////////////////
-    void UtcSetCallback(time_t t)
-    {
-        Serial.println("UtcSetCallback");
-
-        // Push the new time to the RTC.
-        gRtc.now(DateTime(t));
-
-        // Reset the RTC stop flag to inidcate that the RTC time is valid.
-        gRtc.oscillatorStopFlag(false);
-    } // End UtcSetCallback().
-#endif
-
-
 /////////////////////////////////////////////////////////////////////////////////
 // UpdateWebPageCallback()
 //
@@ -271,20 +237,6 @@ void setup()
     // initializes a default time that the RTC may want to override.
     gpWtm = WiFiTimeManager::Instance();
 
-#if defined USE_RTC
-    // Initialize I2C for the RTC.
-    Wire.begin();
-    gRtc.attach(Wire);
-
-    // If the RTC is uninitialized, then set a default time (the start of 2023).
-    if (gRtc.oscillatorStopFlag())
-    {
-        Serial.println("RTC uninitialized.");
-        gRtc.now(DateTime(2023, 1, 1, 0, 0, 0));
-        gRtc.oscillatorStopFlag(false);
-    }
-#endif
-
     // The web page is updated in Init(), so setup our callbacks before
     // WiFiTimeManager::Init() is called.  In this case, we have added some
     // demonstration code above to illustrate how to add fields to the web page.
@@ -292,11 +244,12 @@ void setup()
     gpWtm->SetSaveParamsCallback(SaveParamsCallback);
 
 #if defined USE_RTC
-    // Setup the RTC callbacks.  These should be done before calling
-    // WiFiTimeManager::Init(), since it will use the callbacks to initialize
-    // the current time.
-    gpWtm->SetUtcGetCallback(UtcGetCallback);
-    gpWtm->SetUtcSetCallback(UtcSetCallback);
+    // Initialize I2C for the RTC, and hand the RTC to the WiFiTimeManager.
+    // This must be done before calling WiFiTimeManager::Init(), since it
+    // uses the RTC to initialize the current time.  If the RTC has lost its
+    // time, it is ignored until the first NTP update sets it.
+    Wire.begin();
+    gpWtm->SetRtcBackend(&gRtc, RTC_SQW_PIN);
 #endif
 
     // Initialize the WiFiTimeManager class with our AP and button selections.
@@ -368,6 +321,12 @@ void loop()
         gpWtm->PrintDateTime(&localTime);
         gpWtm->GetLocalTime(&localTime);
         gpWtm->PrintDateTime(&localTime);
+#if defined USE_RTC
+        const RtcClock &rRtc = gpWtm->GetRtcClock();
+        Serial.printf("RTC %s, error %ld us, drift %.2f ppm, aging %d, %u writes\n",
+                      rRtc.IsValid() ? "valid" : "invalid", (long)rRtc.GetLastErrUs(),
+                      rRtc.GetDriftPpm(), rRtc.GetAging(), (unsigned)rRtc.GetWriteCount());
+#endif
         Serial.println();
     }
 
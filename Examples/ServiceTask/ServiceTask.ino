@@ -0,0 +1,115 @@
+/////////////////////////////////////////////////////////////////////////////////
+// ServiceTask.ino
+//
+// This file contains example code demonstrating the use of the WiFiTimeManager
+// library with its optional time service task.
+//
+// In service task mode, the config portal, SNTP bring up, and NVS saves all
+// run in a small task pinned to core 0, next to the WiFi stack.  The Arduino
+// loop() on core 1 never has to call process(), and is never stalled by the
+// network or by flash writes.  Here loop() toggles an output pin on a tight
+// schedule and reports the worst lateness it saw, along with the local time.
+//
+// Pressing the button connected to GPIO 14 asks the service task to start the
+// config portal.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const char *AP_PWD  = NULL;
+                                // AP password.  NULL == no password.
+static const int BUTTON_PIN = 14;
+                                // Starts the config portal when pressed.
+static const int TOGGLE_PIN = 12;
+                                // Toggled every TOGGLE_US microseconds.
+static const uint32_t TOGGLE_US = 1000;
+                                // Period of the toggle.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  This function initializes the WiFiTimeManager
+// class in service task mode, and hands off the network connection to it.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    Serial.begin(115200);
+    delay(1000);
+    Serial.println("\n Starting");
+
+    pinMode(BUTTON_PIN, INPUT_PULLUP);
+    pinMode(TOGGLE_PIN, OUTPUT);
+
+    // Init a pointer to our WiFiTimeManager instance.
+    gpWtm = WiFiTimeManager::Instance();
+
+    // Select service task mode before calling Init().  Pin the task to core 0.
+    gpWtm->SetServiceTask(0);
+
+    // Initialize the WiFiTimeManager class with our AP name.  This also starts
+    // the service task.
+    gpWtm->Init(AP_NAME, AP_PWD);
+
+    // Let the service task connect.  Since we are non-blocking, this returns
+    // right away, and the config portal (if needed) runs in the service task.
+    gpWtm->setConfigPortalBlocking(false);
+    gpWtm->setConfigPortalTimeout(0);
+    gpWtm->autoConnect();
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Toggles an output on a fixed schedule, and
+// once every 10 seconds displays the local time and the worst lateness.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    static uint32_t nextToggle = micros();
+    static uint32_t worstLateUs = 0;
+    static bool     pinState = false;
+
+    // Toggle the output when it is due, and keep track of how late we were.
+    uint32_t now = micros();
+    if ((int32_t)(now - nextToggle) >= 0)
+    {
+        uint32_t late = now - nextToggle;
+        worstLateUs = max(worstLateUs, late);
+        pinState = !pinState;
+        digitalWrite(TOGGLE_PIN, pinState);
+        nextToggle += TOGGLE_US;
+    }
+
+    // Ask the service task to start the config portal if the button is pressed.
+    static bool lastButton = true;
+    bool button = digitalRead(BUTTON_PIN);
+    if (lastButton && !button)
+    {
+        gpWtm->PostServiceCommand(scStartPortal);
+    }
+    lastButton = button;
+
+    // Report every 10 seconds.
+    static uint32_t lastReport = millis();
+    if (millis() - lastReport >= 10000)
+    {
+        lastReport = millis();
+        tm localTime;
+        gpWtm->GetLocalTime(&localTime);
+        gpWtm->PrintDateTime(&localTime);
+        Serial.printf("Connected: %s, worst toggle lateness %u us\n",
+                      gpWtm->IsConnected() ? "yes" : "no", worstLateUs);
+        worstLateUs = 0;
+    }
+} // End loop().
@@ -0,0 +1,404 @@
+/////////////////////////////////////////////////////////////////////////////////
+// StressTest.ino
+//
+// This file checks that the WiFiTimeManager library
+// ( https://github.com/regnaDkciN/WiFiTimeManager ) can be reconfigured by
+// one task while other tasks, on both cores, use it.  No network connection
+// is needed unless USE_REST is set.  It does the following:
+//   1. A writer task on core 0 switches the timezone back and forth between
+//      US Eastern and Central European time as fast as it can, and every so
+//      often replaces the UTC get callback.
+//   2. A reader task on each core, and loop() itself, continually read the
+//      settings with GetParams(), read them one at a time with
+//      GetAppliedTzAbbrev() and GetAppliedDstAbbrev(), copy the zone with
+//      GetZone(),
+//      convert a fixed UTC time with UtcToLocal(), format it with
+//      GetDateTimeString(), and now and then call GetUtcTimeT(true) to use
+//      the UTC get callback.  Every result must belong wholly to one zone or
+//      the other.  A result with some fields from each (e.g. an offset of
+//      -300 with "CET") is counted as an error.
+//   3. Every 5 seconds, the number of zone changes, reads, and errors are
+//      printed.  After TEST_SECONDS, the test stops and prints PASSED or
+//      FAILED.
+//
+// The timezone changes are not saved to NVS.
+//
+// With USE_REST set to true, the zone is instead changed by REST API PUT
+// requests (see SetRestApi()) that the writer task sends to the device's own
+// IP address, and the service task serves them.  This checks the getters
+// against the same edits that a script would make.  The device must be able
+// to connect to a saved WiFi network (use the config portal once if not).
+// Each PUT is saved to NVS, so the PUTs are paced to one every PUT_MS.
+//
+// The latest version of WiFiTimeManager code with documentation and examples
+// can be found on github at: https://github.com/regnaDkciN/WiFiTimeManager .
+//
+// Copyright (c) 2023, Joseph M. Corbett
+/////////////////////////////////////////////////////////////////////////////////
+
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+#include <HTTPClient.h>         // For the REST PUTs.
+#include <atomic>               // For std::atomic.
+
+static WiFiTimeManager *gpWtm;  // Pointer to the WiFiTimeManager singleton instance.
+static const char *AP_NAME = "WiFi Clock Setup";
+                                // AP name user will see as network device.
+static const uint32_t TEST_SECONDS = 60;      // How long to run.
+static const uint32_t TASK_STACK   = 4096;    // Stack size of each test task.
+static const time_t   UTC_TEST     = 1705320000; // Jan 15, 2024 12:00:00 UTC.
+static const bool     USE_REST     = false;   // true to change zones by REST PUT.
+static const char    *REST_TOKEN   = "stress-test";
+                                              // REST API bearer token.
+static const uint32_t PUT_MS       = 250;     // Time between REST PUTs.
+
+// The two zones.  Both are on standard time at UTC_TEST.
+struct ZoneDef
+{
+    int32_t     ofst;           // Standard time offset in minutes.
+    const char *pStdAbbrev;     // Standard time abbreviation.
+    const char *pDstAbbrev;     // DST abbreviation.
+    uint32_t    startWk;        // DST start rule.
+    uint32_t    startMonth;
+    uint32_t    startHour;
+    uint32_t    endWk;          // DST end rule.
+    uint32_t    endMonth;
+    uint32_t    endHour;
+    int         testHour;       // Local hour at UTC_TEST.
+};
+static const ZoneDef ZONES[2] =
+{
+    { -300, "EST", "EDT", wkSecond, mMar, 2, wkFirst, mNov, 2,  7 },
+    {   60, "CET", "CEST", wkLast,  mMar, 2, wkLast,  mOct, 3, 13 }
+};
+
+// Test state shared by all tasks.
+static std::atomic<uint32_t> gChanges(0);     // Zone changes made.
+static std::atomic<uint32_t> gReads(0);       // Reads checked.
+static std::atomic<uint32_t> gErrors(0);      // Reads in error.
+static std::atomic<uint32_t> gCallbacks(0);   // UTC get callback calls.
+static std::atomic<bool>     gDone(false);    // true when the test is over.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SetZone()
+//
+// Applies one of the two zones using the WiFiTimeManager timezone setters.
+// The new settings are not saved to NVS.
+/////////////////////////////////////////////////////////////////////////////////
+void SetZone(const ZoneDef &rZ)
+{
+    gpWtm->BeginUpdate();
+    gpWtm->SetTzOfst(rZ.ofst);
+    gpWtm->SetTzAbbrev(rZ.pStdAbbrev);
+    gpWtm->SetUseDst(true);
+    gpWtm->SetDstOfst(60);
+    gpWtm->SetDstAbbrev(rZ.pDstAbbrev);
+    gpWtm->SetDstStartWk(rZ.startWk);
+    gpWtm->SetDstStartDow(dowSun);
+    gpWtm->SetDstStartMonth(rZ.startMonth);
+    gpWtm->SetDstStartHour(rZ.startHour);
+    gpWtm->SetDstStartOfst(rZ.ofst + 60);
+    gpWtm->SetDstEndWk(rZ.endWk);
+    gpWtm->SetDstEndDow(dowSun);
+    gpWtm->SetDstEndMonth(rZ.endMonth);
+    gpWtm->SetDstEndHour(rZ.endHour);
+    gpWtm->SetDstEndOfst(rZ.ofst);
+    gpWtm->CommitUpdate(false);
+} // End SetZone().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// ParamsMatch()
+//
+// Returns true if every timezone field of rP belongs to rZ.
+/////////////////////////////////////////////////////////////////////////////////
+bool ParamsMatch(const TimeParameters &rP, const ZoneDef &rZ)
+{
+    return (rP.m_TzOfst == rZ.ofst) && rP.m_UseDst && (rP.m_DstOfst == 60) &&
+           (strcmp(rP.m_DstEndRule.abbrev, rZ.pStdAbbrev) == 0) &&
+           (strcmp(rP.m_DstStartRule.abbrev, rZ.pDstAbbrev) == 0) &&
+           (rP.m_DstStartRule.week == rZ.startWk) &&
+           (rP.m_DstStartRule.month == rZ.startMonth) &&
+           (rP.m_DstStartRule.hour == rZ.startHour) &&
+           (rP.m_DstStartRule.offset == rZ.ofst + 60) &&
+           (rP.m_DstEndRule.week == rZ.endWk) &&
+           (rP.m_DstEndRule.month == rZ.endMonth) &&
+           (rP.m_DstEndRule.hour == rZ.endHour) &&
+           (rP.m_DstEndRule.offset == rZ.ofst);
+} // End ParamsMatch().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// ZoneMatch()
+//
+// Returns true if the offsets and abbreviations of rZone belong to rZ.
+/////////////////////////////////////////////////////////////////////////////////
+bool ZoneMatch(const Zone &rZone, const ZoneDef &rZ)
+{
+    return (rZone.GetStdOffset() == rZ.ofst) && (rZone.GetDstOffset() == rZ.ofst + 60) &&
+           (strcmp(rZone.GetStdAbbrev(), rZ.pStdAbbrev) == 0) &&
+           (strcmp(rZone.GetDstAbbrev(), rZ.pDstAbbrev) == 0);
+} // End ZoneMatch().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// CheckOnce()
+//
+// Makes one round of reads, and counts each one that doesn't belong wholly
+// to one of the two zones as an error.
+//
+// Arguments:
+//   pVersion - Pointer to the settings version seen by the last round.  The
+//              version must never go backward.
+//   utcGet   - true to also call GetUtcTimeT(true), which calls the UTC get
+//              callback.
+//
+/////////////////////////////////////////////////////////////////////////////////
+void CheckOnce(uint32_t *pVersion, bool utcGet)
+{
+    uint32_t errors = 0;
+
+    // The settings.
+    TimeParameters params;
+    uint32_t version = gpWtm->GetParams(&params);
+    if ((!ParamsMatch(params, ZONES[0]) && !ParamsMatch(params, ZONES[1])) ||
+        (version < *pVersion))
+    {
+        errors++;
+    }
+    *pVersion = version;
+
+    // The zone.
+    Zone zone;
+    gpWtm->GetZone(&zone);
+    if (!ZoneMatch(zone, ZONES[0]) && !ZoneMatch(zone, ZONES[1]))
+    {
+        errors++;
+    }
+
+    // The settings, one at a time.  Each read may see a different zone.
+    char abbrev[WiFiTimeManager::ABBREV_SIZE];
+    gpWtm->GetAppliedTzAbbrev(abbrev, sizeof(abbrev));
+    if ((strcmp(abbrev, ZONES[0].pStdAbbrev) != 0) && (strcmp(abbrev, ZONES[1].pStdAbbrev) != 0))
+    {
+        errors++;
+    }
+    gpWtm->GetAppliedDstAbbrev(abbrev, sizeof(abbrev));
+    if ((strcmp(abbrev, ZONES[0].pDstAbbrev) != 0) && (strcmp(abbrev, ZONES[1].pDstAbbrev) != 0))
+    {
+        errors++;
+    }
+
+    // A conversion.
+    tm local;
+    gpWtm->UtcToLocal(UTC_TEST, &local);
+    if ((local.tm_hour != ZONES[0].testHour) && (local.tm_hour != ZONES[1].testHour))
+    {
+        errors++;
+    }
+
+    // Its formatted string.  Only the abbreviation is checked, since the zone
+    // may have changed since the conversion.
+    char buf[64];
+    gpWtm->GetDateTimeString(buf, sizeof(buf), &local);
+    if ((strstr(buf, ZONES[0].pStdAbbrev) == NULL) && (strstr(buf, ZONES[1].pStdAbbrev) == NULL))
+    {
+        errors++;
+    }
+
+    // The UTC get callback.  The callback returns whole seconds, and the
+    // clock is set from it, but this sketch has no use for the clock.
+    if (utcGet)
+    {
+        gpWtm->GetUtcTimeT(true);
+    }
+
+    gReads += 6;
+    gErrors += errors;
+} // End CheckOnce().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// WriterTask()
+//
+// Switches between the two zones until the test is over.  Every 100th change
+// also replaces the UTC get callback.
+/////////////////////////////////////////////////////////////////////////////////
+void WriterTask(void *pArg)
+{
+    for (uint32_t i = 0; !gDone; i++)
+    {
+        SetZone(ZONES[i & 1]);
+        gChanges++;
+        if (i % 100 == 0)
+        {
+            gpWtm->SetUtcGetCallback([]() { gCallbacks++; return time(NULL); });
+        }
+
+        // Let the idle task run now and then to keep the watchdog happy.
+        if (i % 16 == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    vTaskDelete(NULL);
+} // End WriterTask().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// PutZone()
+//
+// Applies one of the two zones with a REST API PUT request to this device.
+// Returns true if the request succeeded.
+/////////////////////////////////////////////////////////////////////////////////
+bool PutZone(const ZoneDef &rZ)
+{
+    char url[64];
+    char body[320];
+    snprintf(url, sizeof(url), "http://%s:%u/wtm/api/config", WiFi.localIP().toString().c_str(),
+             WiFiTimeManager::DFLT_REST_PORT);
+    snprintf(body, sizeof(body),
+             "{\"TIMEZONE\":%d,\"TZ_ABBREVIATION\":\"%s\",\"USE_DST\":true,"
+             "\"DST_START_OFFSET\":60,\"DST_ABBREVIATION\":\"%s\","
+             "\"DST_START_WEEK\":%u,\"DST_START_DOW\":%u,\"DST_START_MONTH\":%u,"
+             "\"DST_START_HOUR\":%u,\"DST_END_WEEK\":%u,\"DST_END_DOW\":%u,"
+             "\"DST_END_MONTH\":%u,\"DST_END_HOUR\":%u}",
+             (int)rZ.ofst, rZ.pStdAbbrev, rZ.pDstAbbrev,
+             rZ.startWk, (uint32_t)dowSun, rZ.startMonth, rZ.startHour,
+             rZ.endWk, (uint32_t)dowSun, rZ.endMonth, rZ.endHour);
+
+    HTTPClient http;
+    http.begin(url);
+    http.addHeader("Authorization", String("Bearer ") + REST_TOKEN);
+    http.addHeader("Content-Type", "application/json");
+    int code = http.PUT(body);
+    http.end();
+    return code == 200;
+} // End PutZone().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// PutTask()
+//
+// Switches between the two zones with REST PUTs until the test is over.
+// Every 100th change also replaces the UTC get callback.  A failed PUT is
+// counted as an error.
+/////////////////////////////////////////////////////////////////////////////////
+void PutTask(void *pArg)
+{
+    for (uint32_t i = 0; !gDone; i++)
+    {
+        if (PutZone(ZONES[i & 1]))
+        {
+            gChanges++;
+        }
+        else
+        {
+            gErrors++;
+        }
+        if (i % 100 == 0)
+        {
+            gpWtm->SetUtcGetCallback([]() { gCallbacks++; return time(NULL); });
+        }
+        vTaskDelay(pdMS_TO_TICKS(PUT_MS));
+    }
+    vTaskDelete(NULL);
+} // End PutTask().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// ReaderTask()
+//
+// Checks reads until the test is over.
+/////////////////////////////////////////////////////////////////////////////////
+void ReaderTask(void *pArg)
+{
+    uint32_t version = 0;
+    for (uint32_t i = 0; !gDone; i++)
+    {
+        CheckOnce(&version, i % 64 == 0);
+        if (i % 64 == 0)
+        {
+            vTaskDelay(1);
+        }
+    }
+    vTaskDelete(NULL);
+} // End ReaderTask().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// setup()
+//
+// The Arduino setup() function.  Initializes WiFiTimeManager and starts the
+// test tasks.  With USE_REST, it first waits for the network connection.
+/////////////////////////////////////////////////////////////////////////////////
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println("\n Starting");
+
+    gpWtm = WiFiTimeManager::Instance();
+    if (USE_REST)
+    {
+        // The service task serves the PUTs, so loop() doesn't have to.
+        gpWtm->SetRestApi(true, REST_TOKEN);
+        gpWtm->SetServiceTask(1);
+    }
+    gpWtm->Init(AP_NAME);
+    SetZone(ZONES[0]);
+    gpWtm->SetUtcGetCallback([]() { gCallbacks++; return time(NULL); });
+    if (USE_REST)
+    {
+        gpWtm->setConfigPortalBlocking(false);
+        gpWtm->setConfigPortalTimeout(0);
+        gpWtm->autoConnect();
+        while (!gpWtm->IsConnected())
+        {
+            delay(100);
+        }
+        Serial.printf("Sending REST PUTs to %s\n", WiFi.localIP().toString().c_str());
+    }
+
+    // The writer and one reader share core 0 at different priorities, so
+    // the reader often preempts the writer part way through a change.  The
+    // other reader runs on core 1 alongside loop().
+    xTaskCreatePinnedToCore(USE_REST ? PutTask : WriterTask, "Writer",
+                            USE_REST ? 2 * TASK_STACK : TASK_STACK, NULL, 1, NULL, 0);
+    xTaskCreatePinnedToCore(ReaderTask, "Reader0", TASK_STACK, NULL, 2, NULL, 0);
+    xTaskCreatePinnedToCore(ReaderTask, "Reader1", TASK_STACK, NULL, 1, NULL, 1);
+} // End setup().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// loop()
+//
+// The Arduino loop() function.  Checks reads too, and prints the results.
+/////////////////////////////////////////////////////////////////////////////////
+void loop()
+{
+    static uint32_t version = 0;
+    static uint32_t startTime = millis();
+    static uint32_t lastTime = startTime;
+    uint32_t thisTime = millis();
+
+    if (gDone)
+    {
+        delay(1000);
+        return;
+    }
+
+    CheckOnce(&version, true);
+    if (thisTime - lastTime >= 5000)
+    {
+        lastTime = thisTime;
+        Serial.printf("%3u s: %u zone changes, %u reads, %u callbacks, %u errors\n",
+                      (thisTime - startTime) / 1000, gChanges.load(), gReads.load(),
+                      gCallbacks.load(), gErrors.load());
+        if (thisTime - startTime >= TEST_SECONDS * 1000)
+        {
+            gDone = true;
+            Serial.println(gErrors == 0 ? "PASSED" : "FAILED");
+        }
+    }
+} // End loop().
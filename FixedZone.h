@@ -0,0 +1,272 @@
+/////////////////////////////////////////////////////////////////////////////////
+// FixedZone.h
+//
+// This file implements the FixedZone template class.  A FixedZone describes a
+// timezone that is fixed when the program is compiled.  Its POSIX TZ string,
+// its abbreviations, and a table of its DST transitions are all computed by
+// the compiler and placed in flash.  Installing one via
+// WiFiTimeManager::SetFixedZone() lets headless builds skip the Setup page
+// timezone parameters, NVS storage of the timezone data, and the run time
+// formatting of the TZ string and computation of the transitions.
+//
+// Since strings can't be template arguments, the zone abbreviations are
+// numeric, in the style used by the tz database for zones that have no
+// well known abbreviation (e.g. "-0500" and "-0400" for US Eastern time).
+//
+// Example:
+//     // US Eastern time.  DST starts the 2nd Sunday of March at 2 AM and ends
+//     // the 1st Sunday of November at 2 AM.
+//     typedef FixedZone<-300, -240,
+//                       ZoneRule<mMar, wkSecond, dowSun, 2>,
+//                       ZoneRule<mNov, wkFirst,  dowSun, 2> > EasternZone;
+//
+//     // India.  No DST.
+//     typedef FixedZone<330> IndiaZone;
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined FIXEDZONE_H
+#define FIXEDZONE_H
+
+#include <stdint.h>             // For integer types.
+#include <stddef.h>             // For size_t.
+#include "TimeMath.h"           // For calendar calculations.
+#include "DstTable.h"           // For DstRule and DstTransition.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// ZoneRule
+//
+// A DST start or end rule.  Same meaning as the POSIX "Mm.w.d/h" rule format.
+//
+// Template arguments:
+//   Month - 1=Jan, 2=Feb, ... 12=Dec
+//   Week  - 1 - 4, or 5 for the last week of the month.
+//   Dow   - day of week, 0 = Sun, 1 = Mon, ... 6 = Sat.
+//   Hour  - 0-23 local time.  Standard time for the start rule, and DST for
+//           the end rule.
+/////////////////////////////////////////////////////////////////////////////////
+template <uint8_t Month, uint8_t Week, uint8_t Dow, uint8_t Hour>
+struct ZoneRule
+{
+    static_assert((Month >= 1) && (Month <= 12), "ZoneRule month must be 1 - 12.");
+    static_assert((Week >= 1) && (Week <= 5), "ZoneRule week must be 1 - 5.");
+    static_assert(Dow <= 6, "ZoneRule day of week must be 0 - 6.");
+    static_assert(Hour <= 23, "ZoneRule hour must be 0 - 23.");
+
+    static const bool    VALID = true;
+    static const uint8_t MONTH = Month;
+    static const uint8_t WEEK  = Week;
+    static const uint8_t DOW   = Dow;
+    static const uint8_t HOUR  = Hour;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// NoDstRule
+//
+// Placeholder rule for zones that do not observe DST.
+/////////////////////////////////////////////////////////////////////////////////
+struct NoDstRule
+{
+    static const bool    VALID = false;
+    static const uint8_t MONTH = 1;
+    static const uint8_t WEEK  = 1;
+    static const uint8_t DOW   = 0;
+    static const uint8_t HOUR  = 0;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// FzArray
+//
+// Generates a compile time array from a generator class.  The generator
+// supplies the element type as Type, and element i as At(i).  Used by
+// FixedZone.
+/////////////////////////////////////////////////////////////////////////////////
+template <size_t... I> struct FzIndices {};
+template <size_t N, size_t... I> struct FzMakeIndices : FzMakeIndices<N - 1, N - 1, I...> {};
+template <size_t... I> struct FzMakeIndices<0, I...> { typedef FzIndices<I...> Type; };
+
+template <typename Gen, typename Idx> struct FzArray;
+template <typename Gen, size_t... I>
+struct FzArray<Gen, FzIndices<I...> >
+{
+    static constexpr typename Gen::Type VALUE[sizeof...(I)] = { Gen::At(I)... };
+};
+template <typename Gen, size_t... I>
+constexpr typename Gen::Type FzArray<Gen, FzIndices<I...> >::VALUE[sizeof...(I)];
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// FixedZone
+//
+// Template arguments:
+//   StdOfst - Standard time offset from UTC in minutes (e.g. -300).
+//   DstOfst - DST offset from UTC in minutes (e.g. -240).  Ignored without DST.
+//   Start   - ZoneRule for starting DST, or NoDstRule.
+//   End     - ZoneRule for ending DST, or NoDstRule.
+/////////////////////////////////////////////////////////////////////////////////
+template <int32_t StdOfst, int32_t DstOfst = StdOfst,
+          typename Start = NoDstRule, typename End = NoDstRule>
+class FixedZone
+{
+public:
+    static_assert((StdOfst >= -12 * 60) && (StdOfst <= 14 * 60),
+                  "FixedZone standard offset must be -720 to 840 minutes.");
+    static_assert((DstOfst >= -12 * 60) && (DstOfst <= 14 * 60),
+                  "FixedZone DST offset must be -720 to 840 minutes.");
+    static_assert(Start::VALID == End::VALID,
+                  "FixedZone needs both DST rules or neither.");
+
+    // Zone properties.
+    static const bool    USE_DST  = Start::VALID && (DstOfst != StdOfst);
+    static const int32_t STD_OFST = StdOfst;
+    static const int32_t DST_OFST = USE_DST ? DstOfst : StdOfst;
+
+    // The transition table covers NUM_YEARS years starting with FIRST_YEAR.
+    // Times outside of it are handled by evaluating the rules at run time.
+    static const int32_t FIRST_YEAR = 2024;
+    static const int32_t NUM_YEARS  = 24;
+    static const size_t  NUM_TRANSITIONS = USE_DST ? 2 * NUM_YEARS : 0;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Accessors for the compile time data.  All of it lives in flash.
+    //   GetTzString()    - The POSIX TZ string, e.g.
+    //                      "<-0500>+05:00<-0400>+04:00,M03.2.0/02,M11.1.0/02".
+    //   GetStdAbbrev()   - The standard time abbreviation, e.g. "-0500".
+    //   GetDstAbbrev()   - The DST abbreviation, e.g. "-0400".
+    //   GetTransitions() - The DST transitions (NUM_TRANSITIONS of them).
+    //   GetStartRule()   - The DST start rule.
+    //   GetEndRule()     - The DST end rule.
+    /////////////////////////////////////////////////////////////////////////////
+    static const char *GetTzString()             { return TzArray::VALUE; }
+    static const char *GetStdAbbrev()            { return StdAbbrevArray::VALUE; }
+    static const char *GetDstAbbrev()            { return DstAbbrevArray::VALUE; }
+    static const DstTransition *GetTransitions() { return TransitionArray::VALUE; }
+    static DstRule GetStartRule()
+        { DstRule r = { Start::MONTH, Start::WEEK, Start::DOW, Start::HOUR }; return r; }
+    static DstRule GetEndRule()
+        { DstRule r = { End::MONTH, End::WEEK, End::DOW, End::HOUR }; return r; }
+
+
+private:
+    // Fixed width fields of the TZ string:
+    //   "<-0500>+05:00" for each offset and ",M03.2.0/02" for each rule.
+    static const size_t OFST_LEN   = 13;
+    static const size_t RULE_LEN   = 11;
+    static const size_t TZ_LEN     = USE_DST ? 2 * OFST_LEN + 2 * RULE_LEN : OFST_LEN;
+    static const size_t ABBREV_LEN = 5;
+
+    static constexpr char Digit(int32_t v)
+    {
+        return (char)('0' + v % 10);
+    }
+    static constexpr int32_t Abs(int32_t v)
+    {
+        return v < 0 ? -v : v;
+    }
+
+    // Character j of an offset field.  The abbreviation uses the ISO sign
+    // convention, and the POSIX offset uses the opposite one.
+    static constexpr char OfstChar(int32_t ofst, size_t j)
+    {
+        return (j == 0) ? '<' :
+               (j == 1) ? (ofst < 0 ? '-' : '+') :
+               (j == 2) ? Digit(Abs(ofst) / 600) :
+               (j == 3) ? Digit(Abs(ofst) / 60) :
+               (j == 4) ? Digit((Abs(ofst) % 60) / 10) :
+               (j == 5) ? Digit(Abs(ofst) % 60) :
+               (j == 6) ? '>' :
+               (j == 7) ? (ofst > 0 ? '-' : '+') :
+               (j == 8) ? Digit(Abs(ofst) / 600) :
+               (j == 9) ? Digit(Abs(ofst) / 60) :
+               (j == 10) ? ':' :
+               (j == 11) ? Digit((Abs(ofst) % 60) / 10) : Digit(Abs(ofst) % 60);
+    }
+
+    // Character j of a rule field.
+    static constexpr char RuleChar(int32_t month, int32_t week, int32_t dow,
+                                   int32_t hour, size_t j)
+    {
+        return (j == 0) ? ',' :
+               (j == 1) ? 'M' :
+               (j == 2) ? Digit(month / 10) :
+               (j == 3) ? Digit(month) :
+               (j == 4) ? '.' :
+               (j == 5) ? Digit(week) :
+               (j == 6) ? '.' :
+               (j == 7) ? Digit(dow) :
+               (j == 8) ? '/' :
+               (j == 9) ? Digit(hour / 10) : Digit(hour);
+    }
+
+    // The two transitions of a year, in time order.  The order differs
+    // between the northern and southern hemispheres.
+    static constexpr int64_t StartUtc(int32_t year)
+    {
+        return TimeMath::RuleUtc(year, Start::MONTH, Start::WEEK, Start::DOW,
+                                 Start::HOUR, STD_OFST);
+    }
+    static constexpr int64_t EndUtc(int32_t year)
+    {
+        return TimeMath::RuleUtc(year, End::MONTH, End::WEEK, End::DOW,
+                                 End::HOUR, DST_OFST);
+    }
+    static constexpr DstTransition MakeTransition(bool isStart, int32_t year)
+    {
+        return isStart ? DstTransition{ StartUtc(year), DST_OFST, true } :
+                         DstTransition{ EndUtc(year), STD_OFST, false };
+    }
+    static constexpr DstTransition YearTransition(int32_t year, bool second)
+    {
+        return MakeTransition((StartUtc(year) < EndUtc(year)) != second, year);
+    }
+
+    // Array generators.  See FzArray.
+    struct TzGen
+    {
+        typedef char Type;
+        static constexpr char At(size_t i)
+        {
+            return (i >= TZ_LEN) ? '\0' :
+                   (i < OFST_LEN) ? OfstChar(STD_OFST, i) :
+                   (i < 2 * OFST_LEN) ? OfstChar(DST_OFST, i - OFST_LEN) :
+                   (i < 2 * OFST_LEN + RULE_LEN) ?
+                       RuleChar(Start::MONTH, Start::WEEK, Start::DOW, Start::HOUR,
+                                i - 2 * OFST_LEN) :
+                       RuleChar(End::MONTH, End::WEEK, End::DOW, End::HOUR,
+                                i - 2 * OFST_LEN - RULE_LEN);
+        }
+    };
+    struct StdAbbrevGen
+    {
+        typedef char Type;
+        static constexpr char At(size_t i)
+            { return (i >= ABBREV_LEN) ? '\0' : OfstChar(STD_OFST, i + 1); }
+    };
+    struct DstAbbrevGen
+    {
+        typedef char Type;
+        static constexpr char At(size_t i)
+            { return (i >= ABBREV_LEN) ? '\0' : OfstChar(DST_OFST, i + 1); }
+    };
+    struct TransitionGen
+    {
+        typedef DstTransition Type;
+        static constexpr DstTransition At(size_t i)
+            { return YearTransition(FIRST_YEAR + (int32_t)(i / 2), (i % 2) != 0); }
+    };
+
+    typedef FzArray<TzGen, typename FzMakeIndices<TZ_LEN + 1>::Type> TzArray;
+    typedef FzArray<StdAbbrevGen, typename FzMakeIndices<ABBREV_LEN + 1>::Type> StdAbbrevArray;
+    typedef FzArray<DstAbbrevGen, typename FzMakeIndices<ABBREV_LEN + 1>::Type> DstAbbrevArray;
+    typedef FzArray<TransitionGen, typename FzMakeIndices<2 * NUM_YEARS>::Type> TransitionArray;
+
+}; // End class FixedZone.
+
+
+#endif // FIXEDZONE_H
@@ -0,0 +1,168 @@
+/////////////////////////////////////////////////////////////////////////////////
+// LogBuffer.cpp
+//
+// This file implements the LogBuffer class.  See LogBuffer.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "LogBuffer.h"          // For LogBuffer class.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+/////////////////////////////////////////////////////////////////////////////
+LogBuffer::LogBuffer() : m_Head(0), m_Used(0), m_Dropped(0), m_Task(NULL)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Begin()
+//
+// Starts the drain task.  Does nothing if it is already running.
+//
+// Arguments:
+//   priority - The FreeRTOS priority of the drain task.
+//
+// Returns:
+//   Returns true if the drain task is running, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool LogBuffer::Begin(UBaseType_t priority)
+{
+    TaskHandle_t task = NULL;
+    if ((m_Task == NULL) &&
+        (xTaskCreatePinnedToCore(DrainTask, "WTM Log", TASK_STACK, this, priority,
+                                 &task, tskNO_AFFINITY) == pdPASS))
+    {
+        portENTER_CRITICAL(&m_Mux);
+        m_Task = task;
+        portEXIT_CRITICAL(&m_Mux);
+    }
+    return m_Task != NULL;
+} // End Begin().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Write()
+//
+// Adds a message, made of a prefix and a body, to the buffer.  Never
+// blocks.  The message is added whole or not at all.
+//
+// Arguments:
+//   pPrefix - The NULL terminated prefix.
+//   pBody   - The body.
+//   len     - The number of characters in the body.
+//
+// Returns:
+//   Returns true if the message was added or dropped, or false if the
+//   drain task isn't running.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool LogBuffer::Write(const char *pPrefix, const char *pBody, size_t len)
+{
+    size_t prefixLen = strlen(pPrefix);
+    bool added = false;
+
+    portENTER_CRITICAL(&m_Mux);
+    TaskHandle_t task = m_Task;
+    if (task != NULL)
+    {
+        if (prefixLen + len <= BUFFER_SIZE - m_Used)
+        {
+            Put(pPrefix, prefixLen);
+            Put(pBody, len);
+            added = true;
+        }
+        else
+        {
+            m_Dropped++;
+        }
+    }
+    portEXIT_CRITICAL(&m_Mux);
+
+    if (added)
+    {
+        xTaskNotifyGive(task);
+    }
+    return task != NULL;
+} // End Write().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Put()
+//
+// Copies data into the buffer at m_Head.  Must be called in the critical
+// section with room for len characters.
+/////////////////////////////////////////////////////////////////////////////
+void LogBuffer::Put(const char *pData, size_t len)
+{
+    size_t first = BUFFER_SIZE - m_Head;
+    first = len < first ? len : first;
+    memcpy(&m_Buf[m_Head], pData, first);
+    memcpy(&m_Buf[0], pData + first, len - first);
+    m_Head = (m_Head + len) % BUFFER_SIZE;
+    m_Used += len;
+} // End Put().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Take()
+//
+// Copies up to max characters out of the buffer.
+//
+// Returns:
+//   Returns the number of characters copied.
+//
+/////////////////////////////////////////////////////////////////////////////
+size_t LogBuffer::Take(char *pData, size_t max)
+{
+    portENTER_CRITICAL(&m_Mux);
+    size_t tail = (m_Head + BUFFER_SIZE - m_Used) % BUFFER_SIZE;
+    size_t len = m_Used < max ? m_Used : max;
+    len = len < BUFFER_SIZE - tail ? len : BUFFER_SIZE - tail;
+    memcpy(pData, &m_Buf[tail], len);
+    m_Used -= len;
+    portEXIT_CRITICAL(&m_Mux);
+    return len;
+} // End Take().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DrainTask()
+//
+// Waits for messages and writes them to Serial.  Only this task ever waits
+// on the UART.
+//
+// Arguments:
+//   pArg - Pointer to the LogBuffer.
+//
+/////////////////////////////////////////////////////////////////////////////
+void LogBuffer::DrainTask(void *pArg)
+{
+    LogBuffer *pLb = static_cast<LogBuffer *>(pArg);
+    uint32_t reported = 0;
+    char chunk[64];
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        size_t len;
+        while ((len = pLb->Take(chunk, sizeof(chunk))) != 0)
+        {
+            Serial.write((const uint8_t *)chunk, len);
+        }
+
+        uint32_t dropped = pLb->m_Dropped;
+        if (dropped != reported)
+        {
+            Serial.printf("[WTM] %u messages dropped.\n", (unsigned)(dropped - reported));
+            reported = dropped;
+        }
+    }
+} // End DrainTask().
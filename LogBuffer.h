@@ -0,0 +1,111 @@
+/////////////////////////////////////////////////////////////////////////////////
+// LogBuffer.h
+//
+// This file implements the LogBuffer class.  A LogBuffer holds status
+// messages in a fixed size ring buffer, from which a low priority task writes
+// them to Serial.  Writing a message is a short copy inside of a critical
+// section, so the caller never waits on the UART.  If the buffer is full, the
+// message is dropped and counted, and the drain task reports the count once
+// it catches up.
+//
+// Until Begin() is called, or if the drain task couldn't be started, Write()
+// fails and the caller should print the message itself.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include "WiFiTimeManagerConfig.h" // For WTM_LOG_BUFFER_SIZE.
+#include <Arduino.h>            // For Serial.
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include <freertos/task.h>      // For the drain task.
+
+
+class LogBuffer
+{
+public:
+    // The size of the ring buffer.
+    static const size_t BUFFER_SIZE = WTM_LOG_BUFFER_SIZE;
+
+    // The drain task's stack size.
+    static const uint32_t TASK_STACK = 2048;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    /////////////////////////////////////////////////////////////////////////////
+    LogBuffer();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Begin()
+    //
+    // Starts the drain task.  Does nothing if it is already running.
+    //
+    // Arguments:
+    //   priority - The FreeRTOS priority of the drain task.
+    //
+    // Returns:
+    //   Returns true if the drain task is running, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Begin(UBaseType_t priority);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Write()
+    //
+    // Adds a message, made of a prefix and a body, to the buffer.  Never
+    // blocks.  The message is added whole or not at all.
+    //
+    // Arguments:
+    //   pPrefix - The NULL terminated prefix.
+    //   pBody   - The body.
+    //   len     - The number of characters in the body.
+    //
+    // Returns:
+    //   Returns true if the message was added or dropped, or false if the
+    //   drain task isn't running.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Write(const char *pPrefix, const char *pBody, size_t len);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetDropped()
+    //
+    // Returns the number of messages dropped because the buffer was full.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetDropped() const { return m_Dropped; }
+
+
+private:
+    // Unimplemented methods.  Copying a buffer makes no sense.
+    LogBuffer(const LogBuffer &rLb);
+    LogBuffer &operator=(const LogBuffer &rLb);
+
+    // Copies data into the buffer at m_Head.  Must be called in the critical
+    // section with room for len characters.
+    void Put(const char *pData, size_t len);
+
+    // Copies up to max characters out of the buffer.  Returns the number
+    // copied.
+    size_t Take(char *pData, size_t max);
+
+    // The drain task.
+    static void DrainTask(void *pArg);
+
+    char          m_Buf[BUFFER_SIZE]; // The ring buffer.
+    size_t        m_Head;             // Index of the next character written.
+    size_t        m_Used;             // Number of characters held.
+    uint32_t      m_Dropped;          // Number of messages dropped.
+    portMUX_TYPE  m_Mux;              // Guards the above.
+    TaskHandle_t  m_Task;             // The drain task.
+
+}; // End class LogBuffer.
+
+
+#endif // LOGBUFFER_H
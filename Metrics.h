@@ -0,0 +1,150 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Metrics.h
+//
+// This file implements the Log2Histogram class and the WtmMetrics structure,
+// which hold the statistics that WiFiTimeManager collects about itself (see
+// WiFiTimeManager::GetMetrics()).
+//
+// A Log2Histogram counts values into power of two buckets.  Bucket 0 counts
+// zeros, and bucket n counts values from 2^(n-1) to 2^n - 1, so 33 buckets
+// cover every uint32_t value.  Adding a value is a count leading zeros
+// instruction and a few adds, with no loops or divides, and the whole
+// histogram is a fixed size.  Percentiles come out to within a factor of two,
+// which is plenty to tell a 5 ms sync from a 500 ms one.
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined METRICS_H
+#define METRICS_H
+
+#include <stdint.h>             // For integer types.
+#include <string.h>             // For memset().
+
+
+class Log2Histogram
+{
+public:
+    // The number of buckets.
+    static const uint32_t NUM_BUCKETS = 33;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    /////////////////////////////////////////////////////////////////////////////
+    Log2Histogram() { Reset(); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Reset()
+    //
+    // Empties the histogram.
+    /////////////////////////////////////////////////////////////////////////////
+    void Reset()
+    {
+        memset(m_Buckets, 0, sizeof(m_Buckets));
+        m_Count = 0;
+        m_Min   = UINT32_MAX;
+        m_Max   = 0;
+        m_Sum   = 0;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Add()
+    //
+    // Adds a value to the histogram.
+    /////////////////////////////////////////////////////////////////////////////
+    void Add(uint32_t v)
+    {
+        m_Buckets[BucketOf(v)]++;
+        m_Count++;
+        m_Sum += v;
+        m_Min = v < m_Min ? v : m_Min;
+        m_Max = v > m_Max ? v : m_Max;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Getters.  GetMin() returns 0 if the histogram is empty.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetCount() const { return m_Count; }
+    uint32_t GetMin()   const { return m_Count != 0 ? m_Min : 0; }
+    uint32_t GetMax()   const { return m_Max; }
+    uint32_t GetMean()  const { return m_Count != 0 ? (uint32_t)(m_Sum / m_Count) : 0; }
+    uint32_t GetBucket(uint32_t i) const { return i < NUM_BUCKETS ? m_Buckets[i] : 0; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetPercentile()
+    //
+    // Returns an upper bound on the specified percentile: the top of the
+    // bucket holding it, or the largest value seen if that is smaller.
+    //
+    // Arguments:
+    //   percent - The percentile of interest, 0 - 100.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetPercentile(uint32_t percent) const
+    {
+        uint64_t target = ((uint64_t)m_Count * percent + 99) / 100;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; i++)
+        {
+            seen += m_Buckets[i];
+            if ((seen >= target) && (seen != 0))
+            {
+                uint32_t top = i == 0 ? 0 : i == 32 ? UINT32_MAX : (1UL << i) - 1;
+                return top < m_Max ? top : m_Max;
+            }
+        }
+        return 0;
+    }
+
+
+private:
+    // Returns the bucket that counts v.
+    static uint32_t BucketOf(uint32_t v) { return v == 0 ? 0 : 32 - __builtin_clz(v); }
+
+    uint32_t m_Buckets[NUM_BUCKETS];    // Counts.
+    uint32_t m_Count;                   // Number of values added.
+    uint32_t m_Min;                     // Smallest value added.
+    uint32_t m_Max;                     // Largest value added.
+    uint64_t m_Sum;                     // Sum of the values added.
+
+}; // End class Log2Histogram.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// WtmMetrics structure
+//
+// The statistics that WiFiTimeManager collects.  All times are in
+// microseconds unless noted.
+/////////////////////////////////////////////////////////////////////////////////
+struct WtmMetrics
+{
+    uint32_t      m_SinceMs;            // millis() when collection started.
+    uint32_t      m_Syncs;              // Number of NTP syncs.
+    int64_t       m_LastOffsetUs;       // Correction made by the last sync.
+    Log2Histogram m_SyncOffsetUs;       // Size of the correction of each sync.
+    Log2Histogram m_SyncDelayUs;        // Round trip delay of each NTP probe sync.
+                                        // SNTP library syncs don't report it.
+    Log2Histogram m_SyncIntervalSec;    // Seconds between syncs.
+    uint32_t      m_LastSyncMs;         // millis() of the last sync.
+    uint32_t      m_ForcedSyncs;        // Number of syncs forced by us.
+    Log2Histogram m_RtcReadUs;          // Time taken by the UtcGetCallback.
+    uint32_t      m_NvsWrites;          // Number of NVS writes by Save().
+    Log2Histogram m_NvsWriteUs;         // Time taken by each NVS write.
+    Log2Histogram m_PageBuildUs;        // Time taken to build the Setup page.
+    uint32_t      m_LocalTimeCalls;     // Number of GetLocalTime() calls.
+    uint32_t      m_PpsEdges;           // Number of PPS edges used.
+    uint32_t      m_PpsIgnored;         // Number of PPS edges ignored.
+    uint32_t      m_PpsLockLosses;      // Number of times the PPS lock was lost.
+    Log2Histogram m_PpsErrUs;           // Clock error at each PPS edge used.
+};
+
+
+#endif // METRICS_H
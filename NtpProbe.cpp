@@ -0,0 +1,282 @@
+/////////////////////////////////////////////////////////////////////////////////
+// NtpProbe.cpp
+//
+// This file implements the NtpProbe class.  See NtpProbe.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "NtpProbe.h"           // For NtpProbe class.
+#include <esp_timer.h>          // For esp_timer_get_time().
+#include <sys/time.h>           // For gettimeofday().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Run()
+//
+// Probes the specified servers.  Blocks for up to TIMEOUT_MS plus the time
+// needed for DNS lookups.
+//
+// Arguments:
+//   pNames  - Array of pointers to the server names.  Empty names are
+//             skipped.
+//   count   - The number of names (at most MAX_SERVERS).
+//   pResult - Pointer to where the result is returned.
+//
+// Returns:
+//   Returns true if any server replied, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool NtpProbe::Run(const char *const *pNames, size_t count, Result *pResult)
+{
+    IPAddress addr[MAX_SERVERS];
+    int64_t   sentUs[MAX_SERVERS];
+    int64_t   nonce[MAX_SERVERS];
+    bool      sent[MAX_SERVERS]    = { false };
+    bool      replied[MAX_SERVERS] = { false };
+    size_t    expected = 0;
+    count = count < MAX_SERVERS ? count : MAX_SERVERS;
+
+    WiFiUDP udp;
+    if (!udp.begin(LOCAL_PORT))
+    {
+        return false;
+    }
+
+    // Look up all of the names first, so that the requests all go out
+    // together and no reply sits unread while we wait on DNS.
+    bool found[MAX_SERVERS] = { false };
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((pNames[i] != NULL) && (pNames[i][0] != '\0'))
+        {
+            found[i] = WiFi.hostByName(pNames[i], addr[i]) == 1;
+            if (!found[i])
+            {
+                m_Stats[i].m_Failures++;
+            }
+        }
+    }
+
+    // Send the requests.  Each request's transmit timestamp holds our send
+    // time (plus the server index), which the server echoes back as the
+    // originate timestamp.  This matches replies to requests, and rejects
+    // stale or spoofed replies.
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!found[i])
+        {
+            continue;
+        }
+        uint8_t packet[PACKET_SIZE] = { 0 };
+        packet[0] = 0x23;                       // LI = 0, VN = 4, Mode = 3.
+        sentUs[i] = esp_timer_get_time();
+        nonce[i]  = (sentUs[i] << 8) | (int64_t)i;
+        for (size_t b = 0; b < 8; b++)
+        {
+            packet[40 + b] = (uint8_t)(nonce[i] >> (56 - 8 * b));
+        }
+        if (udp.beginPacket(addr[i], NTP_PORT) && (udp.write(packet, PACKET_SIZE) == PACKET_SIZE) &&
+            udp.endPacket())
+        {
+            sent[i] = true;
+            m_Stats[i].m_Queries++;
+            expected += IsFailing(i) ? 0 : 1;
+        }
+    }
+
+    // Collect replies until every healthy server has answered, or the grace
+    // period after the first reply runs out, or we time out.
+    int32_t  bestDistUs = INT32_MAX;
+    size_t   best       = MAX_SERVERS;
+    size_t   heard      = 0;
+    uint32_t startMs    = millis();
+    uint32_t firstMs    = 0;
+    while (millis() - startMs < TIMEOUT_MS)
+    {
+        if ((best < MAX_SERVERS) &&
+            ((heard >= expected) || (millis() - firstMs >= GRACE_MS)))
+        {
+            break;
+        }
+
+        if (udp.parsePacket() <= 0)
+        {
+            delay(1);
+            continue;
+        }
+        int64_t recvUs = esp_timer_get_time();
+        timeval sysTv;
+        gettimeofday(&sysTv, NULL);
+
+        uint8_t packet[PACKET_SIZE];
+        if (udp.read(packet, PACKET_SIZE) != (int)PACKET_SIZE)
+        {
+            continue;
+        }
+
+        // Which request is this the reply to?
+        int64_t originate = 0;
+        for (size_t b = 0; b < 8; b++)
+        {
+            originate = (originate << 8) | packet[24 + b];
+        }
+        size_t i = (size_t)(originate & 0xff);
+        if ((i >= count) || !sent[i] || replied[i] || (originate != nonce[i]))
+        {
+            continue;
+        }
+
+        // Reject unsynchronized servers and kiss-o'-death packets.
+        uint8_t leap    = packet[0] >> 6;
+        uint8_t mode    = packet[0] & 0x07;
+        uint8_t stratum = packet[1];
+        if ((mode != 4) || (leap == 3) || (stratum == 0) || (stratum > 15) ||
+            (Be32(&packet[40]) == 0))
+        {
+            continue;
+        }
+
+        // Standard NTP calculations.  The server received the request at t2
+        // and replied at t3, by its clock.
+        int64_t t2 = NtpToUnixUs(&packet[32]);
+        int64_t t3 = NtpToUnixUs(&packet[40]);
+        int64_t delayUs = (recvUs - sentUs[i]) - (t3 - t2);
+        delayUs = delayUs < 0 ? 0 : delayUs;
+        int64_t utcUs  = t3 + delayUs / 2;
+        int64_t distUs = delayUs / 2 + ShortToUs(&packet[4]) / 2 + ShortToUs(&packet[8]);
+
+        NtpServerStats &rStats = m_Stats[i];
+        heard += IsFailing(i) ? 0 : 1;
+        replied[i] = true;
+        rStats.m_Replies++;
+        rStats.m_Failures       = 0;
+        rStats.m_LastReplyMs    = millis();
+        rStats.m_LastDelayUs    = (int32_t)delayUs;
+        rStats.m_LastDistanceUs = (int32_t)distUs;
+        rStats.m_LastOffsetUs   = utcUs - ((int64_t)sysTv.tv_sec * 1000000 + sysTv.tv_usec);
+        rStats.m_Stratum        = stratum;
+
+        if (best == MAX_SERVERS)
+        {
+            firstMs = millis();
+        }
+        if (distUs < bestDistUs)
+        {
+            bestDistUs        = (int32_t)distUs;
+            best              = i;
+            pResult->m_Server = i;
+            pResult->m_UtcUs  = utcUs;
+            pResult->m_MonoUs = recvUs;
+        }
+    }
+    udp.stop();
+
+    // Count a failure against every server that did not answer.
+    for (size_t i = 0; i < count; i++)
+    {
+        if (sent[i] && !replied[i])
+        {
+            m_Stats[i].m_Failures++;
+        }
+    }
+
+    if (best == MAX_SERVERS)
+    {
+        return false;
+    }
+    m_Stats[best].m_Wins++;
+    return true;
+} // End Run().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetRanking()
+//
+// Orders the servers from best to worst.  Healthy servers come first,
+// ordered by their last synchronization distance, followed by servers
+// that have never been probed, followed by failing servers.
+//
+// Arguments:
+//   pNames - Array of pointers to the server names.  Empty names are left
+//            out of the ranking.
+//   count  - The number of names (at most MAX_SERVERS).
+//   pOrder - Pointer to room for count indices, best first.
+//
+// Returns:
+//   Returns the number of indices filled in.
+//
+/////////////////////////////////////////////////////////////////////////////
+size_t NtpProbe::GetRanking(const char *const *pNames, size_t count, size_t *pOrder) const
+{
+    int64_t key[MAX_SERVERS];
+    size_t  ranked = 0;
+    count = count < MAX_SERVERS ? count : MAX_SERVERS;
+
+    // Insertion sort.  There are only a few servers.
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((pNames[i] == NULL) || (pNames[i][0] == '\0'))
+        {
+            continue;
+        }
+
+        const NtpServerStats &rStats = m_Stats[i];
+        int64_t k = IsFailing(i) ? INT64_MAX :
+                    (rStats.m_Replies == 0) ? INT32_MAX : rStats.m_LastDistanceUs;
+        size_t j = ranked++;
+        while ((j > 0) && (key[j - 1] > k))
+        {
+            key[j]    = key[j - 1];
+            pOrder[j] = pOrder[j - 1];
+            j--;
+        }
+        key[j]    = k;
+        pOrder[j] = i;
+    }
+    return ranked;
+} // End GetRanking().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Be32()
+//
+// Returns the big endian 32 bit value pointed to by p.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t NtpProbe::Be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+} // End Be32().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// NtpToUnixUs()
+//
+// Converts the NTP timestamp (32 bits of seconds since 1900, and 32 bits of
+// fraction) pointed to by p to microseconds since January 1, 1970.  Values
+// with the top bit clear are taken to be past the 2036 NTP era rollover.
+/////////////////////////////////////////////////////////////////////////////
+int64_t NtpProbe::NtpToUnixUs(const uint8_t *p)
+{
+    int64_t secs = (int64_t)Be32(p) - NTP_UNIX_DELTA;
+    if ((p[0] & 0x80) == 0)
+    {
+        secs += (int64_t)1 << 32;
+    }
+    int64_t frac = (int64_t)(((uint64_t)Be32(p + 4) * 1000000) >> 32);
+    return secs * 1000000 + frac;
+} // End NtpToUnixUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ShortToUs()
+//
+// Converts the NTP short format value (16 bits of seconds, and 16 bits of
+// fraction) pointed to by p to microseconds.
+/////////////////////////////////////////////////////////////////////////////
+int64_t NtpProbe::ShortToUs(const uint8_t *p)
+{
+    return (int64_t)(((uint64_t)Be32(p) * 1000000) >> 16);
+} // End ShortToUs().
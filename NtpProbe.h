@@ -0,0 +1,167 @@
+/////////////////////////////////////////////////////////////////////////////////
+// NtpProbe.h
+//
+// This file implements the NtpProbe class.  An NtpProbe sends an SNTP request
+// to each of a list of NTP servers at the same time, and picks the reply with
+// the smallest synchronization distance (half the round trip delay, plus the
+// server's own root delay and dispersion).  The whole probe takes about as
+// long as the fastest server, plus a short grace period for better replies,
+// rather than the sum of every server's latency or timeouts.
+//
+// Statistics are kept for each server.  Servers that keep failing are still
+// queried, so that they can recover, but the probe no longer waits for them,
+// and they are ranked last when the servers are handed to the SNTP library.
+//
+// Run() blocks (for DNS lookups and replies), so it is meant to be called
+// from its own task.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined NTPPROBE_H
+#define NTPPROBE_H
+
+#include <Arduino.h>            // For Arduino types.
+#include <WiFi.h>               // For WiFiUDP and DNS lookups.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// NtpServerStats structure
+//
+// Statistics kept for each NTP server.
+/////////////////////////////////////////////////////////////////////////////////
+struct NtpServerStats
+{
+    uint32_t m_Queries;         // Number of requests sent.
+    uint32_t m_Replies;         // Number of valid replies received.
+    uint32_t m_Failures;        // Number of failed probes in a row.
+    uint32_t m_Wins;            // Number of probes won.
+    uint32_t m_LastReplyMs;     // millis() of the last valid reply.
+    int32_t  m_LastDelayUs;     // Round trip delay of the last reply.
+    int32_t  m_LastDistanceUs;  // Synchronization distance of the last reply.
+    int64_t  m_LastOffsetUs;    // Server minus system time at the last reply.
+    uint8_t  m_Stratum;         // Stratum of the last reply.
+};
+
+
+class NtpProbe
+{
+public:
+    // The most servers that may be probed.
+    static const size_t MAX_SERVERS = 4;
+
+    // The longest time to wait for replies.
+    static const uint32_t TIMEOUT_MS = 2000;
+
+    // Once a good reply is in, how much longer to wait for a better one.
+    static const uint32_t GRACE_MS = 200;
+
+    // A server that fails this many probes in a row is no longer waited for.
+    static const uint32_t FAILURE_LIMIT = 3;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Result structure
+    //
+    // The outcome of a successful probe.
+    /////////////////////////////////////////////////////////////////////////////
+    struct Result
+    {
+        size_t  m_Server;       // Index of the winning server.
+        int64_t m_UtcUs;        // UTC time, in microseconds, at m_MonoUs.
+        int64_t m_MonoUs;       // esp_timer_get_time() at which m_UtcUs was true.
+    };
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    /////////////////////////////////////////////////////////////////////////////
+    NtpProbe() : m_Stats() {}
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Run()
+    //
+    // Probes the specified servers.  Blocks for up to TIMEOUT_MS plus the time
+    // needed for DNS lookups.
+    //
+    // Arguments:
+    //   pNames  - Array of pointers to the server names.  Empty names are
+    //             skipped.
+    //   count   - The number of names (at most MAX_SERVERS).
+    //   pResult - Pointer to where the result is returned.
+    //
+    // Returns:
+    //   Returns true if any server replied, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Run(const char *const *pNames, size_t count, Result *pResult);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetRanking()
+    //
+    // Orders the servers from best to worst.  Healthy servers come first,
+    // ordered by their last synchronization distance, followed by servers
+    // that have never been probed, followed by failing servers.
+    //
+    // Arguments:
+    //   pNames - Array of pointers to the server names.  Empty names are left
+    //            out of the ranking.
+    //   count  - The number of names (at most MAX_SERVERS).
+    //   pOrder - Pointer to room for count indices, best first.
+    //
+    // Returns:
+    //   Returns the number of indices filled in.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    size_t GetRanking(const char *const *pNames, size_t count, size_t *pOrder) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetStats()
+    //
+    // Returns the statistics of the specified server, or NULL if the index
+    // is out of range.
+    /////////////////////////////////////////////////////////////////////////////
+    const NtpServerStats *GetStats(size_t server) const
+        { return server < MAX_SERVERS ? &m_Stats[server] : NULL; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ResetStats()
+    //
+    // Clears the statistics of the specified server.  Should be called when
+    // its name changes.
+    /////////////////////////////////////////////////////////////////////////////
+    void ResetStats(size_t server)
+        { if (server < MAX_SERVERS) { memset(&m_Stats[server], 0, sizeof(m_Stats[server])); } }
+
+
+private:
+    // Unimplemented methods.  Copying a probe makes no sense.
+    NtpProbe(const NtpProbe &rNp);
+    NtpProbe &operator=(const NtpProbe &rNp);
+
+    // SNTP packet layout.
+    static const size_t   PACKET_SIZE     = 48;
+    static const uint16_t NTP_PORT        = 123;
+    static const uint16_t LOCAL_PORT      = 2390;
+    static const uint32_t NTP_UNIX_DELTA  = 2208988800UL;
+
+    // Decoding helpers.
+    static uint32_t Be32(const uint8_t *p);
+    static int64_t  NtpToUnixUs(const uint8_t *p);
+    static int64_t  ShortToUs(const uint8_t *p);
+
+    // Returns true if the server is failing and should not be waited for.
+    bool IsFailing(size_t server) const
+        { return m_Stats[server].m_Failures >= FAILURE_LIMIT; }
+
+    NtpServerStats m_Stats[MAX_SERVERS];  // Per server statistics.
+
+}; // End class NtpProbe.
+
+
+#endif // NTPPROBE_H
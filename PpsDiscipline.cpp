@@ -0,0 +1,248 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PpsDiscipline.cpp
+//
+// This file implements the PpsDiscipline class.  See PpsDiscipline.h for
+// details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "PpsDiscipline.h"      // For PpsDiscipline class.
+#include "TimeMath.h"           // For FloorDiv().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+/////////////////////////////////////////////////////////////////////////////
+PpsDiscipline::PpsDiscipline(PrecisionClock &rClock) :
+                             m_rClock(rClock), m_Func(NULL), m_EdgeUs(-1),
+                             m_Task(NULL), m_ResetPending(false), m_Locked(false),
+                             m_AvgErrUs(0), m_LastUs(-1), m_LastUtcUs(0),
+                             m_WindowUs(-1), m_WindowUtcUs(0),
+                             m_WindowSec(MIN_WINDOW_SEC), m_Good(0), m_Glitches(0)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Begin()
+//
+// Starts the PPS task and attaches the interrupt.  Does nothing if it is
+// already running.
+//
+// Arguments:
+//   pin      - The GPIO pin that the PPS signal is connected to.
+//   edge     - The edge of the signal that marks the start of a second
+//              (RISING or FALLING).
+//   priority - The FreeRTOS priority of the PPS task.
+//   func     - Function called after each edge.  May be NULL.
+//
+// Returns:
+//   Returns true if the PPS task is running, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool PpsDiscipline::Begin(int pin, int edge, UBaseType_t priority, EdgeFunc_t func)
+{
+    if (m_Task != NULL)
+    {
+        return true;
+    }
+    m_Func = func;
+    if (xTaskCreatePinnedToCore(Task, "WTM PPS", TASK_STACK, this, priority,
+                                &m_Task, tskNO_AFFINITY) != pdPASS)
+    {
+        m_Task = NULL;
+        return false;
+    }
+
+    // Attach the interrupt once the task exists for it to notify.
+    pinMode(pin, INPUT);
+    attachInterruptArg(pin, OnPps, this, edge);
+    return true;
+} // End Begin().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// OnEdge()
+//
+// Handles an edge.  Labels it with the nearest UTC second, checks it against
+// the last good edge, syncs the clock to it, and updates the lock and the
+// rate measurement.
+//
+// Arguments:
+//   edgeUs - The esp_timer time of the edge.
+//   pErrUs - Pointer to where the clock's error at the edge is returned.
+//
+// Returns:
+//   Returns true if the edge was used, or false if it was ignored.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool PpsDiscipline::OnEdge(int64_t edgeUs, int64_t *pErrUs)
+{
+    // The edges can't be labelled until the clock has been set.
+    if (!m_rClock.IsSynced())
+    {
+        return false;
+    }
+    int64_t clockUs = m_rClock.GetUtcMicros(edgeUs);
+    int64_t utcUs = TimeMath::FloorDiv(clockUs + USECS_PER_SEC / 2, USECS_PER_SEC) *
+                    USECS_PER_SEC;
+
+    if (m_LastUs >= 0)
+    {
+        int64_t dtUs = edgeUs - m_LastUs;
+        int64_t secs = (dtUs + USECS_PER_SEC / 2) / USECS_PER_SEC;
+        int64_t offUs = dtUs - secs * USECS_PER_SEC;
+        offUs = offUs < 0 ? -offUs : offUs;
+        if ((secs < 1) || (offUs > secs * MAX_JITTER_PPM))
+        {
+            // A glitch.  If they keep coming, the signal has moved.
+            if (++m_Glitches < MAX_GLITCHES)
+            {
+                return false;
+            }
+            Restart();
+        }
+        else if (utcUs - m_LastUtcUs != secs * USECS_PER_SEC)
+        {
+            // The clock was corrected, so the old labels were wrong.
+            Restart();
+        }
+    }
+    m_Glitches = 0;
+
+    int64_t errUs = utcUs - clockUs;
+    int64_t absErrUs = errUs < 0 ? -errUs : errUs;
+    *pErrUs = errUs;
+    m_rClock.Sync(utcUs, edgeUs, true);
+    m_LastUs = edgeUs;
+    m_LastUtcUs = utcUs;
+    m_AvgErrUs = (uint32_t)(((int64_t)m_AvgErrUs * 7 + absErrUs) / 8);
+
+    // Update the lock.
+    m_Good = absErrUs <= LOCK_ERR_US ? m_Good + 1 : 0;
+    if (absErrUs > UNLOCK_ERR_US)
+    {
+        m_Locked = false;
+    }
+    else if (m_Good >= LOCK_EDGES)
+    {
+        m_Locked = true;
+    }
+
+    // Measure the esp_timer's rate over the window, and correct for it.
+    if (m_WindowUs < 0)
+    {
+        m_WindowUs = edgeUs;
+        m_WindowUtcUs = utcUs;
+    }
+    else if (utcUs - m_WindowUtcUs >= (int64_t)m_WindowSec * USECS_PER_SEC)
+    {
+        int64_t monoUs = edgeUs - m_WindowUs;
+        int64_t ratePpb = (utcUs - m_WindowUtcUs - monoUs) * 1000000000 / monoUs;
+        m_rClock.SetRate((int32_t)ratePpb, edgeUs);
+        m_WindowUs = edgeUs;
+        m_WindowUtcUs = utcUs;
+        m_WindowSec = m_WindowSec * 2 < MAX_WINDOW_SEC ? m_WindowSec * 2 : MAX_WINDOW_SEC;
+    }
+    return true;
+} // End OnEdge().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Restart()
+//
+// Drops the lock and forgets the past edges.  The rate correction is kept,
+// since it is still the esp_timer's rate.
+/////////////////////////////////////////////////////////////////////////////
+void PpsDiscipline::Restart()
+{
+    m_Locked = false;
+    m_LastUs = -1;
+    m_WindowUs = -1;
+    m_WindowSec = MIN_WINDOW_SEC;
+    m_Good = 0;
+    m_Glitches = 0;
+} // End Restart().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// OnPps()
+//
+// The PPS interrupt handler.  Timestamps the edge and wakes the PPS task.
+//
+// Arguments:
+//   pArg - Pointer to the PpsDiscipline.
+//
+/////////////////////////////////////////////////////////////////////////////
+void IRAM_ATTR PpsDiscipline::OnPps(void *pArg)
+{
+    PpsDiscipline *pPd = static_cast<PpsDiscipline *>(pArg);
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&pPd->m_Mux);
+    pPd->m_EdgeUs = nowUs;
+    portEXIT_CRITICAL_ISR(&pPd->m_Mux);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(pPd->m_Task, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+} // End OnPps().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Task()
+//
+// Handles each edge, and drops the lock if the edges stop.
+//
+// Arguments:
+//   pArg - Pointer to the PpsDiscipline.
+//
+/////////////////////////////////////////////////////////////////////////////
+void PpsDiscipline::Task(void *pArg)
+{
+    PpsDiscipline *pPd = static_cast<PpsDiscipline *>(pArg);
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOST_SEC * 1000));
+
+        if (pPd->m_ResetPending)
+        {
+            pPd->m_ResetPending = false;
+            pPd->Restart();
+        }
+
+        portENTER_CRITICAL(&pPd->m_Mux);
+        int64_t edgeUs = pPd->m_EdgeUs;
+        pPd->m_EdgeUs = -1;
+        portEXIT_CRITICAL(&pPd->m_Mux);
+
+        if (edgeUs >= 0)
+        {
+            int64_t errUs = 0;
+            bool good = pPd->OnEdge(edgeUs, &errUs);
+            if (pPd->m_Func)
+            {
+                pPd->m_Func(good, pPd->m_Locked, errUs);
+            }
+        }
+
+        // Drop the lock if there hasn't been a good edge for a while.
+        if (pPd->m_Locked &&
+            (esp_timer_get_time() - pPd->m_LastUs > (int64_t)LOST_SEC * USECS_PER_SEC))
+        {
+            pPd->m_Locked = false;
+            pPd->m_Good = 0;
+            if (pPd->m_Func)
+            {
+                pPd->m_Func(false, false, 0);
+            }
+        }
+    }
+} // End Task().
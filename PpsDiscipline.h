@@ -0,0 +1,182 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PpsDiscipline.h
+//
+// This file implements the PpsDiscipline class.  A PpsDiscipline locks the
+// PrecisionClock to a one pulse per second (PPS) signal, such as that from a
+// GPS module or a DS3231's SQW pin, for microsecond class time.  An
+// interrupt timestamps each edge with esp_timer, and a task then:
+// - Labels the edge with the nearest UTC second, according to the clock.
+//   NTP (or any other fine sync) only has to get the clock to within half a
+//   second for this, so once locked, no network traffic is needed.
+// - Checks that the edge is a whole number of seconds after the last one,
+//   give or take MAX_JITTER_PPM.  Anything else is a glitch, and is ignored,
+//   unless it keeps happening, in which case the signal is taken to have
+//   moved and the lock starts over.
+// - Syncs the clock to the labelled edge.  Errors that small are slewed out
+//   within a few milliseconds.
+// - Measures the esp_timer's rate against the edges over windows of
+//   MIN_WINDOW_SEC, doubling up to MAX_WINDOW_SEC, and corrects the clock's
+//   rate to match, so that the clock stays right between edges.
+//
+// The clock is locked after LOCK_EDGES good edges in a row with an error under
+// LOCK_ERR_US, and unlocked after LOST_SEC without a good edge, or an error
+// over UNLOCK_ERR_US.  While unlocked, the edges still discipline the clock.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined PPSDISCIPLINE_H
+#define PPSDISCIPLINE_H
+
+#include <Arduino.h>            // For attachInterruptArg().
+#include <functional>           // For std::function.
+#include <esp_timer.h>          // For esp_timer_get_time().
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include <freertos/task.h>      // For the PPS task.
+#include "PrecisionClock.h"     // For UTC time.
+
+
+class PpsDiscipline
+{
+public:
+    // The PPS task's stack size.
+    static const uint32_t TASK_STACK = 3072;
+
+    // The most that the time between edges may differ from a whole number of
+    // seconds, in parts per million.
+    static const int64_t MAX_JITTER_PPM = 500;
+
+    // Consecutive glitches after which the signal is taken to have moved.
+    static const uint32_t MAX_GLITCHES = 3;
+
+    // Good edges in a row, with an error under LOCK_ERR_US, needed to lock.
+    static const uint32_t LOCK_EDGES = 4;
+    static const int64_t  LOCK_ERR_US = 100;
+
+    // Errors larger than this, in microseconds, lose the lock.
+    static const int64_t UNLOCK_ERR_US = 1000;
+
+    // Seconds without a good edge after which the lock is lost.
+    static const uint32_t LOST_SEC = 3;
+
+    // The shortest and longest rate measurement windows, in seconds.
+    static const uint32_t MIN_WINDOW_SEC = 8;
+    static const uint32_t MAX_WINDOW_SEC = 64;
+
+    // Called from the PPS task after each edge, and when the lock is lost
+    // for lack of edges.  good is true if the edge was used, locked is true
+    // if the clock is locked, and errUs is the clock's error at a good edge
+    // (positive if the clock was behind).
+    typedef std::function<void(bool good, bool locked, int64_t errUs)> EdgeFunc_t;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rClock - The clock to discipline.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    PpsDiscipline(PrecisionClock &rClock);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Begin()
+    //
+    // Starts the PPS task and attaches the interrupt.  Does nothing if it is
+    // already running.
+    //
+    // Arguments:
+    //   pin      - The GPIO pin that the PPS signal is connected to.
+    //   edge     - The edge of the signal that marks the start of a second
+    //              (RISING or FALLING).
+    //   priority - The FreeRTOS priority of the PPS task.
+    //   func     - Function called after each edge.  May be NULL.
+    //
+    // Returns:
+    //   Returns true if the PPS task is running, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Begin(int pin, int edge, UBaseType_t priority, EdgeFunc_t func);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Reset()
+    //
+    // Drops the lock, and starts over from the next edge.  Must be called
+    // when the clock is corrected by half a second or more, since the edges
+    // will have been labelled with the wrong seconds.  Never blocks.
+    /////////////////////////////////////////////////////////////////////////////
+    void Reset() { m_ResetPending = true; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsLocked()
+    //
+    // Returns true if the clock is locked to the PPS signal.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsLocked() const { return m_Locked; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetErrorUs()
+    //
+    // Returns the clock's typical error, in microseconds, at recent edges.
+    // A running average of the absolute error.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetErrorUs() const { return m_AvgErrUs; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetRatePpb()
+    //
+    // Returns the esp_timer rate correction, in parts per billion, from the
+    // last measurement window.  See PrecisionClock::SetRate().
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetRatePpb() const { return m_rClock.GetRatePpb(); }
+
+
+private:
+    // Unimplemented methods.  Copying a discipline makes no sense.
+    PpsDiscipline(const PpsDiscipline &rPd);
+    PpsDiscipline &operator=(const PpsDiscipline &rPd);
+
+    static const int64_t USECS_PER_SEC = PrecisionClock::USECS_PER_SEC;
+
+    // Handles an edge.  Returns true if it was used.
+    bool OnEdge(int64_t edgeUs, int64_t *pErrUs);
+
+    // Drops the lock and forgets the past edges.
+    void Restart();
+
+    // The PPS interrupt handler.
+    static void OnPps(void *pArg);
+
+    // The PPS task.
+    static void Task(void *pArg);
+
+    PrecisionClock &m_rClock;         // The clock being disciplined.
+    EdgeFunc_t    m_Func;             // Called after each edge.
+
+    // Shared with the interrupt handler.  Guarded by m_Mux.
+    int64_t       m_EdgeUs;           // esp_timer time of the last edge, or -1.
+    portMUX_TYPE  m_Mux;              // Guards the above.
+    TaskHandle_t  m_Task;             // The PPS task.
+
+    // Only written by the PPS task, except as noted.
+    volatile bool m_ResetPending;     // Set by Reset().
+    volatile bool m_Locked;           // true if locked.
+    volatile uint32_t m_AvgErrUs;     // Running average absolute error.
+    int64_t       m_LastUs;           // esp_timer time of the last good edge, or -1.
+    int64_t       m_LastUtcUs;        // UTC label of the last good edge.
+    int64_t       m_WindowUs;         // esp_timer time of the window start, or -1.
+    int64_t       m_WindowUtcUs;      // UTC label of the window start.
+    uint32_t      m_WindowSec;        // Length of the current window.
+    uint32_t      m_Good;             // Good edges in a row.
+    uint32_t      m_Glitches;         // Glitches in a row.
+
+}; // End class PpsDiscipline.
+
+
+#endif // PPSDISCIPLINE_H
@@ -0,0 +1,259 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PrecisionClock.cpp
+//
+// This file implements the PrecisionClock class.  See PrecisionClock.h for
+// details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "PrecisionClock.h"     // For PrecisionClock class.
+
+
+// A hold time that never holds.
+static const int64_t NO_HOLD = INT64_MIN;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+//
+// Until the first sync, the clock reads the time since boot.
+/////////////////////////////////////////////////////////////////////////////
+PrecisionClock::PrecisionClock() : m_Anchor(), m_Current(), m_Synced(false),
+                                   m_StepCount(0)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+
+    m_Current.m_MonoUs = 0;
+    m_Current.m_UtcUs  = 0;
+    m_Current.m_SlewUs = 0;
+    m_Current.m_HoldUs = NO_HOLD;
+    m_Current.m_RatePpb = 0;
+    m_Anchor.TryWrite(m_Current);
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Sync()
+//
+// Corrects the clock to the specified UTC time.
+//
+// Arguments:
+//   utcUs  - The UTC time, in microseconds since January 1, 1970.
+//   monoUs - The esp_timer_get_time() value at which utcUs was true.
+//   fine   - true if utcUs is accurate to well under a second (e.g. it
+//            came from NTP).  false if it only has whole second accuracy
+//            (e.g. it came from an RTC), in which case it is ignored
+//            unless the clock is off by a second or more.
+//
+/////////////////////////////////////////////////////////////////////////////
+void PrecisionClock::Sync(int64_t utcUs, int64_t monoUs, bool fine)
+{
+    // The critical section keeps readers on this core (including ISRs) from
+    // ever seeing a write in progress, and serializes writers.
+    portENTER_CRITICAL(&m_Mux);
+
+    // Start the new anchor where the old one leaves off, so that the clock
+    // is continuous unless we decide to step it.
+    int64_t nowUs = Evaluate(m_Current, monoUs);
+    int64_t deltaUs = utcUs - nowUs;
+    int64_t absDeltaUs = deltaUs < 0 ? -deltaUs : deltaUs;
+
+    if (fine || !m_Synced || (absDeltaUs >= USECS_PER_SEC))
+    {
+        Anchor anchor = { monoUs, nowUs, 0, NO_HOLD, m_Current.m_RatePpb };
+
+        if (!m_Synced)
+        {
+            // Nothing to be continuous with yet.  Just step.
+            anchor.m_UtcUs = utcUs;
+        }
+        else if (absDeltaUs <= SLEW_LIMIT_US)
+        {
+            anchor.m_SlewUs = deltaUs;
+        }
+        else if (deltaUs > 0)
+        {
+            anchor.m_UtcUs = utcUs;
+        }
+        else
+        {
+            // Going back.  Hold the clock still if it won't be too long.
+            anchor.m_UtcUs = utcUs;
+            if (absDeltaUs <= MAX_HOLD_US)
+            {
+                anchor.m_HoldUs = nowUs;
+            }
+            else
+            {
+                m_StepCount = m_StepCount + 1;
+            }
+        }
+
+        m_Synced = m_Synced || fine;
+        m_Current = anchor;
+        m_Anchor.TryWrite(anchor);
+    }
+
+    portEXIT_CRITICAL(&m_Mux);
+} // End Sync().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetRate()
+//
+// Sets how much faster than the esp_timer UTC advances, from the specified
+// esp_timer time on.  The clock is continuous across the change.  The rate
+// is kept across syncs.
+//
+// Arguments:
+//   ratePpb - The rate correction, in parts per billion.  Positive values
+//             mean that the esp_timer runs slow.  Limited to
+//             +/- MAX_RATE_PPB.
+//   monoUs  - The esp_timer_get_time() value at which the new rate takes
+//             effect.  Must be at or after the last sync.
+//
+/////////////////////////////////////////////////////////////////////////////
+void PrecisionClock::SetRate(int32_t ratePpb, int64_t monoUs)
+{
+    ratePpb = ratePpb > MAX_RATE_PPB ? MAX_RATE_PPB :
+              (ratePpb < -MAX_RATE_PPB ? -MAX_RATE_PPB : ratePpb);
+
+    portENTER_CRITICAL(&m_Mux);
+
+    // Rebase the anchor at monoUs, carrying over whatever slew and hold are
+    // still outstanding.
+    Anchor anchor = m_Current;
+    int64_t elapsedUs = monoUs - m_Current.m_MonoUs;
+    int64_t slewedUs = Slewed(m_Current, elapsedUs);
+    anchor.m_MonoUs  = monoUs;
+    anchor.m_UtcUs   = Unheld(m_Current, elapsedUs);
+    anchor.m_SlewUs -= slewedUs;
+    anchor.m_RatePpb = ratePpb;
+
+    m_Current = anchor;
+    m_Anchor.TryWrite(anchor);
+
+    portEXIT_CRITICAL(&m_Mux);
+} // End SetRate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUtcMicros()
+//
+// Returns the UTC time, in microseconds since January 1, 1970, at the
+// specified esp_timer time.  Never blocks.
+//
+// Arguments:
+//   monoUs - An esp_timer_get_time() value at or after the last sync.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t PrecisionClock::GetUtcMicros(int64_t monoUs) const
+{
+    // Writes only happen inside of a critical section, so a failed read means
+    // that the other core is in the middle of one.  It will be done shortly.
+    Anchor anchor;
+    while (!m_Anchor.TryRead(&anchor))
+    {
+    }
+    return Evaluate(anchor, monoUs);
+} // End GetUtcMicros().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUtcTimespec()
+//
+// Returns the current UTC time as a timespec.  Never blocks.
+//
+// Arguments:
+//   pTs - Pointer to where the time is returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+void PrecisionClock::GetUtcTimespec(timespec *pTs) const
+{
+    int64_t utcUs = GetUtcMicros();
+    int64_t secs  = utcUs / USECS_PER_SEC;
+    int64_t usecs = utcUs % USECS_PER_SEC;
+    if (usecs < 0)
+    {
+        secs--;
+        usecs += USECS_PER_SEC;
+    }
+    pTs->tv_sec  = (time_t)secs;
+    pTs->tv_nsec = (long)(usecs * 1000);
+} // End GetUtcTimespec().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Evaluate()
+//
+// Evaluates an anchor at the specified esp_timer time.
+//
+// Arguments:
+//   rAnchor - The anchor.
+//   monoUs  - The esp_timer time of interest.
+//
+// Returns:
+//   Returns the UTC time in microseconds at monoUs.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t PrecisionClock::Evaluate(const Anchor &rAnchor, int64_t monoUs)
+{
+    int64_t utcUs = Unheld(rAnchor, monoUs - rAnchor.m_MonoUs);
+    return utcUs > rAnchor.m_HoldUs ? utcUs : rAnchor.m_HoldUs;
+} // End Evaluate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Unheld()
+//
+// Evaluates an anchor, ignoring its hold.
+//
+// Arguments:
+//   rAnchor   - The anchor.
+//   elapsedUs - The esp_timer time since the anchor.
+//
+// Returns:
+//   Returns the UTC time in microseconds.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t PrecisionClock::Unheld(const Anchor &rAnchor, int64_t elapsedUs)
+{
+    int64_t utcUs = rAnchor.m_UtcUs + elapsedUs + Slewed(rAnchor, elapsedUs);
+    if (rAnchor.m_RatePpb != 0)
+    {
+        utcUs += elapsedUs * rAnchor.m_RatePpb / 1000000000;
+    }
+    return utcUs;
+} // End Unheld().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Slewed()
+//
+// Returns how much of an anchor's slew has taken effect.
+//
+// Arguments:
+//   rAnchor   - The anchor.
+//   elapsedUs - The esp_timer time since the anchor.
+//
+// Returns:
+//   Returns the slew applied so far, in microseconds, with the same sign as
+//   the anchor's slew.
+//
+/////////////////////////////////////////////////////////////////////////////
+int64_t PrecisionClock::Slewed(const Anchor &rAnchor, int64_t elapsedUs)
+{
+    if ((rAnchor.m_SlewUs == 0) || (elapsedUs <= 0))
+    {
+        return 0;
+    }
+    int64_t slewUs = elapsedUs * MAX_SLEW_PPM / USECS_PER_SEC;
+    if (rAnchor.m_SlewUs > 0)
+    {
+        return slewUs < rAnchor.m_SlewUs ? slewUs : rAnchor.m_SlewUs;
+    }
+    return slewUs < -rAnchor.m_SlewUs ? -slewUs : rAnchor.m_SlewUs;
+} // End Slewed().
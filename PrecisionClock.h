@@ -0,0 +1,207 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PrecisionClock.h
+//
+// This file implements the PrecisionClock class.  A PrecisionClock supplies
+// UTC time with microsecond resolution by interpolating from the ESP32's
+// monotonic esp_timer between time syncs.  Each sync publishes a new anchor
+// (a pairing of esp_timer time with UTC time) through a SeqLock, so reading
+// the time is just a copy of the anchor plus a little integer math.  No
+// localtime(), no system calls, no allocation, and no locks are involved.
+//
+// The time returned never goes backwards:
+// - Small corrections (up to SLEW_LIMIT_US) are slewed.  The clock runs up to
+//   MAX_SLEW_PPM fast or slow until the correction has been absorbed.
+// - Larger forward corrections are stepped.
+// - Larger backward corrections of up to MAX_HOLD_US are absorbed by holding
+//   the clock still until the true time catches up.
+// - Anything else (e.g. fixing a wildly wrong RTC) is stepped, and counted
+//   by GetStepCount() so that callers can tell that it happened.
+// - Until the first fine (e.g. NTP) sync, all corrections are stepped.
+//
+// By default UTC advances at the esp_timer's rate.  SetRate() corrects for a
+// known esp_timer rate error (e.g. measured against a PPS signal), so that
+// the clock stays right between syncs.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined PRECISIONCLOCK_H
+#define PRECISIONCLOCK_H
+
+#include <stdint.h>             // For integer types.
+#include <time.h>               // For timespec.
+#include <esp_timer.h>          // For esp_timer_get_time().
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include "SeqLock.h"            // For lock-free publishing of the anchor.
+
+
+class PrecisionClock
+{
+public:
+    // Some handy constants.
+    static const int64_t USECS_PER_SEC = 1000000;
+
+    // Corrections up to this size, in microseconds, are slewed.
+    static const int64_t SLEW_LIMIT_US = 500000;
+
+    // The fastest rate, in parts per million, at which corrections are slewed.
+    // At this rate a correction of SLEW_LIMIT_US takes 100 seconds.
+    static const int64_t MAX_SLEW_PPM = 5000;
+
+    // Backward corrections up to this size, in microseconds, hold the clock
+    // still rather than stepping it back.
+    static const int64_t MAX_HOLD_US = 60 * USECS_PER_SEC;
+
+    // The largest rate correction, in parts per billion.
+    static const int32_t MAX_RATE_PPB = 1000000;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Until the first sync, the clock reads the time since boot.
+    /////////////////////////////////////////////////////////////////////////////
+    PrecisionClock();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Sync()
+    //
+    // Corrects the clock to the specified UTC time.
+    //
+    // Arguments:
+    //   utcUs  - The UTC time, in microseconds since January 1, 1970.
+    //   monoUs - The esp_timer_get_time() value at which utcUs was true.
+    //   fine   - true if utcUs is accurate to well under a second (e.g. it
+    //            came from NTP).  false if it only has whole second accuracy
+    //            (e.g. it came from an RTC), in which case it is ignored
+    //            unless the clock is off by a second or more.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Sync(int64_t utcUs, int64_t monoUs, bool fine);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Sync()
+    //
+    // Same as above, using the current esp_timer time.
+    /////////////////////////////////////////////////////////////////////////////
+    void Sync(int64_t utcUs, bool fine) { Sync(utcUs, esp_timer_get_time(), fine); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetRate()
+    //
+    // Sets how much faster than the esp_timer UTC advances, from the specified
+    // esp_timer time on.  The clock is continuous across the change.  The rate
+    // is kept across syncs.
+    //
+    // Arguments:
+    //   ratePpb - The rate correction, in parts per billion.  Positive values
+    //             mean that the esp_timer runs slow.  Limited to
+    //             +/- MAX_RATE_PPB.
+    //   monoUs  - The esp_timer_get_time() value at which the new rate takes
+    //             effect.  Must be at or after the last sync.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetRate(int32_t ratePpb, int64_t monoUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetRatePpb()
+    //
+    // Returns the rate correction, in parts per billion.  See SetRate().
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetRatePpb() const { return m_Current.m_RatePpb; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUtcMicros()
+    //
+    // Returns the UTC time, in microseconds since January 1, 1970, at the
+    // specified esp_timer time.  Never blocks.
+    //
+    // Arguments:
+    //   monoUs - An esp_timer_get_time() value at or after the last sync.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t GetUtcMicros(int64_t monoUs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUtcMicros()
+    //
+    // Returns the current UTC time in microseconds since January 1, 1970.
+    // Never blocks.
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t GetUtcMicros() const { return GetUtcMicros(esp_timer_get_time()); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUtcTimespec()
+    //
+    // Returns the current UTC time as a timespec.  Never blocks.
+    //
+    // Arguments:
+    //   pTs - Pointer to where the time is returned.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void GetUtcTimespec(timespec *pTs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsSynced()
+    //
+    // Returns true once the clock has had a fine sync.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsSynced() const { return m_Synced; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetStepCount()
+    //
+    // Returns the number of times, since the first fine sync, that the clock
+    // was stepped backwards.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetStepCount() const { return m_StepCount; }
+
+
+private:
+    // Unimplemented methods.  Copying a clock makes no sense.
+    PrecisionClock(const PrecisionClock &rPc);
+    PrecisionClock &operator=(const PrecisionClock &rPc);
+
+    // An anchor ties the esp_timer time to UTC time.  From the anchor on,
+    // UTC advances with the esp_timer corrected by m_RatePpb, plus a slew of
+    // up to MAX_SLEW_PPM until m_SlewUs has been applied, but never reads
+    // earlier than m_HoldUs.
+    struct Anchor
+    {
+        int64_t m_MonoUs;       // esp_timer time of the anchor.
+        int64_t m_UtcUs;        // UTC time at m_MonoUs.
+        int64_t m_SlewUs;       // Correction still to be slewed in.
+        int64_t m_HoldUs;       // Earliest UTC time that may be returned.
+        int32_t m_RatePpb;      // Rate correction in parts per billion.
+    };
+
+    // Evaluate an anchor at the specified esp_timer time.
+    static int64_t Evaluate(const Anchor &rAnchor, int64_t monoUs);
+
+    // Evaluate an anchor, ignoring its hold, at the specified time since it.
+    static int64_t Unheld(const Anchor &rAnchor, int64_t elapsedUs);
+
+    // Returns how much of an anchor's slew has taken effect by the specified
+    // time since it.
+    static int64_t Slewed(const Anchor &rAnchor, int64_t elapsedUs);
+
+    SeqLock<Anchor>   m_Anchor;     // The published anchor.
+    Anchor            m_Current;    // Writer side copy of the anchor.
+    volatile bool     m_Synced;     // true once a fine sync has occurred.
+    volatile uint32_t m_StepCount;  // Number of backward steps.
+    portMUX_TYPE      m_Mux;        // Serializes Sync() against everything.
+
+}; // End class PrecisionClock.
+
+
+#endif // PRECISIONCLOCK_H
@@ -0,0 +1,254 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Rcu.h
+//
+// This file implements the Rcu template class.  An Rcu (read, copy, update)
+// publishes a value from one or more writers to any number of readers, on
+// either core, such that a reader never blocks and never sees a value that
+// is only partly written.  Unlike a SeqLock, a read always succeeds, the
+// value may be any size, and it need not be trivially copyable (e.g. a
+// std::function).
+//
+// The value is kept in two slots.  Readers use whichever slot is published,
+// and count themselves in and out of it with a ReadGuard.  A writer copies
+// the published slot into the other one, changes the copy, and then
+// publishes it.  Before it starts, the writer waits for any readers still
+// using the other slot (from before the last publish) to finish, yielding
+// so that they can.  A reader that picks a slot just as it is unpublished
+// notices, and simply picks again.  So only writers ever wait, and then only
+// for readers, never for each other's partly written data.
+//
+// Writers are serialized by a lock.  A writer that finds another write in
+// progress waits for it, since unlike a SeqLock's value, each write may
+// change something different.  Since a writer may wait, writes must not be
+// made from an interrupt (reads may be), and a task must not write an Rcu
+// while it holds a ReadGuard on it.  A write that finds no one to wait for
+// never calls FreeRTOS, so a constructor may make one.
+//
+// Example:
+//     Rcu<Settings> settings;
+//
+//     // Any task.
+//     {
+//         Rcu<Settings>::ReadGuard s(settings);
+//         Serial.println(s->m_Name);
+//     }
+//
+//     // The task that changes the settings.
+//     Settings &rNew = settings.BeginWrite();
+//     rNew.m_Name = "new";
+//     settings.Commit();
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined RCU_H
+#define RCU_H
+
+#include <atomic>               // For std::atomic.
+#include <freertos/FreeRTOS.h>  // For FreeRTOS types.
+#include <freertos/task.h>      // For vTaskDelay().
+
+
+template <typename T>
+class Rcu
+{
+public:
+    /////////////////////////////////////////////////////////////////////////////
+    // ReadGuard class
+    //
+    // Holds the published value for as long as the guard exists.  Keep
+    // guards short lived, since a writer waits for them.
+    /////////////////////////////////////////////////////////////////////////////
+    class ReadGuard
+    {
+    public:
+        /////////////////////////////////////////////////////////////////////////
+        // Constructor.  Never blocks.
+        //
+        // Arguments:
+        //   rRcu - The Rcu to be read.
+        //
+        /////////////////////////////////////////////////////////////////////////
+        ReadGuard(const Rcu &rRcu) : m_rRcu(rRcu), m_Slot(rRcu.Enter()) {}
+
+
+        /////////////////////////////////////////////////////////////////////////
+        // Destructor.
+        /////////////////////////////////////////////////////////////////////////
+        ~ReadGuard() { m_rRcu.m_Readers[m_Slot].fetch_sub(1); }
+
+
+        /////////////////////////////////////////////////////////////////////////
+        // Access to the value.
+        /////////////////////////////////////////////////////////////////////////
+        const T &operator*()  const { return m_rRcu.m_Data[m_Slot]; }
+        const T *operator->() const { return &m_rRcu.m_Data[m_Slot]; }
+
+
+        /////////////////////////////////////////////////////////////////////////
+        // GetVersion()
+        //
+        // Returns the number of writes that had been published when the
+        // value was.  0 for the initial value.
+        /////////////////////////////////////////////////////////////////////////
+        uint32_t GetVersion() const { return m_rRcu.m_Versions[m_Slot]; }
+
+
+    private:
+        // Unimplemented methods.  Copying a guard would release it twice.
+        ReadGuard(const ReadGuard &rRg);
+        ReadGuard &operator=(const ReadGuard &rRg);
+
+        const Rcu &m_rRcu;                // The Rcu being read.
+        uint32_t   m_Slot;                // The slot being read.
+
+    }; // End class ReadGuard.
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // The published value starts out default constructed.
+    /////////////////////////////////////////////////////////////////////////////
+    Rcu() : m_Published(0), m_Writing(false), m_Version(0)
+    {
+        m_Readers[0] = 0;
+        m_Readers[1] = 0;
+        m_Versions[0] = 0;
+        m_Versions[1] = 0;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Read()
+    //
+    // Copy the published value.  Never blocks.
+    //
+    // Arguments:
+    //   pData - Pointer to where the value will be copied.
+    //
+    // Returns:
+    //   Returns the version of the value (see ReadGuard::GetVersion()).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t Read(T *pData) const
+    {
+        ReadGuard guard(*this);
+        *pData = *guard;
+        return guard.GetVersion();
+    } // End Read().
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // BeginWrite()
+    //
+    // Starts a write.  Waits for any other writer, and for any readers left
+    // on the unpublished slot, then copies the published value into it.
+    // Must be followed by Commit() or Abort().
+    //
+    // Returns:
+    //   Returns a reference to the copy, which may be changed at will until
+    //   Commit() publishes it.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    T &BeginWrite()
+    {
+        bool expected = false;
+        while (!m_Writing.compare_exchange_weak(expected, true,
+                                                std::memory_order_acquire))
+        {
+            expected = false;
+            vTaskDelay(1);
+        }
+
+        uint32_t published = m_Published.load();
+        uint32_t spare = published ^ 1;
+        while (m_Readers[spare].load() != 0)
+        {
+            vTaskDelay(1);
+        }
+        m_Data[spare] = m_Data[published];
+        return m_Data[spare];
+    } // End BeginWrite().
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Commit()
+    //
+    // Publishes the value from BeginWrite().  Readers that start after this
+    // see the new value.
+    /////////////////////////////////////////////////////////////////////////////
+    void Commit()
+    {
+        uint32_t spare = m_Published.load() ^ 1;
+        m_Versions[spare] = ++m_Version;
+        m_Published.store(spare);
+        m_Writing.store(false, std::memory_order_release);
+    } // End Commit().
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Abort()
+    //
+    // Ends a write without publishing anything.
+    /////////////////////////////////////////////////////////////////////////////
+    void Abort() { m_Writing.store(false, std::memory_order_release); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Write()
+    //
+    // Publishes a new value.
+    //
+    // Arguments:
+    //   rData - The value to be published.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Write(const T &rData)
+    {
+        BeginWrite() = rData;
+        Commit();
+    } // End Write().
+
+
+private:
+    // Unimplemented methods.  Copying an Rcu makes no sense.
+    Rcu(const Rcu &rRcu);
+    Rcu &operator=(const Rcu &rRcu);
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Enter()
+    //
+    // Counts a reader into the published slot, and returns the slot.  If the
+    // slot was unpublished before the reader was counted, the writer may
+    // not have seen the reader, so the reader leaves and tries again.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t Enter() const
+    {
+        for (;;)
+        {
+            uint32_t slot = m_Published.load();
+            m_Readers[slot].fetch_add(1);
+            if (m_Published.load() == slot)
+            {
+                return slot;
+            }
+            m_Readers[slot].fetch_sub(1);
+        }
+    } // End Enter().
+
+    // Readers and writers race on m_Published and m_Readers, so they use
+    // sequentially consistent operations.  Each side stores to one and then
+    // loads the other, and must see the other side's store.
+    std::atomic<uint32_t>         m_Published;  // The slot readers use.
+    mutable std::atomic<uint32_t> m_Readers[2]; // Readers in each slot.
+    std::atomic<bool>             m_Writing;    // Writer lock.
+    uint32_t                      m_Version;    // Writes published so far.
+    volatile uint32_t             m_Versions[2];// Version in each slot.
+    T                             m_Data[2];    // The slots.
+
+}; // End class Rcu.
+
+
+#endif // RCU_H
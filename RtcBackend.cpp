@@ -0,0 +1,310 @@
+/////////////////////////////////////////////////////////////////////////////////
+// RtcBackend.cpp
+//
+// This file implements the RtcBackend interface and the DS3231 and PCF8563
+// drivers.  See RtcBackend.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "RtcBackend.h"         // For RtcBackend class.
+#include "TimeMath.h"           // For calendar conversions.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ReadRegs()
+//
+// Reads consecutive registers in one transaction.
+//
+// Arguments:
+//   reg  - The first register.
+//   pBuf - Pointer to where the register values are returned.
+//   len  - The number of registers.
+//
+// Returns:
+//   Returns true if successful, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool RtcBackend::ReadRegs(uint8_t reg, uint8_t *pBuf, size_t len)
+{
+    m_rWire.beginTransmission(m_Addr);
+    m_rWire.write(reg);
+    if ((m_rWire.endTransmission(false) != 0) ||
+        (m_rWire.requestFrom(m_Addr, (uint8_t)len) != len))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        pBuf[i] = m_rWire.read();
+    }
+    return true;
+} // End ReadRegs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WriteRegs()
+//
+// Writes consecutive registers in one transaction.
+//
+// Arguments:
+//   reg  - The first register.
+//   pBuf - Pointer to the register values.
+//   len  - The number of registers.
+//
+// Returns:
+//   Returns true if successful, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool RtcBackend::WriteRegs(uint8_t reg, const uint8_t *pBuf, size_t len)
+{
+    m_rWire.beginTransmission(m_Addr);
+    m_rWire.write(reg);
+    m_rWire.write(pBuf, len);
+    return m_rWire.endTransmission() == 0;
+} // End WriteRegs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::Begin()
+//
+// Checks that the chip responds, and makes sure that its oscillator keeps
+// running on battery power.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::Begin()
+{
+    uint8_t ctrl;
+    if (!ReadRegs(REG_CONTROL, &ctrl, 1))
+    {
+        return false;
+    }
+    if (ctrl & CTRL_EOSC)
+    {
+        ctrl &= ~CTRL_EOSC;
+        return WriteRegs(REG_CONTROL, &ctrl, 1);
+    }
+    return true;
+} // End Ds3231Rtc::Begin().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::Read()
+//
+// Reads the time, control, and status registers in one transaction, and
+// returns the time unless the oscillator has stopped.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::Read(time_t *pUtc)
+{
+    uint8_t regs[REG_STATUS - REG_SECONDS + 1];
+    if (!ReadRegs(REG_SECONDS, regs, sizeof(regs)) ||
+        (regs[REG_STATUS - REG_SECONDS] & STAT_OSF))
+    {
+        return false;
+    }
+
+    tm t;
+    t.tm_sec  = FromBcd(regs[0] & 0x7f);
+    t.tm_min  = FromBcd(regs[1] & 0x7f);
+    if (regs[2] & 0x40)
+    {
+        // 12 hour mode.  Bit 5 is PM.
+        t.tm_hour = FromBcd(regs[2] & 0x1f) % 12 + ((regs[2] & 0x20) ? 12 : 0);
+    }
+    else
+    {
+        t.tm_hour = FromBcd(regs[2] & 0x3f);
+    }
+    t.tm_mday = FromBcd(regs[4] & 0x3f);
+    t.tm_mon  = FromBcd(regs[5] & 0x1f) - 1;
+    t.tm_year = FromBcd(regs[6]) + ((regs[5] & CENTURY) ? 200 : 100);
+    if ((t.tm_sec > 59) || (t.tm_min > 59) || (t.tm_hour > 23) ||
+        (t.tm_mday < 1) || (t.tm_mday > 31) || (t.tm_mon < 0) || (t.tm_mon > 11))
+    {
+        return false;
+    }
+    *pUtc = (time_t)TimeMath::TmToSecs(&t);
+    return true;
+} // End Ds3231Rtc::Read().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::Write()
+//
+// Writes the time registers in one transaction, then clears the oscillator
+// stopped flag.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::Write(time_t utc)
+{
+    tm t;
+    TimeMath::SecsToTm(utc, &t);
+    int32_t year = t.tm_year + TimeMath::TM_YEAR_BASE;
+    if ((year < 2000) || (year > 2199))
+    {
+        return false;
+    }
+
+    uint8_t regs[7];
+    regs[0] = ToBcd(t.tm_sec);
+    regs[1] = ToBcd(t.tm_min);
+    regs[2] = ToBcd(t.tm_hour);
+    regs[3] = t.tm_wday + 1;
+    regs[4] = ToBcd(t.tm_mday);
+    regs[5] = ToBcd(t.tm_mon + 1) | (year >= 2100 ? CENTURY : 0);
+    regs[6] = ToBcd(year % 100);
+
+    uint8_t status;
+    if (!WriteRegs(REG_SECONDS, regs, sizeof(regs)) || !ReadRegs(REG_STATUS, &status, 1))
+    {
+        return false;
+    }
+    status &= ~STAT_OSF;
+    return WriteRegs(REG_STATUS, &status, 1);
+} // End Ds3231Rtc::Write().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::EnableSqw()
+//
+// Sets INT/SQW to a 1 Hz square wave.  The seconds count changes on its
+// falling edge.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::EnableSqw()
+{
+    uint8_t ctrl;
+    if (!ReadRegs(REG_CONTROL, &ctrl, 1))
+    {
+        return false;
+    }
+    ctrl &= ~(CTRL_EOSC | CTRL_RS | CTRL_INTCN);
+    return WriteRegs(REG_CONTROL, &ctrl, 1);
+} // End Ds3231Rtc::EnableSqw().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::GetAging()
+//
+// Reads the aging offset register.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::GetAging(int8_t *pAging)
+{
+    uint8_t aging;
+    if (!ReadRegs(REG_AGING, &aging, 1))
+    {
+        return false;
+    }
+    *pAging = (int8_t)aging;
+    return true;
+} // End Ds3231Rtc::GetAging().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc::SetAging()
+//
+// Writes the aging offset register, then starts a temperature conversion so
+// that the new offset takes effect right away rather than at the next
+// automatic conversion.
+/////////////////////////////////////////////////////////////////////////////
+bool Ds3231Rtc::SetAging(int8_t aging)
+{
+    uint8_t value = (uint8_t)aging;
+    uint8_t ctrl;
+    if (!WriteRegs(REG_AGING, &value, 1) || !ReadRegs(REG_CONTROL, &ctrl, 1))
+    {
+        return false;
+    }
+    ctrl |= CTRL_CONV;
+    return WriteRegs(REG_CONTROL, &ctrl, 1);
+} // End Ds3231Rtc::SetAging().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pcf8563Rtc::Begin()
+//
+// Checks that the chip responds, and makes sure that its clock is running.
+/////////////////////////////////////////////////////////////////////////////
+bool Pcf8563Rtc::Begin()
+{
+    uint8_t ctrl;
+    if (!ReadRegs(REG_CONTROL1, &ctrl, 1))
+    {
+        return false;
+    }
+    if (ctrl & CTRL1_STOP)
+    {
+        ctrl &= ~CTRL1_STOP;
+        return WriteRegs(REG_CONTROL1, &ctrl, 1);
+    }
+    return true;
+} // End Pcf8563Rtc::Begin().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pcf8563Rtc::Read()
+//
+// Reads the time registers in one transaction, and returns the time unless
+// the voltage low flag is set.
+/////////////////////////////////////////////////////////////////////////////
+bool Pcf8563Rtc::Read(time_t *pUtc)
+{
+    uint8_t regs[7];
+    if (!ReadRegs(REG_SECONDS, regs, sizeof(regs)) || (regs[0] & SEC_VL))
+    {
+        return false;
+    }
+
+    tm t;
+    t.tm_sec  = FromBcd(regs[0] & 0x7f);
+    t.tm_min  = FromBcd(regs[1] & 0x7f);
+    t.tm_hour = FromBcd(regs[2] & 0x3f);
+    t.tm_mday = FromBcd(regs[3] & 0x3f);
+    t.tm_mon  = FromBcd(regs[5] & 0x1f) - 1;
+    t.tm_year = FromBcd(regs[6]) + ((regs[5] & CENTURY) ? 200 : 100);
+    if ((t.tm_sec > 59) || (t.tm_min > 59) || (t.tm_hour > 23) ||
+        (t.tm_mday < 1) || (t.tm_mday > 31) || (t.tm_mon < 0) || (t.tm_mon > 11))
+    {
+        return false;
+    }
+    *pUtc = (time_t)TimeMath::TmToSecs(&t);
+    return true;
+} // End Pcf8563Rtc::Read().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pcf8563Rtc::Write()
+//
+// Writes the time registers in one transaction.  Writing the seconds
+// register clears the voltage low flag.
+/////////////////////////////////////////////////////////////////////////////
+bool Pcf8563Rtc::Write(time_t utc)
+{
+    tm t;
+    TimeMath::SecsToTm(utc, &t);
+    int32_t year = t.tm_year + TimeMath::TM_YEAR_BASE;
+    if ((year < 2000) || (year > 2199))
+    {
+        return false;
+    }
+
+    uint8_t regs[7];
+    regs[0] = ToBcd(t.tm_sec);
+    regs[1] = ToBcd(t.tm_min);
+    regs[2] = ToBcd(t.tm_hour);
+    regs[3] = ToBcd(t.tm_mday);
+    regs[4] = t.tm_wday;
+    regs[5] = ToBcd(t.tm_mon + 1) | (year >= 2100 ? CENTURY : 0);
+    regs[6] = ToBcd(year % 100);
+    return WriteRegs(REG_SECONDS, regs, sizeof(regs));
+} // End Pcf8563Rtc::Write().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Pcf8563Rtc::EnableSqw()
+//
+// Sets CLKOUT to 1 Hz.
+/////////////////////////////////////////////////////////////////////////////
+bool Pcf8563Rtc::EnableSqw()
+{
+    uint8_t clkout = CLKOUT_1HZ;
+    return WriteRegs(REG_CLKOUT, &clkout, 1);
+} // End Pcf8563Rtc::EnableSqw().
@@ -0,0 +1,277 @@
+/////////////////////////////////////////////////////////////////////////////////
+// RtcBackend.h
+//
+// This file implements the RtcBackend interface, along with drivers for the
+// DS3231 and PCF8563 hardware real time clocks (RTCs).  An RtcBackend only
+// knows how to talk to its chip.  Scheduling the reads, keeping the time
+// cached, and trimming the chip's rate are done by the RtcClock class, which
+// calls the backend from its own task.  Nothing here is thread safe, and
+// every method blocks on the I2C bus, so a backend should only be used by one
+// task at a time.
+//
+// The RTCs keep UTC time.  Each driver reads all of its time registers in a
+// single I2C transaction, so the fields can't roll over between reads.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined RTCBACKEND_H
+#define RTCBACKEND_H
+
+#include <Arduino.h>            // For FALLING.
+#include <Wire.h>               // For TwoWire.
+#include <time.h>               // For time_t.
+
+
+class RtcBackend
+{
+public:
+    /////////////////////////////////////////////////////////////////////////////
+    // Destructor.
+    /////////////////////////////////////////////////////////////////////////////
+    virtual ~RtcBackend() {}
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Begin()
+    //
+    // Checks that the chip responds.  The I2C bus must already have been
+    // started (e.g. with Wire.begin()).
+    //
+    // Returns:
+    //   Returns true if the chip responded, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool Begin() = 0;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Read()
+    //
+    // Reads the UTC time from the chip.
+    //
+    // Arguments:
+    //   pUtc - Pointer to where the UTC time is returned.
+    //
+    // Returns:
+    //   Returns true if the time was read and is valid, or false if the chip
+    //   didn't respond or has lost the time (e.g. its battery ran down).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool Read(time_t *pUtc) = 0;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Write()
+    //
+    // Sets the chip to the specified UTC time, and marks its time as valid.
+    // The chip starts the new second when the write completes, so callers
+    // that care about the phase should write just after a UTC second starts.
+    //
+    // Arguments:
+    //   utc - The UTC time.
+    //
+    // Returns:
+    //   Returns true if successful, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool Write(time_t utc) = 0;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // EnableSqw()
+    //
+    // Sets the chip to output a 1 Hz square wave.  The seconds count changes
+    // on the edge given by GetSqwEdge().
+    //
+    // Returns:
+    //   Returns true if successful, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool EnableSqw() = 0;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetSqwEdge()
+    //
+    // Returns the edge of the 1 Hz output (RISING or FALLING) on which the
+    // seconds count changes.
+    /////////////////////////////////////////////////////////////////////////////
+    virtual int GetSqwEdge() const { return FALLING; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetDriftPpm()
+    //
+    // Returns the most, in parts per million, that the chip is expected to
+    // drift.  Used to bound the error of its time (see
+    // WiFiTimeManager::GetTimeSource()).  The default suits a plain 32 kHz
+    // watch crystal.
+    /////////////////////////////////////////////////////////////////////////////
+    virtual float GetDriftPpm() const { return 20.0f; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetAgingPpm()
+    //
+    // Returns how much, in parts per million, one step of the aging offset
+    // slows the chip.  Returns 0 if the chip has no aging offset.
+    /////////////////////////////////////////////////////////////////////////////
+    virtual float GetAgingPpm() const { return 0.0f; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetAging()
+    //
+    // Reads the aging offset.
+    //
+    // Arguments:
+    //   pAging - Pointer to where the aging offset is returned.
+    //
+    // Returns:
+    //   Returns true if successful, or false if the read failed or the chip
+    //   has no aging offset.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool GetAging(int8_t *pAging) { return false; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetAging()
+    //
+    // Writes the aging offset.  Positive values slow the chip.
+    //
+    // Arguments:
+    //   aging - The new aging offset.
+    //
+    // Returns:
+    //   Returns true if successful, or false if the write failed or the chip
+    //   has no aging offset.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    virtual bool SetAging(int8_t aging) { return false; }
+
+
+protected:
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rWire - The I2C bus that the chip is on.
+    //   addr  - The chip's 7 bit I2C address.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    RtcBackend(TwoWire &rWire, uint8_t addr) : m_rWire(rWire), m_Addr(addr) {}
+
+    // Reads len consecutive registers starting at reg, in one transaction.
+    bool ReadRegs(uint8_t reg, uint8_t *pBuf, size_t len);
+
+    // Writes len consecutive registers starting at reg, in one transaction.
+    bool WriteRegs(uint8_t reg, const uint8_t *pBuf, size_t len);
+
+    // BCD conversions.
+    static uint8_t FromBcd(uint8_t v) { return (v >> 4) * 10 + (v & 0x0f); }
+    static uint8_t ToBcd(uint8_t v)   { return ((v / 10) << 4) | (v % 10); }
+
+    TwoWire &m_rWire;           // The I2C bus.
+    uint8_t  m_Addr;            // The chip's I2C address.
+
+private:
+    // Unimplemented methods.  Copying a driver makes no sense.
+    RtcBackend(const RtcBackend &rRb);
+    RtcBackend &operator=(const RtcBackend &rRb);
+
+}; // End class RtcBackend.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Ds3231Rtc
+//
+// Driver for the Maxim DS3231 (and the pin compatible DS3232).  The aging
+// offset is about 0.1 ppm per step at 25 C.  The 1 Hz output is on the
+// INT/SQW pin, which is open drain and needs a pull up.
+/////////////////////////////////////////////////////////////////////////////////
+class Ds3231Rtc : public RtcBackend
+{
+public:
+    // The chip's I2C address.
+    static const uint8_t I2C_ADDR = 0x68;
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rWire - The I2C bus that the chip is on.  Optional, defaults to Wire.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    Ds3231Rtc(TwoWire &rWire = Wire) : RtcBackend(rWire, I2C_ADDR) {}
+
+    virtual bool Begin();
+    virtual bool Read(time_t *pUtc);
+    virtual bool Write(time_t utc);
+    virtual bool EnableSqw();
+    virtual float GetDriftPpm() const { return 2.0f; }
+    virtual float GetAgingPpm() const { return 0.1f; }
+    virtual bool GetAging(int8_t *pAging);
+    virtual bool SetAging(int8_t aging);
+
+private:
+    // Register addresses and bits.
+    static const uint8_t REG_SECONDS = 0x00;
+    static const uint8_t REG_CONTROL = 0x0e;
+    static const uint8_t REG_STATUS  = 0x0f;
+    static const uint8_t REG_AGING   = 0x10;
+    static const uint8_t CTRL_EOSC   = 0x80;  // Oscillator off on battery.
+    static const uint8_t CTRL_CONV   = 0x20;  // Start a temperature conversion.
+    static const uint8_t CTRL_RS     = 0x18;  // Square wave rate.
+    static const uint8_t CTRL_INTCN  = 0x04;  // Alarm interrupt, not square wave.
+    static const uint8_t STAT_OSF    = 0x80;  // Oscillator has stopped.
+    static const uint8_t CENTURY     = 0x80;  // Century bit in the month.
+
+}; // End class Ds3231Rtc.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Pcf8563Rtc
+//
+// Driver for the NXP PCF8563 (and compatibles such as the BM8563).  The chip
+// has no aging offset, so its rate can't be trimmed.  The 1 Hz output is on
+// the CLKOUT pin, which is open drain and needs a pull up.  The data sheet
+// doesn't say how CLKOUT lines up with the seconds count, but RtcClock
+// measures that after each write.
+/////////////////////////////////////////////////////////////////////////////////
+class Pcf8563Rtc : public RtcBackend
+{
+public:
+    // The chip's I2C address.
+    static const uint8_t I2C_ADDR = 0x51;
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rWire - The I2C bus that the chip is on.  Optional, defaults to Wire.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    Pcf8563Rtc(TwoWire &rWire = Wire) : RtcBackend(rWire, I2C_ADDR) {}
+
+    virtual bool Begin();
+    virtual bool Read(time_t *pUtc);
+    virtual bool Write(time_t utc);
+    virtual bool EnableSqw();
+
+private:
+    // Register addresses and bits.
+    static const uint8_t REG_CONTROL1 = 0x00;
+    static const uint8_t REG_SECONDS  = 0x02;
+    static const uint8_t REG_CLKOUT   = 0x0d;
+    static const uint8_t CTRL1_STOP   = 0x20;  // Clock stopped.
+    static const uint8_t SEC_VL       = 0x80;  // Voltage low, time not valid.
+    static const uint8_t CLKOUT_1HZ   = 0x83;  // Enabled, 1 Hz.
+    static const uint8_t CENTURY      = 0x80;  // Century bit in the month.
+
+}; // End class Pcf8563Rtc.
+
+
+#endif // RTCBACKEND_H
@@ -0,0 +1,376 @@
+/////////////////////////////////////////////////////////////////////////////////
+// RtcClock.cpp
+//
+// This file implements the RtcClock class.  See RtcClock.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "RtcClock.h"           // For RtcClock class.
+#include "TimeMath.h"           // For FloorDiv().
+#include <math.h>               // For lroundf().
+
+
+// Handy constant.
+static const int64_t USECS_PER_SEC = PrecisionClock::USECS_PER_SEC;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+/////////////////////////////////////////////////////////////////////////////
+RtcClock::RtcClock(const PrecisionClock &rClock) :
+                   m_rClock(rClock), m_pRtc(NULL), m_SqwPin(-1),
+                   m_RtcSec(0), m_RtcStartUs(0), m_Valid(false),
+                   m_EdgeUs(-1), m_CheckUs(-1), m_Task(NULL),
+                   m_EdgeOfstUs(0), m_Calibrate(false),
+                   m_TrimStartUs(-1), m_TrimStartErrUs(0),
+                   m_LastErrUs(0), m_DriftPpm(0.0f), m_Aging(0), m_Writes(0)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Begin()
+//
+// Starts the RTC and reads it once, so that the cache is ready right away,
+// then starts the RTC task.  Does nothing if it is already running.
+//
+// Arguments:
+//   pRtc     - Pointer to the RTC driver.  Only the RTC task uses it after
+//              this call.
+//   sqwPin   - The GPIO pin connected to the RTC's 1 Hz output, or -1 to
+//              poll the RTC instead.
+//   priority - The FreeRTOS priority of the RTC task.
+//
+// Returns:
+//   Returns true if the RTC task is running, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool RtcClock::Begin(RtcBackend *pRtc, int sqwPin, UBaseType_t priority)
+{
+    if (m_Task != NULL)
+    {
+        return true;
+    }
+    if ((pRtc == NULL) || !pRtc->Begin())
+    {
+        return false;
+    }
+    m_pRtc = pRtc;
+
+    // Prime the cache.  The phase isn't known yet, so assume mid-second.
+    time_t rtc = 0;
+    bool valid = pRtc->Read(&rtc);
+    Publish(valid, rtc, esp_timer_get_time() - USECS_PER_SEC / 2);
+
+    int8_t aging;
+    if ((pRtc->GetAgingPpm() > 0.0f) && pRtc->GetAging(&aging))
+    {
+        m_Aging = aging;
+    }
+
+    m_SqwPin = ((sqwPin >= 0) && pRtc->EnableSqw()) ? sqwPin : -1;
+    if (xTaskCreatePinnedToCore(Task, "WTM RTC", TASK_STACK, this, priority,
+                                &m_Task, tskNO_AFFINITY) != pdPASS)
+    {
+        m_Task = NULL;
+        return false;
+    }
+
+    // Attach the interrupt once the task exists for it to notify.
+    if (m_SqwPin >= 0)
+    {
+        pinMode(m_SqwPin, INPUT_PULLUP);
+        attachInterruptArg(m_SqwPin, OnSqw, this, pRtc->GetSqwEdge());
+    }
+    return true;
+} // End Begin().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUtc()
+//
+// Returns the RTC's time from the cache.  Never blocks.
+//
+// Arguments:
+//   pUtc - Pointer to where the UTC time is returned.
+//
+// Returns:
+//   Returns true if the cache holds a valid time, or false if the RTC
+//   couldn't be read or has lost the time.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool RtcClock::GetUtc(time_t *pUtc) const
+{
+    portENTER_CRITICAL(&m_Mux);
+    bool valid = m_Valid;
+    time_t rtc = m_RtcSec;
+    int64_t startUs = m_RtcStartUs;
+    portEXIT_CRITICAL(&m_Mux);
+
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+    if (!valid || (elapsedUs >= STALE_US))
+    {
+        return false;
+    }
+    *pUtc = rtc + (time_t)TimeMath::FloorDiv(elapsedUs, USECS_PER_SEC);
+    return true;
+} // End GetUtc().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// RequestCheck()
+//
+// Asks the RTC task to check the RTC against the PrecisionClock, which must
+// have just had a fine sync.  The check is made at the first tick after
+// now.  Never blocks.
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::RequestCheck()
+{
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&m_Mux);
+    m_CheckUs = nowUs;
+    portEXIT_CRITICAL(&m_Mux);
+} // End RequestCheck().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Publish()
+//
+// Updates the cache.
+//
+// Arguments:
+//   valid   - true if the RTC was read and its time is valid.
+//   rtc     - The RTC's time.
+//   startUs - The esp_timer time at which the RTC's second began.
+//
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::Publish(bool valid, time_t rtc, int64_t startUs)
+{
+    portENTER_CRITICAL(&m_Mux);
+    m_Valid = valid;
+    m_RtcSec = rtc;
+    m_RtcStartUs = startUs;
+    portEXIT_CRITICAL(&m_Mux);
+} // End Publish().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Check()
+//
+// Compares the RTC against the PrecisionClock at an SQW tick.  Rewrites the
+// RTC if it is too far off, and otherwise trims its aging offset once the
+// rate has been measured for long enough.
+//
+// Arguments:
+//   rtc    - The RTC's time, read just after the tick.
+//   edgeUs - The esp_timer time of the tick.
+//
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::Check(time_t rtc, int64_t edgeUs)
+{
+    int64_t errUs = (int64_t)rtc * USECS_PER_SEC - m_rClock.GetUtcMicros(edgeUs);
+
+    // Just after a rewrite, the RTC is right by definition, so the error is
+    // where the tick falls within the second.
+    if (m_Calibrate)
+    {
+        m_Calibrate = false;
+        m_EdgeOfstUs = errUs;
+        m_LastErrUs = 0;
+        m_TrimStartUs = edgeUs;
+        m_TrimStartErrUs = 0;
+        return;
+    }
+
+    errUs -= m_EdgeOfstUs;
+    m_LastErrUs = (int32_t)errUs;
+    if ((errUs > MAX_ERR_US) || (errUs < -MAX_ERR_US))
+    {
+        WriteAligned();
+        return;
+    }
+
+    float agingPpm = m_pRtc->GetAgingPpm();
+    if (agingPpm <= 0.0f)
+    {
+        return;
+    }
+    if (m_TrimStartUs < 0)
+    {
+        m_TrimStartUs = edgeUs;
+        m_TrimStartErrUs = errUs;
+        return;
+    }
+    int64_t spanUs = edgeUs - m_TrimStartUs;
+    if (spanUs < (int64_t)TRIM_SEC * USECS_PER_SEC)
+    {
+        return;
+    }
+
+    // The error's growth per second, in microseconds, is the rate error in
+    // ppm.  A fast RTC needs a larger aging offset to slow it down.
+    float ppm = (float)(errUs - m_TrimStartErrUs) * USECS_PER_SEC / spanUs;
+    int32_t steps = lroundf(ppm / agingPpm);
+    steps = steps > MAX_TRIM_STEPS ? MAX_TRIM_STEPS :
+            (steps < -MAX_TRIM_STEPS ? -MAX_TRIM_STEPS : steps);
+    int32_t aging = m_Aging + steps;
+    aging = aging > INT8_MAX ? INT8_MAX : (aging < INT8_MIN ? INT8_MIN : aging);
+    m_DriftPpm = ppm;
+    if ((aging != m_Aging) && m_pRtc->SetAging((int8_t)aging))
+    {
+        m_Aging = (int8_t)aging;
+    }
+
+    // The rate has changed, so start measuring it again from here.
+    m_TrimStartUs = edgeUs;
+    m_TrimStartErrUs = errUs;
+} // End Check().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CheckPolled()
+//
+// Compares the RTC against the PrecisionClock when polling.  The RTC's
+// phase isn't known, so the RTC is only rewritten if it is off by more than
+// half a second plus MAX_ERR_US, and its rate isn't trimmed.
+//
+// Arguments:
+//   rtc    - The RTC's time.
+//   readUs - The esp_timer time at which it was read.
+//
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::CheckPolled(time_t rtc, int64_t readUs)
+{
+    int64_t errUs = (int64_t)rtc * USECS_PER_SEC + USECS_PER_SEC / 2 -
+                    m_rClock.GetUtcMicros(readUs);
+    m_LastErrUs = (int32_t)errUs;
+    if ((errUs > USECS_PER_SEC / 2 + MAX_ERR_US) ||
+        (errUs < -(USECS_PER_SEC / 2 + MAX_ERR_US)))
+    {
+        WriteAligned();
+    }
+} // End CheckPolled().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WriteAligned()
+//
+// Writes the RTC just after the next UTC second starts, so that its seconds
+// roll over with UTC's.  Sleeps until shortly before the second, then spins
+// for the last couple of milliseconds.
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::WriteAligned()
+{
+    int64_t nowUs = m_rClock.GetUtcMicros();
+    int64_t nextUs = (TimeMath::FloorDiv(nowUs, USECS_PER_SEC) + 1) * USECS_PER_SEC;
+    int64_t sleepMs = (nextUs - nowUs) / 1000 - 2;
+    if (sleepMs > 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS(sleepMs));
+    }
+    while (m_rClock.GetUtcMicros() < nextUs)
+    {
+    }
+
+    if (m_pRtc->Write((time_t)(nextUs / USECS_PER_SEC)))
+    {
+        m_Writes++;
+        m_Calibrate = m_SqwPin >= 0;
+        m_TrimStartUs = -1;
+    }
+} // End WriteAligned().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// OnSqw()
+//
+// The SQW interrupt handler.  Timestamps the tick and wakes the RTC task.
+//
+// Arguments:
+//   pArg - Pointer to the RtcClock.
+//
+/////////////////////////////////////////////////////////////////////////////
+void IRAM_ATTR RtcClock::OnSqw(void *pArg)
+{
+    RtcClock *pRc = static_cast<RtcClock *>(pArg);
+    int64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&pRc->m_Mux);
+    pRc->m_EdgeUs = nowUs;
+    portEXIT_CRITICAL_ISR(&pRc->m_Mux);
+
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(pRc->m_Task, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+} // End OnSqw().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Task()
+//
+// Reads the RTC after each tick, or once per second if there is no SQW pin
+// or the ticks stop, and makes any requested check.  Only this task ever
+// waits on the I2C bus.
+//
+// Arguments:
+//   pArg - Pointer to the RtcClock.
+//
+/////////////////////////////////////////////////////////////////////////////
+void RtcClock::Task(void *pArg)
+{
+    RtcClock *pRc = static_cast<RtcClock *>(pArg);
+    const TickType_t wait = pdMS_TO_TICKS(pRc->m_SqwPin >= 0 ? 1500 : 1000);
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        portENTER_CRITICAL(&pRc->m_Mux);
+        int64_t edgeUs = pRc->m_EdgeUs;
+        int64_t checkUs = pRc->m_CheckUs;
+        pRc->m_EdgeUs = -1;
+        portEXIT_CRITICAL(&pRc->m_Mux);
+
+        time_t rtc = 0;
+        int64_t readUs = esp_timer_get_time();
+        bool valid = pRc->m_pRtc->Read(&rtc);
+
+        // A tick is only trusted if it was read within the same second.
+        bool checked = false;
+        if ((edgeUs >= 0) && (readUs - edgeUs < USECS_PER_SEC / 2))
+        {
+            pRc->Publish(valid, rtc, edgeUs + pRc->m_EdgeOfstUs);
+            checked = (checkUs >= 0) && (edgeUs > checkUs);
+            if (valid && (checked || pRc->m_Calibrate))
+            {
+                pRc->Check(rtc, edgeUs);
+            }
+        }
+        else
+        {
+            pRc->Publish(valid, rtc, readUs - USECS_PER_SEC / 2);
+            checked = checkUs >= 0;
+            if (valid && checked)
+            {
+                pRc->CheckPolled(rtc, readUs);
+            }
+        }
+
+        // Clear the request unless another one came in meanwhile.
+        if (checked)
+        {
+            portENTER_CRITICAL(&pRc->m_Mux);
+            if (pRc->m_CheckUs == checkUs)
+            {
+                pRc->m_CheckUs = -1;
+            }
+            portEXIT_CRITICAL(&pRc->m_Mux);
+        }
+    }
+} // End Task().
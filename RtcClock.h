@@ -0,0 +1,204 @@
+/////////////////////////////////////////////////////////////////////////////////
+// RtcClock.h
+//
+// This file implements the RtcClock class.  An RtcClock keeps a cached copy
+// of a hardware RTC's time, so that reading it never touches the I2C bus.  A
+// low priority task reads the RTC once per second, right after the RTC's
+// 1 Hz square wave (SQW) output ticks.  The tick is timestamped with
+// esp_timer in an interrupt, so the cache knows where each RTC second
+// started to within the interrupt latency.  Without an SQW pin, the task
+// polls once per second instead, and the cache is only good to a second.
+//
+// After each fine (e.g. NTP) sync of the PrecisionClock, RequestCheck() asks
+// the task to compare the RTC against it at the next tick:
+// - If the RTC is off by more than MAX_ERR_US, it is rewritten just after a
+//   UTC second starts.  The tick after that measures where the SQW edge falls
+//   within the second, and later checks are made relative to it.
+// - Otherwise, on chips with an aging offset (e.g. the DS3231), the change in
+//   the error over at least TRIM_SEC gives the RTC's rate error, and the
+//   aging offset is stepped to cancel it.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined RTCCLOCK_H
+#define RTCCLOCK_H
+
+#include <Arduino.h>            // For attachInterruptArg().
+#include <esp_timer.h>          // For esp_timer_get_time().
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include <freertos/task.h>      // For the RTC task.
+#include "RtcBackend.h"         // For the RTC chip.
+#include "PrecisionClock.h"     // For UTC time.
+
+
+class RtcClock
+{
+public:
+    // The RTC task's stack size.
+    static const uint32_t TASK_STACK = 3072;
+
+    // RTC errors larger than this, in microseconds, are fixed by rewriting
+    // the RTC.
+    static const int64_t MAX_ERR_US = 250000;
+
+    // The shortest time, in seconds, over which the RTC's rate is measured
+    // before the aging offset is changed.
+    static const int32_t TRIM_SEC = 6 * 3600;
+
+    // The most aging offset steps taken by one trim.
+    static const int32_t MAX_TRIM_STEPS = 10;
+
+    // The cache is stale if the RTC hasn't been read for this long, in
+    // microseconds.
+    static const int64_t STALE_US = 3 * PrecisionClock::USECS_PER_SEC;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Arguments:
+    //   rClock - The clock that the RTC is checked against.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    RtcClock(const PrecisionClock &rClock);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Begin()
+    //
+    // Starts the RTC and reads it once, so that the cache is ready right
+    // away, then starts the RTC task.  Does nothing if it is already running.
+    //
+    // Arguments:
+    //   pRtc     - Pointer to the RTC driver.  Only the RTC task uses it
+    //              after this call.
+    //   sqwPin   - The GPIO pin connected to the RTC's 1 Hz output, or -1 to
+    //              poll the RTC instead.
+    //   priority - The FreeRTOS priority of the RTC task.
+    //
+    // Returns:
+    //   Returns true if the RTC task is running, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Begin(RtcBackend *pRtc, int sqwPin, UBaseType_t priority);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUtc()
+    //
+    // Returns the RTC's time from the cache.  Never blocks.
+    //
+    // Arguments:
+    //   pUtc - Pointer to where the UTC time is returned.
+    //
+    // Returns:
+    //   Returns true if the cache holds a valid time, or false if the RTC
+    //   couldn't be read or has lost the time.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetUtc(time_t *pUtc) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsValid()
+    //
+    // Returns true if the cache holds a valid time.  Never blocks.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsValid() const { time_t t; return GetUtc(&t); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // RequestCheck()
+    //
+    // Asks the RTC task to check the RTC against the PrecisionClock, which
+    // must have just had a fine sync.  Never blocks.
+    /////////////////////////////////////////////////////////////////////////////
+    void RequestCheck();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetLastErrUs()
+    //
+    // Returns the RTC's error, in microseconds, at the last check.  Positive
+    // values mean that the RTC was ahead.
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetLastErrUs() const { return m_LastErrUs; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetDriftPpm()
+    //
+    // Returns the RTC's rate error, in parts per million, at the last trim.
+    // Positive values mean that the RTC was fast.
+    /////////////////////////////////////////////////////////////////////////////
+    float GetDriftPpm() const { return m_DriftPpm; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetAging()
+    //
+    // Returns the RTC's aging offset, or 0 if it has none.
+    /////////////////////////////////////////////////////////////////////////////
+    int8_t GetAging() const { return m_Aging; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetWriteCount()
+    //
+    // Returns the number of times that the RTC has been rewritten.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetWriteCount() const { return m_Writes; }
+
+
+private:
+    // Unimplemented methods.  Copying a clock makes no sense.
+    RtcClock(const RtcClock &rRc);
+    RtcClock &operator=(const RtcClock &rRc);
+
+    // Updates the cache.
+    void Publish(bool valid, time_t rtc, int64_t startUs);
+
+    // Compares the RTC against the PrecisionClock at an SQW tick.
+    void Check(time_t rtc, int64_t edgeUs);
+
+    // Compares the RTC against the PrecisionClock when polling.
+    void CheckPolled(time_t rtc, int64_t readUs);
+
+    // Writes the RTC just after the next UTC second starts.
+    void WriteAligned();
+
+    // The SQW interrupt handler.
+    static void OnSqw(void *pArg);
+
+    // The RTC task.
+    static void Task(void *pArg);
+
+    const PrecisionClock &m_rClock;   // Gives UTC time.
+    RtcBackend   *m_pRtc;             // The RTC chip.
+    int           m_SqwPin;           // The SQW pin, or -1.
+
+    // Shared with the interrupt handler and other tasks.  Guarded by m_Mux.
+    time_t        m_RtcSec;           // Cached RTC time.
+    int64_t       m_RtcStartUs;       // esp_timer time at which m_RtcSec began.
+    bool          m_Valid;            // true if the cached time is valid.
+    int64_t       m_EdgeUs;           // esp_timer time of the last tick, or -1.
+    int64_t       m_CheckUs;          // esp_timer time of a pending check, or -1.
+    mutable portMUX_TYPE m_Mux;       // Guards the above.
+    TaskHandle_t  m_Task;             // The RTC task.
+
+    // Only written by the RTC task.
+    int64_t       m_EdgeOfstUs;       // Start of an RTC second, from a tick.
+    bool          m_Calibrate;        // Measure m_EdgeOfstUs at the next tick.
+    int64_t       m_TrimStartUs;      // esp_timer time of the trim baseline, or -1.
+    int64_t       m_TrimStartErrUs;   // RTC error at the trim baseline.
+    volatile int32_t  m_LastErrUs;    // RTC error at the last check.
+    volatile float    m_DriftPpm;     // RTC rate error at the last trim.
+    volatile int8_t   m_Aging;        // RTC aging offset.
+    volatile uint32_t m_Writes;       // Number of RTC rewrites.
+
+}; // End class RtcClock.
+
+
+#endif // RTCCLOCK_H
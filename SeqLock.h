@@ -0,0 +1,114 @@
+/////////////////////////////////////////////////////////////////////////////////
+// SeqLock.h
+//
+// This file implements the SeqLock template class.  A SeqLock publishes a
+// small, trivially copyable value from one or more writers to any number of
+// readers, on either core, without ever blocking a reader.
+//
+// A sequence counter is bumped to an odd value before the data is written and
+// to the next even value afterward.  A reader copies the data and then checks
+// that the counter was even and unchanged across the copy.  If not, the copy
+// may be torn and the read fails, and the reader should fall back to computing
+// the value itself.  Writers are serialized by a try-lock.  A writer that
+// finds another write in progress simply gives up, since the value it would
+// have published is about to be replaced anyway.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>               // For std::atomic.
+#include <string.h>             // For memcpy().
+
+
+template <typename T>
+class SeqLock
+{
+public:
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // The lock starts out empty.  TryRead() fails until the first write.
+    /////////////////////////////////////////////////////////////////////////////
+    SeqLock() : m_Seq(0), m_Writing(false), m_Valid(false), m_Data() {}
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // TryWrite()
+    //
+    // Publish a new value.
+    //
+    // Arguments:
+    //   rData - The value to be published.
+    //
+    // Returns:
+    //   Returns true if the value was published, or false if another writer
+    //   was busy.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool TryWrite(const T &rData)
+    {
+        bool expected = false;
+        if (!m_Writing.compare_exchange_strong(expected, true,
+                                               std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        uint32_t seq = m_Seq.load(std::memory_order_relaxed);
+        m_Seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&m_Data, &rData, sizeof(T));
+        m_Valid = true;
+        m_Seq.store(seq + 2, std::memory_order_release);
+
+        m_Writing.store(false, std::memory_order_release);
+        return true;
+    } // End TryWrite().
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // TryRead()
+    //
+    // Copy the most recently published value.  Never blocks.
+    //
+    // Arguments:
+    //   pData - Pointer to where the value will be copied.
+    //
+    // Returns:
+    //   Returns true if a consistent value was copied.  Returns false if
+    //   nothing has been published yet or a write was in progress, in which
+    //   case the contents of pData are undefined.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool TryRead(T *pData) const
+    {
+        uint32_t seq = m_Seq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            return false;
+        }
+        memcpy(pData, (const void *)&m_Data, sizeof(T));
+        bool valid = m_Valid;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return valid && (m_Seq.load(std::memory_order_relaxed) == seq);
+    } // End TryRead().
+
+
+private:
+    // Unimplemented methods.  Copying a lock makes no sense.
+    SeqLock(const SeqLock &rSl);
+    SeqLock &operator=(const SeqLock &rSl);
+
+    std::atomic<uint32_t> m_Seq;          // Sequence counter.  Odd while writing.
+    std::atomic<bool>     m_Writing;      // Writer try-lock.
+    volatile bool         m_Valid;        // True once a value has been written.
+    T                     m_Data;         // The published value.
+
+}; // End class SeqLock.
+
+
+#endif // SEQLOCK_H
@@ -0,0 +1,282 @@
+/////////////////////////////////////////////////////////////////////////////////
+// TimeFormat.cpp
+//
+// This file implements the TimeFormat class.  See TimeFormat.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "TimeFormat.h"         // For TimeFormat class.
+#include <string.h>             // For strlen() and memcpy().
+
+
+// Some common formats.
+const char *const TimeFormat::ISO_8601    = "%Y-%m-%dT%H:%M:%S";
+const char *const TimeFormat::RFC_3339_MS = "%Y-%m-%dT%H:%M:%S.%L%:z";
+const char *const TimeFormat::LOG_STAMP   = "%m-%d %H:%M:%S.%L";
+const char *const TimeFormat::DATE_TIME   = "%A, %B %d %Y %r %Z Day of Year: %j";
+
+// Names in the "C" locale.
+static const char *const WDAY_NAMES[] =
+    { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+static const char *const MON_NAMES[] =
+    { "January", "February", "March", "April", "May", "June", "July",
+      "August", "September", "October", "November", "December" };
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Writer
+//
+// Appends to a caller supplied buffer, dropping whatever doesn't fit, and
+// always leaving room for the terminating NULL.
+/////////////////////////////////////////////////////////////////////////////////
+class Writer
+{
+public:
+    Writer(char *pBuf, size_t size) : m_pBuf(pBuf), m_Left(size > 0 ? size - 1 : 0), m_Len(0) {}
+
+    // Appends text.
+    void Text(const char *pText, size_t len)
+    {
+        len = len < m_Left ? len : m_Left;
+        memcpy(m_pBuf + m_Len, pText, len);
+        m_Len  += len;
+        m_Left -= len;
+    }
+
+    // Appends a number as exactly width digits (at most 10), padded on the
+    // left with pad.
+    void Digits(uint32_t value, size_t width, char pad = '0')
+    {
+        char digits[10];
+        for (size_t i = width; i-- > 0; )
+        {
+            digits[i] = (char)('0' + value % 10);
+            value /= 10;
+        }
+        for (size_t i = 0; (i + 1 < width) && (digits[i] == '0') && (pad != '0'); i++)
+        {
+            digits[i] = pad;
+        }
+        Text(digits, width);
+    }
+
+    // Terminates the string and returns its length.
+    size_t Finish(size_t size)
+    {
+        if (size > 0)
+        {
+            m_pBuf[m_Len] = '\0';
+        }
+        return m_Len;
+    }
+
+private:
+    char  *m_pBuf;      // The buffer.
+    size_t m_Left;      // Room left, not counting the NULL.
+    size_t m_Len;       // Characters written so far.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+//
+// Parses the format.  The text between conversions is not copied, so
+// the format string must remain valid for as long as the TimeFormat is
+// used (e.g. a string literal).
+//
+// Arguments:
+//   pFormat - The strftime() style format string.
+//
+/////////////////////////////////////////////////////////////////////////////
+TimeFormat::TimeFormat(const char *pFormat) : m_Count(0), m_Valid(true)
+{
+    Parse(pFormat != NULL ? pFormat : "");
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Format()
+//
+// Formats a broken-down time.
+//
+// Arguments:
+//   pBuf    - Pointer to the buffer that receives the NULL terminated
+//             string.  The string is truncated if it doesn't fit.
+//   size    - The size of the buffer in bytes.
+//   pTm     - The time to format.
+//   millis  - The milliseconds (0 - 999) for %L.
+//   ofstMin - The offset from UTC, in minutes, for %z and %:z.
+//   pAbbrev - The zone abbreviation for %Z.  May be NULL.
+//
+// Returns:
+//   Returns the number of characters written, not counting the
+//   terminating NULL.
+//
+/////////////////////////////////////////////////////////////////////////////
+size_t TimeFormat::Format(char *pBuf, size_t size, const tm *pTm, uint32_t millis,
+                          int32_t ofstMin, const char *pAbbrev) const
+{
+    Writer out(pBuf, size);
+    int32_t  year  = pTm->tm_year + 1900;
+    uint32_t wday  = (uint32_t)pTm->tm_wday % 7;
+    uint32_t mon   = (uint32_t)pTm->tm_mon % 12;
+    uint32_t hour  = (uint32_t)pTm->tm_hour;
+    uint32_t absOf = (uint32_t)(ofstMin < 0 ? -ofstMin : ofstMin);
+
+    for (size_t i = 0; i < m_Count; i++)
+    {
+        const Op &rOp = m_Ops[i];
+        switch (rOp.m_Code)
+        {
+            case opText:       out.Text(rOp.m_pText, rOp.m_Len);                  break;
+            case opYear:
+                if (year < 0)
+                {
+                    out.Text("-", 1);
+                }
+                out.Digits((uint32_t)(year < 0 ? -year : year),
+                           (year > 9999) || (year < -9999) ? 10 : 4);
+                break;
+            case opYear2:      out.Digits((uint32_t)((year % 100 + 100) % 100), 2); break;
+            case opMonth:      out.Digits(mon + 1, 2);                            break;
+            case opDay:        out.Digits((uint32_t)pTm->tm_mday, 2);             break;
+            case opDaySpace:   out.Digits((uint32_t)pTm->tm_mday, 2, ' ');        break;
+            case opYday:       out.Digits((uint32_t)pTm->tm_yday + 1, 3);         break;
+            case opHour:       out.Digits(hour, 2);                               break;
+            case opHour12:     out.Digits(hour % 12 == 0 ? 12 : hour % 12, 2);    break;
+            case opMin:        out.Digits((uint32_t)pTm->tm_min, 2);              break;
+            case opSec:        out.Digits((uint32_t)pTm->tm_sec, 2);              break;
+            case opMillis:     out.Digits(millis % 1000, 3);                      break;
+            case opAmPm:       out.Text(hour < 12 ? "AM" : "PM", 2);              break;
+            case opWdayName:   out.Text(WDAY_NAMES[wday], strlen(WDAY_NAMES[wday])); break;
+            case opWdayAbbrev: out.Text(WDAY_NAMES[wday], 3);                     break;
+            case opMonName:    out.Text(MON_NAMES[mon], strlen(MON_NAMES[mon]));  break;
+            case opMonAbbrev:  out.Text(MON_NAMES[mon], 3);                       break;
+            case opAbbrev:
+                if (pAbbrev != NULL)
+                {
+                    out.Text(pAbbrev, strlen(pAbbrev));
+                }
+                break;
+            case opOfst:
+            case opOfstColon:
+                out.Text(ofstMin < 0 ? "-" : "+", 1);
+                out.Digits(absOf / 60, 2);
+                if (rOp.m_Code == opOfstColon)
+                {
+                    out.Text(":", 1);
+                }
+                out.Digits(absOf % 60, 2);
+                break;
+            default:                                                              break;
+        }
+    }
+    return out.Finish(size);
+} // End Format().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Parse()
+//
+// Parses a format into operations.  Composite conversions (e.g. %T) are
+// parsed as the formats they stand for.
+//
+// Arguments:
+//   pFormat - The format string.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeFormat::Parse(const char *pFormat)
+{
+    const char *pText = pFormat;
+    const char *p     = pFormat;
+    while (*p != '\0')
+    {
+        if ((*p != '%') || (p[1] == '\0'))
+        {
+            p++;
+            continue;
+        }
+
+        // Flush the text before the conversion.
+        Add(opText, pText, (size_t)(p - pText));
+        const char *pSpec = p + 1;
+        p += 2;
+        switch (*pSpec)
+        {
+            case 'Y': Add(opYear);        break;
+            case 'y': Add(opYear2);       break;
+            case 'm': Add(opMonth);       break;
+            case 'd': Add(opDay);         break;
+            case 'e': Add(opDaySpace);    break;
+            case 'j': Add(opYday);        break;
+            case 'H': Add(opHour);        break;
+            case 'I': Add(opHour12);      break;
+            case 'M': Add(opMin);         break;
+            case 'S': Add(opSec);         break;
+            case 'L': Add(opMillis);      break;
+            case 'p': Add(opAmPm);        break;
+            case 'A': Add(opWdayName);    break;
+            case 'a': Add(opWdayAbbrev);  break;
+            case 'B': Add(opMonName);     break;
+            case 'b': Add(opMonAbbrev);   break;
+            case 'Z': Add(opAbbrev);      break;
+            case 'z': Add(opOfst);        break;
+            case 'F': Parse("%Y-%m-%d");  break;
+            case 'T': Parse("%H:%M:%S");  break;
+            case 'R': Parse("%H:%M");     break;
+            case 'r': Parse("%I:%M:%S %p"); break;
+            case '%': Add(opText, pSpec, 1); break;
+            case ':':
+                if (pSpec[1] == 'z')
+                {
+                    Add(opOfstColon);
+                    p++;
+                    break;
+                }
+                // Fall through.
+            default:
+                // Unknown.  Copy it as is.
+                Add(opText, pSpec - 1, 2);
+                break;
+        }
+        pText = p;
+    }
+    Add(opText, pText, (size_t)(p - pText));
+} // End Parse().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Add()
+//
+// Adds an operation.  Empty text is skipped, and long text is split.
+//
+// Arguments:
+//   code  - The OpCode_t.
+//   pText - The text, for opText.
+//   len   - The length of the text, for opText.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeFormat::Add(uint8_t code, const char *pText, size_t len)
+{
+    do
+    {
+        if ((code == opText) && (len == 0))
+        {
+            return;
+        }
+        if (m_Count >= MAX_OPS)
+        {
+            m_Valid = false;
+            return;
+        }
+        size_t chunk = len < 255 ? len : 255;
+        Op &rOp = m_Ops[m_Count++];
+        rOp.m_pText = pText;
+        rOp.m_Code  = code;
+        rOp.m_Len   = (uint8_t)chunk;
+        pText += chunk;
+        len   -= chunk;
+    } while (code == opText);
+} // End Add().
@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////////////////////
+// TimeFormat.h
+//
+// This file implements the TimeFormat class.  A TimeFormat formats broken-down
+// times much like strftime(), but the format string is parsed only once, when
+// the TimeFormat is constructed, into a short list of operations.  Formatting
+// then just runs the list, writing fixed width digits and table lookups
+// straight into the caller's buffer.  There is no locale handling, no TZ
+// lookup, and no heap use, so it is cheap enough to stamp every log line.
+//
+// The supported conversions are a subset of strftime()'s, in the "C" locale:
+//     %Y  Year (e.g. 2023)               %y  Year within century (00 - 99)
+//     %m  Month (01 - 12)                %d  Day of month (01 - 31)
+//     %e  Day of month, space padded     %j  Day of year (001 - 366)
+//     %H  Hour (00 - 23)                 %I  Hour (01 - 12)
+//     %M  Minute (00 - 59)               %S  Second (00 - 60)
+//     %p  AM or PM                       %A  Weekday (e.g. Sunday)
+//     %a  Weekday (e.g. Sun)             %B  Month (e.g. January)
+//     %b  Month (e.g. Jan)               %Z  Zone abbreviation (e.g. EST)
+//     %z  Offset from UTC (e.g. -0500)   %:z Offset from UTC (e.g. -05:00)
+//     %F  Same as %Y-%m-%d               %T  Same as %H:%M:%S
+//     %R  Same as %H:%M                  %r  Same as %I:%M:%S %p
+//     %L  Milliseconds (000 - 999)       %%  A percent sign
+// Anything else is copied as is.  The zone abbreviation, the offset from
+// UTC, and the milliseconds don't come from the tm structure, and are passed
+// to Format() instead.
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined TIMEFORMAT_H
+#define TIMEFORMAT_H
+
+#include <stdint.h>             // For integer types.
+#include <stddef.h>             // For size_t.
+#include <time.h>               // For tm.
+
+
+class TimeFormat
+{
+public:
+    // The most operations a format may hold.  Each conversion and each run
+    // of other text is one operation.  %F, %T, %R, and %r count as 5, 5, 3,
+    // and 7 respectively.
+    static const size_t MAX_OPS = 32;
+
+    // Some common formats.
+    static const char *const ISO_8601;      // 2023-03-12T07:00:00
+    static const char *const RFC_3339_MS;   // 2023-03-12T07:00:00.123-04:00
+    static const char *const LOG_STAMP;     // 03-12 07:00:00.123
+    static const char *const DATE_TIME;     // As used by GetDateTimeString().
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // Parses the format.  The text between conversions is not copied, so
+    // the format string must remain valid for as long as the TimeFormat is
+    // used (e.g. a string literal).
+    //
+    // Arguments:
+    //   pFormat - The strftime() style format string.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    explicit TimeFormat(const char *pFormat);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Format()
+    //
+    // Formats a broken-down time.
+    //
+    // Arguments:
+    //   pBuf    - Pointer to the buffer that receives the NULL terminated
+    //             string.  The string is truncated if it doesn't fit.
+    //   size    - The size of the buffer in bytes.
+    //   pTm     - The time to format.
+    //   millis  - The milliseconds (0 - 999) for %L.
+    //   ofstMin - The offset from UTC, in minutes, for %z and %:z.
+    //   pAbbrev - The zone abbreviation for %Z.  May be NULL.
+    //
+    // Returns:
+    //   Returns the number of characters written, not counting the
+    //   terminating NULL.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    size_t Format(char *pBuf, size_t size, const tm *pTm, uint32_t millis = 0,
+                  int32_t ofstMin = 0, const char *pAbbrev = NULL) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsValid()
+    //
+    // Returns true if the whole format fit in MAX_OPS operations.  If not,
+    // the operations past MAX_OPS are dropped.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsValid() const { return m_Valid; }
+
+
+private:
+    // The operations.
+    enum OpCode_t
+    {
+        opText = 0, opYear, opYear2, opMonth, opDay, opDaySpace, opYday,
+        opHour, opHour12, opMin, opSec, opMillis, opAmPm, opWdayName,
+        opWdayAbbrev, opMonName, opMonAbbrev, opAbbrev, opOfst, opOfstColon
+    };
+
+    // One operation.  Text operations point into the format string.
+    struct Op
+    {
+        const char *m_pText;    // Text to copy, for opText.
+        uint8_t     m_Code;     // An OpCode_t.
+        uint8_t     m_Len;      // Length of the text, for opText.
+    };
+
+    // Parses a format into operations.
+    void Parse(const char *pFormat);
+
+    // Adds an operation.
+    void Add(uint8_t code, const char *pText = NULL, size_t len = 0);
+
+    Op      m_Ops[MAX_OPS];     // The operations, in order.
+    uint8_t m_Count;            // The number of operations.
+    bool    m_Valid;            // false if operations were dropped.
+
+}; // End class TimeFormat.
+
+
+#endif // TIMEFORMAT_H
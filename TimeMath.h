@@ -0,0 +1,277 @@
+/////////////////////////////////////////////////////////////////////////////////
+// TimeMath.h
+//
+// This file implements the TimeMath class.  It is a collection of small,
+// static calendar helpers used to evaluate DST rules and to convert between
+// time_t (seconds since January 1, 1970) and broken-down tm values without
+// the help of the C library (and therefore without the TZ environment).
+//
+// The rule helpers are written as C++11 constexpr functions (a single return
+// statement each) so that they may be evaluated at compile time when all of
+// their arguments are constants.  The date algorithms are those described by
+// Howard Hinnant at http://howardhinnant.github.io/date_algorithms.html .
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined TIMEMATH_H
+#define TIMEMATH_H
+
+#include <stdint.h>             // For integer types.
+#include <time.h>               // For tm and time_t.
+
+
+class TimeMath
+{
+public:
+    // Some handy constants.
+    static const int32_t SECS_PER_MIN  = 60;
+    static const int32_t SECS_PER_HOUR = 60 * SECS_PER_MIN;
+    static const int32_t SECS_PER_DAY  = 24 * SECS_PER_HOUR;
+    static const int32_t DAYS_PER_WEEK = 7;
+    static const int32_t EPOCH_YEAR    = 1970;
+    static const int32_t TM_YEAR_BASE  = 1900;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsLeapYear()
+    //
+    // Returns true if the specified year (e.g. 2024) is a leap year.
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr bool IsLeapYear(int32_t y)
+    {
+        return ((y % 4 == 0) && (y % 100 != 0)) || (y % 400 == 0);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // DaysInMonth()
+    //
+    // Returns the number of days in the specified month (1 - 12) of the
+    // specified year.
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int32_t DaysInMonth(int32_t y, int32_t m)
+    {
+        return (m == 2) ? (IsLeapYear(y) ? 29 : 28) :
+               ((m == 4) || (m == 6) || (m == 9) || (m == 11)) ? 30 : 31;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // DaysFromCivil()
+    //
+    // Returns the number of days since January 1, 1970 of the specified date.
+    //
+    // Arguments:
+    //   y - The year (e.g. 2023).
+    //   m - The month (1 - 12).
+    //   d - The day of the month (1 - 31).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int32_t DaysFromCivil(int32_t y, int32_t m, int32_t d)
+    {
+        return DaysFromShiftedCivil(y - (m <= 2 ? 1 : 0), m, d);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // DayOfWeek()
+    //
+    // Returns the day of the week (0 = Sunday, ... 6 = Saturday) of the day
+    // that is the specified number of days since January 1, 1970 (a Thursday).
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int32_t DayOfWeek(int32_t days)
+    {
+        return (days >= -4) ? ((days + 4) % DAYS_PER_WEEK) :
+                              ((days + 5) % DAYS_PER_WEEK + 6);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // RuleDay()
+    //
+    // Returns the day of the month selected by a POSIX "Mm.w.d" style rule.
+    //
+    // Arguments:
+    //   y    - The year (e.g. 2023).
+    //   m    - The month (1 - 12).
+    //   week - The week of the month (1 - 4), or 5 for the last week.
+    //   dow  - The day of the week (0 = Sunday, ... 6 = Saturday).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int32_t RuleDay(int32_t y, int32_t m, int32_t week, int32_t dow)
+    {
+        return NthDay(FirstDow(DayOfWeek(DaysFromCivil(y, m, 1)), dow),
+                      week, DaysInMonth(y, m));
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // RuleUtc()
+    //
+    // Returns the UTC time, in seconds since January 1, 1970, at which a POSIX
+    // "Mm.w.d/h" style rule takes effect in the specified year.
+    //
+    // Arguments:
+    //   y          - The year (e.g. 2023).
+    //   m          - The month (1 - 12).
+    //   week       - The week of the month (1 - 4), or 5 for the last week.
+    //   dow        - The day of the week (0 = Sunday, ... 6 = Saturday).
+    //   hour       - The hour (0 - 23) of local time at which the rule applies.
+    //   ofstBefore - The offset from UTC, in minutes, that is in effect just
+    //                before the rule applies (i.e. the offset of the local time
+    //                that hour is expressed in).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int64_t RuleUtc(int32_t y, int32_t m, int32_t week,
+                                     int32_t dow, int32_t hour, int32_t ofstBefore)
+    {
+        return (int64_t)DaysFromCivil(y, m, RuleDay(y, m, week, dow)) * SECS_PER_DAY +
+               (int64_t)hour * SECS_PER_HOUR - (int64_t)ofstBefore * SECS_PER_MIN;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // YearOf()
+    //
+    // Returns the year (e.g. 2023) of the specified time in seconds since
+    // January 1, 1970.
+    /////////////////////////////////////////////////////////////////////////////
+    static int32_t YearOf(int64_t secs)
+    {
+        int32_t y, m, d;
+        CivilFromDays(FloorDiv(secs, SECS_PER_DAY), &y, &m, &d);
+        return y;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // CivilFromDays()
+    //
+    // Converts a number of days since January 1, 1970 to a calendar date.
+    //
+    // Arguments:
+    //   days - The number of days since January 1, 1970.
+    //   pY   - Pointer to where the year (e.g. 2023) is returned.
+    //   pM   - Pointer to where the month (1 - 12) is returned.
+    //   pD   - Pointer to where the day of the month (1 - 31) is returned.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void CivilFromDays(int32_t days, int32_t *pY, int32_t *pM, int32_t *pD)
+    {
+        days += 719468;
+        const int32_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const int32_t doe = days - era * 146097;
+        const int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const int32_t mp  = (5 * doy + 2) / 153;
+        *pD = doy - (153 * mp + 2) / 5 + 1;
+        *pM = mp < 10 ? mp + 3 : mp - 9;
+        *pY = yoe + era * 400 + (*pM <= 2 ? 1 : 0);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SecsToTm()
+    //
+    // Converts seconds since January 1, 1970 to broken-down time.  No timezone
+    // is applied, so pass UTC seconds for UTC time, or UTC seconds plus the
+    // local offset for local time.  tm_isdst is set to 0.
+    //
+    // Arguments:
+    //   secs - Seconds since January 1, 1970.
+    //   pTm  - Pointer to the tm structure that receives the broken-down time.
+    //
+    // Returns:
+    //   Always returns pTm.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static tm *SecsToTm(int64_t secs, tm *pTm)
+    {
+        const int32_t days = (int32_t)FloorDiv(secs, SECS_PER_DAY);
+        int32_t rem = (int32_t)(secs - (int64_t)days * SECS_PER_DAY);
+        int32_t y, m, d;
+        CivilFromDays(days, &y, &m, &d);
+
+        pTm->tm_year  = y - TM_YEAR_BASE;
+        pTm->tm_mon   = m - 1;
+        pTm->tm_mday  = d;
+        pTm->tm_hour  = rem / SECS_PER_HOUR;
+        rem          %= SECS_PER_HOUR;
+        pTm->tm_min   = rem / SECS_PER_MIN;
+        pTm->tm_sec   = rem % SECS_PER_MIN;
+        pTm->tm_wday  = DayOfWeek(days);
+        pTm->tm_yday  = days - DaysFromCivil(y, 1, 1);
+        pTm->tm_isdst = 0;
+        return pTm;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // TmToSecs()
+    //
+    // Converts broken-down time to seconds since January 1, 1970.  No timezone
+    // is applied, and tm_isdst, tm_wday, and tm_yday are ignored.  Out of range
+    // month, day, hour, minute, and second fields are normalized.
+    //
+    // Arguments:
+    //   pTm - Pointer to the tm structure holding the time to be converted.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static int64_t TmToSecs(const tm *pTm)
+    {
+        int32_t y = pTm->tm_year + TM_YEAR_BASE + FloorDiv(pTm->tm_mon, 12);
+        int32_t m = pTm->tm_mon - 12 * FloorDiv(pTm->tm_mon, 12) + 1;
+        return ((int64_t)DaysFromCivil(y, m, 1) + pTm->tm_mday - 1) * SECS_PER_DAY +
+               (int64_t)pTm->tm_hour * SECS_PER_HOUR +
+               (int64_t)pTm->tm_min * SECS_PER_MIN + pTm->tm_sec;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // FloorDiv()
+    //
+    // Integer division that rounds toward negative infinity.
+    /////////////////////////////////////////////////////////////////////////////
+    static constexpr int64_t FloorDiv(int64_t a, int64_t b)
+    {
+        return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+    }
+
+
+private:
+    // Helpers for the constexpr methods above.
+    static constexpr int32_t Era(int32_t y)
+    {
+        return (y >= 0 ? y : y - 399) / 400;
+    }
+    static constexpr int32_t DayOfShiftedYear(int32_t m, int32_t d)
+    {
+        return (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    }
+    static constexpr int32_t DayOfEra(int32_t yoe, int32_t m, int32_t d)
+    {
+        return yoe * 365 + yoe / 4 - yoe / 100 + DayOfShiftedYear(m, d);
+    }
+    static constexpr int32_t DaysFromShiftedCivil(int32_t y, int32_t m, int32_t d)
+    {
+        return Era(y) * 146097 + DayOfEra(y - Era(y) * 400, m, d) - 719468;
+    }
+    static constexpr int32_t FirstDow(int32_t firstDayDow, int32_t dow)
+    {
+        return 1 + (dow - firstDayDow + DAYS_PER_WEEK) % DAYS_PER_WEEK;
+    }
+    static constexpr int32_t NthDay(int32_t first, int32_t week, int32_t dim)
+    {
+        return (week < 5) ? (first + (week - 1) * DAYS_PER_WEEK) :
+               ((first + 4 * DAYS_PER_WEEK <= dim) ? (first + 4 * DAYS_PER_WEEK) :
+                                                     (first + 3 * DAYS_PER_WEEK));
+    }
+
+}; // End class TimeMath.
+
+
+#endif // TIMEMATH_H
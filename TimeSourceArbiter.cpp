@@ -0,0 +1,367 @@
+/////////////////////////////////////////////////////////////////////////////////
+// TimeSourceArbiter.cpp
+//
+// This file implements the TimeSourceArbiter class.  See TimeSourceArbiter.h
+// for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "TimeSourceArbiter.h"  // For TimeSourceArbiter class.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+//
+// The clock starts out with an unknown error, from source 0.  Sources
+// start out with no drift, no margin, and no calibration.
+/////////////////////////////////////////////////////////////////////////////
+TimeSourceArbiter::TimeSourceArbiter() : m_State(), m_Published(), m_ClockSource(0)
+{
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_Mux = unlocked;
+
+    m_State.m_LocalPpm    = 0;
+    m_State.m_ClockMonoUs = 0;
+    m_State.m_ClockErrUs  = UNKNOWN_ERR_US;
+    for (size_t i = 0; i < MAX_SOURCES; i++)
+    {
+        Source &rSrc = m_State.m_Sources[i];
+        rSrc.m_DriftPpm   = 0;
+        rSrc.m_MarginUs   = 0;
+        rSrc.m_Calibrated = false;
+        rSrc.m_CalMonoUs  = 0;
+        rSrc.m_CalErrUs   = UNKNOWN_ERR_US;
+    }
+    Publish();
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetLocalDriftPpm()
+//
+// Sets how fast, in ppm, the clock's error grows between readings.
+//
+// Arguments:
+//   ppm - The worst drift of the local oscillator.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::SetLocalDriftPpm(float ppm)
+{
+    portENTER_CRITICAL(&m_Mux);
+    m_State.m_LocalPpm = ppm < 0 ? -ppm : ppm;
+    Publish();
+    portEXIT_CRITICAL(&m_Mux);
+} // End SetLocalDriftPpm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetDriftPpm()
+//
+// Sets how fast, in ppm, a source's own error grows after it is
+// calibrated.  Only matters for sources that are calibrated.
+//
+// Arguments:
+//   source - The source.
+//   ppm    - The source's worst drift.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::SetDriftPpm(size_t source, float ppm)
+{
+    if (source < MAX_SOURCES)
+    {
+        portENTER_CRITICAL(&m_Mux);
+        m_State.m_Sources[source].m_DriftPpm = ppm < 0 ? -ppm : ppm;
+        Publish();
+        portEXIT_CRITICAL(&m_Mux);
+    }
+} // End SetDriftPpm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetMarginUs()
+//
+// Sets how much better than the clock a source's reading must be to be
+// accepted.
+//
+// Arguments:
+//   source   - The source.
+//   marginUs - The margin in microseconds.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::SetMarginUs(size_t source, uint32_t marginUs)
+{
+    if (source < MAX_SOURCES)
+    {
+        portENTER_CRITICAL(&m_Mux);
+        m_State.m_Sources[source].m_MarginUs = marginUs;
+        Publish();
+        portEXIT_CRITICAL(&m_Mux);
+    }
+} // End SetMarginUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Calibrate()
+//
+// Records that a source that keeps time itself was set (e.g. an RTC was
+// written from NTP time).
+//
+// Arguments:
+//   source - The source.
+//   monoUs - The esp_timer time at which it was set.
+//   errUs  - The error of the time that it was set to.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::Calibrate(size_t source, int64_t monoUs, uint32_t errUs)
+{
+    if (source < MAX_SOURCES)
+    {
+        portENTER_CRITICAL(&m_Mux);
+        Source &rSrc = m_State.m_Sources[source];
+        rSrc.m_Calibrated = true;
+        rSrc.m_CalMonoUs  = monoUs;
+        rSrc.m_CalErrUs   = errUs;
+        Publish();
+        portEXIT_CRITICAL(&m_Mux);
+    }
+} // End Calibrate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetSourceErrorUs()
+//
+// Returns the error, in microseconds, that a reading from a source
+// would have.
+//
+// Arguments:
+//   source - The source.
+//   monoUs - The esp_timer time of the reading.
+//   readUs - The error of the reading itself (e.g. its resolution).
+//
+/////////////////////////////////////////////////////////////////////////////
+uint32_t TimeSourceArbiter::GetSourceErrorUs(size_t source, int64_t monoUs,
+                                             uint32_t readUs) const
+{
+    State state;
+    Snapshot(&state);
+    return SourceErrorUs(state, source, monoUs, readUs);
+} // End GetSourceErrorUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// IsBetter()
+//
+// Returns true if a reading from a source would be accepted, whatever it
+// turns out to say.  Lets the caller skip readings that aren't needed.
+//
+// Arguments:
+//   source - The source.
+//   monoUs - The esp_timer time of the reading.
+//   readUs - The error of the reading itself.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool TimeSourceArbiter::IsBetter(size_t source, int64_t monoUs, uint32_t readUs) const
+{
+    if (source >= MAX_SOURCES)
+    {
+        return false;
+    }
+
+    State state;
+    Snapshot(&state);
+    uint64_t srcErrUs = SourceErrorUs(state, source, monoUs, readUs);
+    uint64_t clkErrUs = ClockErrorUs(state, monoUs);
+    uint32_t marginUs = state.m_Sources[source].m_MarginUs;
+
+    // Anything is accepted while the clock's error is unknown.
+    return (clkErrUs == UNKNOWN_ERR_US) || (srcErrUs + marginUs < clkErrUs);
+} // End IsBetter().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Offer()
+//
+// Offers a reading from a source.  If it is accepted, the caller must set
+// the clock to it, and the clock takes on its error.
+//
+// Arguments:
+//   source   - The source.
+//   monoUs   - The esp_timer time of the reading.
+//   readUs   - The error of the reading itself.
+//   offsetUs - How far the reading is ahead of the clock.
+//
+// Returns:
+//   Returns true if the reading was accepted, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool TimeSourceArbiter::Offer(size_t source, int64_t monoUs, uint32_t readUs,
+                              int64_t offsetUs)
+{
+    if (source >= MAX_SOURCES)
+    {
+        return false;
+    }
+
+    uint64_t absOffsetUs = offsetUs < 0 ? -offsetUs : offsetUs;
+
+    portENTER_CRITICAL(&m_Mux);
+    uint32_t srcErrUs = SourceErrorUs(m_State, source, monoUs, readUs);
+    uint32_t clkErrUs = ClockErrorUs(m_State, monoUs);
+    uint64_t marginUs = m_State.m_Sources[source].m_MarginUs;
+
+    bool accept;
+    if (srcErrUs == UNKNOWN_ERR_US)
+    {
+        // Only take a reading with no idea of its error if the clock has
+        // none either.
+        accept = (clkErrUs == UNKNOWN_ERR_US);
+    }
+    else if (clkErrUs == UNKNOWN_ERR_US)
+    {
+        accept = true;
+    }
+    else
+    {
+        accept = ((uint64_t)srcErrUs + marginUs < clkErrUs) ||
+                 ((srcErrUs < clkErrUs) &&
+                  (absOffsetUs > (uint64_t)srcErrUs + clkErrUs));
+    }
+
+    if (accept)
+    {
+        m_ClockSource         = source;
+        m_State.m_ClockMonoUs = monoUs;
+        m_State.m_ClockErrUs  = srcErrUs;
+        Publish();
+    }
+    portEXIT_CRITICAL(&m_Mux);
+
+    return accept;
+} // End Offer().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Set()
+//
+// Records that a source set the clock, whatever the clock's error was
+// (e.g. the PPS discipline sets the clock itself).
+//
+// Arguments:
+//   source - The source.
+//   monoUs - The esp_timer time at which the clock was set.
+//   errUs  - The clock's error at monoUs.
+//
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::Set(size_t source, int64_t monoUs, uint32_t errUs)
+{
+    if (source < MAX_SOURCES)
+    {
+        portENTER_CRITICAL(&m_Mux);
+        m_ClockSource         = source;
+        m_State.m_ClockMonoUs = monoUs;
+        m_State.m_ClockErrUs  = errUs;
+        Publish();
+        portEXIT_CRITICAL(&m_Mux);
+    }
+} // End Set().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetErrorUs()
+//
+// Returns the bound, in microseconds, on the clock's error at the
+// specified esp_timer time, or UNKNOWN_ERR_US if it isn't known.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t TimeSourceArbiter::GetErrorUs(int64_t monoUs) const
+{
+    State state;
+    Snapshot(&state);
+    return ClockErrorUs(state, monoUs);
+} // End GetErrorUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetSetMonoUs()
+//
+// Returns the esp_timer time at which the clock was last set.
+/////////////////////////////////////////////////////////////////////////////
+int64_t TimeSourceArbiter::GetSetMonoUs() const
+{
+    State state;
+    Snapshot(&state);
+    return state.m_ClockMonoUs;
+} // End GetSetMonoUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Age()
+//
+// Returns errUs grown by ppm over the time from sinceUs to monoUs.  An
+// unknown error stays unknown, and an error too large to hold becomes
+// unknown.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t TimeSourceArbiter::Age(uint32_t errUs, float ppm, int64_t sinceUs,
+                                int64_t monoUs)
+{
+    if ((errUs == UNKNOWN_ERR_US) || (monoUs <= sinceUs))
+    {
+        return errUs;
+    }
+
+    float totalUs = (float)errUs + (float)(monoUs - sinceUs) * ppm * 1.0e-6f;
+    return (totalUs >= (float)UNKNOWN_ERR_US) ? UNKNOWN_ERR_US : (uint32_t)totalUs;
+} // End Age().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SourceErrorUs()
+//
+// Returns the error of a source's reading in a state.  The reading's own
+// error, plus the aged calibration error if the source is calibrated.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t TimeSourceArbiter::SourceErrorUs(const State &rState, size_t source,
+                                          int64_t monoUs, uint32_t readUs)
+{
+    if (source >= MAX_SOURCES)
+    {
+        return UNKNOWN_ERR_US;
+    }
+
+    const Source &rSrc = rState.m_Sources[source];
+    if (!rSrc.m_Calibrated || (readUs == UNKNOWN_ERR_US))
+    {
+        return readUs;
+    }
+
+    uint64_t errUs = (uint64_t)readUs +
+                     Age(rSrc.m_CalErrUs, rSrc.m_DriftPpm, rSrc.m_CalMonoUs, monoUs);
+    return (errUs >= UNKNOWN_ERR_US) ? UNKNOWN_ERR_US : (uint32_t)errUs;
+} // End SourceErrorUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ClockErrorUs()
+//
+// Returns the clock's error in a state.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t TimeSourceArbiter::ClockErrorUs(const State &rState, int64_t monoUs)
+{
+    return Age(rState.m_ClockErrUs, rState.m_LocalPpm, rState.m_ClockMonoUs, monoUs);
+} // End ClockErrorUs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Snapshot()
+//
+// Copies the published state without locking.  A read only fails while a
+// write is in progress, and writes are short and made in the critical
+// section, so the read is simply retried.
+/////////////////////////////////////////////////////////////////////////////
+void TimeSourceArbiter::Snapshot(State *pState) const
+{
+    while (!m_Published.TryRead(pState))
+    {
+    }
+} // End Snapshot().
@@ -0,0 +1,253 @@
+/////////////////////////////////////////////////////////////////////////////////
+// TimeSourceArbiter.h
+//
+// This file implements the TimeSourceArbiter class.  A TimeSourceArbiter
+// decides which of several time sources (e.g. NTP, a hardware RTC, a PPS
+// signal, or the time cached across a reset) should set the clock, and keeps
+// a bound on the clock's error.
+//
+// Every error here is a bound that grows with age:
+// - The clock's error is the error of the reading that last set it, plus the
+//   local oscillator's worst drift (see SetLocalDriftPpm()) times the time
+//   since then.
+// - A source's reading has the error that its caller gives for it, plus, if
+//   the source keeps time itself between calibrations (e.g. an RTC that is
+//   rewritten after each NTP sync), the error of its last calibration and its
+//   own drift (see SetDriftPpm()) times the time since then.
+//
+// A reading is offered to the arbiter, which accepts it if its error is
+// lower than the clock's by at least the source's margin.  The caller then
+// sets the clock (which slews or steps as needed), and the clock takes on
+// the reading's error.  The margin keeps a source that is only a little
+// better from being used over and over.  A reading that is better, but not
+// by the margin, is still accepted if it disagrees with the clock by more
+// than both errors together, since then the clock's bound must be wrong.
+// A worse reading is never accepted, however much it disagrees, so that
+// e.g. an RTC with a flat battery can't undo a good NTP sync.
+//
+// Sources are numbered from 0 to MAX_SOURCES - 1 by the caller.  All of the
+// methods may be called from any task.  The methods that only ask about the
+// errors (IsBetter(), GetErrorUs(), and so on) never lock.  They read a copy
+// of the state that the other methods publish through a SeqLock.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined TIMESOURCEARBITER_H
+#define TIMESOURCEARBITER_H
+
+#include <stdint.h>             // For integer types.
+#include <stddef.h>             // For size_t.
+#include <freertos/FreeRTOS.h>  // For portMUX_TYPE.
+#include "SeqLock.h"            // For the published state.
+
+
+class TimeSourceArbiter
+{
+public:
+    // The number of sources that may be arbitrated.
+    static const size_t MAX_SOURCES = 8;
+
+    // An error that is not known at all (e.g. the clock has never been set).
+    static const uint32_t UNKNOWN_ERR_US = UINT32_MAX;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // The clock starts out with an unknown error, from source 0.  Sources
+    // start out with no drift, no margin, and no calibration.
+    /////////////////////////////////////////////////////////////////////////////
+    TimeSourceArbiter();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetLocalDriftPpm()
+    //
+    // Sets how fast, in ppm, the clock's error grows between readings.
+    //
+    // Arguments:
+    //   ppm - The worst drift of the local oscillator.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetLocalDriftPpm(float ppm);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetDriftPpm()
+    //
+    // Sets how fast, in ppm, a source's own error grows after it is
+    // calibrated.  Only matters for sources that are calibrated.
+    //
+    // Arguments:
+    //   source - The source.
+    //   ppm    - The source's worst drift.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetDriftPpm(size_t source, float ppm);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetMarginUs()
+    //
+    // Sets how much better than the clock a source's reading must be to be
+    // accepted.
+    //
+    // Arguments:
+    //   source   - The source.
+    //   marginUs - The margin in microseconds.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetMarginUs(size_t source, uint32_t marginUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Calibrate()
+    //
+    // Records that a source that keeps time itself was set (e.g. an RTC was
+    // written from NTP time).
+    //
+    // Arguments:
+    //   source - The source.
+    //   monoUs - The esp_timer time at which it was set.
+    //   errUs  - The error of the time that it was set to.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Calibrate(size_t source, int64_t monoUs, uint32_t errUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetSourceErrorUs()
+    //
+    // Returns the error, in microseconds, that a reading from a source
+    // would have.
+    //
+    // Arguments:
+    //   source - The source.
+    //   monoUs - The esp_timer time of the reading.
+    //   readUs - The error of the reading itself (e.g. its resolution).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetSourceErrorUs(size_t source, int64_t monoUs, uint32_t readUs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsBetter()
+    //
+    // Returns true if a reading from a source would be accepted, whatever it
+    // turns out to say.  Lets the caller skip readings that aren't needed.
+    //
+    // Arguments:
+    //   source - The source.
+    //   monoUs - The esp_timer time of the reading.
+    //   readUs - The error of the reading itself.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsBetter(size_t source, int64_t monoUs, uint32_t readUs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Offer()
+    //
+    // Offers a reading from a source.  If it is accepted, the caller must set
+    // the clock to it, and the clock takes on its error.
+    //
+    // Arguments:
+    //   source   - The source.
+    //   monoUs   - The esp_timer time of the reading.
+    //   readUs   - The error of the reading itself.
+    //   offsetUs - How far the reading is ahead of the clock.
+    //
+    // Returns:
+    //   Returns true if the reading was accepted, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool Offer(size_t source, int64_t monoUs, uint32_t readUs, int64_t offsetUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Set()
+    //
+    // Records that a source set the clock, whatever the clock's error was
+    // (e.g. the PPS discipline sets the clock itself).
+    //
+    // Arguments:
+    //   source - The source.
+    //   monoUs - The esp_timer time at which the clock was set.
+    //   errUs  - The clock's error at monoUs.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Set(size_t source, int64_t monoUs, uint32_t errUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetErrorUs()
+    //
+    // Returns the bound, in microseconds, on the clock's error at the
+    // specified esp_timer time, or UNKNOWN_ERR_US if it isn't known.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetErrorUs(int64_t monoUs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetSource()
+    //
+    // Returns the source that last set the clock.
+    /////////////////////////////////////////////////////////////////////////////
+    size_t GetSource() const { return m_ClockSource; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetSetMonoUs()
+    //
+    // Returns the esp_timer time at which the clock was last set.
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t GetSetMonoUs() const;
+
+
+private:
+    // Unimplemented methods.  Copying an arbiter makes no sense.
+    TimeSourceArbiter(const TimeSourceArbiter &rTsa);
+    TimeSourceArbiter &operator=(const TimeSourceArbiter &rTsa);
+
+    struct Source
+    {
+        float    m_DriftPpm;    // Drift after calibration.
+        uint32_t m_MarginUs;    // Improvement needed to be accepted.
+        bool     m_Calibrated;  // true once calibrated.
+        int64_t  m_CalMonoUs;   // esp_timer time of the calibration.
+        uint32_t m_CalErrUs;    // Error of the calibration.
+    };
+
+    struct State
+    {
+        Source   m_Sources[MAX_SOURCES]; // The sources.
+        float    m_LocalPpm;     // Drift of the clock between readings.
+        int64_t  m_ClockMonoUs;  // esp_timer time the clock was set.
+        uint32_t m_ClockErrUs;   // The clock's error when it was set.
+    };
+
+    // Returns errUs grown by ppm over the time from sinceUs to monoUs.
+    static uint32_t Age(uint32_t errUs, float ppm, int64_t sinceUs, int64_t monoUs);
+
+    // The errors of a source's reading and of the clock, from a state.
+    static uint32_t SourceErrorUs(const State &rState, size_t source, int64_t monoUs,
+                                  uint32_t readUs);
+    static uint32_t ClockErrorUs(const State &rState, int64_t monoUs);
+
+    // Publishes m_State.  Called in the critical section.
+    void Publish() { m_Published.TryWrite(m_State); }
+
+    // Copies the published state without locking.
+    void Snapshot(State *pState) const;
+
+    State             m_State;        // The state.
+    SeqLock<State>    m_Published;    // Copy of m_State for the readers.
+    volatile size_t   m_ClockSource;  // The source that last set the clock.
+    mutable portMUX_TYPE m_Mux;       // Guards everything above.
+
+}; // End class TimeSourceArbiter.
+
+
+#endif // TIMESOURCEARBITER_H
@@ -0,0 +1,611 @@
+/////////////////////////////////////////////////////////////////////////////////
+// HostTest.cpp
+//
+// Checks and measures the time conversion path of the WiFiTimeManager library
+// on a desktop computer, using the stand-ins in the stubs directory for the
+// Arduino core, WiFiManager, WebServer, Preferences, SNTP and FreeRTOS.  It
+// does the following:
+//   1. Compare Zone, and Zone attached to a FixedZone table, against the C
+//      library's localtime_r() every 30 minutes from 1970 through 2099, for
+//      zones in both hemispheres, with half hour offsets and half hour DST.
+//   2. Save the Setup page through SaveParamCallback(), as the WiFiManager
+//      does for a browser, and check the decoded values, the range limits,
+//      the TZ string, and that an unchanged save doesn't write NVS.
+//   3. Set the time through the SNTP callback, and check GetUtcTimeT() and
+//      UtcToLocal() as the simulated clock runs.
+//   4. Time each conversion, and the Setup page save, and print the calls per
+//      second and heap allocations per call.
+//
+// The Examples/Benchmark sketch does the same measurements on the device.
+// Exits with 0 if every check passed.  See the Makefile for building it.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <WiFiTimeManager.h>    // Manages timezone, DST, and NTP.
+#include <Preferences.h>        // For the NVS write count.
+#include <chrono>               // For timing.
+#include <new>                  // For the allocation counter.
+#include <stdlib.h>             // For setenv().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Heap allocations made since startup.  Every operator new is counted.
+/////////////////////////////////////////////////////////////////////////////////
+static size_t gAllocs = 0;
+
+void *operator new(size_t size)
+{
+    gAllocs++;
+    void *p = malloc(size != 0 ? size : 1);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void *operator new[](size_t size)              { return operator new(size); }
+void operator delete(void *p) noexcept         { free(p); }
+void operator delete[](void *p) noexcept       { free(p); }
+void operator delete(void *p, size_t) noexcept   { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+
+static int gFailures = 0;       // Number of failed checks.
+static volatile int64_t gSink;  // Keeps the compiler from dropping results.
+
+#define CHECK(cond)                                                         \
+    do                                                                      \
+    {                                                                       \
+        if (!(cond))                                                        \
+        {                                                                   \
+            printf("FAILED: %s (%s:%d)\n", #cond, __FILE__, __LINE__);      \
+            gFailures++;                                                    \
+        }                                                                   \
+    } while (0)
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The zones to check.  The rules are given both as a POSIX TZ string for the
+// C library and as the values that the Setup page would hold.
+/////////////////////////////////////////////////////////////////////////////////
+struct TestZone
+{
+    const char *pTz;            // POSIX TZ string.
+    const char *pStd;           // Standard time abbreviation.
+    const char *pDst;           // DST abbreviation.
+    int32_t     stdOfst;        // Standard offset from UTC in minutes.
+    bool        useDst;         // true if DST is observed.
+    int32_t     dstOfst;        // DST offset from UTC in minutes.
+    DstRule     start;          // Start of DST in standard time.
+    DstRule     end;            // End of DST in DST.
+};
+
+static const TestZone ZONES[] =
+{
+    { "EST5EDT,M3.2.0/2,M11.1.0/2",         "EST",  "EDT",  -300, true,  -240, { 3, 2, 0, 2 }, { 11, 1, 0, 2 } },
+    { "CET-1CEST,M3.5.0/2,M10.5.0/3",       "CET",  "CEST",   60, true,   120, { 3, 5, 0, 2 }, { 10, 5, 0, 3 } },
+    { "GMT0BST,M3.5.0/1,M10.5.0/2",         "GMT",  "BST",     0, true,    60, { 3, 5, 0, 1 }, { 10, 5, 0, 2 } },
+    { "AEST-10AEDT,M10.1.0/2,M4.1.0/3",     "AEST", "AEDT",  600, true,   660, { 10, 1, 0, 2 }, { 4, 1, 0, 3 } },
+    { "NST3:30NDT,M3.2.0/2,M11.1.0/2",      "NST",  "NDT",  -210, true,  -150, { 3, 2, 0, 2 }, { 11, 1, 0, 2 } },
+    { "LHST-10:30LHDT-11,M10.1.0/2,M4.1.0/2", "LHST", "LHDT", 630, true,  660, { 10, 1, 0, 2 }, { 4, 1, 0, 2 } },
+    { "IST-5:30",                           "IST",  "IST",   330, false,  330, { 1, 1, 0, 0 }, { 1, 1, 0, 0 } },
+};
+static const size_t NUM_ZONES = sizeof(ZONES) / sizeof(ZONES[0]);
+
+static const int64_t UTC_1970 = 0;
+static const int64_t UTC_2100 = 4102444800LL;   // Jan 1, 2100 00:00:00 UTC.
+static const int64_t UTC_2024 = 1704067200LL;   // Jan 1, 2024 00:00:00 UTC.
+static const int64_t HALF_HOUR = 30 * 60;
+#define REST_TOKEN "host-test-token"                  // REST API token.
+static const size_t WEB_HEADROOM = 300;                // Setup page buffer headroom.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SetTz()
+//
+// Selects the C library's timezone.
+/////////////////////////////////////////////////////////////////////////////////
+static void SetTz(const char *pTz)
+{
+    setenv("TZ", pTz, 1);
+    tzset();
+} // End SetTz().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// CompareZone()
+//
+// Compares a zone against localtime_r() every 30 minutes from 1970 through
+// 2099.  The C library's timezone must already be set.
+//
+// Returns:
+//   Returns the number of times that differ.
+/////////////////////////////////////////////////////////////////////////////////
+static size_t CompareZone(const char *pName, const Zone &rZone)
+{
+    size_t mismatches = 0;
+    for (int64_t utc = UTC_1970; utc < UTC_2100; utc += HALF_HOUR)
+    {
+        time_t t = (time_t)utc;
+        tm expected;
+        tm actual;
+        localtime_r(&t, &expected);
+        rZone.ToLocal(utc, &actual);
+        if ((actual.tm_year != expected.tm_year) || (actual.tm_mon != expected.tm_mon) ||
+            (actual.tm_mday != expected.tm_mday) || (actual.tm_hour != expected.tm_hour) ||
+            (actual.tm_min != expected.tm_min) || (actual.tm_sec != expected.tm_sec) ||
+            (actual.tm_wday != expected.tm_wday) || (actual.tm_yday != expected.tm_yday) ||
+            (actual.tm_isdst != expected.tm_isdst) ||
+            (strcmp(rZone.GetAbbrev(utc), expected.tm_zone) != 0))
+        {
+            if (mismatches++ == 0)
+            {
+                printf("  %s differs at UTC %lld: %04d-%02d-%02d %02d:%02d %s vs %04d-%02d-%02d %02d:%02d %s\n",
+                       pName, (long long)utc,
+                       actual.tm_year + 1900, actual.tm_mon + 1, actual.tm_mday,
+                       actual.tm_hour, actual.tm_min, rZone.GetAbbrev(utc),
+                       expected.tm_year + 1900, expected.tm_mon + 1, expected.tm_mday,
+                       expected.tm_hour, expected.tm_min, expected.tm_zone);
+            }
+        }
+    }
+    return mismatches;
+} // End CompareZone().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// CompareFixedZone()
+//
+// Compares a FixedZone, through both its TZ string and its compile time
+// table, against localtime_r().
+/////////////////////////////////////////////////////////////////////////////////
+template <typename FZ>
+static size_t CompareFixedZone(const char *pName)
+{
+    SetTz(FZ::GetTzString());
+    Zone zone;
+    zone.Attach(FZ::STD_OFST, FZ::USE_DST, FZ::DST_OFST, FZ::GetStartRule(), FZ::GetEndRule(),
+                FZ::GetStdAbbrev(), FZ::GetDstAbbrev(), FZ::GetTransitions(), FZ::NUM_TRANSITIONS);
+    return CompareZone(pName, zone);
+} // End CompareFixedZone().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TestZones()
+/////////////////////////////////////////////////////////////////////////////////
+static void TestZones()
+{
+    printf("Zone vs localtime_r(), every 30 minutes, 1970 - 2099:\n");
+    for (size_t z = 0; z < NUM_ZONES; z++)
+    {
+        const TestZone &rTz = ZONES[z];
+        SetTz(rTz.pTz);
+        Zone zone;
+        zone.Build(rTz.stdOfst, rTz.useDst, rTz.dstOfst, rTz.start, rTz.end,
+                   rTz.pStd, rTz.pDst, 2023);
+        size_t mismatches = CompareZone(rTz.pTz, zone);
+        printf("  %-40s %zu mismatches\n", rTz.pTz, mismatches);
+        CHECK(mismatches == 0);
+    }
+
+    typedef FixedZone<-300, -240, ZoneRule<mMar, wkSecond, dowSun, 2>,
+                      ZoneRule<mNov, wkFirst, dowSun, 2> > EasternZone;
+    typedef FixedZone<600, 660, ZoneRule<mOct, wkFirst, dowSun, 2>,
+                      ZoneRule<mApr, wkFirst, dowSun, 3> > SydneyZone;
+    typedef FixedZone<330> IndiaZone;
+    size_t mismatches = CompareFixedZone<EasternZone>("EasternZone");
+    printf("  %-40s %zu mismatches\n", EasternZone::GetTzString(), mismatches);
+    CHECK(mismatches == 0);
+    mismatches = CompareFixedZone<SydneyZone>("SydneyZone");
+    printf("  %-40s %zu mismatches\n", SydneyZone::GetTzString(), mismatches);
+    CHECK(mismatches == 0);
+    mismatches = CompareFixedZone<IndiaZone>("IndiaZone");
+    printf("  %-40s %zu mismatches\n", IndiaZone::GetTzString(), mismatches);
+    CHECK(mismatches == 0);
+} // End TestZones().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// SetForm()
+//
+// Fills in the Setup page form for a zone, as a browser would send it.  A
+// browser leaves out the DST checkbox when it is unchecked.
+/////////////////////////////////////////////////////////////////////////////////
+static void SetForm(WebServer *pServer, const TestZone &rTz, const char *pHour1 = NULL)
+{
+    char buf[16];
+    pServer->ClearRequest();
+    snprintf(buf, sizeof(buf), "%d", (int)rTz.stdOfst);
+    pServer->AddArg("tzOffset", buf);
+    snprintf(buf, sizeof(buf), "%d", (int)(rTz.dstOfst - rTz.stdOfst));
+    pServer->AddArg("dstOffset", buf);
+    if (rTz.useDst)
+    {
+        pServer->AddArg("useDstFld", "true");
+    }
+    pServer->AddArg("tzAbbrStr", rTz.pStd);
+    pServer->AddArg("dstAbbrStr", rTz.pDst);
+    snprintf(buf, sizeof(buf), "%d", rTz.start.week);
+    pServer->AddArg("weekNum1", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.start.dow);
+    pServer->AddArg("dayOfWeek1", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.start.month);
+    pServer->AddArg("month1", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.start.hour);
+    pServer->AddArg("hour1", pHour1 != NULL ? pHour1 : buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.end.week);
+    pServer->AddArg("weekNum2", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.end.dow);
+    pServer->AddArg("dayOfWeek2", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.end.month);
+    pServer->AddArg("month2", buf);
+    snprintf(buf, sizeof(buf), "%d", rTz.end.hour);
+    pServer->AddArg("hour2", buf);
+    pServer->AddArg("ntpServer1", "pool.ntp.org");
+    pServer->AddArg("ntpServer2", "time.nist.gov");
+    pServer->AddArg("ntpServer3", "");
+    pServer->AddArg("ntpServer4", "");
+} // End SetForm().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// RunProcess()
+//
+// Runs process() for a while of simulated time, so that any pending save
+// is done.  No call may write NVS more than once.
+/////////////////////////////////////////////////////////////////////////////////
+static void RunProcess(WiFiTimeManager *pWtm, uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms / 100; i++)
+    {
+        HostClock::Advance(100 * 1000);
+        size_t writes = Preferences::s_Writes;
+        pWtm->process();
+        CHECK(Preferences::s_Writes - writes <= 1);
+    }
+} // End RunProcess().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TestSetupForm()
+/////////////////////////////////////////////////////////////////////////////////
+static void TestSetupForm(WiFiTimeManager *pWtm)
+{
+    printf("Setup page save:\n");
+    WebServer *pServer = pWtm->server.get();
+
+    // Every field is decoded, and the TZ string follows.
+    const TestZone &rCet = ZONES[1];
+    SetForm(pServer, rCet);
+    pWtm->HostSaveParams();
+    TimeParameters params;
+    pWtm->GetParams(&params);
+    CHECK(params.m_TzOfst == 60);
+    CHECK(params.m_UseDst);
+    CHECK(params.m_DstOfst == 60);
+    CHECK(strcmp(params.m_DstEndRule.abbrev, "CET") == 0);
+    CHECK(strcmp(params.m_DstStartRule.abbrev, "CEST") == 0);
+    CHECK((params.m_DstStartRule.week == 5) && (params.m_DstStartRule.month == 3) &&
+          (params.m_DstStartRule.dow == 0) && (params.m_DstStartRule.hour == 2));
+    CHECK((params.m_DstEndRule.week == 5) && (params.m_DstEndRule.month == 10) &&
+          (params.m_DstEndRule.dow == 0) && (params.m_DstEndRule.hour == 3));
+    CHECK(strcmp(params.m_NtpAddr[0], "pool.ntp.org") == 0);
+    CHECK(strcmp(params.m_NtpAddr[1], "time.nist.gov") == 0);
+    CHECK(params.m_NtpAddr[2][0] == '\0');
+    printf("  TZ string: %s\n", getenv("TZ"));
+    CHECK(strcmp(getenv("TZ"), "CET-1:0CEST-2:0,M3.5.0/2,M10.5.0/3") == 0);
+
+    // The getters read back a setting as soon as it is set, while GetParams()
+    // and the GetApplied...() getters give the settings in effect.
+    char buf[TimeParameters::MAX_NTP_ADDR];
+    CHECK((pWtm->GetTzOfst() == 60) && pWtm->GetUseDst() && (pWtm->GetDstEndMonth() == 10));
+    CHECK(strcmp(pWtm->GetTzAbbrev(), "CET") == 0);
+    CHECK(strcmp(pWtm->GetDstAbbrev(), "CEST") == 0);
+    CHECK(strcmp(pWtm->GetNtpAddr(1), "time.nist.gov") == 0);
+    CHECK(strcmp(pWtm->GetAppliedTzAbbrev(buf, sizeof(buf)), "CET") == 0);
+    CHECK(strcmp(pWtm->GetAppliedDstAbbrev(buf, sizeof(buf)), "CEST") == 0);
+    CHECK(strcmp(pWtm->GetAppliedNtpAddr(1, buf, sizeof(buf)), "time.nist.gov") == 0);
+    CHECK(strcmp(pWtm->GetAppliedNtpAddr(0, buf, 5), "pool") == 0);
+    pWtm->BeginUpdate();
+    pWtm->SetTzOfst(120);
+    pWtm->SetTzAbbrev("EET");
+    CHECK((pWtm->GetTzOfst() == 120) && (strcmp(pWtm->GetTzAbbrev(), "EET") == 0));
+    CHECK(strcmp(pWtm->GetAppliedTzAbbrev(buf, sizeof(buf)), "CET") == 0);
+    CHECK((pWtm->GetParams(&params) != 0) && (params.m_TzOfst == 60));
+    pWtm->AbortUpdate();
+    CHECK((pWtm->GetTzOfst() == 60) && (strcmp(pWtm->GetTzAbbrev(), "CET") == 0));
+
+    // An empty text field clears the text, and missing fields are left alone.
+    pServer->ClearRequest();
+    pServer->AddArg("ntpServer2", "");
+    pWtm->HostSaveParams();
+    pWtm->GetParams(&params);
+    CHECK(params.m_NtpAddr[1][0] == '\0');
+    CHECK(strcmp(params.m_NtpAddr[0], "pool.ntp.org") == 0);
+    CHECK(params.m_TzOfst == 60);
+
+    // Values are kept within range, and a missing checkbox means no DST.
+    TestZone noDst = rCet;
+    noDst.useDst = false;
+    SetForm(pServer, noDst, "99");
+    pWtm->HostSaveParams();
+    pWtm->GetParams(&params);
+    CHECK(!params.m_UseDst);
+    CHECK(params.m_DstStartRule.hour == WiFiTimeManager::HOUR_MAX);
+
+    // Let the save happen, then check that saving the same values again
+    // doesn't write NVS.
+    size_t writes = Preferences::s_Writes;
+    SetForm(pServer, rCet);
+    pWtm->HostSaveParams();
+    RunProcess(pWtm, 10000);
+    CHECK(Preferences::s_Writes > writes);
+    writes = Preferences::s_Writes;
+    pWtm->HostSaveParams();
+    RunProcess(pWtm, 10000);
+    printf("  NVS writes for an unchanged save: %zu\n", Preferences::s_Writes - writes);
+    CHECK(Preferences::s_Writes == writes);
+} // End TestSetupForm().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TestWebPage()
+/////////////////////////////////////////////////////////////////////////////////
+static void TestWebPage(WiFiTimeManager *pWtm)
+{
+    printf("Setup page buffer:\n");
+
+    // The buffer holds the page and its settings, plus the headroom.
+    size_t pageLen = 0;
+    uint32_t maxSize = 0;
+    pWtm->SetUpdateWebPageCallback([&](String &rPage, uint32_t max)
+        { pageLen = rPage.length(); maxSize = max; });
+    const char *pPage = pWtm->HostParamHtml(0);
+    CHECK(pPage != NULL);
+    CHECK(strlen(pPage) == pageLen);
+    CHECK(strstr(pPage, "</script>") != NULL);
+    printf("  page %zu bytes, buffer %u bytes\n", pageLen, maxSize + 1);
+    CHECK(maxSize - pageLen >= WEB_HEADROOM);
+    CHECK(maxSize - pageLen < WEB_HEADROOM + 512);
+    pWtm->SetUpdateWebPageCallback(NULL);
+} // End TestWebPage().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TestUtcTime()
+/////////////////////////////////////////////////////////////////////////////////
+static void TestUtcTime(WiFiTimeManager *pWtm)
+{
+    printf("UTC time:\n");
+
+    // Connect, and let network time come up.
+    WiFi.HostConnect(true);
+    RunProcess(pWtm, 1000);
+    CHECK(pWtm->IsConnected());
+
+    // An SNTP sync sets the time.
+    timeval tv = { (time_t)UTC_2024 + 12345, 250000 };
+    sntp_sync_time(&tv);
+    CHECK(pWtm->UsingNetworkTime());
+    CHECK(pWtm->GetUtcTimeT() == tv.tv_sec);
+
+    // It then follows the clock.
+    HostClock::Advance(90 * 1000000LL + 500000);
+    CHECK(pWtm->GetUtcTimeT() == tv.tv_sec + 90);
+    CHECK(pWtm->GetUtcMicros() == ((int64_t)tv.tv_sec + 90) * 1000000 + 750000);
+
+    // Save a zone for the checks below.  Then a checkpoint of good time and a
+    // scheduled save that fall due together are written by separate
+    // process() calls.
+    SetForm(pWtm->server.get(), ZONES[0]);
+    pWtm->HostSaveParams();
+    size_t writes = Preferences::s_Writes;
+    pWtm->SetNtpAddr(3, "time.google.com");
+    pWtm->ScheduleSave();
+    HostClock::Advance(WiFiTimeManager::DFLT_CHECKPOINT_SEC * 1000000LL);
+    RunProcess(pWtm, 1000);
+    printf("  NVS writes for a checkpoint and a save: %zu\n", Preferences::s_Writes - writes);
+    CHECK(Preferences::s_Writes - writes == 2);
+
+    // Local time agrees with the C library's for the zone that was saved,
+    // which it sets in the TZ environment.
+    tzset();
+    size_t mismatches = 0;
+    for (int64_t utc = UTC_2024; utc < UTC_2024 + 10 * 366 * 86400LL; utc += HALF_HOUR)
+    {
+        time_t t = (time_t)utc;
+        tm expected;
+        tm actual;
+        localtime_r(&t, &expected);
+        pWtm->UtcToLocal(t, &actual);
+        if ((actual.tm_hour != expected.tm_hour) || (actual.tm_mday != expected.tm_mday) ||
+            (actual.tm_isdst != expected.tm_isdst))
+        {
+            mismatches++;
+        }
+    }
+    printf("  UtcToLocal() vs localtime_r(), 2024 - 2033: %zu mismatches\n", mismatches);
+    CHECK(mismatches == 0);
+} // End TestUtcTime().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// RestRequest()
+//
+// Sends a REST API request, and returns the reply's status code.  pAuth and
+// pBody may be NULL to leave out the Authorization header or the body.  The
+// heap allocations made while handling it are left in gRequestAllocs.
+/////////////////////////////////////////////////////////////////////////////////
+static size_t gRequestAllocs = 0;
+static int RestRequest(WiFiTimeManager *pWtm, HTTPMethod method, const char *pUri,
+                       const char *pAuth, const char *pBody = NULL)
+{
+    WebServer *pServer = WebServer::HostFind(WiFiTimeManager::DFLT_REST_PORT);
+    pServer->ClearRequest();
+    if (pAuth != NULL)
+    {
+        pServer->AddHeader("Authorization", pAuth);
+    }
+    if (pBody != NULL)
+    {
+        pServer->AddArg("plain", pBody);
+    }
+    pServer->m_LastCode = 0;
+    size_t allocs = gAllocs;
+    CHECK(pServer->HandleRequest(method, pUri));
+    gRequestAllocs = gAllocs - allocs;
+    return pServer->m_LastCode;
+} // End RestRequest().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TestRest()
+/////////////////////////////////////////////////////////////////////////////////
+static void TestRest(WiFiTimeManager *pWtm)
+{
+    printf("REST API:\n");
+    const char *pConfig = "/wtm/api/config";
+    const char *pGood   = "Bearer " REST_TOKEN;
+
+    // The API has a server of its own, started once the network connected.
+    // The WiFiManager's portal, with its unguarded pages, has stopped.
+    WebServer *pServer = WebServer::HostFind(WiFiTimeManager::DFLT_REST_PORT);
+    CHECK((pServer != NULL) && (pServer != pWtm->server.get()));
+    if (pServer == NULL)
+    {
+        return;
+    }
+    CHECK(pServer->m_Began);
+    CHECK(!pWtm->getWebPortalActive());
+    CHECK(!pWtm->server->HandleRequest(HTTP_GET, pConfig));
+
+    // Only the whole token will do.
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, NULL) == 401);
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, "Bearer") == 401);
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, "Bearer host-test-tokem") == 401);
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, "Bearer host-test-toke") == 401);
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, "Bearer host-test-token2") == 401);
+    CHECK(RestRequest(pWtm, HTTP_GET, pConfig, pGood) == 200);
+
+    // A missing or bad body is refused, and a good one is applied.
+    TimeParameters params;
+    CHECK(RestRequest(pWtm, HTTP_PUT, pConfig, pGood) == 400);
+    CHECK(RestRequest(pWtm, HTTP_PUT, pConfig, pGood, "{\"TIMEZONE\":") == 400);
+    CHECK(RestRequest(pWtm, HTTP_PUT, pConfig, pGood, "{\"TIMEZONE\":\"x\"}") == 400);
+    CHECK(RestRequest(pWtm, HTTP_PUT, pConfig, pGood,
+                      "{\"NTP_ADDRESS2\":\"time.google.com\"}") == 200);
+    pWtm->GetParams(&params);
+    CHECK(strcmp(params.m_NtpAddr[1], "time.google.com") == 0);
+
+    // The replies need no heap.  A GET costs only the copies of the
+    // Authorization header's name and value, and a PUT the copy of its body
+    // as well.
+    CHECK(RestRequest(pWtm, HTTP_GET, "/wtm/api/metrics", pGood) == 200);
+    printf("  Metrics request allocations: %zu\n", gRequestAllocs);
+    CHECK(RestRequest(pWtm, HTTP_GET, "/wtm/api/status", pGood) == 200);
+    size_t getAllocs = gRequestAllocs;
+    printf("  Status request allocations: %zu\n", getAllocs);
+    CHECK(getAllocs == 2);
+    CHECK(RestRequest(pWtm, HTTP_PUT, pConfig, pGood, "{\"USE_DST\":true}") == 200);
+    printf("  Config PUT allocations: %zu\n", gRequestAllocs);
+    CHECK(gRequestAllocs == getAllocs + 1);
+} // End TestRest().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Measure()
+//
+// Runs a function many times, and prints the calls per second and the heap
+// allocations per call.
+/////////////////////////////////////////////////////////////////////////////////
+template <typename Func>
+static double Measure(const char *pName, size_t calls, Func func)
+{
+    size_t allocs = gAllocs;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++)
+    {
+        func(i);
+    }
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    double allocsPerCall = (double)(gAllocs - allocs) / calls;
+    printf("  %-34s %12.0f calls/s %9.1f ns/call %6.2f allocs/call\n",
+           pName, calls / secs.count(), 1e9 * secs.count() / calls, allocsPerCall);
+    return allocsPerCall;
+} // End Measure().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Benchmark()
+/////////////////////////////////////////////////////////////////////////////////
+static void Benchmark(WiFiTimeManager *pWtm)
+{
+    printf("Benchmarks:\n");
+    const size_t CALLS = 1000000;
+    const TestZone &rTz = ZONES[0];
+    SetTz(rTz.pTz);
+    Zone zone;
+    zone.Build(rTz.stdOfst, rTz.useDst, rTz.dstOfst, rTz.start, rTz.end, rTz.pStd, rTz.pDst, 2023);
+    tm local;
+
+    Measure("localtime_r()", CALLS, [&](size_t i)
+        { time_t t = (time_t)(UTC_2024 + 997 * (int64_t)i); gSink = localtime_r(&t, &local)->tm_hour; });
+    CHECK(Measure("Zone::ToLocal()", CALLS, [&](size_t i)
+        { gSink = zone.ToLocal(UTC_2024 + 997 * (int64_t)i, &local)->tm_hour; }) == 0);
+    CHECK(Measure("Zone::ToLocal() past the table", CALLS, [&](size_t i)
+        { gSink = zone.ToLocal(UTC_2100 + 997 * (int64_t)i, &local)->tm_hour; }) == 0);
+    CHECK(Measure("UtcToLocal()", CALLS, [&](size_t i)
+        { gSink = pWtm->UtcToLocal((time_t)(UTC_2024 + 997 * (int64_t)i), &local)->tm_hour; }) == 0);
+    CHECK(Measure("GetUtcTimeT()", CALLS, [&](size_t)
+        { HostClock::Advance(1000); gSink = pWtm->GetUtcTimeT(); }) == 0);
+    CHECK(Measure("GetLocalTime()", CALLS, [&](size_t)
+        { HostClock::Advance(1000); gSink = pWtm->GetLocalTime(&local)->tm_sec; }) == 0);
+    char abbrev[WiFiTimeManager::ABBREV_SIZE];
+    CHECK(Measure("GetLocalTimezoneString()", CALLS, [&](size_t)
+        { gSink = (int64_t)pWtm->GetLocalTimezoneString(abbrev, sizeof(abbrev))[0]; }) == 0);
+    CHECK(Measure("GetTzOfst()", CALLS, [&](size_t)
+        { gSink = pWtm->GetTzOfst(); }) == 0);
+
+    // A save of the Setup page.  The field names all fit in a String's inline
+    // buffer, so copying them costs nothing.  Only the two NTP addresses are
+    // too long for it, so their copies are the only allocations.
+    WebServer *pServer = pWtm->server.get();
+    SetForm(pServer, ZONES[1]);
+    double allocs = Measure("SaveParamCallback() unchanged", CALLS / 10, [&](size_t)
+        { pWtm->HostSaveParams(); });
+    CHECK(allocs == 2.0);
+    RunProcess(pWtm, 10000);
+} // End Benchmark().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// main()
+/////////////////////////////////////////////////////////////////////////////////
+int main()
+{
+    TestZones();
+
+    // Start the library as a sketch would.  There is no network, so it
+    // comes up offline with the default settings.
+    HostClock::Advance(1000000);
+    WiFiTimeManager *pWtm = WiFiTimeManager::Instance();
+    pWtm->SetPrintLevel(WiFiTimeManager::PL_NONE);
+    CHECK(!pWtm->SetRestApi(true));
+    CHECK(!pWtm->SetRestApi(true, ""));
+    CHECK(pWtm->SetRestApi(true, REST_TOKEN));
+    pWtm->SetWebPageHeadroom(WEB_HEADROOM);
+    CHECK(pWtm->Init("Host Test", NULL, true));
+    pWtm->setConfigPortalBlocking(false);
+    pWtm->HostStartPortal();
+
+    TestSetupForm(pWtm);
+    TestWebPage(pWtm);
+    TestUtcTime(pWtm);
+    TestRest(pWtm);
+    Benchmark(pWtm);
+
+    printf("%s: %d failures\n", gFailures == 0 ? "PASSED" : "FAILED", gFailures);
+    return gFailures == 0 ? 0 : 1;
+} // End main().
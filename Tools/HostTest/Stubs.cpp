@@ -0,0 +1,446 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Stubs.cpp
+//
+// Implements the host stand-ins in the stubs directory.  The system clock
+// (gettimeofday(), settimeofday() and time()) is simulated on top of
+// HostClock, so the library can set it without touching the host's clock.
+// The linker sends the library's calls here (see the Makefile).
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPmDNS.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <esp_sntp.h>
+
+
+int64_t        HostClock::s_Us = 0;
+HardwareSerial Serial;
+EspClass       ESP;
+MDNSResponder  MDNS;
+TwoWire        Wire;
+WiFiClass      WiFi;
+size_t         WiFiClient::s_Written = 0;
+sntp_sync_time_cb_t g_HostSntpCallback = NULL;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The simulated system clock.  It starts at the epoch, and runs at the rate
+// of HostClock.
+/////////////////////////////////////////////////////////////////////////////////
+static int64_t s_SysOffsetUs = 0;
+
+extern "C" int __wrap_gettimeofday(struct timeval *pTv, void *)
+{
+    int64_t us = HostClock::s_Us + s_SysOffsetUs;
+    pTv->tv_sec  = (time_t)(us / 1000000);
+    pTv->tv_usec = (suseconds_t)(us % 1000000);
+    return 0;
+}
+
+extern "C" int __wrap_settimeofday(const struct timeval *pTv, const void *)
+{
+    s_SysOffsetUs = (int64_t)pTv->tv_sec * 1000000 + pTv->tv_usec - HostClock::s_Us;
+    return 0;
+}
+
+extern "C" time_t __wrap_time(time_t *pT)
+{
+    struct timeval tv;
+    __wrap_gettimeofday(&tv, NULL);
+    if (pT != NULL)
+    {
+        *pT = tv.tv_sec;
+    }
+    return tv.tv_sec;
+}
+
+void sntp_sync_time(struct timeval *pTv)
+{
+    __wrap_settimeofday(pTv, NULL);
+    if (g_HostSntpCallback != NULL)
+    {
+        g_HostSntpCallback(pTv);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Preferences
+/////////////////////////////////////////////////////////////////////////////////
+size_t Preferences::s_Writes = 0;
+std::map<std::string, Preferences::Space_t> Preferences::s_Store;
+
+bool Preferences::clear()
+{
+    s_Writes++;
+    s_Store[m_Space].clear();
+    return true;
+}
+
+bool Preferences::remove(const char *pKey)
+{
+    s_Writes++;
+    return s_Store[m_Space].erase(pKey) != 0;
+}
+
+size_t Preferences::putBytes(const char *pKey, const void *pValue, size_t len)
+{
+    if (m_ReadOnly)
+    {
+        return 0;
+    }
+    s_Writes++;
+    const uint8_t *pBytes = (const uint8_t *)pValue;
+    s_Store[m_Space][pKey].assign(pBytes, pBytes + len);
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char *pKey)
+{
+    Space_t &rSpace = s_Store[m_Space];
+    Space_t::const_iterator it = rSpace.find(pKey);
+    return it == rSpace.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *pKey, void *pBuf, size_t maxLen)
+{
+    Space_t &rSpace = s_Store[m_Space];
+    Space_t::const_iterator it = rSpace.find(pKey);
+    if ((it == rSpace.end()) || (it->second.size() > maxLen))
+    {
+        return 0;
+    }
+    memcpy(pBuf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JSON documents.
+/////////////////////////////////////////////////////////////////////////////////
+const JsonSlot *JsonVariantConst::Slot() const
+{
+    return m_pDoc != NULL ? m_pDoc->GetSlot(m_Slot) : NULL;
+}
+
+bool JsonVariantConst::isNull() const
+{
+    const JsonSlot *pSlot = Slot();
+    return (pSlot == NULL) || (pSlot->m_Type == JsonSlot::jtNull);
+}
+
+void JsonVariant::SetInt(int64_t value, JsonSlot::Type_t type)
+{
+    JsonSlot *pSlot = MutableSlot();
+    if (pSlot != NULL)
+    {
+        pSlot->m_Type = type;
+        pSlot->m_Int  = value;
+    }
+}
+
+void JsonVariant::SetFloat(double value)
+{
+    JsonSlot *pSlot = MutableSlot();
+    if (pSlot != NULL)
+    {
+        pSlot->m_Type  = JsonSlot::jtFloat;
+        pSlot->m_Float = value;
+    }
+}
+
+void JsonVariant::SetString(const char *pValue)
+{
+    JsonSlot *pSlot = MutableSlot();
+    if ((pSlot != NULL) && (pValue != NULL))
+    {
+        JsonDocument *pDoc = const_cast<JsonDocument *>(m_pDoc);
+        pSlot->m_pStr = pDoc->CopyString(pValue, strlen(pValue));
+        pSlot->m_Type = pSlot->m_pStr != NULL ? JsonSlot::jtString : JsonSlot::jtNull;
+    }
+}
+
+JsonVariant JsonObject::operator[](const char *pKey) const
+{
+    return JsonVariant(m_pDoc, m_pDoc != NULL ? m_pDoc->FindOrAdd(m_Slot, pKey) : -1);
+}
+
+void JsonDocument::clear()
+{
+    m_Used       = 1;
+    m_PoolUsed   = 0;
+    m_Overflowed = false;
+    m_pSlots[0].m_Parent = -1;
+    m_pSlots[0].m_pKey   = NULL;
+    m_pSlots[0].m_Type   = JsonSlot::jtObject;
+}
+
+int JsonDocument::Find(int parent, const char *pKey) const
+{
+    for (size_t i = 1; i < m_Used; i++)
+    {
+        if ((m_pSlots[i].m_Parent == parent) && (strcmp(m_pSlots[i].m_pKey, pKey) == 0))
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int JsonDocument::FindOrAdd(int parent, const char *pKey)
+{
+    int slot = Find(parent, pKey);
+    if ((slot >= 0) || (parent < 0))
+    {
+        return slot;
+    }
+    const char *pCopy = CopyString(pKey, strlen(pKey));
+    if ((pCopy == NULL) || (m_Used == m_MaxSlots))
+    {
+        m_Overflowed = true;
+        return -1;
+    }
+    JsonSlot &rSlot = m_pSlots[m_Used];
+    rSlot.m_Parent = parent;
+    rSlot.m_pKey   = pCopy;
+    rSlot.m_Type   = JsonSlot::jtNull;
+    return (int)m_Used++;
+}
+
+const char *JsonDocument::CopyString(const char *pStr, size_t len)
+{
+    if (m_PoolUsed + len + 1 > m_PoolSize)
+    {
+        m_Overflowed = true;
+        return NULL;
+    }
+    char *pCopy = m_pPool + m_PoolUsed;
+    memcpy(pCopy, pStr, len);
+    pCopy[len] = '\0';
+    m_PoolUsed += len + 1;
+    return pCopy;
+}
+
+JsonObject JsonDocument::createNestedObject(const char *pKey)
+{
+    int slot = FindOrAdd(0, pKey);
+    if (slot >= 0)
+    {
+        m_pSlots[slot].m_Type = JsonSlot::jtObject;
+    }
+    return JsonObject(this, slot);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JSON serialization.
+/////////////////////////////////////////////////////////////////////////////////
+void WriteJsonString(const char *pStr, void (*pPut)(void *, const char *, size_t), void *pCtx)
+{
+    pPut(pCtx, "\"", 1);
+    for (; *pStr != '\0'; pStr++)
+    {
+        if ((*pStr == '"') || (*pStr == '\\'))
+        {
+            pPut(pCtx, "\\", 1);
+        }
+        pPut(pCtx, pStr, 1);
+    }
+    pPut(pCtx, "\"", 1);
+}
+
+static void SerializeObject(const JsonDocument &rDoc, int parent,
+                            void (*pPut)(void *, const char *, size_t), void *pCtx)
+{
+    bool first = true;
+    pPut(pCtx, "{", 1);
+    for (size_t i = 1; i < rDoc.GetUsed(); i++)
+    {
+        const JsonSlot *pSlot = rDoc.GetSlot((int)i);
+        if (pSlot->m_Parent != parent)
+        {
+            continue;
+        }
+        if (!first)
+        {
+            pPut(pCtx, ",", 1);
+        }
+        first = false;
+        WriteJsonString(pSlot->m_pKey, pPut, pCtx);
+        pPut(pCtx, ":", 1);
+
+        char buf[32];
+        switch (pSlot->m_Type)
+        {
+            case JsonSlot::jtNull:
+                pPut(pCtx, "null", 4);
+                break;
+            case JsonSlot::jtInt:
+                pPut(pCtx, buf, snprintf(buf, sizeof(buf), "%lld", (long long)pSlot->m_Int));
+                break;
+            case JsonSlot::jtFloat:
+                pPut(pCtx, buf, snprintf(buf, sizeof(buf), "%.9g", pSlot->m_Float));
+                break;
+            case JsonSlot::jtBool:
+                pSlot->m_Int ? pPut(pCtx, "true", 4) : pPut(pCtx, "false", 5);
+                break;
+            case JsonSlot::jtString:
+                WriteJsonString(pSlot->m_pStr, pPut, pCtx);
+                break;
+            case JsonSlot::jtObject:
+                SerializeObject(rDoc, (int)i, pPut, pCtx);
+                break;
+        }
+    }
+    pPut(pCtx, "}", 1);
+}
+
+void SerializeJsonTo(const JsonDocument &rDoc, void (*pPut)(void *, const char *, size_t), void *pCtx)
+{
+    SerializeObject(rDoc, 0, pPut, pCtx);
+}
+
+static void CountBytes(void *pCtx, const char *, size_t len)
+{
+    *(size_t *)pCtx += len;
+}
+
+size_t measureJson(const JsonDocument &rDoc)
+{
+    size_t len = 0;
+    SerializeJsonTo(rDoc, CountBytes, &len);
+    return len;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JSON parsing.  Handles objects of numbers, booleans, null, strings without
+// escapes, and nested objects.
+/////////////////////////////////////////////////////////////////////////////////
+static const char *SkipSpace(const char *p)
+{
+    while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))
+    {
+        p++;
+    }
+    return p;
+}
+
+static DeserializationError ParseObject(JsonDocument &rDoc, int parent, const char *&p)
+{
+    p = SkipSpace(p);
+    if (*p++ != '{')
+    {
+        return DeserializationError::InvalidInput;
+    }
+    p = SkipSpace(p);
+    if (*p == '}')
+    {
+        p++;
+        return DeserializationError::Ok;
+    }
+    for (;;)
+    {
+        p = SkipSpace(p);
+        if (*p++ != '"')
+        {
+            return DeserializationError::InvalidInput;
+        }
+        const char *pKeyEnd = strchr(p, '"');
+        if (pKeyEnd == NULL)
+        {
+            return DeserializationError::IncompleteInput;
+        }
+        char key[64];
+        size_t keyLen = std::min((size_t)(pKeyEnd - p), sizeof(key) - 1);
+        memcpy(key, p, keyLen);
+        key[keyLen] = '\0';
+        p = SkipSpace(pKeyEnd + 1);
+        if (*p++ != ':')
+        {
+            return DeserializationError::InvalidInput;
+        }
+        int slot = rDoc.FindOrAdd(parent, key);
+        if (slot < 0)
+        {
+            return DeserializationError::NoMemory;
+        }
+        JsonSlot *pSlot = const_cast<JsonSlot *>(rDoc.GetSlot(slot));
+
+        p = SkipSpace(p);
+        if (*p == '"')
+        {
+            const char *pEnd = strchr(++p, '"');
+            if (pEnd == NULL)
+            {
+                return DeserializationError::IncompleteInput;
+            }
+            pSlot->m_pStr = rDoc.CopyString(p, pEnd - p);
+            if (pSlot->m_pStr == NULL)
+            {
+                return DeserializationError::NoMemory;
+            }
+            pSlot->m_Type = JsonSlot::jtString;
+            p = pEnd + 1;
+        }
+        else if (*p == '{')
+        {
+            pSlot->m_Type = JsonSlot::jtObject;
+            DeserializationError err = ParseObject(rDoc, slot, p);
+            if (err)
+            {
+                return err;
+            }
+        }
+        else if (strncmp(p, "true", 4) == 0)  { pSlot->m_Type = JsonSlot::jtBool; pSlot->m_Int = 1; p += 4; }
+        else if (strncmp(p, "false", 5) == 0) { pSlot->m_Type = JsonSlot::jtBool; pSlot->m_Int = 0; p += 5; }
+        else if (strncmp(p, "null", 4) == 0)  { pSlot->m_Type = JsonSlot::jtNull; p += 4; }
+        else if (*p == '[')
+        {
+            return DeserializationError::NotSupported;
+        }
+        else
+        {
+            char *pEnd = NULL;
+            double d = strtod(p, &pEnd);
+            if (pEnd == p)
+            {
+                return DeserializationError::InvalidInput;
+            }
+            bool isFloat = memchr(p, '.', pEnd - p) || memchr(p, 'e', pEnd - p) || memchr(p, 'E', pEnd - p);
+            pSlot->m_Type  = isFloat ? JsonSlot::jtFloat : JsonSlot::jtInt;
+            pSlot->m_Float = d;
+            pSlot->m_Int   = strtoll(p, NULL, 10);
+            p = pEnd;
+        }
+
+        p = SkipSpace(p);
+        if (*p == ',')
+        {
+            p++;
+            continue;
+        }
+        if (*p++ == '}')
+        {
+            return DeserializationError::Ok;
+        }
+        return DeserializationError::InvalidInput;
+    }
+}
+
+DeserializationError deserializeJson(JsonDocument &rDoc, char *pInput)
+{
+    rDoc.clear();
+    const char *p = SkipSpace(pInput);
+    if (*p == '\0')
+    {
+        return DeserializationError::EmptyInput;
+    }
+    return ParseObject(rDoc, 0, p);
+}
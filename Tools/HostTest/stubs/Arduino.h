@@ -0,0 +1,214 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Arduino.h
+//
+// Host stand-in for the parts of the ESP32 Arduino core that the library
+// uses.  String keeps the core's small string optimization (values of up to
+// 10 characters are held inline), so that heap counts taken on the host
+// match the device.  millis() and micros() follow a clock that the test
+// sets (see HostClock).
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include "pgmspace.h"
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH    1
+#define LOW     0
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define INPUT_PULLUP 0x05
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+using std::min;
+using std::max;
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// HostClock
+//
+// The simulated time base behind millis(), micros() and esp_timer_get_time().
+// It only moves when the test advances it.
+/////////////////////////////////////////////////////////////////////////////////
+struct HostClock
+{
+    static int64_t s_Us;
+    static void Advance(int64_t us) { s_Us += us; }
+};
+
+inline uint32_t millis()        { return (uint32_t)(HostClock::s_Us / 1000); }
+inline uint32_t micros()        { return (uint32_t)HostClock::s_Us; }
+inline void delay(uint32_t ms)  { HostClock::Advance((int64_t)ms * 1000); }
+inline void yield()             {}
+inline void pinMode(int, int)   {}
+inline void detachInterrupt(int) {}
+inline void attachInterruptArg(int, void (*)(void *), void *, int) {}
+inline int  digitalPinToInterrupt(int pin) { return pin; }
+
+
+class String;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Print
+/////////////////////////////////////////////////////////////////////////////////
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *pData, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            write(pData[i]);
+        }
+        return size;
+    }
+    size_t write(const char *pStr) { return write((const uint8_t *)pStr, strlen(pStr)); }
+    size_t write(const char *pData, size_t size) { return write((const uint8_t *)pData, size); }
+    size_t print(const char *pStr) { return write(pStr); }
+    size_t print(const String &rStr);
+    size_t print(int n)            { char b[16]; snprintf(b, sizeof(b), "%d", n); return write(b); }
+    size_t println(const char *pStr = "") { return print(pStr) + write("\r\n"); }
+    size_t printf(const char *fmt, ...)
+    {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        return n > 0 ? write((const uint8_t *)buf, std::min((size_t)n, sizeof(buf) - 1)) : 0;
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// String
+/////////////////////////////////////////////////////////////////////////////////
+class String
+{
+public:
+    String(const char *pStr = "") { Init(pStr, strlen(pStr)); }
+    String(const String &rOther)  { Init(rOther.c_str(), rOther.m_Len); }
+    explicit String(int n)        { char b[16]; snprintf(b, sizeof(b), "%d", n); Init(b, strlen(b)); }
+    ~String()                     { Free(); }
+
+    String &operator=(const String &rOther)
+    {
+        if (this != &rOther)
+        {
+            Free();
+            Init(rOther.c_str(), rOther.m_Len);
+        }
+        return *this;
+    }
+    String &operator=(const char *pStr) { Free(); Init(pStr, strlen(pStr)); return *this; }
+    String &operator+=(const char *pStr)
+    {
+        String old(*this);
+        size_t add = strlen(pStr);
+        char *pJoined = new char[old.m_Len + add + 1];
+        memcpy(pJoined, old.c_str(), old.m_Len);
+        memcpy(pJoined + old.m_Len, pStr, add + 1);
+        Free();
+        Init(pJoined, old.m_Len + add);
+        delete[] pJoined;
+        return *this;
+    }
+    String &operator+=(const String &rOther) { return *this += rOther.c_str(); }
+
+    bool operator==(const char *pStr) const { return strcmp(c_str(), pStr) == 0; }
+    bool operator==(const String &rOther) const { return *this == rOther.c_str(); }
+    bool operator!=(const char *pStr) const { return !(*this == pStr); }
+
+    const char *c_str() const   { return m_pHeap != NULL ? m_pHeap : m_Sso; }
+    char *begin()               { return m_pHeap != NULL ? m_pHeap : m_Sso; }
+    size_t length() const       { return m_Len; }
+    bool isEmpty() const        { return m_Len == 0; }
+    long toInt() const          { return strtol(c_str(), NULL, 10); }
+    bool startsWith(const char *pStr) const { return strncmp(c_str(), pStr, strlen(pStr)) == 0; }
+    void toCharArray(char *pBuf, size_t size) const
+    {
+        if (size > 0)
+        {
+            strncpy(pBuf, c_str(), size - 1);
+            pBuf[size - 1] = '\0';
+        }
+    }
+
+private:
+    static const size_t SSO_LEN = 10;
+
+    void Init(const char *pStr, size_t len)
+    {
+        m_Len = len;
+        m_pHeap = NULL;
+        char *pDest = m_Sso;
+        if (len > SSO_LEN)
+        {
+            m_pHeap = new char[len + 1];
+            pDest = m_pHeap;
+        }
+        memcpy(pDest, pStr, len);
+        pDest[len] = '\0';
+    }
+    void Free() { delete[] m_pHeap; m_pHeap = NULL; }
+
+    char   *m_pHeap;
+    size_t  m_Len;
+    char    m_Sso[SSO_LEN + 1];
+};
+
+inline size_t Print::print(const String &rStr) { return write(rStr.c_str()); }
+inline String operator+(const String &rLeft, const char *pRight) { String s(rLeft); s += pRight; return s; }
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Serial and ESP
+/////////////////////////////////////////////////////////////////////////////////
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *pData, size_t size) { return fwrite(pData, 1, size, stdout); }
+    using Print::write;
+    int availableForWrite() { return 128; }
+    operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getFreeHeap() { return 200000; }
+    void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+
+#endif // HOST_ARDUINO_H
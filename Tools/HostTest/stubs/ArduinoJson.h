@@ -0,0 +1,242 @@
+/////////////////////////////////////////////////////////////////////////////////
+// ArduinoJson.h
+//
+// Host stand-in for the subset of ArduinoJson 6 that the library uses.  A
+// document holds objects whose members are numbers, booleans, strings or
+// other objects, in fixed capacity storage like StaticJsonDocument.
+// DynamicJsonDocument takes its storage from the heap, as the real one
+// does.  All strings are copied into the document.  Arrays are not
+// supported.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ARDUINOJSON_H
+#define HOST_ARDUINOJSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+#include "Arduino.h"
+
+class JsonDocument;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JsonSlot
+//
+// One member of an object.  The root object is slot 0.
+/////////////////////////////////////////////////////////////////////////////////
+struct JsonSlot
+{
+    enum Type_t { jtNull, jtInt, jtFloat, jtBool, jtString, jtObject };
+
+    int         m_Parent;       // Index of the enclosing object, or -1.
+    const char *m_pKey;         // Member name, in the document's pool.
+    Type_t      m_Type;         // Type of the value.
+    int64_t     m_Int;          // jtInt or jtBool value.
+    double      m_Float;        // jtFloat value.
+    const char *m_pStr;         // jtString value, in the document's pool.
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// DeserializationError
+/////////////////////////////////////////////////////////////////////////////////
+class DeserializationError
+{
+public:
+    enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, NotSupported };
+
+    DeserializationError(Code code = Ok) : m_Code(code) {}
+    explicit operator bool() const { return m_Code != Ok; }
+    Code code() const { return m_Code; }
+    const char *c_str() const
+    {
+        static const char *NAMES[] =
+            { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "NotSupported" };
+        return NAMES[m_Code];
+    }
+
+private:
+    Code m_Code;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JsonVariantConst and JsonVariant
+/////////////////////////////////////////////////////////////////////////////////
+class JsonVariantConst
+{
+public:
+    JsonVariantConst(const JsonDocument *pDoc = NULL, int slot = -1) : m_pDoc(pDoc), m_Slot(slot) {}
+
+    bool isNull() const;
+    template <typename T> bool is() const;
+    template <typename T> T as() const;
+
+protected:
+    const JsonSlot *Slot() const;
+
+    const JsonDocument *m_pDoc;
+    int                 m_Slot;
+};
+
+class JsonVariant : public JsonVariantConst
+{
+public:
+    JsonVariant(JsonDocument *pDoc = NULL, int slot = -1) : JsonVariantConst(pDoc, slot) {}
+
+    JsonVariant &operator=(bool value)               { SetInt(value, JsonSlot::jtBool); return *this; }
+    JsonVariant &operator=(int value)                { SetInt(value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(unsigned value)           { SetInt(value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(long value)               { SetInt(value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(unsigned long value)      { SetInt((int64_t)value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(long long value)          { SetInt(value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(unsigned long long value) { SetInt((int64_t)value, JsonSlot::jtInt); return *this; }
+    JsonVariant &operator=(float value)              { SetFloat(value); return *this; }
+    JsonVariant &operator=(double value)             { SetFloat(value); return *this; }
+    JsonVariant &operator=(const char *pValue)       { SetString(pValue); return *this; }
+
+private:
+    JsonSlot *MutableSlot() const { return const_cast<JsonSlot *>(Slot()); }
+    void SetInt(int64_t value, JsonSlot::Type_t type);
+    void SetFloat(double value);
+    void SetString(const char *pValue);
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JsonObject
+/////////////////////////////////////////////////////////////////////////////////
+class JsonObject
+{
+public:
+    JsonObject(JsonDocument *pDoc = NULL, int slot = -1) : m_pDoc(pDoc), m_Slot(slot) {}
+    JsonVariant operator[](const char *pKey) const;
+    bool isNull() const { return m_Slot < 0; }
+
+private:
+    JsonDocument *m_pDoc;
+    int           m_Slot;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JsonDocument
+/////////////////////////////////////////////////////////////////////////////////
+class JsonDocument
+{
+public:
+    JsonVariant      operator[](const char *pKey)       { return JsonVariant(this, FindOrAdd(0, pKey)); }
+    JsonVariantConst operator[](const char *pKey) const { return JsonVariantConst(this, Find(0, pKey)); }
+    JsonObject       createNestedObject(const char *pKey);
+    void             clear();
+    bool             overflowed() const { return m_Overflowed; }
+    size_t           capacity() const { return m_PoolSize; }
+
+    // Used by the helpers below.
+    int             Find(int parent, const char *pKey) const;
+    int             FindOrAdd(int parent, const char *pKey);
+    const char     *CopyString(const char *pStr, size_t len);
+    const JsonSlot *GetSlot(int i) const { return (i >= 0) && ((size_t)i < m_Used) ? &m_pSlots[i] : NULL; }
+    size_t          GetUsed() const { return m_Used; }
+
+protected:
+    JsonDocument(JsonSlot *pSlots, size_t maxSlots, char *pPool, size_t poolSize) :
+        m_pSlots(pSlots), m_MaxSlots(maxSlots), m_pPool(pPool), m_PoolSize(poolSize)
+        { clear(); }
+    JsonDocument(const JsonDocument &);
+    JsonDocument &operator=(const JsonDocument &);
+
+    JsonSlot *m_pSlots;
+    size_t    m_MaxSlots;
+    size_t    m_Used;
+    char     *m_pPool;
+    size_t    m_PoolSize;
+    size_t    m_PoolUsed;
+    bool      m_Overflowed;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument
+{
+public:
+    StaticJsonDocument() : JsonDocument(m_Slots, N / 16 + 1, m_Pool, N) {}
+
+private:
+    JsonSlot m_Slots[N / 16 + 1];
+    char     m_Pool[N];
+};
+
+class DynamicJsonDocument : public JsonDocument
+{
+public:
+    explicit DynamicJsonDocument(size_t size) :
+        JsonDocument(new JsonSlot[size / 16 + 1], size / 16 + 1, new char[size], size) {}
+    ~DynamicJsonDocument() { delete[] m_pSlots; delete[] m_pPool; }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// JsonVariantConst templates.
+/////////////////////////////////////////////////////////////////////////////////
+template <typename T>
+bool JsonVariantConst::is() const
+{
+    const JsonSlot *pSlot = Slot();
+    if ((pSlot == NULL) || (pSlot->m_Type != JsonSlot::jtInt))
+    {
+        return false;
+    }
+    return (pSlot->m_Int >= (int64_t)std::numeric_limits<T>::min()) &&
+           ((uint64_t)pSlot->m_Int <= (uint64_t)std::numeric_limits<T>::max());
+}
+template <> inline bool JsonVariantConst::is<bool>() const
+    { return (Slot() != NULL) && (Slot()->m_Type == JsonSlot::jtBool); }
+template <> inline bool JsonVariantConst::is<const char *>() const
+    { return (Slot() != NULL) && (Slot()->m_Type == JsonSlot::jtString); }
+template <> inline bool JsonVariantConst::is<float>() const
+    { return (Slot() != NULL) && ((Slot()->m_Type == JsonSlot::jtFloat) || (Slot()->m_Type == JsonSlot::jtInt)); }
+
+template <typename T>
+T JsonVariantConst::as() const
+{
+    const JsonSlot *pSlot = Slot();
+    if (pSlot == NULL)
+    {
+        return T();
+    }
+    return pSlot->m_Type == JsonSlot::jtFloat ? (T)pSlot->m_Float : (T)pSlot->m_Int;
+}
+template <> inline const char *JsonVariantConst::as<const char *>() const
+    { return is<const char *>() ? Slot()->m_pStr : NULL; }
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Serialization.
+/////////////////////////////////////////////////////////////////////////////////
+void   WriteJsonString(const char *pStr, void (*pPut)(void *, const char *, size_t), void *pCtx);
+void   SerializeJsonTo(const JsonDocument &rDoc, void (*pPut)(void *, const char *, size_t), void *pCtx);
+size_t measureJson(const JsonDocument &rDoc);
+DeserializationError deserializeJson(JsonDocument &rDoc, char *pInput);
+
+// Writes to anything with a write(const uint8_t *, size_t) method, as
+// ArduinoJson's custom writers and Print do.
+template <typename TWriter>
+size_t serializeJson(const JsonDocument &rDoc, TWriter &rWriter)
+{
+    struct Put
+    {
+        static void Call(void *pCtx, const char *pData, size_t len)
+            { static_cast<TWriter *>(pCtx)->write((const uint8_t *)pData, len); }
+    };
+    SerializeJsonTo(rDoc, Put::Call, &rWriter);
+    return measureJson(rDoc);
+}
+
+#endif // HOST_ARDUINOJSON_H
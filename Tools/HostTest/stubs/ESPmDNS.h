@@ -0,0 +1,20 @@
+/////////////////////////////////////////////////////////////////////////////////
+// ESPmDNS.h
+//
+// Host stand-in for the ESP32 mDNS responder.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+class MDNSResponder
+{
+public:
+    bool begin(const char *) { return true; }
+};
+extern MDNSResponder MDNS;
+
+#endif // HOST_ESPMDNS_H
@@ -0,0 +1,51 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Preferences.h
+//
+// Host stand-in for the ESP32 NVS Preferences library.  Values are kept in
+// memory, and every write is counted so that a test can check how often
+// the library would wear the flash.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Preferences
+{
+public:
+    static size_t s_Writes;     // Writes to any namespace since startup.
+
+    bool begin(const char *pName, bool readOnly = false)
+        { m_Space = pName; m_ReadOnly = readOnly; return true; }
+    void end() {}
+    bool clear();
+    bool remove(const char *pKey);
+
+    size_t putBytes(const char *pKey, const void *pValue, size_t len);
+    size_t getBytesLength(const char *pKey);
+    size_t getBytes(const char *pKey, void *pBuf, size_t maxLen);
+    size_t putLong64(const char *pKey, int64_t value)
+        { return putBytes(pKey, &value, sizeof(value)) != 0 ? sizeof(value) : 0; }
+    int64_t getLong64(const char *pKey, int64_t dflt = 0)
+    {
+        int64_t value = dflt;
+        return getBytes(pKey, &value, sizeof(value)) == sizeof(value) ? value : dflt;
+    }
+
+private:
+    typedef std::map<std::string, std::vector<uint8_t> > Space_t;
+    static std::map<std::string, Space_t> s_Store;
+
+    std::string m_Space;
+    bool        m_ReadOnly;
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,150 @@
+/////////////////////////////////////////////////////////////////////////////////
+// WebServer.h
+//
+// Host stand-in for the ESP32 WebServer.  A test finds a server by its port,
+// fills in the arguments and headers of a request, then has the server run
+// the library's handler.  Replies are counted but not kept.  Like the real
+// server (arduino-esp32 2.x), arg(), hasArg(), and header() take the name as
+// a String by value, and arg() and header() return String copies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_WEBSERVER_H
+#define HOST_WEBSERVER_H
+
+#include <functional>
+#include <vector>
+#include "Arduino.h"
+#include "WiFi.h"
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_POST, HTTP_PUT, HTTP_DELETE };
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+class WebServer
+{
+public:
+    typedef std::function<void()> THandlerFunction;
+
+    explicit WebServer(int port = 80) : m_Port(port) { Servers().push_back(this); }
+    ~WebServer()
+    {
+        std::vector<WebServer *> &rList = Servers();
+        rList.erase(std::find(rList.begin(), rList.end(), this));
+    }
+
+    // Returns the server on a port, or NULL if there is none.  For tests.
+    static WebServer *HostFind(int port)
+    {
+        for (size_t i = 0; i < Servers().size(); i++)
+        {
+            if (Servers()[i]->m_Port == port)
+            {
+                return Servers()[i];
+            }
+        }
+        return NULL;
+    }
+
+    // Request set up, for tests.
+    void ClearRequest() { m_Args.clear(); m_Headers.clear(); }
+    void AddArg(const char *pName, const char *pValue)
+        { m_Args.push_back(Pair(pName, pValue)); }
+    void AddHeader(const char *pName, const char *pValue)
+        { m_Headers.push_back(Pair(pName, pValue)); }
+
+    // Runs the handler for a request, as the server would when one arrives.
+    // Returns false if there is no handler for it.
+    bool HandleRequest(HTTPMethod method, const char *pUri)
+    {
+        for (size_t i = 0; i < m_Handlers.size(); i++)
+        {
+            if ((m_Handlers[i].m_Method == method) && (m_Handlers[i].m_Uri == pUri))
+            {
+                m_Handlers[i].m_Func();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The WebServer interface.
+    void   on(const char *pUri, HTTPMethod method, THandlerFunction func)
+        { m_Handlers.push_back(Handler(pUri, method, func)); }
+    void   begin() { m_Began = true; }
+    void   handleClient() {}
+    void   collectHeaders(const char **, size_t) {}
+    int    args() const { return (int)m_Args.size(); }
+    String argName(int i) const { return i < args() ? m_Args[i].m_Name : String(); }
+    String arg(int i) const { return i < args() ? m_Args[i].m_Value : String(); }
+    String arg(String name) const { return Find(m_Args, name.c_str()); }
+    bool   hasArg(String name) const { return Has(m_Args, name.c_str()); }
+    String header(String name) const { return Find(m_Headers, name.c_str()); }
+
+    void   setContentLength(size_t) {}
+    void   sendHeader(const char *, const char *) {}
+    void   send(int code, const char * = NULL, const char *pContent = "")
+        { m_LastCode = code; WiFiClient::s_Written += strlen(pContent); }
+    void   send_P(int code, const char *, const char *, size_t size)
+        { m_LastCode = code; WiFiClient::s_Written += size; }
+    void   sendContent(const char *pContent, size_t size) { (void)pContent; WiFiClient::s_Written += size; }
+    void   sendContent(const char *pContent) { sendContent(pContent, strlen(pContent)); }
+    WiFiClient client() { return WiFiClient(); }
+
+    int    m_LastCode = 0;      // Status code of the last reply.
+    bool   m_Began = false;     // true once begin() is called.
+
+private:
+    static std::vector<WebServer *> &Servers()
+    {
+        static std::vector<WebServer *> s_Servers;
+        return s_Servers;
+    }
+
+    struct Pair
+    {
+        Pair(const char *pName, const char *pValue) : m_Name(pName), m_Value(pValue) {}
+        String m_Name;
+        String m_Value;
+    };
+
+    struct Handler
+    {
+        Handler(const char *pUri, HTTPMethod method, THandlerFunction func) :
+            m_Uri(pUri), m_Method(method), m_Func(func) {}
+        String           m_Uri;
+        HTTPMethod       m_Method;
+        THandlerFunction m_Func;
+    };
+
+    static String Find(const std::vector<Pair> &rList, const char *pName)
+    {
+        for (size_t i = 0; i < rList.size(); i++)
+        {
+            if (rList[i].m_Name == pName)
+            {
+                return rList[i].m_Value;
+            }
+        }
+        return String();
+    }
+    static bool Has(const std::vector<Pair> &rList, const char *pName)
+    {
+        for (size_t i = 0; i < rList.size(); i++)
+        {
+            if (rList[i].m_Name == pName)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int m_Port;
+    std::vector<Pair> m_Args;
+    std::vector<Pair> m_Headers;
+    std::vector<Handler> m_Handlers;
+};
+
+#endif // HOST_WEBSERVER_H
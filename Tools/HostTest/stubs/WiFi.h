@@ -0,0 +1,86 @@
+/////////////////////////////////////////////////////////////////////////////////
+// WiFi.h
+//
+// Host stand-in for the ESP32 WiFi library.  The station connects only
+// when a test says so.  Names never resolve, and UDP sockets never open.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+
+enum wl_status_t { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 };
+enum wifi_mode_t { WIFI_OFF = 0, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum arduino_event_id_t
+{
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP
+};
+union arduino_event_info_t { uint32_t reason; };
+typedef void (*WiFiEventSysCb)(arduino_event_id_t event, arduino_event_info_t info);
+
+class IPAddress
+{
+public:
+    IPAddress() : m_Addr(0) {}
+    operator uint32_t() const { return m_Addr; }
+private:
+    uint32_t m_Addr;
+};
+
+class WiFiClient : public Print
+{
+public:
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *, size_t size) { s_Written += size; return size; }
+    using Print::write;
+
+    static size_t s_Written;    // Bytes sent to any client since startup.
+};
+
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t) { return 0; }
+    void    stop() {}
+    int     beginPacket(IPAddress, uint16_t) { return 0; }
+    size_t  write(const uint8_t *, size_t) { return 0; }
+    int     endPacket() { return 0; }
+    int     parsePacket() { return 0; }
+    int     read(uint8_t *, size_t) { return 0; }
+};
+
+class WiFiClass
+{
+public:
+    bool        mode(wifi_mode_t) { return true; }
+    wl_status_t status() { return m_Status; }
+    int         onEvent(WiFiEventSysCb cb) { m_EventCb = cb; return 0; }
+    int         hostByName(const char *, IPAddress &) { return 0; }
+
+    // Connects the station, or drops its connection, and sends the event
+    // that the WiFi task would.  For tests.
+    void HostConnect(bool connect)
+    {
+        m_Status = connect ? WL_CONNECTED : WL_DISCONNECTED;
+        if (m_EventCb != NULL)
+        {
+            arduino_event_info_t info = { 0 };
+            m_EventCb(connect ? ARDUINO_EVENT_WIFI_STA_GOT_IP :
+                                ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+        }
+    }
+
+private:
+    wl_status_t    m_Status = WL_DISCONNECTED;
+    WiFiEventSysCb m_EventCb = NULL;
+};
+extern WiFiClass WiFi;
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,104 @@
+/////////////////////////////////////////////////////////////////////////////////
+// WiFiManager.h
+//
+// Host stand-in for the tzapu WiFiManager.  It keeps the callbacks and
+// parameters that it is given, and owns a stand-in WebServer that a test
+// can drive, but it never connects and never serves a portal.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_WIFIMANAGER_H
+#define HOST_WIFIMANAGER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Arduino.h"
+#include "WiFi.h"
+#include "WebServer.h"
+
+// Page templates, much shortened.
+static const char HTTP_HEAD_START[] = "<!DOCTYPE html><html><head><title>{v}</title>";
+static const char HTTP_SCRIPT[]     = "<script></script>";
+static const char HTTP_STYLE[]      = "<style></style>";
+static const char HTTP_HEAD_END[]   = "</head><body class='{c}'><div class='wrap'>";
+static const char HTTP_FORM_START[] = "<form method='POST' action='{v}'>";
+static const char HTTP_FORM_END[]   = "<button type='submit'>{v}</button></form>";
+static const char HTTP_BACKBTN[]    = "<form action='/'><button>Back</button></form>";
+static const char HTTP_END[]        = "</div></body></html>";
+
+class WiFiManagerParameter
+{
+public:
+    explicit WiFiManagerParameter(const char *pCustomHtml) : m_pCustomHtml(pCustomHtml) {}
+    virtual ~WiFiManagerParameter() {}
+    virtual const char *getCustomHTML() const { return m_pCustomHtml; }
+
+private:
+    const char *m_pCustomHtml;
+};
+
+class WiFiManager
+{
+public:
+    WiFiManager() : server(new WebServer()) {}
+    virtual ~WiFiManager() {}
+
+    boolean autoConnect() { return false; }
+    boolean autoConnect(const char *, const char * = NULL) { return false; }
+    boolean startConfigPortal(const char *, const char * = NULL) { return false; }
+    void    startWebPortal() { m_WebPortalActive = true; }
+    void    stopWebPortal() { m_WebPortalActive = false; }
+    bool    process() { return false; }
+    bool    getConfigPortalActive() { return false; }
+    bool    getWebPortalActive() { return m_WebPortalActive; }
+    void    resetSettings() {}
+    bool    addParameter(WiFiManagerParameter *p) { m_Params.push_back(p); return true; }
+    void    setMenu(std::vector<const char *> &) {}
+    void    setMenu(const char *[], uint8_t) {}
+    void    setClass(String) {}
+    void    setShowInfoErase(bool) {}
+    void    setConfigPortalBlocking(bool) {}
+    void    setSaveParamsCallback(std::function<void()> func) { m_SaveParamsCallback = func; }
+    void    setWebServerCallback(std::function<void()> func) { m_WebServerCallback = func; }
+    void    setCaptivePortalEnable(bool) {}
+    void    setCleanConnect(bool) {}
+    void    setTitle(String) {}
+    void    setHostname(const char *) {}
+    void    setConnectTimeout(unsigned long) {}
+    void    setConfigPortalTimeout(unsigned long) {}
+
+    // Start the web portal, save the Setup page, and get a parameter's HTML,
+    // as the real one would for a browser.  For tests.
+    void HostStartPortal()
+    {
+        m_WebPortalActive = true;
+        if (m_WebServerCallback)
+        {
+            m_WebServerCallback();
+        }
+    }
+    void HostSaveParams()
+    {
+        if (m_SaveParamsCallback)
+        {
+            m_SaveParamsCallback();
+        }
+    }
+    const char *HostParamHtml(size_t i) const
+    {
+        return i < m_Params.size() ? m_Params[i]->getCustomHTML() : NULL;
+    }
+
+    std::unique_ptr<WebServer> server;
+
+protected:
+    bool m_WebPortalActive = false;
+    std::vector<WiFiManagerParameter *> m_Params;
+    std::function<void()> m_SaveParamsCallback;
+    std::function<void()> m_WebServerCallback;
+};
+
+#endif // HOST_WIFIMANAGER_H
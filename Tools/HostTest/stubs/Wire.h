@@ -0,0 +1,29 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Wire.h
+//
+// Host stand-in for the Arduino I2C library.  There is no bus, so every
+// transfer fails.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire
+{
+public:
+    bool    begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    void    beginTransmission(uint8_t) {}
+    size_t  write(uint8_t) { return 1; }
+    size_t  write(const uint8_t *, size_t len) { return len; }
+    uint8_t endTransmission(bool = true) { return 2; }
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+    int     read() { return -1; }
+};
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
@@ -0,0 +1,30 @@
+/////////////////////////////////////////////////////////////////////////////////
+// esp_rom_crc.h
+//
+// Host stand-in for the ESP32 ROM CRC routine.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+// The same CRC-32 (little endian, reflected) as the ROM version.
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *pBuf, uint32_t len)
+{
+    crc = ~crc;
+    while (len-- > 0)
+    {
+        crc ^= *pBuf++;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+#endif // HOST_ESP_ROM_CRC_H
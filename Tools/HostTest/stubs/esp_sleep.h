@@ -0,0 +1,21 @@
+/////////////////////////////////////////////////////////////////////////////////
+// esp_sleep.h
+//
+// Host stand-in for the ESP-IDF deep sleep calls.  The host never sleeps.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include <stdint.h>
+
+enum esp_sleep_wakeup_cause_t { ESP_SLEEP_WAKEUP_UNDEFINED, ESP_SLEEP_WAKEUP_TIMER };
+
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+inline void esp_sleep_enable_timer_wakeup(uint64_t) {}
+inline void esp_deep_sleep_start() {}
+
+#endif // HOST_ESP_SLEEP_H
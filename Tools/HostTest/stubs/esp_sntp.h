@@ -0,0 +1,28 @@
+/////////////////////////////////////////////////////////////////////////////////
+// esp_sntp.h
+//
+// Host stand-in for the ESP-IDF SNTP client.  No packets are sent.  A test
+// delivers a sync by calling the notification callback, as the client would.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ESP_SNTP_H
+#define HOST_ESP_SNTP_H
+
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *pTv);
+
+extern sntp_sync_time_cb_t g_HostSntpCallback;
+
+inline void sntp_init() {}
+inline void sntp_stop() {}
+inline bool sntp_restart() { return true; }
+inline void sntp_set_sync_interval(uint32_t) {}
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t cb) { g_HostSntpCallback = cb; }
+void        sntp_sync_time(struct timeval *pTv);
+inline void configTime(long, int, const char *, const char * = NULL, const char * = NULL) {}
+
+#endif // HOST_ESP_SNTP_H
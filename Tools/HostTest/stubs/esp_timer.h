@@ -0,0 +1,40 @@
+/////////////////////////////////////////////////////////////////////////////////
+// esp_timer.h
+//
+// Host stand-in for the ESP-IDF high resolution timer.  The time follows
+// HostClock.  There are no timer callbacks on the host, so creating a timer
+// fails, which the library already handles.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include "Arduino.h"
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+typedef void *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *);
+enum esp_timer_dispatch_t { ESP_TIMER_TASK };
+struct esp_timer_create_args_t
+{
+    esp_timer_cb_t       callback;
+    void                *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char          *name;
+    bool                 skip_unhandled_events;
+};
+
+inline int64_t   esp_timer_get_time() { return HostClock::s_Us; }
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *, esp_timer_handle_t *pTimer)
+    { *pTimer = NULL; return ESP_FAIL; }
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t, uint64_t) { return ESP_FAIL; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t) { return ESP_FAIL; }
+inline esp_err_t esp_timer_delete(esp_timer_handle_t) { return ESP_OK; }
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,40 @@
+/////////////////////////////////////////////////////////////////////////////////
+// freertos/FreeRTOS.h
+//
+// Host stand-in for the FreeRTOS types and critical section macros.  The
+// harness runs on one thread, so critical sections do nothing.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+typedef void        *TaskHandle_t;
+typedef void        *QueueHandle_t;
+
+struct portMUX_TYPE { uint32_t owner; uint32_t count; };
+#define portMUX_INITIALIZER_UNLOCKED    { 0, 0 }
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  1
+#define pdFAIL                  0
+#define tskNO_AFFINITY          0x7fffffff
+#define portMAX_DELAY           0xffffffffU
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+#define portENTER_CRITICAL(pMux)        ((void)(pMux))
+#define portEXIT_CRITICAL(pMux)         ((void)(pMux))
+#define portENTER_CRITICAL_ISR(pMux)    ((void)(pMux))
+#define portEXIT_CRITICAL_ISR(pMux)     ((void)(pMux))
+#define portYIELD_FROM_ISR()            ((void)0)
+
+#endif // HOST_FREERTOS_H
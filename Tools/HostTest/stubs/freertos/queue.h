@@ -0,0 +1,20 @@
+/////////////////////////////////////////////////////////////////////////////////
+// freertos/queue.h
+//
+// Host stand-in for the FreeRTOS queue calls.  There is no service task on
+// the host, so no queue is ever created.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+inline QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return NULL; }
+inline BaseType_t    xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdFALSE; }
+inline BaseType_t    xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFALSE; }
+
+#endif // HOST_FREERTOS_QUEUE_H
@@ -0,0 +1,35 @@
+/////////////////////////////////////////////////////////////////////////////////
+// freertos/task.h
+//
+// Host stand-in for the FreeRTOS task calls.  The harness has no tasks, so
+// creating one fails, which makes the library do the work in line instead.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t,
+                                          void *, UBaseType_t, TaskHandle_t *pTask,
+                                          BaseType_t)
+{
+    if (pTask != NULL)
+    {
+        *pTask = NULL;
+    }
+    return pdFAIL;
+}
+inline void         vTaskDelete(TaskHandle_t) {}
+inline void         vTaskDelay(TickType_t) {}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return NULL; }
+inline BaseType_t   xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline void         vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+inline uint32_t     ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+
+#endif // HOST_FREERTOS_TASK_H
@@ -0,0 +1,22 @@
+/////////////////////////////////////////////////////////////////////////////////
+// pgmspace.h
+//
+// Host stand-in for the ESP32 PROGMEM helpers.  Flash is just memory.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#define PROGMEM
+#define PGM_P           const char *
+#define PSTR(s)         (s)
+#define FPSTR(p)        (p)
+#define F(s)            (s)
+#define strlen_P        strlen
+#define memcpy_P        memcpy
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+
+#endif // HOST_PGMSPACE_H
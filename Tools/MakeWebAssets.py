@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+###############################################################################
+# MakeWebAssets.py
+#
+# Builds WebAssets.h, which holds the gzipped static part of the Setup page
+# that is served in the wpmCached web page mode.  Run it from anywhere after
+# changing TZ_SELECT_STR in WebPages.h or Tools/WebAssets/setup.js:
+#
+#     python3 Tools/MakeWebAssets.py
+#
+# The HTML between the "<!-- HTML START -->" and "<!-- HTML END -->" markers
+# of TZ_SELECT_STR is inserted into setup.js, along with the java script
+# between the "// WTM SELECTORS START" and "// WTM SELECTORS END" markers
+# that fills in its selection lists, so the two pages never differ.
+# The gzip output has no timestamp, so that unchanged inputs always give the
+# same bytes, and the same ETag.
+#
+# Copyright (c) 2023, Joseph M. Corbett
+###############################################################################
+
+import gzip
+import json
+import os
+import re
+import zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+WEB_PAGES = os.path.join(ROOT, "WebPages.h")
+SETUP_JS = os.path.join(ROOT, "Tools", "WebAssets", "setup.js")
+OUTPUT = os.path.join(ROOT, "WebAssets.h")
+
+
+def setup_html():
+    """Returns the HTML part of TZ_SELECT_STR."""
+    with open(WEB_PAGES) as f:
+        text = f.read()
+    page = re.search(r'TZ_SELECT_STR\[\] = R"=====\((.*?)\)====="', text, re.S).group(1)
+    start = page.index("<!-- HTML START -->") + len("<!-- HTML START -->")
+    end = page.index("<!-- HTML END -->")
+    # Squeeze out the indentation.  Gzip would mostly hide it, but the
+    # browser doesn't need it either.
+    return "\n".join(line.strip() for line in page[start:end].splitlines() if line.strip())
+
+
+def setup_selectors():
+    """Returns the java script of TZ_SELECT_STR that fills in the selectors."""
+    with open(WEB_PAGES) as f:
+        text = f.read()
+    start = text.index("// WTM SELECTORS START")
+    end = text.index("// WTM SELECTORS END") + len("// WTM SELECTORS END")
+    return text[start:end]
+
+
+def main():
+    with open(SETUP_JS) as f:
+        script = f.read()
+    script = script.replace('/*WTM_HTML*/""', json.dumps(setup_html()), 1)
+    script = script.replace("/*WTM_SELECTORS*/", setup_selectors(), 1)
+    data = gzip.compress(script.encode(), 9, mtime=0)
+    etag = "%08x" % zlib.crc32(data)
+
+    lines = [
+        "/////////////////////////////////////////////////////////////////////////////////",
+        "// WebAssets.h",
+        "//",
+        "// Generated by Tools/MakeWebAssets.py from WebPages.h and",
+        "// Tools/WebAssets/setup.js.  Do not edit.",
+        "//",
+        "// The gzipped static part of the Setup page, served in the wpmCached web",
+        "// page mode.",
+        "//",
+        "/////////////////////////////////////////////////////////////////////////////////",
+        "#if !defined WEBASSETS_H",
+        "#define WEBASSETS_H",
+        "",
+        "#include <pgmspace.h>           // For PROGMEM.",
+        "",
+        "// Changes whenever the script does.  Used as its ETag and in its URL.",
+        '#define WTM_SETUP_JS_ETAG "%s"' % etag,
+        "",
+        "// %u bytes of script, %u bytes gzipped." % (len(script), len(data)),
+        "const uint8_t WTM_SETUP_JS_GZ[] PROGMEM =",
+        "{",
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines += ["};", "", "#endif // WEBASSETS_H", ""]
+
+    # C++ sources use CRLF line endings (see .gitattributes).
+    with open(OUTPUT, "w", newline="\r\n") as f:
+        f.write("\n".join(lines))
+    print("Wrote %s: %u bytes gzipped, ETag %s." % (OUTPUT, len(data), etag))
+
+
+if __name__ == "__main__":
+    main()
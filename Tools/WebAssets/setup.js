@@ -0,0 +1,97 @@
+// setup.js
+//
+// The static part of the WiFiTimeManager Setup page, used by the wpmCached
+// web page mode.  MakeWebAssets.py replaces the WTM_HTML placeholder with
+// the HTML of TZ_SELECT_STR in WebPages.h, and the WTM_SELECTORS placeholder
+// with the java script that fills in its selection lists, then gzips this
+// script into WebAssets.h.  The browser caches it, and fetches only the
+// current settings on each visit.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+(function() {
+  // Refresh page since we might have arrived here due returning from save.
+  if (sessionStorage.getItem("doReload") == "true") {
+    sessionStorage.setItem("doReload", "false");
+    location.reload();
+    return;
+  }
+
+  // Fill in our part of the form, and its selection lists.
+  document.getElementById("wtmSetup").innerHTML = /*WTM_HTML*/"";
+  fillSelectors();
+
+  /*WTM_SELECTORS*/
+
+  // Select an option of a selection list based on its value.
+  function setSelectedIndex(s, v) {
+    let obj = document.getElementById(s);
+    for (let i = 0; i < obj.options.length; i++) {
+      if (obj.options[i].value == v) {
+        obj.options[i].selected = true;
+        return;
+      }
+    }
+  }
+
+  // Hide/unhide DST related fields based on DST checkbox.  Global, since the
+  // checkbox calls it.
+  window.checkUseDst = function() {
+    let dstIsChecked = document.getElementById("useDstFld").checked;
+    let dispType = dstIsChecked ? "inline" : "none";
+    let x = document.getElementsByClassName("canHide");
+    for (var i = 0; i < x.length; i++) {
+      x[i].style.display = dispType;
+    }
+  }
+
+  // Initialize current timezone/DST settings.
+  function initializeSettings(json) {
+    setSelectedIndex("tzOffset", json.TIMEZONE);
+    setSelectedIndex("weekNum1", json.DST_START_WEEK);
+    setSelectedIndex("dayOfWeek1", json.DST_START_DOW);
+    setSelectedIndex("month1", json.DST_START_MONTH);
+    setSelectedIndex("hour1", json.DST_START_HOUR);
+    setSelectedIndex("dstOffset", json.DST_START_OFFSET);
+    setSelectedIndex("weekNum2", json.DST_END_WEEK);
+    setSelectedIndex("dayOfWeek2", json.DST_END_DOW);
+    setSelectedIndex("month2", json.DST_END_MONTH);
+    setSelectedIndex("hour2", json.DST_END_HOUR);
+
+    document.getElementById("useDstFld").checked = json.USE_DST == true;
+    document.getElementById("tzAbbrStr").value = json.TZ_ABBREVIATION;
+    document.getElementById("dstAbbrStr").value = json.DST_ABBREVIATION;
+
+    document.getElementById("ntpServer1").value = json.NTP_ADDRESS;
+    document.getElementById("ntpServer2").value = json.NTP_ADDRESS2;
+    document.getElementById("ntpServer3").value = json.NTP_ADDRESS3;
+    document.getElementById("ntpServer4").value = json.NTP_ADDRESS4;
+  }
+
+  window.addEventListener("load", function() {
+    // Find the page's submit button, and trigger a reload when it is clicked.
+    var objs = document.getElementsByTagName("button");
+    for (var i = 0; i < objs.length; i++) {
+      if (objs[i].type == "submit") {
+        objs[i].addEventListener("click", function() {
+          sessionStorage.setItem("doReload", "true");
+          if (typeof wtmOnSave == "function") {
+            wtmOnSave();
+          }
+        });
+        break;
+      }
+    }
+
+    // Fetch the current settings.  Until they arrive, the fields hold the
+    // first value of each list.
+    fetch("/wtm/config", { cache: "no-store" })
+      .then(function(response) { return response.json(); })
+      .then(function(json) {
+        initializeSettings(json);
+        checkUseDst();
+        if (typeof wtmOnLoad == "function") {
+          wtmOnLoad();
+        }
+      });
+  });
+})();
@@ -0,0 +1,229 @@
+/////////////////////////////////////////////////////////////////////////////////
+// WebAssets.h
+//
+// Generated by Tools/MakeWebAssets.py from WebPages.h and
+// Tools/WebAssets/setup.js.  Do not edit.
+//
+// The gzipped static part of the Setup page, served in the wpmCached web
+// page mode.
+//
+/////////////////////////////////////////////////////////////////////////////////
+#if !defined WEBASSETS_H
+#define WEBASSETS_H
+
+#include <pgmspace.h>           // For PROGMEM.
+
+// Changes whenever the script does.  Used as its ETag and in its URL.
+#define WTM_SETUP_JS_ETAG "3a8dec1c"
+
+// 9297 bytes of script, 3273 bytes gzipped.
+const uint8_t WTM_SETUP_JS_GZ[] PROGMEM =
+{
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x5a, 0x7b, 0x53, 0xdb, 0xb8,
+    0x16, 0xff, 0xbf, 0x9f, 0x42, 0xd7, 0x33, 0x77, 0x6f, 0xb2, 0x0d, 0x01, 0x02, 0x65, 0x77, 0x81,
+    0xf6, 0x4e, 0x08, 0xa1, 0x50, 0x08, 0x61, 0x48, 0x28, 0x77, 0xb7, 0xed, 0x30, 0x72, 0xac, 0xc4,
+    0x6a, 0x6c, 0x29, 0x23, 0xc9, 0x84, 0xb0, 0xc3, 0x77, 0xbf, 0xe7, 0x48, 0xb6, 0x63, 0xe7, 0xc1,
+    0x63, 0x3b, 0xbb, 0xc4, 0x96, 0x74, 0x7e, 0xe7, 0xa9, 0xa3, 0x23, 0xc9, 0x9b, 0x9b, 0x44, 0x33,
+    0x93, 0x4c, 0xea, 0x3f, 0xf5, 0xbb, 0xcd, 0x4d, 0xf8, 0x8f, 0xf4, 0x43, 0x46, 0xb4, 0xa1, 0x86,
+    0x0f, 0xc8, 0x84, 0x2a, 0x43, 0xe4, 0x90, 0x18, 0x68, 0xba, 0xe5, 0x27, 0xbc, 0xcf, 0x63, 0xd6,
+    0xa1, 0x82, 0x8e, 0x98, 0x22, 0x3d, 0xa4, 0x82, 0x11, 0x23, 0x56, 0x23, 0x89, 0x66, 0x01, 0xf1,
+    0x67, 0x76, 0xdc, 0x74, 0x12, 0xb7, 0xe8, 0x20, 0x64, 0x01, 0x62, 0x4d, 0x99, 0x6f, 0x87, 0x90,
+    0x58, 0x06, 0xac, 0x4e, 0x48, 0x87, 0x8e, 0xd9, 0x2d, 0xf3, 0x9b, 0x1a, 0x78, 0xea, 0xfa, 0x64,
+    0x46, 0x14, 0x9b, 0x44, 0x74, 0xc0, 0xb4, 0x63, 0xd1, 0xef, 0xdc, 0x9d, 0xf6, 0x3b, 0x17, 0xc4,
+    0xb6, 0x85, 0x32, 0x0a, 0x80, 0xcf, 0x94, 0x9b, 0x10, 0xa1, 0x70, 0x80, 0xed, 0x04, 0x79, 0xfa,
+    0x7f, 0xdd, 0xf5, 0xda, 0x17, 0xed, 0x56, 0xff, 0xae, 0xd7, 0xbf, 0x26, 0x5c, 0x10, 0xc0, 0xbc,
+    0x02, 0x36, 0xba, 0x1e, 0xd6, 0x08, 0x15, 0x41, 0x8e, 0xe6, 0x46, 0x75, 0xaf, 0x7b, 0x45, 0x48,
+    0x2b, 0x18, 0xa0, 0xda, 0x51, 0x3f, 0xe9, 0x3d, 0x25, 0x7a, 0xa0, 0xf8, 0xc4, 0xc0, 0x3b, 0x35,
+    0x64, 0xc8, 0xa3, 0x48, 0x23, 0x26, 0x37, 0x1a, 0x4c, 0x13, 0xb1, 0x81, 0xe1, 0x52, 0x90, 0x88,
+    0x6b, 0xa3, 0x6b, 0x48, 0x22, 0xc8, 0xe8, 0x91, 0x4f, 0x50, 0x62, 0x8e, 0x26, 0xcb, 0x88, 0xb9,
+    0x30, 0x92, 0xcc, 0x75, 0x0b, 0x41, 0x5b, 0xb4, 0xa4, 0xaf, 0xe4, 0x54, 0x83, 0x1a, 0x03, 0xb4,
+    0x09, 0xe0, 0x1a, 0x27, 0xe0, 0x90, 0x19, 0xfb, 0x2e, 0x45, 0x64, 0xcd, 0x86, 0x40, 0x83, 0x44,
+    0x29, 0x26, 0x0c, 0xfa, 0xc3, 0x70, 0x31, 0xc2, 0x4e, 0xc2, 0x80, 0x8c, 0xdc, 0x73, 0xcd, 0x4d,
+    0x3d, 0x75, 0x4f, 0x4b, 0x4e, 0x66, 0x8a, 0x8f, 0x42, 0x43, 0x2a, 0x83, 0x2a, 0x69, 0x6c, 0x35,
+    0x76, 0x6a, 0xe4, 0x8b, 0xd4, 0x6c, 0x12, 0x92, 0x4e, 0x1d, 0x7a, 0x95, 0x0f, 0xe4, 0xef, 0x2a,
+    0xc3, 0x44, 0x58, 0xc1, 0x2b, 0x55, 0xf2, 0xf7, 0x3b, 0x42, 0x80, 0xf0, 0x9a, 0x0d, 0x15, 0xd3,
+    0xa1, 0xf3, 0x87, 0xe6, 0x62, 0x00, 0xbe, 0x02, 0xc7, 0x58, 0xa8, 0x90, 0xde, 0x33, 0x42, 0x95,
+    0xe2, 0xf7, 0xe0, 0xc8, 0x90, 0x29, 0x46, 0x82, 0x84, 0x81, 0x73, 0x4c, 0xa2, 0x04, 0x88, 0x42,
+    0x86, 0x4a, 0xc6, 0x44, 0xc3, 0xa0, 0x3a, 0x60, 0xf1, 0x21, 0xa9, 0x68, 0xa6, 0x35, 0xa0, 0xf7,
+    0x8c, 0x54, 0x00, 0x57, 0x1f, 0x31, 0x73, 0x66, 0x58, 0x5c, 0xf1, 0x02, 0x79, 0xcd, 0x22, 0x49,
+    0x03, 0xaf, 0x4a, 0x3e, 0x7e, 0x24, 0x9e, 0x51, 0x09, 0xf3, 0x9c, 0x04, 0x84, 0x2c, 0xd0, 0xe8,
+    0x25, 0x9a, 0x1a, 0xf1, 0x86, 0x34, 0xd2, 0x40, 0x71, 0x60, 0x09, 0x22, 0x39, 0xa0, 0xa8, 0x43,
+    0x5d, 0xd9, 0xfe, 0x4a, 0xda, 0xec, 0xc4, 0xc2, 0xe7, 0xa7, 0x77, 0x4e, 0xb5, 0x13, 0xf0, 0x19,
+    0xba, 0x4c, 0x26, 0xaa, 0x14, 0xb3, 0x43, 0xa9, 0x62, 0x67, 0xef, 0x15, 0xce, 0x44, 0x55, 0x02,
+    0x39, 0x48, 0x62, 0xb0, 0x39, 0x2a, 0xd0, 0x8e, 0x18, 0x3e, 0x1e, 0xcd, 0xce, 0x82, 0x8a, 0x37,
+    0x35, 0xb1, 0x0d, 0x70, 0xaf, 0x5a, 0xe7, 0x42, 0x30, 0x65, 0x23, 0x0f, 0x14, 0x3a, 0xfc, 0xd7,
+    0xc6, 0x06, 0xe9, 0x9f, 0x75, 0xda, 0x7f, 0x75, 0x2f, 0xdb, 0xc4, 0x85, 0xd7, 0x59, 0xf7, 0x92,
+    0x6c, 0x6c, 0x7c, 0xfa, 0x2e, 0x0e, 0x7d, 0xb5, 0x89, 0x3f, 0xe1, 0x0e, 0x4c, 0xa0, 0x59, 0xc4,
+    0x3e, 0x7e, 0xf7, 0x02, 0xae, 0x21, 0xf2, 0x66, 0xfb, 0x5c, 0x44, 0x5c, 0xb0, 0xef, 0xde, 0xa7,
+    0x8c, 0x76, 0xff, 0x70, 0x33, 0xdc, 0xc1, 0xc1, 0x4e, 0x2a, 0x22, 0x68, 0x8c, 0xe3, 0xcd, 0x63,
+    0x77, 0x38, 0x04, 0xcb, 0x7c, 0xf7, 0x08, 0x0f, 0x4a, 0xef, 0x38, 0x76, 0xd3, 0x0d, 0xc6, 0x47,
+    0x94, 0xe3, 0xb8, 0xd7, 0x27, 0xed, 0xcb, 0x63, 0xd2, 0x3c, 0x3a, 0xba, 0x6e, 0x7f, 0x3d, 0x6b,
+    0x5a, 0x49, 0x16, 0x65, 0x7a, 0x8d, 0x30, 0x25, 0x84, 0x5c, 0x32, 0x2e, 0x26, 0x09, 0x4c, 0x8a,
+    0xd9, 0xc4, 0x0a, 0xc6, 0x1e, 0x0a, 0x42, 0x35, 0x7d, 0x5f, 0xf5, 0x8c, 0x82, 0x86, 0x5c, 0xee,
+    0x79, 0x53, 0x0c, 0xf8, 0x4c, 0x8c, 0x4c, 0x08, 0xed, 0x3b, 0xf8, 0x4e, 0x1f, 0xf2, 0xf7, 0x0f,
+    0x4e, 0x11, 0x94, 0xfe, 0xa6, 0xd7, 0xb6, 0x1a, 0xb4, 0x4e, 0xdb, 0xad, 0xf3, 0xa3, 0xee, 0xff,
+    0x72, 0x1b, 0x7e, 0xc2, 0xff, 0x17, 0xf9, 0xc3, 0x6c, 0x19, 0x8c, 0x7d, 0xf9, 0x90, 0xc9, 0x00,
+    0x29, 0xe7, 0x58, 0x9b, 0x93, 0x28, 0x98, 0xcb, 0x50, 0x6c, 0xba, 0xa7, 0x51, 0x62, 0xe5, 0x82,
+    0x00, 0x84, 0x57, 0x98, 0x4a, 0x83, 0x90, 0x8a, 0x51, 0x8e, 0x74, 0x63, 0xc7, 0x56, 0xaa, 0x4e,
+    0x9c, 0xe7, 0x6c, 0x74, 0x18, 0x51, 0x9f, 0x45, 0x18, 0x4a, 0x65, 0x16, 0x9f, 0x7e, 0x11, 0xbe,
+    0x9e, 0x10, 0x00, 0x42, 0x2d, 0x0e, 0x37, 0xed, 0xb0, 0x4f, 0x99, 0xed, 0x7c, 0x98, 0xf1, 0x11,
+    0xd5, 0x1a, 0xf9, 0x51, 0x71, 0xca, 0x03, 0x0b, 0xb5, 0xb2, 0xb5, 0xe0, 0xcc, 0x5e, 0xbf, 0x79,
+    0xdd, 0x7f, 0xd1, 0x9d, 0xcb, 0x10, 0x48, 0xbb, 0xec, 0xc2, 0x55, 0x66, 0x2c, 0xba, 0x31, 0xd0,
+    0x66, 0xc9, 0x8f, 0xa5, 0xb6, 0x25, 0x46, 0xab, 0x5c, 0xf9, 0x36, 0x4d, 0xd7, 0x8a, 0x6f, 0x55,
+    0xef, 0x91, 0x05, 0xd9, 0xcb, 0x86, 0xb9, 0x6d, 0xb7, 0xcf, 0xc9, 0xe5, 0x4d, 0xe7, 0xa8, 0x7d,
+    0xbd, 0x64, 0x97, 0xf2, 0x34, 0x9a, 0x32, 0x36, 0xbe, 0x4c, 0xe2, 0xed, 0x4c, 0xd5, 0xc2, 0xfb,
+    0x4a, 0xb1, 0x56, 0x4c, 0x2c, 0xc7, 0xf2, 0xb8, 0xf9, 0x27, 0xe9, 0x9e, 0x38, 0xce, 0xcf, 0xb3,
+    0x0c, 0xe8, 0xac, 0x3b, 0xbc, 0x05, 0x3e, 0x39, 0xd3, 0x52, 0xcb, 0xdb, 0xd8, 0x76, 0xba, 0x97,
+    0xfd, 0xd3, 0x17, 0x18, 0xc6, 0x52, 0x98, 0x30, 0x67, 0x96, 0xbf, 0xbd, 0x8d, 0xd1, 0x69, 0xf7,
+    0xe6, 0x25, 0x5b, 0x86, 0x90, 0x55, 0x73, 0x36, 0xd9, 0xcb, 0x6b, 0xb9, 0x74, 0x4f, 0x4e, 0x7a,
+    0xed, 0xfe, 0x4b, 0xa6, 0xd3, 0xa6, 0x9c, 0xf5, 0x8a, 0x0d, 0xaf, 0xe5, 0x84, 0x89, 0xf0, 0xb9,
+    0x00, 0x79, 0x73, 0x9c, 0x66, 0x92, 0xb4, 0x45, 0xb0, 0x52, 0x8c, 0x94, 0xe9, 0x52, 0xcc, 0xae,
+    0x8c, 0xc4, 0xc6, 0x42, 0x24, 0x36, 0xde, 0xa8, 0xd9, 0x3f, 0x88, 0xc3, 0xc6, 0x52, 0x1c, 0xbe,
+    0x95, 0xe9, 0xab, 0xa3, 0xb0, 0x51, 0x8a, 0xc2, 0xb7, 0xb2, 0x79, 0x65, 0x0c, 0x36, 0x8a, 0x31,
+    0xf8, 0x1a, 0x1e, 0xcf, 0x65, 0xdb, 0xcb, 0xfe, 0x15, 0xb0, 0xbc, 0xfe, 0xba, 0x32, 0x50, 0x5e,
+    0x5a, 0x12, 0x0a, 0xc4, 0xcd, 0xe3, 0xe3, 0xeb, 0x76, 0xaf, 0xd7, 0xee, 0xed, 0xcf, 0x33, 0xff,
+    0xb3, 0x49, 0x57, 0x98, 0x49, 0x8f, 0xa9, 0x7b, 0x66, 0x67, 0x51, 0xaa, 0x5d, 0xa9, 0xad, 0x98,
+    0x62, 0x1b, 0x69, 0x8e, 0x7d, 0x19, 0xad, 0xb1, 0x02, 0xad, 0xb1, 0x06, 0xed, 0xb5, 0x12, 0xee,
+    0xac, 0xc0, 0xdc, 0xf9, 0xc7, 0x12, 0xee, 0xae, 0x40, 0xdb, 0x5d, 0x2f, 0xa1, 0x87, 0xf5, 0x1d,
+    0xd6, 0xe2, 0x3d, 0xeb, 0x4f, 0xa9, 0x34, 0x96, 0x7f, 0xae, 0xdc, 0x83, 0xca, 0x9e, 0xcc, 0x2b,
+    0x7b, 0x9b, 0xc8, 0xca, 0x75, 0x20, 0xd6, 0x7e, 0x06, 0xf6, 0x2a, 0x8f, 0x52, 0x30, 0x5b, 0xfe,
+    0x61, 0xa8, 0x2d, 0x94, 0x7f, 0xae, 0xa6, 0x1d, 0xc8, 0x78, 0x42, 0x21, 0xce, 0x0c, 0xf5, 0x23,
+    0xd8, 0x3e, 0xd8, 0x9a, 0xdd, 0x61, 0xc9, 0x89, 0x1d, 0x6b, 0x0b, 0x09, 0x0d, 0xb5, 0x31, 0xb3,
+    0xa8, 0x1a, 0x34, 0x20, 0xd4, 0x6d, 0x57, 0xf2, 0x3a, 0x5d, 0x63, 0xd5, 0x9e, 0xef, 0x28, 0xb0,
+    0xbe, 0xc6, 0xda, 0x32, 0xab, 0xc0, 0x17, 0xb5, 0x48, 0xab, 0xe1, 0x81, 0x14, 0xda, 0x10, 0x94,
+    0x50, 0x43, 0x61, 0xf9, 0xcd, 0xb6, 0x11, 0xf2, 0x6d, 0xe3, 0xb7, 0xc6, 0x16, 0xd4, 0xc1, 0x6d,
+    0xc1, 0xa7, 0xcc, 0xc8, 0x71, 0x8d, 0x9c, 0x4f, 0xe9, 0x4f, 0x1a, 0x31, 0x2e, 0xbc, 0x1f, 0x35,
+    0xe8, 0xde, 0xdb, 0xc3, 0xee, 0x0e, 0x0f, 0xa6, 0x74, 0x46, 0xce, 0x74, 0x04, 0xda, 0xd5, 0x48,
+    0x8f, 0xc6, 0x92, 0x42, 0x7f, 0x0e, 0xb2, 0xb7, 0x85, 0xa3, 0x4e, 0xe9, 0x94, 0x72, 0xee, 0xe8,
+    0x3e, 0xfc, 0x86, 0x2d, 0x7d, 0xca, 0x65, 0x48, 0x59, 0xda, 0xb4, 0x8b, 0x4d, 0x4d, 0x98, 0x22,
+    0xe3, 0x12, 0xf1, 0xee, 0xef, 0xd8, 0x7e, 0x45, 0x07, 0x7c, 0x08, 0x7b, 0x40, 0xdc, 0xf3, 0x91,
+    0xca, 0x4d, 0x8f, 0xfc, 0x42, 0x5a, 0xb0, 0xf5, 0x0b, 0x68, 0xd5, 0x51, 0xef, 0x5a, 0x39, 0x3b,
+    0x32, 0x11, 0x86, 0x82, 0xc9, 0x57, 0x0e, 0xcb, 0x21, 0x77, 0xac, 0xd4, 0x2d, 0xb0, 0x93, 0xa2,
+    0xd1, 0x8a, 0xb1, 0x35, 0xd2, 0x61, 0x0f, 0x7c, 0x20, 0x49, 0x8b, 0x9b, 0x59, 0x89, 0xd0, 0x2a,
+    0xd2, 0xa6, 0xda, 0x30, 0x25, 0x56, 0x12, 0x1e, 0xc9, 0x91, 0x34, 0xb4, 0x46, 0x2e, 0x78, 0x4c,
+    0x9d, 0x64, 0x0d, 0xab, 0x6a, 0x8b, 0x2a, 0x3a, 0xa0, 0xba, 0x08, 0xd6, 0x70, 0x0a, 0x1b, 0x30,
+    0x9a, 0xc9, 0x35, 0xcb, 0x81, 0x52, 0x02, 0x40, 0xa2, 0xe4, 0x8a, 0x3e, 0xa6, 0x58, 0xdb, 0x48,
+    0x72, 0xc9, 0xa6, 0x43, 0x50, 0x34, 0x40, 0x6b, 0x17, 0x01, 0xb7, 0xad, 0xa5, 0x8e, 0x14, 0x7d,
+    0xe4, 0x11, 0x48, 0x92, 0x30, 0x21, 0x35, 0x69, 0x72, 0xd8, 0x66, 0xd5, 0xc8, 0x67, 0x26, 0x15,
+    0xec, 0x2a, 0xe4, 0x34, 0x75, 0xdc, 0x76, 0x23, 0x75, 0xdc, 0x46, 0x26, 0x40, 0xd9, 0x61, 0x28,
+    0xd9, 0xa3, 0xb4, 0xa4, 0x2d, 0x3a, 0x61, 0xe4, 0x2b, 0x53, 0x01, 0x4b, 0x3d, 0x5c, 0xd4, 0x02,
+    0x07, 0xde, 0x32, 0x67, 0x8f, 0x76, 0xa2, 0x24, 0x0c, 0x45, 0x45, 0x40, 0x6c, 0x29, 0x02, 0x29,
+    0xd0, 0x10, 0xda, 0xc7, 0xdf, 0x16, 0xd5, 0x10, 0xd4, 0x54, 0x0c, 0x8a, 0xce, 0xdd, 0x73, 0x02,
+    0x27, 0xb0, 0x49, 0x8d, 0x90, 0x13, 0x90, 0x8b, 0x10, 0x02, 0x16, 0xc6, 0x77, 0x68, 0xa0, 0x38,
+    0x04, 0xd3, 0x15, 0x55, 0x5c, 0x5b, 0x99, 0x9d, 0xc8, 0xe7, 0x14, 0xd2, 0x1e, 0xc4, 0xb9, 0xa2,
+    0x18, 0x69, 0x32, 0x81, 0x30, 0x6f, 0x0e, 0x15, 0x2f, 0xc1, 0xa6, 0x86, 0xa0, 0xa3, 0x30, 0xc0,
+    0x51, 0xd7, 0x7c, 0x46, 0x03, 0xd8, 0x8a, 0x77, 0xa4, 0x1e, 0xc8, 0x29, 0x50, 0x99, 0x3a, 0xb9,
+    0x62, 0x20, 0xb2, 0xf6, 0x13, 0x35, 0xb2, 0xd8, 0xce, 0xb0, 0x7d, 0x16, 0x2a, 0x2a, 0x0a, 0x40,
+    0xa9, 0x8b, 0xfc, 0x84, 0x1c, 0x87, 0xd4, 0xe7, 0x00, 0x91, 0x68, 0xd8, 0x04, 0x82, 0x71, 0xe9,
+    0x38, 0xa9, 0x91, 0xbe, 0xcf, 0x61, 0xf2, 0xba, 0x90, 0x76, 0x6e, 0x3e, 0xa7, 0x7e, 0x12, 0x15,
+    0x00, 0xd2, 0x80, 0x19, 0x53, 0xe0, 0xc6, 0x05, 0xb2, 0xab, 0x59, 0x23, 0xc6, 0xd4, 0x47, 0xc9,
+    0xce, 0xd1, 0xc9, 0x21, 0xe0, 0xf6, 0xa9, 0x0e, 0xc7, 0x10, 0x8f, 0x45, 0xd2, 0x1d, 0xab, 0x84,
+    0x8c, 0x7d, 0x3a, 0x43, 0xf3, 0x45, 0x83, 0xc4, 0x60, 0x64, 0xa1, 0x61, 0x30, 0x2e, 0x20, 0x0a,
+    0xc8, 0x31, 0x8b, 0x42, 0xc7, 0x7e, 0x67, 0xf7, 0x83, 0x65, 0x6f, 0xc2, 0x18, 0x3c, 0x04, 0xb2,
+    0x5d, 0xc9, 0x71, 0x08, 0xe8, 0x45, 0x40, 0xe7, 0xd5, 0x28, 0xa6, 0x06, 0x00, 0x41, 0xa1, 0x31,
+    0x45, 0x93, 0x47, 0xc0, 0x41, 0x3a, 0x8c, 0x3f, 0x70, 0xc0, 0x9f, 0xb0, 0x31, 0x91, 0xd6, 0x01,
+    0x22, 0xa0, 0xb0, 0xd0, 0x14, 0x10, 0xdc, 0x24, 0x3b, 0x82, 0x01, 0x63, 0xcc, 0x05, 0xa7, 0x54,
+    0x48, 0x90, 0xfd, 0x0b, 0x00, 0x29, 0xe3, 0xa2, 0xdd, 0x4d, 0xd6, 0x23, 0xc6, 0x7f, 0x82, 0x8b,
+    0x40, 0x08, 0xa6, 0x0c, 0x18, 0xbe, 0x07, 0x2f, 0x74, 0x02, 0xd1, 0x04, 0x34, 0x12, 0xf6, 0xef,
+    0xe7, 0xf0, 0xa7, 0x00, 0xfb, 0xa1, 0x81, 0xb2, 0xb7, 0x13, 0x58, 0x1e, 0x2d, 0x88, 0xcb, 0x04,
+    0x7d, 0x39, 0x9e, 0x49, 0xa0, 0x65, 0x32, 0x81, 0x68, 0xee, 0x6a, 0x2b, 0x6e, 0x8f, 0x4e, 0x00,
+    0x07, 0x9a, 0xff, 0x04, 0x07, 0x18, 0x3d, 0x2e, 0xa2, 0x58, 0x07, 0x34, 0x03, 0x16, 0x51, 0x58,
+    0x5b, 0x41, 0x41, 0xaa, 0xa6, 0x69, 0x9a, 0xda, 0x2b, 0x4d, 0xdb, 0x66, 0xa2, 0x71, 0xde, 0x73,
+    0x80, 0xfb, 0x9c, 0x50, 0xd8, 0x91, 0x7f, 0x8d, 0x68, 0xc0, 0xef, 0xa5, 0x86, 0x04, 0x57, 0x8c,
+    0x4d, 0x6b, 0xff, 0x0b, 0xa9, 0x02, 0x10, 0x7a, 0x9a, 0xc5, 0xbe, 0xc3, 0x73, 0x59, 0x8f, 0x8e,
+    0x60, 0xaa, 0x0a, 0x8c, 0x42, 0xb0, 0x21, 0x64, 0xd6, 0x74, 0x76, 0x38, 0xd7, 0x80, 0xc3, 0x18,
+    0x4c, 0x00, 0x5e, 0x0a, 0x77, 0x6b, 0xe0, 0x4b, 0xa9, 0x86, 0x32, 0x1a, 0x17, 0x01, 0x5d, 0x96,
+    0x6d, 0x26, 0x83, 0xb1, 0xcb, 0xa0, 0xb7, 0x2c, 0x82, 0x28, 0x1f, 0x19, 0xf4, 0xc3, 0x09, 0xd8,
+    0x12, 0x23, 0x25, 0x86, 0x2d, 0xa3, 0x29, 0xa5, 0xc6, 0xdf, 0xf6, 0xd0, 0x6e, 0x2d, 0x68, 0x0e,
+    0x69, 0x5c, 0x98, 0x9b, 0xd0, 0x63, 0xdd, 0xd0, 0x9c, 0xa0, 0x8e, 0x97, 0xc9, 0x38, 0xa1, 0x91,
+    0x1c, 0x3a, 0xdb, 0xfe, 0x6e, 0x6d, 0x7b, 0x01, 0x95, 0xc3, 0x5c, 0x5c, 0xb0, 0x34, 0x18, 0x2d,
+    0xf1, 0x7e, 0x58, 0xe0, 0x1f, 0x07, 0x85, 0x05, 0x01, 0xeb, 0x43, 0xbb, 0x20, 0x78, 0x27, 0x5c,
+    0x69, 0x83, 0x67, 0x22, 0x3d, 0x06, 0x5d, 0xf6, 0x74, 0xa4, 0x1f, 0x72, 0x65, 0x1f, 0x4e, 0xa0,
+    0x04, 0x32, 0x21, 0x3e, 0x5d, 0x80, 0x8d, 0xbd, 0x12, 0x02, 0x94, 0x7b, 0x0e, 0xa0, 0x07, 0x19,
+    0x0b, 0xa2, 0xc9, 0x66, 0xe9, 0xec, 0xa9, 0x0f, 0x8b, 0x59, 0xfa, 0x78, 0xcb, 0x02, 0x91, 0xbf,
+    0xf4, 0xc3, 0x44, 0xb9, 0xe7, 0x54, 0xd7, 0xe2, 0x3f, 0xef, 0x04, 0x12, 0x83, 0x1b, 0xd7, 0xa3,
+    0x26, 0x51, 0xf8, 0x5c, 0x62, 0x69, 0xcb, 0x3e, 0xc7, 0xf4, 0x0b, 0x15, 0x09, 0x55, 0x76, 0xec,
+    0x09, 0xf3, 0x55, 0xf6, 0xdc, 0xa1, 0x6a, 0x60, 0xe5, 0x6d, 0x4e, 0x14, 0x8f, 0x5c, 0x8b, 0xed,
+    0xf8, 0x92, 0x08, 0xe6, 0x7e, 0xa3, 0xd5, 0xcc, 0x09, 0xba, 0x69, 0x94, 0x64, 0xa6, 0x98, 0x18,
+    0x16, 0xfb, 0x4c, 0xe1, 0x4b, 0x17, 0x16, 0xd4, 0xf4, 0xf1, 0x52, 0xde, 0xe7, 0xcd, 0xc7, 0x6c,
+    0xe0, 0x9e, 0x7f, 0xd8, 0x7a, 0xc1, 0x2e, 0xe6, 0xcd, 0x20, 0xd0, 0x20, 0x2b, 0xac, 0x55, 0xe9,
+    0xba, 0x0e, 0x2b, 0xb8, 0x24, 0x74, 0xa1, 0x26, 0xa8, 0xdb, 0xe1, 0xa5, 0x75, 0xbb, 0x82, 0x19,
+    0xd1, 0x12, 0xd6, 0x5c, 0x29, 0x50, 0x23, 0x76, 0xa3, 0x9f, 0xad, 0xe2, 0x84, 0x44, 0x0c, 0x30,
+    0xfd, 0x9f, 0xa0, 0xfc, 0xba, 0xc3, 0x24, 0x1e, 0xa4, 0x07, 0x57, 0x04, 0x4f, 0x11, 0x48, 0x05,
+    0x29, 0x38, 0x8c, 0xdf, 0x3a, 0x80, 0x9f, 0x43, 0x87, 0x0e, 0x8f, 0xef, 0xdf, 0xcf, 0x41, 0x09,
+    0x42, 0xd6, 0x69, 0x10, 0x54, 0x04, 0x44, 0x76, 0xd7, 0x8a, 0x5c, 0xb1, 0x8c, 0x2b, 0xbc, 0x9a,
+    0x4a, 0x02, 0x4f, 0xd5, 0x1c, 0xf8, 0xe9, 0xdd, 0xfc, 0x2f, 0x16, 0x42, 0x52, 0x41, 0xd2, 0x81,
+    0xb2, 0x45, 0x10, 0x69, 0x37, 0x52, 0xae, 0xda, 0xb9, 0xe9, 0xb7, 0xb0, 0x3c, 0x8a, 0xb9, 0x48,
+    0x0c, 0x2e, 0x34, 0xac, 0x3e, 0xaa, 0x13, 0xaf, 0xf2, 0xb9, 0xd3, 0x27, 0x1b, 0x7f, 0xec, 0xef,
+    0x6c, 0x55, 0xbd, 0x05, 0x13, 0x8c, 0x62, 0x53, 0x89, 0xcb, 0xba, 0x52, 0x90, 0xbc, 0x03, 0x13,
+    0xa0, 0x4e, 0x7d, 0x0d, 0x7d, 0x99, 0x00, 0xee, 0x50, 0x8e, 0xc4, 0x78, 0xec, 0xb7, 0x45, 0xfe,
+    0xeb, 0x50, 0xab, 0x1e, 0xd9, 0x4f, 0xf1, 0x3d, 0xf2, 0x9e, 0x54, 0x62, 0x50, 0xd7, 0x76, 0x6e,
+    0xd8, 0x8e, 0xf7, 0x5e, 0x15, 0x5a, 0x2d, 0xd8, 0x30, 0x92, 0x52, 0x55, 0x28, 0xd9, 0x24, 0x7b,
+    0x5b, 0xd0, 0x58, 0x8e, 0x03, 0x6f, 0x1f, 0xa9, 0x7b, 0x06, 0x12, 0xfa, 0x08, 0xc6, 0xfc, 0x1b,
+    0xc7, 0xd4, 0x27, 0x34, 0xe8, 0x19, 0x48, 0x83, 0x95, 0x06, 0xf8, 0x7c, 0xcb, 0x22, 0x79, 0x55,
+    0xef, 0x60, 0xad, 0x1d, 0x70, 0xd7, 0x90, 0x69, 0x4c, 0x0d, 0x69, 0xec, 0x6f, 0x6d, 0x91, 0x66,
+    0x67, 0x51, 0x61, 0x1c, 0x55, 0x09, 0xe7, 0x1a, 0xa7, 0x6a, 0x85, 0xb9, 0x5a, 0x40, 0x0a, 0x6b,
+    0xb8, 0xc0, 0x53, 0x53, 0xd4, 0xc1, 0x76, 0x6c, 0x37, 0xd2, 0x9e, 0x4b, 0x29, 0x05, 0xb4, 0x2e,
+    0x48, 0x0f, 0x1d, 0x56, 0xfb, 0x4a, 0x08, 0x7f, 0xb7, 0xb7, 0xab, 0xa0, 0x00, 0x50, 0xc0, 0xa3,
+    0x95, 0x19, 0xe5, 0xb0, 0xdd, 0x21, 0x18, 0xc7, 0x21, 0x81, 0x58, 0x68, 0x9e, 0xab, 0x4e, 0x76,
+    0x10, 0xfa, 0xe4, 0x02, 0xd9, 0x06, 0x64, 0x7e, 0x24, 0x08, 0xb1, 0x6e, 0xab, 0xc7, 0xba, 0x2b,
+    0x9f, 0x6b, 0x18, 0x53, 0x9f, 0x5c, 0xd3, 0x37, 0xfe, 0xe3, 0xdb, 0xd6, 0x8f, 0xc2, 0x6c, 0xb2,
+    0x5d, 0xe8, 0xcc, 0x42, 0xb7, 0xe5, 0x6e, 0x59, 0xe7, 0x8d, 0xdb, 0x3f, 0x52, 0x86, 0x79, 0x9c,
+    0x0a, 0xf0, 0xf6, 0xf6, 0x01, 0xfc, 0x1c, 0x7e, 0x24, 0x0d, 0xf8, 0x2d, 0x06, 0xa9, 0x13, 0x27,
+    0xdd, 0xd0, 0x22, 0x0e, 0xe4, 0x4e, 0x9b, 0xbe, 0xca, 0x12, 0x71, 0x54, 0x35, 0x7d, 0xb6, 0xdd,
+    0xc0, 0x69, 0x3e, 0x21, 0x2c, 0x46, 0xbe, 0x43, 0x4d, 0x51, 0x30, 0x85, 0x2d, 0x80, 0xa4, 0xbf,
+    0xd8, 0xb3, 0x4c, 0x6f, 0xf3, 0x4f, 0x4a, 0xeb, 0x72, 0xd1, 0x7a, 0x11, 0x3c, 0x39, 0xb4, 0x4a,
+    0xbb, 0x71, 0xcb, 0x58, 0x18, 0x01, 0x29, 0x54, 0x63, 0x77, 0xce, 0x1d, 0x9b, 0xab, 0xc5, 0xe8,
+    0x4a, 0x25, 0xcf, 0x4e, 0x2a, 0xc0, 0x1b, 0x8d, 0x74, 0xf4, 0xce, 0x16, 0xf9, 0x95, 0x54, 0x2c,
+    0xcf, 0x6a, 0xc6, 0x14, 0xa6, 0xb2, 0xe5, 0x5a, 0xec, 0xb3, 0xf6, 0x4f, 0xe7, 0xa2, 0xf3, 0xf4,
+    0xd3, 0xaa, 0xfd, 0x0d, 0x6c, 0x91, 0xd3, 0x7d, 0x8f, 0xdb, 0x44, 0xd8, 0x49, 0xed, 0x36, 0x27,
+    0xa0, 0xca, 0x62, 0x0e, 0x23, 0x3e, 0xc5, 0xcb, 0x18, 0xe9, 0xee, 0x2f, 0x6c, 0xa2, 0x28, 0x6d,
+    0x46, 0x40, 0x54, 0x07, 0xc3, 0x82, 0x33, 0x11, 0xb0, 0x87, 0x0a, 0xa4, 0x81, 0xfb, 0xcc, 0xa7,
+    0x2f, 0xe7, 0x32, 0xbd, 0x18, 0x20, 0x85, 0x44, 0x86, 0x29, 0x2b, 0xcd, 0xae, 0xa9, 0xf9, 0x17,
+    0xb2, 0x1a, 0x5e, 0x1c, 0x14, 0x06, 0x81, 0xed, 0xeb, 0x56, 0x40, 0x9c, 0x43, 0xf7, 0x8b, 0xc9,
+    0xaf, 0x30, 0x48, 0xa7, 0x02, 0x03, 0x2b, 0x3c, 0xcf, 0x3d, 0xc8, 0xc7, 0xcd, 0x6f, 0x02, 0xca,
+    0x39, 0x30, 0xbb, 0x17, 0xc0, 0x3d, 0xff, 0x66, 0x22, 0x42, 0xf8, 0xb1, 0x5b, 0x40, 0x05, 0xab,
+    0x2e, 0xe2, 0x0c, 0x39, 0x8b, 0x60, 0x41, 0xc8, 0x4d, 0x85, 0x7d, 0xd9, 0x01, 0x33, 0xec, 0x01,
+    0x3f, 0x47, 0xd2, 0xa7, 0x50, 0x02, 0xb9, 0x4b, 0x12, 0x93, 0xed, 0x08, 0xb3, 0x11, 0x64, 0x40,
+    0xed, 0x15, 0x91, 0x5d, 0x2f, 0xa0, 0xe2, 0x09, 0xe4, 0xb4, 0x5e, 0x38, 0x54, 0x06, 0x29, 0x17,
+    0x2e, 0x5f, 0x9c, 0x61, 0x21, 0x54, 0xce, 0x74, 0x0b, 0xc7, 0x59, 0x4d, 0xd6, 0x5e, 0x3d, 0xe4,
+    0x67, 0xcc, 0x5e, 0xd5, 0xc1, 0xb2, 0xe0, 0x60, 0x0e, 0xc2, 0xf5, 0xa4, 0x0f, 0xbb, 0x6c, 0x04,
+    0x28, 0xe2, 0x41, 0xd6, 0x70, 0xc7, 0x13, 0x36, 0x73, 0x08, 0x98, 0xd0, 0xde, 0x9c, 0xe8, 0x61,
+    0x35, 0x3b, 0x7d, 0x34, 0x6b, 0xe1, 0xf9, 0xc8, 0x25, 0xec, 0x69, 0x2b, 0xd9, 0x11, 0x89, 0x57,
+    0x74, 0xf0, 0x3d, 0x55, 0x45, 0x07, 0x3f, 0xac, 0x76, 0xeb, 0x83, 0xf5, 0x11, 0x1e, 0x96, 0xd4,
+    0xd3, 0xa3, 0x12, 0xe4, 0x97, 0x0a, 0x7a, 0xb0, 0xe4, 0x94, 0x33, 0xc1, 0x0d, 0x87, 0x6a, 0xf0,
+    0x91, 0xe5, 0x37, 0x5e, 0xd9, 0x5e, 0x7d, 0xd3, 0xed, 0xd3, 0xdd, 0xb6, 0xba, 0x14, 0xb6, 0x3c,
+    0x27, 0xea, 0xa5, 0xdd, 0x95, 0x9f, 0x5a, 0x8a, 0xf9, 0xd5, 0xd2, 0x42, 0x54, 0x17, 0xb3, 0x24,
+    0x0e, 0xac, 0x67, 0x57, 0x1d, 0xa9, 0x7a, 0xcb, 0x04, 0xd9, 0x11, 0x71, 0x46, 0x00, 0xa2, 0xdc,
+    0xd9, 0xa3, 0x85, 0x3b, 0x3c, 0x74, 0x5b, 0x4b, 0x36, 0x3f, 0xe4, 0x5d, 0x26, 0x3c, 0xee, 0xde,
+    0xae, 0xa5, 0x73, 0xe7, 0xb5, 0xcb, 0x34, 0xf6, 0xcc, 0x6d, 0x2d, 0x95, 0x3d, 0x7e, 0x5d, 0x26,
+    0xc2, 0x13, 0xb4, 0xf5, 0x12, 0x16, 0x52, 0xd4, 0x02, 0x9d, 0x3b, 0x9d, 0x7d, 0xc9, 0x24, 0x8d,
+    0x22, 0x21, 0x64, 0xa3, 0x57, 0x1a, 0x64, 0x89, 0xec, 0x45, 0x73, 0x2c, 0x51, 0xbc, 0x6c, 0x8c,
+    0x25, 0x92, 0xd4, 0x14, 0x96, 0xe4, 0x2d, 0x53, 0x0c, 0x42, 0xd6, 0xe2, 0xdc, 0xf4, 0xda, 0x77,
+    0x18, 0x85, 0x1f, 0x8b, 0xb9, 0x66, 0x2d, 0x50, 0x7e, 0xed, 0x05, 0x40, 0x69, 0x2a, 0x4b, 0xc3,
+    0xed, 0xaf, 0xbb, 0xe2, 0x85, 0xcc, 0x0b, 0x30, 0xf3, 0x5b, 0x97, 0x45, 0x1c, 0x54, 0xab, 0x0c,
+    0xf4, 0x3c, 0xd2, 0xfc, 0x28, 0x71, 0x11, 0xe9, 0xb2, 0x7f, 0x75, 0x97, 0x9e, 0x56, 0x1e, 0xbc,
+    0x12, 0xa3, 0xf1, 0x0c, 0x46, 0xe3, 0xb5, 0x20, 0x3b, 0xcf, 0x80, 0xec, 0xbc, 0x16, 0x64, 0xf7,
+    0x19, 0x90, 0xdd, 0xfc, 0x26, 0x38, 0xcd, 0xc5, 0xb0, 0xd6, 0xb6, 0xef, 0x01, 0xe3, 0x02, 0x96,
+    0x43, 0x26, 0x98, 0xaa, 0x78, 0xe9, 0xed, 0xf2, 0x52, 0x5a, 0xb6, 0x47, 0x86, 0xe9, 0xe7, 0x02,
+    0x78, 0x6c, 0xf7, 0x1f, 0x4d, 0x74, 0xe2, 0xc7, 0x1c, 0x56, 0x51, 0xd8, 0xfa, 0xe3, 0x5e, 0xd0,
+    0x7e, 0x4c, 0xa0, 0xf8, 0x08, 0xbf, 0x78, 0xa0, 0xc4, 0xdd, 0x43, 0x93, 0x29, 0x7e, 0x04, 0x00,
+    0x83, 0x38, 0xec, 0x29, 0x22, 0x8e, 0xd1, 0xe3, 0xaa, 0x48, 0x4c, 0x97, 0xb0, 0x74, 0xe9, 0xb5,
+    0xe9, 0xb6, 0x4f, 0x47, 0x2e, 0xd9, 0x3a, 0xf8, 0xe7, 0x72, 0x2d, 0xe2, 0x3c, 0xbb, 0x8a, 0xda,
+    0x95, 0xd1, 0xd8, 0xa5, 0xe0, 0x23, 0xf1, 0x9c, 0xd8, 0xde, 0xc2, 0x22, 0x6a, 0xc7, 0x2c, 0x9b,
+    0xc3, 0x0a, 0xbd, 0xca, 0x1e, 0xee, 0xdf, 0x6b, 0xee, 0xe9, 0xdd, 0xc5, 0xfe, 0x41, 0x81, 0x0a,
+    0xc5, 0x42, 0x71, 0xa0, 0x26, 0x99, 0x9a, 0xb8, 0x2b, 0x7a, 0xf8, 0x49, 0x01, 0x8a, 0x96, 0x71,
+    0xf1, 0xca, 0x5c, 0xc8, 0x7c, 0x58, 0xa5, 0x04, 0xf4, 0x94, 0x3f, 0x3f, 0x15, 0xda, 0x7d, 0xc5,
+    0xe8, 0x78, 0x71, 0xa5, 0xcf, 0x9d, 0x88, 0x5f, 0x53, 0x58, 0x2f, 0x2e, 0x7e, 0x43, 0x01, 0xab,
+    0xf9, 0x8d, 0x30, 0x3c, 0xc2, 0xce, 0x59, 0xfa, 0x85, 0x43, 0xcd, 0x7d, 0x1b, 0xe0, 0x6a, 0x00,
+    0xfc, 0x24, 0x24, 0x5d, 0xe2, 0x2d, 0xd4, 0x10, 0x77, 0xdd, 0xae, 0x6e, 0xc2, 0xf2, 0xca, 0x7e,
+    0x7f, 0x51, 0xd8, 0x1b, 0x22, 0xa3, 0x8a, 0xb7, 0x09, 0xa2, 0x6f, 0xc2, 0xd6, 0x77, 0xc8, 0x47,
+    0x60, 0x8c, 0xbf, 0xdd, 0xc7, 0x1d, 0x76, 0xdd, 0xdd, 0xd0, 0x60, 0x35, 0x58, 0x84, 0x9f, 0xaa,
+    0xa9, 0xa8, 0x75, 0xfc, 0x62, 0x64, 0xfe, 0x35, 0x86, 0x62, 0x7a, 0x02, 0x55, 0x0d, 0x03, 0x5b,
+    0x64, 0x7b, 0x8b, 0xac, 0xa9, 0x8e, 0x81, 0x0d, 0xa6, 0x58, 0x4b, 0x5b, 0x5c, 0xf0, 0xac, 0xc5,
+    0xd7, 0xac, 0x89, 0x73, 0xa3, 0x95, 0xae, 0xba, 0xe7, 0xcd, 0x8b, 0xae, 0xba, 0xc0, 0xa0, 0x7e,
+    0xc6, 0x55, 0xf9, 0xa0, 0x22, 0x48, 0xe6, 0x26, 0xe7, 0x24, 0xfc, 0xfb, 0x54, 0xc5, 0xfe, 0xff,
+    0x03, 0x93, 0x5c, 0xdc, 0x31, 0x51, 0x24, 0x00, 0x00,
+};
+
+#endif // WEBASSETS_H
@@ -42,198 +42,84 @@
 #if !defined WEBPAGES_H
 #define WEBPAGES_H
 
+#include "WebAssets.h"          // For the gzipped Setup page script.
+
+// Marker within TZ_SELECT_STR that gets replaced by the JSON representation
+// of the current timezone, DST, and NTP settings.
+const char TZ_JSON_MARKER[] = "*PUT_TZ_JSON_DATA_HERE*";
+
+// The comment markers (described above) that may be used to locate specific
+// places within TZ_SELECT_STR.  These are passed to the user's stream web page
+// callback as the page is rendered.
+const char *const WEB_PAGE_MARKERS[] =
+{
+    "<!-- HTML START -->",
+    "<!-- HTML END -->",
+    "// JS START",
+    "// JS ONLOAD",
+    "// JS SAVE",
+    "// JS END"
+};
+
 const char TZ_SELECT_STR[] = R"=====(
     <!-- HTML START -->
     <!-- TIMEZONE SELECTION -->
     <br/>
     <h3 style="display:inline">TIMEZONE:</h3>
-    <select name="timezoneOffset" id="timezoneOffset">
-      <option value="-720">(GMT -12:00) Eniwetok, Kwajalein</option>
-      <option value="-660">(GMT -11:00) Midway Island, Samoa</option>
-      <option value="-600">(GMT -10:00) Hawaii</option>
-      <option value="-570">(GMT -9:30) Taiohae</option>
-      <option value="-540">(GMT -9:00) Alaska</option>
-      <option value="-480">(GMT -8:00) Pacific Time (US &amp; Canada)</option>
-      <option value="-420">(GMT -7:00) Mountain Time (US &amp; Canada)</option>
-      <option value="-360">(GMT -6:00) Central Time (US &amp; Canada), Mexico City</option>
-      <option value="-300">(GMT -5:00) Eastern Time (US &amp; Canada), Bogota, Lima</option>
-      <option value="-270">(GMT -4:30) Caracas</option>
-      <option value="-240">(GMT -4:00) Atlantic Time (Canada), Caracas, La Paz</option>
-      <option value="-210">(GMT -3:30) Newfoundland</option>
-      <option value="-180">(GMT -3:00) Brazil, Buenos Aires, Georgetown</option>
-      <option value="-120">(GMT -2:00) Mid-Atlantic</option>
-      <option value="-60">(GMT -1:00) Azores, Cape Verde Islands</option>
-      <option value="0">(GMT) Western Europe Time, London, Lisbon, Casablanca</option>
-      <option value="60">(GMT +1:00) Brussels, Copenhagen, Madrid, Paris</option>
-      <option value="120">(GMT +2:00) Kaliningrad, South Africa</option>
-      <option value="180">(GMT +3:00) Baghdad, Riyadh, Moscow, St. Petersburg</option>
-      <option value="210">(GMT +3:30) Tehran</option>
-      <option value="240">(GMT +4:00) Abu Dhabi, Muscat, Baku, Tbilisi</option>
-      <option value="270">(GMT +4:30) Kabul</option>
-      <option value="300">(GMT +5:00) Ekaterinburg, Islamabad, Karachi, Tashkent</option>
-      <option value="330">(GMT +5:30) Bombay, Calcutta, Madras, New Delhi</option>
-      <option value="345">(GMT +5:45) Kathmandu, Pokhara</option>
-      <option value="360">(GMT +6:00) Almaty, Dhaka, Colombo</option>
-      <option value="390">(GMT +6:30) Yangon, Mandalay</option>
-      <option value="420">(GMT +7:00) Bangkok, Hanoi, Jakarta</option>
-      <option value="480">(GMT +8:00) Beijing, Perth, Singapore, Hong Kong</option>
-      <option value="525">(GMT +8:45) Eucla</option>
-      <option value="540">(GMT +9:00) Tokyo, Seoul, Osaka, Sapporo, Yakutsk</option>
-      <option value="570">(GMT +9:30) Adelaide, Darwin</option>
-      <option value="600">(GMT +10:00) Eastern Australia, Guam, Vladivostok</option>
-      <option value="630">(GMT +10:30) Lord Howe Island</option>
-      <option value="660">(GMT +11:00) Magadan, Solomon Islands, New Caledonia</option>
-      <option value="690">(GMT +11:30) Norfolk Island</option>
-      <option value="720">(GMT +12:00) Auckland, Wellington, Fiji, Kamchatka</option>
-      <option value="765">(GMT +12:45) Chatham Islands</option>
-      <option value="780">(GMT +13:00) Apia, Nukualofa</option>
-      <option value="840">(GMT +14:00) Line Islands, Tokelau</option>
+    <select name="tzOffset" id="tzOffset">
     </select>
     <!-- DST END ABBREVIATION SELECTION -->
     <h3 style="display:inline">TIMEZONE ABBREVIATION:</h3>
-    <input type="text" id="dstEndString" name="dstEndString" maxlength="5">
+    <input type="text" id="tzAbbrStr" name="tzAbbrStr" minlength="3" maxlength="5">
     <!-- USE DST CHECKBOX -->
     <br><br>
-    <input type="checkbox" id="useDstField" name="useDstField" value="true"  onchange="checkUseDst()">
-    <h3 style="display:inline"><label for="useDstField">&nbsp Use DST</label></h3>
+    <input type="checkbox" id="useDstFld" name="useDstFld" value="true"  onchange="checkUseDst()">
+    <h3 style="display:inline"><label for="useDstFld">&nbsp Use DST</label></h3>
     <br class="canHide"><br class="canHide">
     <!-- DST START ABBREVIATION SELECTION -->
     <h3 class="canHide">DST ABBREVIATION:</h3><br>
-    <input type="text" id="dstStartString" name="dstStartString" class="canHide" maxlength="5">
+    <input type="text" id="dstAbbrStr" name="dstAbbrStr" class="canHide" maxlength="5">
     <br class="canHide"><br class="canHide">
     <h3 class="canHide">DST STARTS ON:</h3><br>
     <!-- DST START WEEK NUMBER SELECTION -->
-    <select name="weekNumber1" id="weekNumber1" class="canHide">
-      <option value="1">First</option>
-      <option value="2">Second</option>
-      <option value="3">Third</option>
-      <option value="4">Fourth</option>
-      <option value="5">Last</option>
+    <select name="weekNum1" id="weekNum1" class="canHide">
     </select>
     <!-- DST START DAY OF WEEK SELECTION -->
     <select name="dayOfWeek1" id="dayOfWeek1" class="canHide">
-      <option value="0">Sunday</option>
-      <option value="1">Monday</option>
-      <option value="2">Tuesday</option>
-      <option value="3">Wednesday</option>
-      <option value="4">Thursday</option>
-      <option value="5">Friday</option>
-      <option value="6">Saturday</option>
     </select>
     <!-- DST START MONTH SELECTION -->
     <select name="month1" id="month1" class="canHide">
-      <option value="1">of January</option>
-      <option value="2">of February</option>
-      <option value="3">of March</option>
-      <option value="4">of April</option>
-      <option value="5">of May</option>
-      <option value="6">of June</option>
-      <option value="7">of July</option>
-      <option value="8">of August</option>
-      <option value="9">of September</option>
-      <option value="10">of October</option>
-      <option value="11">of November</option>
-      <option value="12">of December</option>
     </select>
     <!-- DST START HOUR SELECTION -->
     <select name="hour1" id="hour1" class="canHide">
-      <option value="0">at Midnight</option>
-      <option value="1">at 1:00 AM</option>
-      <option value="2">at 2:00 AM</option>
-      <option value="3">at 3:00 AM</option>
-      <option value="4">at 4:00 AM</option>
-      <option value="5">at 5:00 AM</option>
-      <option value="6">at 6:00 AM</option>
-      <option value="7">at 7:00 AM</option>
-      <option value="8">at 8:00 AM</option>
-      <option value="9">at 9:00 AM</option>
-      <option value="10">at 10:00 AM</option>
-      <option value="11">at 11:00 AM</option>
-      <option value="12">at Noon</option>
-      <option value="13">at 1:00 PM</option>
-      <option value="14">at 2:00 PM</option>
-      <option value="15">at 3:00 PM</option>
-      <option value="16">at 4:00 PM</option>
-      <option value="17">at 5:00 PM</option>
-      <option value="18">at 6:00 PM</option>
-      <option value="19">at 7:00 PM</option>
-      <option value="20">at 8:00 PM</option>
-      <option value="21">at 9:00 PM</option>
-      <option value="22">at 10:00 PM</option>
-      <option value="23">at 11:00 PM</option>
     </select>
     <!-- DST OFFSET SELECTION -->
     <select name="dstOffset" id="dstOffset" class="canHide">
-      <option value="30">add 30 minutes</option>
-      <option value="60">add 60 minutes</option>
     </select>
     <!-- DST END WEEK NUMBER SELECTION -->
     <br class="canHide"><br class="canHide">
     <h3 id="dstEnd" class="canHide">DST ENDS ON:</h3><br>
-    <select name="weekNumber2" id="weekNumber2" class="canHide">
-      <option value="1">First</option>
-      <option value="2">Second</option>
-      <option value="3">Third</option>
-      <option value="4">Fourth</option>
-      <option value="5">Last</option>
+    <select name="weekNum2" id="weekNum2" class="canHide">
     </select>
     <!-- DST END DAY OF WEEK SELECTION -->
     <select name="dayOfWeek2" id="dayOfWeek2" class="canHide">
-      <option value="0">Sunday</option>
-      <option value="1">Monday</option>
-      <option value="2">Tuesday</option>
-      <option value="3">Wednesday</option>
-      <option value="4">Thursday</option>
-      <option value="5">Friday</option>
-      <option value="6">Saturday</option>
     </select>
     <!-- DST END MONTH SELECTION -->
     <select name="month2" id="month2" class="canHide">
-      <option value="1">of January</option>
-      <option value="2">of February</option>
-      <option value="3">of March</option>
-      <option value="4">of April</option>
-      <option value="5">of May</option>
-      <option value="6">of June</option>
-      <option value="7">of July</option>
-      <option value="8">of August</option>
-      <option value="9">of September</option>
-      <option value="10">of October</option>
-      <option value="11">of November</option>
-      <option value="12">of December</option>
     </select>
     <!-- DST END HOUR SELECTION -->
     <select name="hour2" id="hour2" class="canHide">
-      <option value="0">at Midnight</option>
-      <option value="1">at 1:00 AM</option>
-      <option value="2">at 2:00 AM</option>
-      <option value="3">at 3:00 AM</option>
-      <option value="4">at 4:00 AM</option>
-      <option value="5">at 5:00 AM</option>
-      <option value="6">at 6:00 AM</option>
-      <option value="7">at 7:00 AM</option>
-      <option value="8">at 8:00 AM</option>
-      <option value="9">at 9:00 AM</option>
-      <option value="10">at 10:00 AM</option>
-      <option value="11">at 11:00 AM</option>
-      <option value="12">at Noon</option>
-      <option value="13">at 1:00 PM</option>
-      <option value="14">at 2:00 PM</option>
-      <option value="15">at 3:00 PM</option>
-      <option value="16">at 4:00 PM</option>
-      <option value="17">at 5:00 PM</option>
-      <option value="18">at 6:00 PM</option>
-      <option value="19">at 7:00 PM</option>
-      <option value="20">at 8:00 PM</option>
-      <option value="21">at 9:00 PM</option>
-      <option value="22">at 10:00 PM</option>
-      <option value="23">at 11:00 PM</option>
     </select>
     <br class="canHide">
     <!-- NTP SERVER SELECTION -->
     <br>
-    <h3 style="display:inline">NTP SERVER ADDRESS:</h3>
-    <input type="text" id="ntpServerAddr" name="ntpServerAddr" maxlength="25">
+    <h3 style="display:inline">NTP SERVER ADDRESSES:</h3>
+    <br>
+    <input type="text" id="ntpServer1" name="ntpServer1" maxlength="25">
+    <input type="text" id="ntpServer2" name="ntpServer2" maxlength="25">
+    <br>
+    <input type="text" id="ntpServer3" name="ntpServer3" maxlength="25">
+    <input type="text" id="ntpServer4" name="ntpServer4" maxlength="25">
     <br>
     <!-- HTML END -->
 </body>
@@ -243,7 +129,9 @@ const char TZ_SELECT_STR[] = R"=====(
 
   // Initialize globals on page load.
   window.onload = (event) => {
-    // Initialize current timezone/DST settings.
+    // Fill in the selection lists, then initialize current timezone/DST
+    // settings.
+    fillSelectors();
     initializeSettings();
 
     // Hide or show the initial DST values selections.
@@ -288,29 +176,99 @@ const char TZ_SELECT_STR[] = R"=====(
     let tzAbbrev = json.TZ_ABBREVIATION;
     let dstAbbrev = json.DST_ABBREVIATION;
     let ntpAddr = json.NTP_ADDRESS;
+    let ntpAddr2 = json.NTP_ADDRESS2;
+    let ntpAddr3 = json.NTP_ADDRESS3;
+    let ntpAddr4 = json.NTP_ADDRESS4;
 
     // Initialize the select fields.
-    setSelectedIndex("timezoneOffset", timeZone);
-    setSelectedIndex("weekNumber1", dstStartWeek);
+    setSelectedIndex("tzOffset", timeZone);
+    setSelectedIndex("weekNum1", dstStartWeek);
     setSelectedIndex("dayOfWeek1", dstStartDow);
     setSelectedIndex("month1", dstStartMonth);
     setSelectedIndex("hour1", dstStartHour);
     setSelectedIndex("dstOffset", dstStartOffset);
-    setSelectedIndex("weekNumber2", dstEndWeek);
+    setSelectedIndex("weekNum2", dstEndWeek);
     setSelectedIndex("dayOfWeek2", dstEndDow);
     setSelectedIndex("month2", dstEndMonth);
     setSelectedIndex("hour2", dstEndHour);
 
-    document.getElementById("useDstField").checked = useDst;
-    document.getElementById("dstEndString").value = tzAbbrev;
-    document.getElementById("dstStartString").value = dstAbbrev;
+    document.getElementById("useDstFld").checked = useDst;
+    document.getElementById("tzAbbrStr").value = tzAbbrev;
+    document.getElementById("dstAbbrStr").value = dstAbbrev;
 
-    document.getElementById("ntpServerAddr").value = ntpAddr;
+    document.getElementById("ntpServer1").value = ntpAddr;
+    document.getElementById("ntpServer2").value = ntpAddr2;
+    document.getElementById("ntpServer3").value = ntpAddr3;
+    document.getElementById("ntpServer4").value = ntpAddr4;
   }
 
+  // WTM SELECTORS START
+  // Fill in the timezone and DST selection lists from compact tables.  The
+  // option values are the same as the settings sent with the page.
+  function fillSelectors() {
+    const zones = [
+      [-720, "Eniwetok, Kwajalein"], [-660, "Midway Island, Samoa"],
+      [-600, "Hawaii"], [-570, "Taiohae"], [-540, "Alaska"],
+      [-480, "Pacific Time (US & Canada)"], [-420, "Mountain Time (US & Canada)"],
+      [-360, "Central Time (US & Canada), Mexico City"],
+      [-300, "Eastern Time (US & Canada), Bogota, Lima"], [-270, "Caracas"],
+      [-240, "Atlantic Time (Canada), Caracas, La Paz"], [-210, "Newfoundland"],
+      [-180, "Brazil, Buenos Aires, Georgetown"], [-120, "Mid-Atlantic"],
+      [-60, "Azores, Cape Verde Islands"],
+      [0, "Western Europe Time, London, Lisbon, Casablanca"],
+      [60, "Brussels, Copenhagen, Madrid, Paris"], [120, "Kaliningrad, South Africa"],
+      [180, "Baghdad, Riyadh, Moscow, St. Petersburg"], [210, "Tehran"],
+      [240, "Abu Dhabi, Muscat, Baku, Tbilisi"], [270, "Kabul"],
+      [300, "Ekaterinburg, Islamabad, Karachi, Tashkent"],
+      [330, "Bombay, Calcutta, Madras, New Delhi"], [345, "Kathmandu, Pokhara"],
+      [360, "Almaty, Dhaka, Colombo"], [390, "Yangon, Mandalay"],
+      [420, "Bangkok, Hanoi, Jakarta"], [480, "Beijing, Perth, Singapore, Hong Kong"],
+      [525, "Eucla"], [540, "Tokyo, Seoul, Osaka, Sapporo, Yakutsk"],
+      [570, "Adelaide, Darwin"], [600, "Eastern Australia, Guam, Vladivostok"],
+      [630, "Lord Howe Island"], [660, "Magadan, Solomon Islands, New Caledonia"],
+      [690, "Norfolk Island"], [720, "Auckland, Wellington, Fiji, Kamchatka"],
+      [765, "Chatham Islands"], [780, "Apia, Nukualofa"], [840, "Line Islands, Tokelau"]
+    ];
+    const weeks = ["First", "Second", "Third", "Fourth", "Last"];
+    const days = ["Sunday", "Monday", "Tuesday", "Wednesday", "Thursday",
+                  "Friday", "Saturday"];
+    const months = ["January", "February", "March", "April", "May", "June", "July",
+                    "August", "September", "October", "November", "December"];
+
+    // Adds count options to a selection list.
+    function fill(id, count, value, label) {
+      let obj = document.getElementById(id);
+      for (let i = 0; i < count; i++) {
+        obj.add(new Option(label(i), value(i)));
+      }
+    }
+    // Formats an offset from UTC in minutes, e.g. "(GMT -9:30)".
+    function gmt(m) {
+      let a = Math.abs(m);
+      return m == 0 ? "(GMT)" : "(GMT " + (m < 0 ? "-" : "+") + Math.floor(a / 60) +
+             ":" + String(a % 60).padStart(2, "0") + ")";
+    }
+    // Formats an hour, e.g. "at 2:00 AM".
+    function hour(h) {
+      return h == 0 ? "at Midnight" : h == 12 ? "at Noon" :
+             "at " + ((h + 11) % 12 + 1) + ":00 " + (h < 12 ? "AM" : "PM");
+    }
+
+    fill("tzOffset", zones.length, i => zones[i][0],
+         i => gmt(zones[i][0]) + " " + zones[i][1]);
+    for (let n = 1; n <= 2; n++) {
+      fill("weekNum" + n, weeks.length, i => i + 1, i => weeks[i]);
+      fill("dayOfWeek" + n, days.length, i => i, i => days[i]);
+      fill("month" + n, months.length, i => i + 1, i => "of " + months[i]);
+      fill("hour" + n, 24, i => i, hour);
+    }
+    fill("dstOffset", 2, i => 30 * (i + 1), i => "add " + 30 * (i + 1) + " minutes");
+  }
+  // WTM SELECTORS END
+
   // Hide/unhide DST related fields based on DST checkbox.
   function checkUseDst() {
-    let dstIsChecked = document.getElementById("useDstField").checked;
+    let dstIsChecked = document.getElementById("useDstFld").checked;
     let dispType = "inline";
     if (!dstIsChecked) {
       dispType = "none";
@@ -337,4 +295,28 @@ const char TZ_SELECT_STR[] = R"=====(
 
 )=====";  // End TZ_SELECT_STR[].
 
+
+// The Setup page used in the wpmCached web page mode.  Our fields are filled
+// in by the gzipped /wtm/setup.js script (see WebAssets.h), which the browser
+// caches, and the current settings are fetched from /wtm/config.  The same
+// markers are present, so user code may still add to the page.  Java script
+// added at "// JS ONLOAD" runs once the settings are in, and java script
+// added at "// JS SAVE" runs when the Save button is pressed.
+const char TZ_CACHED_STR[] = R"=====(
+    <!-- HTML START -->
+    <div id="wtmSetup"></div>
+    <!-- HTML END -->
+<script>
+  // JS START
+  function wtmOnLoad() {
+    // JS ONLOAD
+  }
+  function wtmOnSave() {
+    // JS SAVE
+  }
+// JS END
+</script>
+<script src="/wtm/setup.js?v=)=====" WTM_SETUP_JS_ETAG R"=====("></script>
+)=====";  // End TZ_CACHED_STR[].
+
 #endif // WEBPAGES_H
\ No newline at end of file
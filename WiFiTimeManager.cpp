@@ -46,18 +46,486 @@
 #include <Preferences.h>        // For NVS data storage.
 #include <ArduinoJson.h>        // For JSON handling.
 #include <ESPmDNS.h>            // For Mdns support.
+#include <esp_rom_crc.h>        // For esp_rom_crc32_le().
+#include <esp_sleep.h>          // For deep sleep.
 #include "WiFiTimeManager.h"    // For WiFiTimeManager class.
 
 // Some constants used by the WiFiTimeManager class.
 const size_t  WiFiTimeManager::MAX_NVS_NAME_LEN     = 15U;
 const char   *WiFiTimeManager::pPrefSavedStateLabel = "All Time Data";
-char          WiFiTimeManager::WebPageBuffer[WiFiTimeManager::MAX_WEB_PAGE_SIZE];
+const char   *WiFiTimeManager::pPrefCheckpointLabel = "Last UTC";
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The time of the last good sync, kept in RTC memory across soft resets and
+// deep sleep, which the ESP32 system clock also survives.  After a power
+// cycle it holds garbage, which the check word catches.
+/////////////////////////////////////////////////////////////////////////////////
+struct RtcCheckpoint
+{
+    uint32_t m_Magic;           // RTC_CHECKPOINT_MAGIC when valid.
+    int64_t  m_UtcSec;          // UTC time of the last good sync.
+    uint32_t m_Check;           // Check word over the fields above.
+
+    uint32_t Compute() const
+        { return ~m_Magic ^ (uint32_t)m_UtcSec ^ (uint32_t)(m_UtcSec >> 32); }
+};
+static const uint32_t RTC_CHECKPOINT_MAGIC = 0x57544D31;  // "WTM1"
+static RTC_NOINIT_ATTR RtcCheckpoint s_RtcCheckpoint;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Our state, kept in RTC memory by PrepareForSleep() for the next wake from
+// deep sleep.  It is used once, and only on a wake from deep sleep, so a
+// record left behind by a sleep that never happened is ignored.  The
+// parameters are kept as bytes, since a constructor would wipe them at boot.
+/////////////////////////////////////////////////////////////////////////////////
+struct SleepRecord
+{
+    uint32_t       m_Magic;         // SLEEP_RECORD_MAGIC when valid.
+    uint8_t        m_Params[sizeof(TimeParameters)]; // Timezone and NTP data.
+    uint32_t       m_SavedCrc;      // CRC of m_Params as last in NVS.
+    bool           m_SavedCrcValid; // true if m_SavedCrc is known.
+    bool           m_ErrorKnown;    // true if m_ErrUs is based on an NTP sync.
+    DriftEstimator::State m_Drift;  // Drift estimate.
+    uint32_t       m_ErrUs;         // Expected error when the sleep started.
+    int64_t        m_UtcSec;        // UTC time when the sleep started.
+    uint32_t       m_Check;         // CRC over the fields above.
+
+    uint32_t Compute() const
+        { return esp_rom_crc32_le(0, (const uint8_t *)this, offsetof(SleepRecord, m_Check)); }
+};
+static const uint32_t SLEEP_RECORD_MAGIC = 0x57544D53;  // "WTMS"
+static RTC_NOINIT_ATTR SleepRecord s_SleepRecord;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The TimeParameters layout saved by version 7, which held a single NTP
+// server.  Restore() migrates it rather than dropping the user's settings.
+/////////////////////////////////////////////////////////////////////////////////
+struct TimeParametersV7
+{
+    uint32_t       m_Version;
+    int32_t        m_TzOfst;
+    bool           m_UseDst;
+    int32_t        m_DstOfst;
+    char           m_NtpAddr[TimeParameters::MAX_NTP_ADDR];
+    TimeChangeInfo m_DstStartRule;
+    TimeChangeInfo m_DstEndRule;
+};
 const char   *WiFiTimeManager::m_pName = "TIME DATA";
 volatile bool WiFiTimeManager::m_UsingNetworkTime = false;
 
-// Create our WiFiManagerParameter custom_field.  This custom field contains
-// all of our data fields embedded within.
-static WiFiManagerParameter tzSelectField;
+/////////////////////////////////////////////////////////////////////////////////
+// JsonClientWriter
+//
+// An ArduinoJson writer that streams a document to a WiFiClient through a
+// small buffer, so that neither the whole document nor a byte per packet
+// has to be sent at once.  Flushes when destroyed.
+/////////////////////////////////////////////////////////////////////////////////
+class JsonClientWriter
+{
+public:
+    explicit JsonClientWriter(WiFiClient &rClient) : m_rClient(rClient), m_Len(0) {}
+    ~JsonClientWriter() { Flush(); }
+
+    size_t write(uint8_t c)
+    {
+        if (m_Len == sizeof(m_Buf))
+        {
+            Flush();
+        }
+        m_Buf[m_Len++] = c;
+        return 1;
+    }
+    size_t write(const uint8_t *pData, size_t len)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            write(pData[i]);
+        }
+        return len;
+    }
+
+private:
+    void Flush()
+    {
+        if (m_Len != 0)
+        {
+            m_rClient.write(m_Buf, m_Len);
+            m_Len = 0;
+        }
+    }
+
+    WiFiClient &m_rClient;
+    uint8_t     m_Buf[128];
+    size_t      m_Len;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// The Setup page fields, and where each one is stored in TimeParameters.
+// For fftInt and fftByte fields, min and max give the allowed range.  For
+// fftText fields, max gives the buffer size.  The names must match those in
+// WebPages.h and Tools/WebAssets/setup.js, and are kept to 10 characters or
+// less so that the copy of each name that WebServer::arg() and hasArg() take
+// (by value, in the arduino-esp32 2.x core) fits in a String's inline buffer.
+/////////////////////////////////////////////////////////////////////////////////
+enum FormFieldType_t { fftInt, fftByte, fftCheckbox, fftText };
+struct FormField
+{
+    const char     *pName;      // Form field name.
+    FormFieldType_t type;       // How the value is stored.
+    size_t          offset;     // Offset of the value in TimeParameters.
+    int32_t         min;        // See above.
+    int32_t         max;        // See above.
+};
+#define TP_OFST(m) offsetof(TimeParameters, m)
+static const FormField FORM_FIELDS[] =
+{
+    { "tzOffset",   fftInt,      TP_OFST(m_TzOfst),             WiFiTimeManager::TZ_OFST_MIN, WiFiTimeManager::TZ_OFST_MAX },
+    { "dstOffset",  fftInt,      TP_OFST(m_DstOfst),            WiFiTimeManager::OFFSET_MIN,  WiFiTimeManager::OFFSET_MAX },
+    { "useDstFld",  fftCheckbox, TP_OFST(m_UseDst),             0, 0 },
+    { "tzAbbrStr",  fftText,     TP_OFST(m_DstEndRule.abbrev),  0, sizeof(TimeChangeInfo::abbrev) },
+    { "dstAbbrStr", fftText,     TP_OFST(m_DstStartRule.abbrev),0, sizeof(TimeChangeInfo::abbrev) },
+    { "weekNum1",   fftByte,     TP_OFST(m_DstStartRule.week),  WiFiTimeManager::WK_MIN,    WiFiTimeManager::WK_MAX },
+    { "dayOfWeek1", fftByte,     TP_OFST(m_DstStartRule.dow),   WiFiTimeManager::DOW_MIN,   WiFiTimeManager::DOW_MAX },
+    { "month1",     fftByte,     TP_OFST(m_DstStartRule.month), WiFiTimeManager::MONTH_MIN, WiFiTimeManager::MONTH_MAX },
+    { "hour1",      fftByte,     TP_OFST(m_DstStartRule.hour),  WiFiTimeManager::HOUR_MIN,  WiFiTimeManager::HOUR_MAX },
+    { "weekNum2",   fftByte,     TP_OFST(m_DstEndRule.week),    WiFiTimeManager::WK_MIN,    WiFiTimeManager::WK_MAX },
+    { "dayOfWeek2", fftByte,     TP_OFST(m_DstEndRule.dow),     WiFiTimeManager::DOW_MIN,   WiFiTimeManager::DOW_MAX },
+    { "month2",     fftByte,     TP_OFST(m_DstEndRule.month),   WiFiTimeManager::MONTH_MIN, WiFiTimeManager::MONTH_MAX },
+    { "hour2",      fftByte,     TP_OFST(m_DstEndRule.hour),    WiFiTimeManager::HOUR_MIN,  WiFiTimeManager::HOUR_MAX },
+    { "ntpServer1", fftText,     TP_OFST(m_NtpAddr[0]),         0, TimeParameters::MAX_NTP_ADDR },
+    { "ntpServer2", fftText,     TP_OFST(m_NtpAddr[1]),         0, TimeParameters::MAX_NTP_ADDR },
+    { "ntpServer3", fftText,     TP_OFST(m_NtpAddr[2]),         0, TimeParameters::MAX_NTP_ADDR },
+    { "ntpServer4", fftText,     TP_OFST(m_NtpAddr[3]),         0, TimeParameters::MAX_NTP_ADDR },
+};
+#undef TP_OFST
+static const size_t FORM_FIELD_COUNT = sizeof(FORM_FIELDS) / sizeof(FORM_FIELDS[0]);
+
+// The Setup page field names as Strings, for looking values up through the
+// WebServer without building a String from each name on every save.  Filled
+// in once by Init(), before the web server can call us.
+static String s_FormNames[FORM_FIELD_COUNT];
+
+
+// Metrics collection.  WTM_METRIC(pObj, stmt) runs the statement on the
+// object's m_Metrics while holding its lock, and WTM_METRIC_START(var) notes
+// the time in micros().  Both compile to nothing if metrics are disabled.
+#if WTM_ENABLE_METRICS
+#define WTM_METRIC(pObj, stmt)                          \
+    do                                                  \
+    {                                                   \
+        portENTER_CRITICAL(&(pObj)->m_MetricsMux);      \
+        (pObj)->m_Metrics.stmt;                         \
+        portEXIT_CRITICAL(&(pObj)->m_MetricsMux);       \
+    } while (0)
+#define WTM_METRIC_START(var) uint32_t var = micros()
+#else
+#define WTM_METRIC(pObj, stmt) do { } while (0)
+#define WTM_METRIC_START(var)  do { } while (0)
+#endif
+
+
+// Status message macros.  WTM_LOG_WARN(pObj, fmt, ...) and friends print via
+// the object's WTMPrint(), subject to SetPrintLevel().  Levels above
+// WTM_LOG_LEVEL compile to nothing, arguments and format strings included.
+#if WTM_LOG_LEVEL >= 1
+#define WTM_LOG_WARN(pObj, ...)  (pObj)->WTMPrint(PL_WARN_BP, __VA_ARGS__)
+#else
+#define WTM_LOG_WARN(pObj, ...)  do { } while (0)
+#endif
+#if WTM_LOG_LEVEL >= 2
+#define WTM_LOG_INFO(pObj, ...)  (pObj)->WTMPrint(PL_INFO_BP, __VA_ARGS__)
+#else
+#define WTM_LOG_INFO(pObj, ...)  do { } while (0)
+#endif
+#if WTM_LOG_LEVEL >= 3
+#define WTM_LOG_DEBUG(pObj, ...) (pObj)->WTMPrint(PL_DEBUG_BP, __VA_ARGS__)
+#else
+#define WTM_LOG_DEBUG(pObj, ...) do { } while (0)
+#endif
+
+
+// The headers that our web server handlers, and the REST API's, look at.
+static const char *WEB_HEADERS[]  = { "If-None-Match" };
+static const char *REST_HEADERS[] = { "Authorization" };
+
+// The names that the WebServer keeps a request body and the REST token
+// under, kept as Strings so that they aren't built again for each request.
+// The 2.x core still copies a name passed to header(), and "Authorization"
+// is too long for a String's inline buffer, so that copy costs one
+// allocation per REST request.
+static const String BODY_ARG("plain");
+static const String AUTH_HEADER("Authorization");
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// RestState struct
+//
+// The REST API's web server, and the JSON documents that its handlers use.
+// They are too big for the service task's stack, and the server handles one
+// request at a time, so they are allocated once, by Init(), and only if the
+// API is enabled.
+/////////////////////////////////////////////////////////////////////////////////
+struct WiFiTimeManager::RestState
+{
+    explicit RestState(uint16_t port) : m_Server(port), m_Started(false) {}
+
+    WebServer m_Server;                             // Serves only the REST API.
+    bool      m_Started;                            // true once m_Server is started.
+    StaticJsonDocument<MAX_JSON_IN_SIZE>  m_In;     // Request body.
+    StaticJsonDocument<MAX_JSON_OUT_SIZE> m_Out;    // Reply.
+#if WTM_ENABLE_METRICS
+    WtmMetrics m_Metrics;                           // Metrics copy for the reply.
+#endif
+}; // End struct RestState.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// CopyString()
+//
+// Copies a NULL terminated string into a buffer, truncating it if it doesn't
+// fit.
+//
+// Arguments:
+//   pBuf  - Pointer to the buffer that receives the string.
+//   size  - The size, in bytes, of the buffer pointed to by pBuf.
+//   pStr  - Pointer to the string to be copied.
+//
+// Returns:
+//   Returns pBuf.
+//
+/////////////////////////////////////////////////////////////////////////////////
+static char *CopyString(char *pBuf, size_t size, const char *pStr)
+{
+    if (size > 0)
+    {
+        size_t len = strnlen(pStr, size - 1);
+        memcpy(pBuf, pStr, len);
+        pBuf[len] = '\0';
+    }
+    return pBuf;
+} // End CopyString().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// DeviceHash()
+//
+// Returns a well mixed 32 bit hash of this device's MAC address, so that
+// devices with nearly the same address get very different NTP jitter.
+/////////////////////////////////////////////////////////////////////////////////
+static uint32_t DeviceHash()
+{
+    uint64_t x = ESP.getEfuseMac();
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+} // End DeviceHash().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TzSelectParameter class
+//
+// Our WiFiManagerParameter custom field.  This custom field contains all of
+// our data fields embedded within.  The WiFiManager only asks for its HTML
+// as it serves the page, so the page isn't built until then (see
+// GetWebPage()).
+/////////////////////////////////////////////////////////////////////////////////
+class TzSelectParameter : public WiFiManagerParameter
+{
+public:
+    TzSelectParameter() : WiFiManagerParameter("") {}
+
+    virtual const char *getCustomHTML() const
+        { return WiFiTimeManager::Instance()->GetWebPage(); }
+
+}; // End class TzSelectParameter.
+
+static TzSelectParameter tzSelectField;
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// FillSettingsJson()
+//
+// Fill a JSON document with all of our user settable parameters.
+//
+// Arguments:
+//   pWtm  - Pointer to the WiFiTimeManager instance.
+//   rDoc  - Reference to the JSON document to be filled.
+//
+/////////////////////////////////////////////////////////////////////////////////
+static void FillSettingsJson(WiFiTimeManager *pWtm, JsonDocument &rDoc)
+{
+    // Take the settings in effect all at once.  The strings are char arrays
+    // in our copy, so the document copies them rather than pointing at them.
+    TimeParameters params;
+    pWtm->GetParams(&params);
+    rDoc["TIMEZONE"] = params.m_TzOfst;
+    rDoc["USE_DST"] = params.m_UseDst;
+    rDoc["DST_START_WEEK"] = params.m_DstStartRule.week;
+    rDoc["DST_START_DOW"] = params.m_DstStartRule.dow;
+    rDoc["DST_START_MONTH"] = params.m_DstStartRule.month;
+    rDoc["DST_START_HOUR"] = params.m_DstStartRule.hour;
+    rDoc["DST_START_OFFSET"] = params.m_DstOfst;
+    rDoc["DST_END_WEEK"] = params.m_DstEndRule.week;
+    rDoc["DST_END_DOW"] = params.m_DstEndRule.dow;
+    rDoc["DST_END_MONTH"] = params.m_DstEndRule.month;
+    rDoc["DST_END_HOUR"] = params.m_DstEndRule.hour;
+    rDoc["TZ_ABBREVIATION"] = params.m_DstEndRule.abbrev;
+    rDoc["DST_ABBREVIATION"] = params.m_DstStartRule.abbrev;
+    rDoc["NTP_ADDRESS"] = params.m_NtpAddr[0];
+    rDoc["NTP_ADDRESS2"] = params.m_NtpAddr[1];
+    rDoc["NTP_ADDRESS3"] = params.m_NtpAddr[2];
+    rDoc["NTP_ADDRESS4"] = params.m_NtpAddr[3];
+} // End FillSettingsJson().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// FillHistogramJson()
+//
+// Fill a JSON object with a summary of a histogram.
+//
+// Arguments:
+//   obj   - The JSON object to be filled.
+//   rHist - Reference to the histogram.
+//
+/////////////////////////////////////////////////////////////////////////////////
+static void FillHistogramJson(JsonObject obj, const Log2Histogram &rHist)
+{
+    obj["COUNT"] = rHist.GetCount();
+    obj["MEAN"]  = rHist.GetMean();
+    obj["MAX"]   = rHist.GetMax();
+    obj["P50"]   = rHist.GetPercentile(50);
+    obj["P99"]   = rHist.GetPercentile(99);
+} // End FillHistogramJson().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// StreamTemplate()
+//
+// Write a template string to a Print object, replacing each occurrence of
+// a token with the specified value.  Used to fill in the WiFiManager page
+// templates (e.g. "{v}") without building a String.
+//
+// Arguments:
+//   rOut   - The Print object that receives the output.
+//   pTmpl  - Pointer to the NULL terminated template string.
+//   pToken - Pointer to the NULL terminated token to be replaced.
+//   pValue - Pointer to the NULL terminated replacement value.
+//
+/////////////////////////////////////////////////////////////////////////////////
+static void StreamTemplate(Print &rOut, const char *pTmpl, const char *pToken,
+                           const char *pValue)
+{
+    const size_t tokenLen = strlen(pToken);
+    const char *pHit = NULL;
+    while ((pHit = strstr(pTmpl, pToken)) != NULL)
+    {
+        rOut.write(pTmpl, pHit - pTmpl);
+        rOut.print(pValue);
+        pTmpl = pHit + tokenLen;
+    }
+    rOut.print(pTmpl);
+} // End StreamTemplate().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// WebPageWriter constructors
+//
+// The first version sends its output, in chunks, to the specified web server.
+// The second version fills the specified buffer, truncating the output if
+// necessary.  The buffer is always NULL terminated.
+//
+/////////////////////////////////////////////////////////////////////////////////
+WebPageWriter::WebPageWriter(WebServer *pServer) :
+    m_pServer(pServer), m_pBuf(m_Chunk), m_Size(CHUNK_SIZE), m_Used(0),
+    m_Written(0)
+{
+} // End constructor.
+
+WebPageWriter::WebPageWriter(char *pBuf, size_t size) :
+    m_pServer(NULL), m_pBuf(pBuf), m_Size(size), m_Used(0), m_Written(0)
+{
+    if (m_Size > 0)
+    {
+        m_pBuf[0] = '\0';
+    }
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// WebPageWriter::write()
+//
+// Print interface methods.  Buffer the data, sending full chunks to the
+// web server if one was specified.  Large blocks are sent straight from their
+// source (normally flash) without being copied.
+//
+/////////////////////////////////////////////////////////////////////////////////
+size_t WebPageWriter::write(uint8_t c)
+{
+    return write(&c, 1);
+} // End write().
+
+size_t WebPageWriter::write(const uint8_t *pData, size_t size)
+{
+    if (m_pServer != NULL)
+    {
+        // Send large blocks directly if there is nothing buffered ahead of them.
+        if ((size >= CHUNK_SIZE) && (m_Used == 0))
+        {
+            m_pServer->sendContent((const char *)pData, size);
+        }
+        else
+        {
+            size_t left = size;
+            while (left > 0)
+            {
+                size_t n = min(left, m_Size - m_Used);
+                memcpy(m_pBuf + m_Used, pData, n);
+                m_Used += n;
+                pData += n;
+                left -= n;
+                if (m_Used == m_Size)
+                {
+                    Flush();
+                }
+            }
+        }
+    }
+    else if (m_Size > 0)
+    {
+        // Fill the caller's buffer, leaving room for the NULL terminator.
+        size_t n = min(size, m_Size - 1 - m_Used);
+        memcpy(m_pBuf + m_Used, pData, n);
+        m_Used += n;
+        m_pBuf[m_Used] = '\0';
+    }
+
+    m_Written += size;
+    return size;
+} // End write().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// WebPageWriter::Flush()
+//
+// Send any buffered data to the web server client.  Does nothing when filling
+// a caller supplied buffer.
+//
+/////////////////////////////////////////////////////////////////////////////////
+void WebPageWriter::Flush()
+{
+    if ((m_pServer != NULL) && (m_Used > 0))
+    {
+        m_pServer->sendContent(m_pBuf, m_Used);
+        m_Used = 0;
+    }
+} // End Flush().
 
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -71,11 +539,94 @@ WiFiTimeManager::WiFiTimeManager() : WiFiManager(), m_pApName(NULL),
                                      m_Params(),
                                      m_MinNtpRateMs(60 * 60 * 1000),
                                      m_LastUpdateMs(0),
+                                     m_ConnState(csOffline),
+                                     m_WiFiEvents(0),
+                                     m_MaxProcessUs(0),
+                                     m_PortalBlocking(true),
+                                     m_ServiceRequested(false),
+                                     m_RestApi(false),
+                                     m_pRestToken(NULL),
+                                     m_RestPort(DFLT_REST_PORT),
+                                     m_pRest(NULL),
+                                     m_ServiceCore(DFLT_SERVICE_CORE),
+                                     m_ServicePriority(DFLT_SERVICE_PRIORITY),
+                                     m_ServiceStack(DFLT_SERVICE_STACK),
+                                     m_ServiceTask(NULL),
+                                     m_ServiceQueue(NULL),
+                                     m_ConnectPending(false),
+                                     m_RtcSyncPending(false),
+                                     m_NtpProbe(),
+                                     m_ProbeRunning(false),
+                                     m_Drift(),
+                                     m_Arbiter(),
+                                     m_NtpTargetErrUs(0),
+                                     m_SleepDriftPpm(DFLT_SLEEP_DRIFT_PPM),
+                                     m_WokeFromSleep(false),
+                                     m_NtpRateMs(60 * 60 * 1000),
+                                     m_DeviceHash(0),
+                                     m_NtpStartJitterMs(DFLT_NTP_START_JITTER_MS),
+                                     m_NtpPollJitterPct(DFLT_NTP_POLL_JITTER_PCT),
+                                     m_NtpStartTimer(NULL),
+                                     m_NtpStartPending(false),
+                                     m_NtpPending(false),
+                                     m_NtpAttemptMs(0),
+                                     m_NtpFailures(0),
+                                     m_SyncErrUs(SNTP_SYNC_ERR_US),
+                                     m_TimeQuality(tqNone),
+                                     m_CheckpointMs(DFLT_CHECKPOINT_SEC * 1000),
+                                     m_LastCheckpointMs(0),
+                                     m_Checkpointed(false),
+                                     m_SavedCrc(0),
+                                     m_SavedCrcValid(false),
+                                     m_SavePending(false),
+                                     m_SaveDueMs(0),
+                                     m_AutoSaveMs(0),
+                                     m_AutoCheckMs(0),
+                                     m_PendingCrc(0),
+                                     m_Updating(false),
+                                     m_UpdateBase(),
+                                     m_AppliedTz(),
+                                     m_NtpApplied(false),
+                                     m_AppliedNtp(),
+                                     m_WebPageMode(wpmBuffered),
+                                     m_pWebPageBuffer(NULL),
+                                     m_WebPageHeadroom(DFLT_WEB_PAGE_HEADROOM),
+                                     m_Provisioned(false),
+                                     m_PortalReleased(false),
+                                     m_WebPageValid(false),
+                                     m_WebPageCrc(0),
+                                     m_BodyClass(),
+                                     m_pFixedTz(NULL),
+                                     m_AppliedParams(),
+                                     m_Zone(),
+                                     m_TzGeneration(0),
+                                     m_LocalTimeCache(),
+                                     m_Alarms(m_PrecisionClock, m_Zone),
+                                     m_RtcClock(m_PrecisionClock),
+                                     m_pRtcBackend(NULL), m_RtcSqwPin(-1),
+                                     m_Pps(m_PrecisionClock), m_PpsPin(-1),
+                                     m_PpsEdge(RISING), m_PpsWasLocked(false),
                                      m_pSaveParamsCallback(NULL),
-                                     m_pUtcGetCallback(NULL),
-                                     m_pUtcSetCallback(NULL),
-                                     m_pUpdateWebPageCallback(NULL)
+                                     m_pUtcGetCallback(),
+                                     m_pUtcSetCallback(),
+                                     m_pUpdateWebPageCallback(NULL),
+                                     m_pStreamWebPageCallback(NULL),
+                                     m_pWebServerCallback(NULL)
 {
+    // Start out with transitions for the default timezone settings.
+    BuildDstTable();
+
+    // The user device only keeps whole seconds, and is only worth reading
+    // when it beats the clock by a useful margin.
+    m_Arbiter.SetLocalDriftPpm(m_Drift.GetWorstPpm());
+    m_Arbiter.SetDriftPpm(tqUserDevice, DFLT_UTC_DEVICE_DRIFT_PPM);
+    m_Arbiter.SetMarginUs(tqUserDevice, UTC_DEVICE_MARGIN_US);
+
+#if WTM_ENABLE_METRICS
+    portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+    m_MetricsMux = unlocked;
+    ResetMetrics();
+#endif
 } // End constructor.
 
 
@@ -132,12 +683,36 @@ bool WiFiTimeManager::Init(const char *pApName, const char *pApPassword,
     // We're not using network time yet.
     m_UsingNetworkTime = false;
 
+#if WTM_LOG_LEVEL > 0
+    // From now on, status messages go through the log task.
+    m_Log.Begin(WTM_LOG_TASK_PRIORITY);
+#endif
+
     // Set the WiFi mode.  ESP defaults to STA+AP.
     WiFi.mode(WIFI_STA);
 
+    // Have the WiFi let us know when the connection comes and goes.
+    WiFi.onEvent(WiFiEventCallback);
+
     // Initialize the ESP32 SNTP system.
     sntp_init();
 
+    // Our NTP jitter comes from our MAC address.  A timer ends our NTP start
+    // delay.
+    m_DeviceHash = DeviceHash();
+    if (m_NtpStartTimer == NULL)
+    {
+        esp_timer_create_args_t args = {};
+        args.callback        = StartDelayedSntp;
+        args.arg             = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name            = "WTM NTP start";
+        if (esp_timer_create(&args, &m_NtpStartTimer) != ESP_OK)
+        {
+            m_NtpStartTimer = NULL;
+        }
+    }
+
     // Validate our AP name.
     if ((pApName == NULL) || (*pApName == '\0'))
     {
@@ -148,14 +723,21 @@ bool WiFiTimeManager::Init(const char *pApName, const char *pApPassword,
     m_pApName     = pApName;
     m_pApPassword = pApPassword;
 
-    // Restore our saved state info.  If no state info has been saved yet, then
-    // save our default values.
-    if (!Restore())
+    // Restore our saved state info, from RTC memory on a wake from deep sleep,
+    // or from NVS otherwise.  If no state info has been saved yet, then save
+    // our default values.  A fixed zone was set at compile time, so it has
+    // nothing in NVS and no Setup page.
+    m_WokeFromSleep = RestoreSleepState();
+    if (IsFixedZone())
+    {
+        setupButton = false;
+    }
+    else if (!m_WokeFromSleep && !Restore())
     {
-        WTMPrint(PL_WARN_BP, "Restore failed.\n");
+        WTM_LOG_WARN(this, "Restore failed.\n");
         if (!Save())
         {
-            WTMPrint(PL_WARN_BP, "Save failed.\n");
+            WTM_LOG_WARN(this, "Save failed.\n");
             return false;
         }
     }
@@ -163,19 +745,45 @@ bool WiFiTimeManager::Init(const char *pApName, const char *pApPassword,
     // Set our network name for DNS use.
     MDNS.begin(pApName);
 
-    // Create our web page using previously saved values.
-    UpdateWebPage();
+    // The streamed Setup page replaces the WiFiManager param page, so it can
+    // only be used when the time parameters have their own Setup page.
+    if ((m_WebPageMode == wpmStreamed) && !setupButton && !IsFixedZone())
+    {
+        WTM_LOG_WARN(this, "Streamed web page needs setup button.  Using buffered.\n");
+        m_WebPageMode = wpmBuffered;
+    }
+
+    if (!IsFixedZone())
+    {
+        //  Let the WiFiManager know about our web page.  It is built the first
+        //  time it is served.  In wpmStreamed mode it is served by our own
+        //  handler, so the parameter stays empty, and only makes the
+        //  WiFiManager display the Setup button.
+        addParameter(&tzSelectField);
+
+        // Build the field names that DecodeSetupForm() looks up, so that
+        // saving the page doesn't build them again each time.
+        for (size_t f = 0; f < FORM_FIELD_COUNT; f++)
+        {
+            s_FormNames[f] = FORM_FIELDS[f].pName;
+        }
 
-    // Use a placement new to install our web page into the WiFiManager.
-    new (&tzSelectField) WiFiManagerParameter(GetWebPage());
+        // Install our "save parameter" handler.  This handler fetches any
+        // (possibly changed) values of our timezone and NTP parameters after
+        // the user saves the Setup page.
+        WiFiManager::setSaveParamsCallback(SaveParamCallback);
+    }
 
-    //  Let the WiFiManager know about our web page.
-    addParameter(&tzSelectField);
+    // Install our web server callback so that we can add our own handlers
+    // when the WiFiManager web server gets created.
+    WiFiManager::setWebServerCallback(WebServerCallback);
 
-    // Install our "save parameter" handler.  This handler fetches any (possibly
-    // changed) values of our timezone and NTP parameters after the user saves
-    // the Setup page.
-    WiFiManager::setSaveParamsCallback(SaveParamCallback);
+    // The REST API has a server of its own, which starts once the network
+    // connects.
+    if (m_RestApi)
+    {
+        InitRest();
+    }
 
     // Setup our custom menu.  Note: if 'setupButton' is true we want our setup page
     // button to appear before the WiFi config button on the web page.
@@ -204,22 +812,33 @@ bool WiFiTimeManager::Init(const char *pApName, const char *pApPassword,
     setClass("invert");
 
     // Set the timezone string per current values.
-    const uint32_t MAX_TZ_STR = 64;
-    char tzBuf[MAX_TZ_STR];
-    GetTimezoneString(tzBuf, sizeof(tzBuf));
-    setenv("TZ", tzBuf, 1);
-    tzset();
+    SetTimezoneEnv();
 
-    // Initialize the clock to the start of 2023 as default.  Will (hopefully)
-    // be updated to the correct time later.
-    const time_t UTC_2023_START = 1672531200;
-    timeval tv = { .tv_sec = UTC_2023_START };
-    settimeofday(&tv, NULL);
+    // Start the clock from cached time if we have any.  Will (hopefully) be
+    // updated to the correct time later.
+    WarmStart();
+
+    // Start reading the hardware RTC, if there is one.  This reads it once,
+    // so that its time is ready below.
+    if ((m_pRtcBackend != NULL) &&
+        !m_RtcClock.Begin(m_pRtcBackend, m_RtcSqwPin, WTM_RTC_TASK_PRIORITY))
+    {
+        WTM_LOG_WARN(this, "RTC not responding.\n");
+    }
+
+    // Start disciplining the clock to the PPS signal, if there is one.
+    if ((m_PpsPin >= 0) &&
+        !m_Pps.Begin(m_PpsPin, m_PpsEdge, WTM_PPS_TASK_PRIORITY,
+                     [this](bool good, bool locked, int64_t errUs)
+                     { OnPpsEdge(good, locked, errUs); }))
+    {
+        WTM_LOG_WARN(this, "PPS task not started.\n");
+    }
 
     // If the user has specified a UTC get callback, then get the current time
     // and force it to use the time from the user callback code.  This will
     // (hopefully) let us start with a fairly accurate date/time.
-    if (m_pUtcGetCallback)
+    if (UtcDeviceReady())
     {
         GetUtcTimeT(true);
 
@@ -229,821 +848,3527 @@ bool WiFiTimeManager::Init(const char *pApName, const char *pApPassword,
         m_UsingNetworkTime = false;
     }
 
+    // Start the service task last, once everything it uses is set up.
+    if (m_ServiceRequested && (m_ServiceTask == NULL))
+    {
+        // The service task must never block in the portal, so the WiFiManager
+        // runs it in non-blocking mode from now on.  The mode that the user
+        // chose only decides whether autoConnect() waits (see
+        // setConfigPortalBlocking()).
+        WiFiManager::setConfigPortalBlocking(false);
+        m_ServiceQueue = xQueueCreate(SERVICE_QUEUE_LEN, sizeof(ServiceMsg));
+        if ((m_ServiceQueue == NULL) ||
+            (xTaskCreatePinnedToCore(ServiceTask, "WTM Service", m_ServiceStack,
+                                     this, m_ServicePriority, &m_ServiceTask,
+                                     m_ServiceCore) != pdPASS))
+        {
+            WTM_LOG_WARN(this, "Service task start failed.\n");
+            m_ServiceTask = NULL;
+            return false;
+        }
+    }
+
     // Return success if we got this far.
     return true;
 } // End Init().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// process()
+// SetServiceTask()
 //
-// Overrides the WiFiManager process() method.
-// This method handles the non-blocking WiFi manager completion.
+// Selects the opt-in service task mode.  Must be called before Init().
+// In this mode, Init() starts a small time service task pinned to the
+// specified core.  That task runs the config portal, SNTP bring up,
+// the UtcGetCallback and UtcSetCallback (e.g. RTC reads and writes), and
+// NVS saves, which keeps WiFi and flash stalls away from the application's
+// tasks.  The application talks to it via PostServiceCommand().
 //
-// Returns:
-//    Returns a bool indicating whether or not the network is now connected.
-//    A 'true' value indicates connected, while a 'false' value
-//    indicates not connected.
+// Arguments:
+//   core      - The core (0 or 1) to pin the task to.  WiFi runs on core 0
+//               and the Arduino loop() on core 1.
+//   priority  - The FreeRTOS priority of the task.
+//   stackSize - The task's stack size in bytes.
 //
-// NOTE: The time will be updated immediately after a new connection is
-//       established.
+// Returns:
+//   Returns true if successful, or false if Init() has already been called.
 //
 /////////////////////////////////////////////////////////////////////////////
-bool WiFiTimeManager::process()
+bool WiFiTimeManager::SetServiceTask(BaseType_t core, UBaseType_t priority,
+                                     uint32_t stackSize)
 {
-    // If we're not yet connected, then call the WiFi manager to see if a
-    // connection was recently made.
-    if (!IsConnected())
+    if (m_pApName != NULL)
     {
-        if (WiFiManager::process())
-        {
-            // We must have just connected.  Delay briefly to let the network
-            // settle, then attempt to get the time from the network.
-            StartNewConnection();
-
-            // Make sure the WiFi manager stops.
-            stopWebPortal();
-        }
+        return false;
     }
-
-    // Return an indication of the network connection status.
-    return IsConnected();
-} // End process().
+    m_ServiceRequested = true;
+    m_ServiceCore      = core;
+    m_ServicePriority  = priority;
+    m_ServiceStack     = stackSize;
+    return true;
+} // End SetServiceTask().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// ResetData()
+// SetRtcBackend()
 //
-// This method resets/clears any saved network connection credentials
-// (network SSID and password) and all timezone and NTP data that may have
-// been previously saved.  The next reboot will cause the WiFi Manager access
-// point to execute and new set of network credentials will be needed.
+// Uses a hardware real time clock (RTC) driver (e.g. Ds3231Rtc or
+// Pcf8563Rtc) as the non-NTP time source, in place of the UTC get and set
+// callbacks.  Init() starts a task that reads the RTC once per second, so
+// getting the time never waits on the I2C bus.  After each NTP update, the
+// RTC is rewritten if it is off by more than a quarter second, and its aging
+// offset (if any) is trimmed to cancel its measured drift.  Must be called
+// before Init(), after the I2C bus has been started.
+//
+// Arguments:
+//   pRtc   - Pointer to the RTC driver.  It must outlive the
+//            WiFiTimeManager, and must not be used by anything else.
+//   sqwPin - The GPIO pin connected to the RTC's 1 Hz square wave output, or
+//            -1 to poll the RTC instead.  Polling only keeps the time to
+//            within a second, and can't trim the drift.  This argument is
+//            optional, and defaults to -1.
+//
+// Returns:
+//   Returns true if successful, or false if Init() has already been called
+//   or the pin is the PPS pin.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::ResetData()
+bool WiFiTimeManager::SetRtcBackend(RtcBackend *pRtc, int sqwPin)
 {
-    // Clear the WiFiManager network data.
-    resetSettings();
+    if ((m_pApName != NULL) || ((sqwPin >= 0) && (sqwPin == m_PpsPin)))
+    {
+        return false;
+    }
+    m_pRtcBackend = pRtc;
+    m_RtcSqwPin   = sqwPin;
+    SetUtcDeviceDriftPpm(pRtc->GetDriftPpm());
 
-    // Clear our timezone/DST state data.
-    Preferences prefs;
-    prefs.begin(m_pName);
-    prefs.clear();
-    prefs.end();
-} // End ResetData().
+    // Both callbacks only touch the RtcClock's cache, so neither blocks.
+    SetUtcGetCallback([this]()
+    {
+        time_t t = 0;
+        m_RtcClock.GetUtc(&t);
+        return t;
+    });
+    SetUtcSetCallback([this](time_t) { m_RtcClock.RequestCheck(); });
+    return true;
+} // End SetRtcBackend().
 
 
-/////////////////////////////////////////////////////////////////////////////////
-// Save()
+/////////////////////////////////////////////////////////////////////////////
+// SetPpsSource()
 //
-// Saves our current state to NVS.  This includes all timezone and NTP data.
+// Disciplines the clock to a one pulse per second (PPS) signal, such as that
+// from a GPS module or a DS3231's SQW pin, for microsecond class
+// GetUtcMicros() and GetUtcTimespec() times.  Init() attaches an interrupt
+// to the pin.  NTP is still needed to get the clock to within half a second,
+// so that each pulse can be labelled with its UTC second, but once the clock
+// is locked, NTP is only polled every PPS_NTP_RATE_SEC.  While locked,
+// GetTimeQuality() returns tqPps.  Must be called before Init().
+//
+// Arguments:
+//   pin  - The GPIO pin that the PPS signal is connected to.  Must not be
+//          the pin passed to SetRtcBackend().
+//   edge - The edge of the signal that marks the start of a second (RISING
+//          or FALLING).  This argument is optional, and defaults to RISING,
+//          as used by most GPS modules.  Use FALLING for a DS3231.
 //
 // Returns:
-//    Returns 'true' if successful, or 'false' otherwise.
+//   Returns true if successful, or false if Init() has already been called
+//   or the pin is the RTC's SQW pin.
 //
-/////////////////////////////////////////////////////////////////////////////////
-bool WiFiTimeManager::Save() const
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::SetPpsSource(int pin, int edge)
 {
-    // Assume that the save will fail.
-    bool saved = false;
-    WTMPrint(PL_INFO_BP, "Saving Data.\n");
-
-    // Read our currently saved state.  If it hasn't changed, then don't
-    // bother to do the save in order to conserve writes to NVS.
-    TimeParameters nvsState;
-    Preferences prefs;
-    prefs.begin(m_pName);
+    if ((m_pApName != NULL) || (pin < 0) || (pin == m_RtcSqwPin))
+    {
+        return false;
+    }
+    m_PpsPin  = pin;
+    m_PpsEdge = edge;
+    return true;
+} // End SetPpsSource().
 
-    // Get the previously saved data.
-    size_t nvsSize =
-        prefs.getBytes(pPrefSavedStateLabel, &nvsState, sizeof(TimeParameters));
 
-    // See if our working data has changed since our last save.
-    if ((nvsSize != sizeof(TimeParameters)) ||
-        memcmp(&nvsState, &m_Params, sizeof(TimeParameters)))
+/////////////////////////////////////////////////////////////////////////////
+// OnPpsEdge()
+//
+// Called by the PpsDiscipline after each PPS edge.  Collects metrics, and
+// handles gaining and losing the lock.  While locked, each edge counts as a
+// time update, and NTP is polled only every PPS_NTP_RATE_SEC.
+//
+// Arguments:
+//   good   - true if the edge was used.
+//   locked - true if the clock is locked.
+//   errUs  - The clock's error at a good edge.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::OnPpsEdge(bool good, bool locked, int64_t errUs)
+{
+    if (good)
     {
-        // Data has changed so go ahead and save it.
-        WTMPrint(PL_INFO_BP, "\nTimeSettings - saving to NVS.\n");
-        saved =
-          (prefs.putBytes(pPrefSavedStateLabel, &m_Params, sizeof(TimeParameters)) ==
-              sizeof(TimeParameters));
+        WTM_METRIC(this, m_PpsEdges++);
+        WTM_METRIC(this, m_PpsErrUs.Add(errUs < 0 ? (uint32_t)-errUs : (uint32_t)errUs));
     }
     else
     {
-        // Data has not changed.  Do nothing.
-        saved = true;
-        WTMPrint(PL_INFO_BP, "\nTimeSettings - not saving to NVS.\n");
+        WTM_METRIC(this, m_PpsIgnored++);
+    }
+    if (locked)
+    {
+        m_LastUpdateMs = millis();
+        if (good)
+        {
+            m_Arbiter.Set(tqPps, esp_timer_get_time(), m_Pps.GetErrorUs());
+        }
     }
-    prefs.end();
-
-    // Let the caller know if we succeeded or failed.
-    return saved;
- } // End Save().
 
+    // Each good edge corrects the precision clock.  Keep the system clock,
+    // which time() and the SNTP library use, with it.
+    if (good)
+    {
+        SteerSystemClock();
+    }
 
-/////////////////////////////////////////////////////////////////////////////////
-// Restore()
+    if (locked != m_PpsWasLocked)
+    {
+        m_PpsWasLocked = locked;
+        if (locked)
+        {
+            m_TimeQuality = tqPps;
+            WTM_LOG_INFO(this, "PPS locked.\n");
+            ApplyNtpRate();
+        }
+        else
+        {
+            // The clock free runs at the measured rate from here, and NTP
+            // takes over again right away.
+            m_TimeQuality = tqCached;
+            WTM_METRIC(this, m_PpsLockLosses++);
+            WTM_LOG_WARN(this, "PPS lost.\n");
+            ApplyNtpRate();
+            sntp_restart();
+        }
+    }
+} // End OnPpsEdge().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// PostServiceCommand()
 //
-// Restores our state from NVS.  This includes all timezone and NTP data.
+// Sends a command to the service task.  See ServiceCmd_t.  If the service
+// task is not being used, then the command is carried out immediately by
+// the calling task.
+//
+// Arguments:
+//   cmd    - The command to send.
+//   waitMs - The longest time, in milliseconds, to wait for room in the
+//            command queue.  The default is not to wait.
 //
 // Returns:
-//    Returns 'true' if successful, or 'false' otherwise.
+//   Returns true if the command was sent (or carried out), or false if the
+//   queue was full.
 //
-/////////////////////////////////////////////////////////////////////////////////
-bool WiFiTimeManager::Restore()
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::PostServiceCommand(ServiceCmd_t cmd, uint32_t waitMs)
 {
-    // Assume we're gonna fail.
-    bool succeeded = false;
-    WTMPrint(PL_INFO_BP, "Restoring Saved Data.\n");
-
-    // Restore our state data to a temporary structure.
-    TimeParameters cachedState;
-    Preferences prefs;
-    prefs.begin(m_pName);
-    size_t restored =
-        prefs.getBytes(pPrefSavedStateLabel, &cachedState, sizeof(TimeParameters));
-
-    // Save the restored values only if the get was successful.
-    if ((restored == sizeof(TimeParameters)) &&
-        (cachedState.m_Version == TP_VERSION))
+    // The internal commands need more than the application can supply.
+    if ((cmd == scConnect) || (cmd == scSetRtc))
     {
-        memcpy(&m_Params, &cachedState, sizeof(TimeParameters));
-        succeeded = true;
+        return false;
     }
-    prefs.end();
-
-    // Let the caller know if we succeeded or failed.
-    return succeeded;
- } // End Restore().
+    return SendServiceMsg(cmd, 0, waitMs);
+} // End PostServiceCommand().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// Reset()
+// SendServiceMsg()
 //
-// Reset our state info in NVS.  This includes all timezone and NTP data.
-// WiFi credential information is not affected.
+// Sends a message to the service task, or handles it right away if there
+// is no service task.
+//
+// Arguments:
+//   cmd    - The command to send.
+//   t      - UTC time for the scSetRtc command.
+//   waitMs - The longest time, in milliseconds, to wait for room.
 //
 // Returns:
-//    Returns 'true' if successful, or 'false' otherwise.
+//   Returns true if sent, or false if the queue was full.
 //
 /////////////////////////////////////////////////////////////////////////////
-bool WiFiTimeManager::Reset()
+bool WiFiTimeManager::SendServiceMsg(ServiceCmd_t cmd, time_t t, uint32_t waitMs)
 {
-    bool status = false;
-
-    // Erase all the stored information in the WiFiManager.
-    ResetData();
-
-    // Remove our state data from NVS.
-    Preferences prefs;
-    prefs.begin(m_pName);
-    status = prefs.remove(pPrefSavedStateLabel);
-    prefs.end();
-
-    // Let the user know if we succeeded or failed.
-    return status;
-} // End Reset().
+    ServiceMsg msg = { cmd, t };
+    if (!DeferToServiceTask())
+    {
+        HandleServiceMsg(msg);
+        return true;
+    }
+    return xQueueSend(m_ServiceQueue, &msg, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+} // End SendServiceMsg().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetTimezoneString()
+// HandleServiceMsg()
 //
-// Returns a string that represents the user selected timezone information
-// in a form that is compliant with the POSIX TZ environment variable.
-// See https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html .
+// Carries out a service task command in the calling task.
 //
 // Arguments:
-//   pBuffer - A pointer to the buffer in which the TZ string will be returned.
-//   bufSize - The size, in chars, of the buffer pointed to by pBuffer.
-//             Should be at least 64 chars.
-//
-// Returns:
-//   Returns the TZ string in pBuffer, and a pointer to pBuffer.
+//   rMsg - The message holding the command.
 //
 /////////////////////////////////////////////////////////////////////////////
-char *WiFiTimeManager::GetTimezoneString(char *pBuffer, size_t bufSize)
+void WiFiTimeManager::HandleServiceMsg(const ServiceMsg &rMsg)
 {
-    char *pBuf = pBuffer;
-    size_t size = bufSize;
-
-    // Start by forming the standard timezone information (e.g. "EST+5:0").
-    // Abbreviation - OffsetHour : OffsetMinute
-    size_t charsSoFar = snprintf(pBuf, size, "%s%+01d:%01d", GetTzAbbrev(),
-        0 - GetTzOfst() / 60, abs(GetTzOfst()) % 60);
-
-    // If DST is observed, then we need more data...
-    if (GetUseDst())
+    switch (rMsg.m_Cmd)
     {
-        // Form the timzone DST abbreviation and its offset (e.g. "EDT+4:0").
-        // Abbreviation - OffsetHour : OffsetMinute
-        size -= charsSoFar;
-        int32_t dstOfst = GetTzOfst() + GetDstOfst();
-        charsSoFar += snprintf(pBuf + charsSoFar, size, "%s%+01d:%01d",
-            GetDstAbbrev(), 0 - dstOfst / 60, abs(dstOfst) % 60);
-        size = bufSize - charsSoFar;
-
-        // Form the DST start data (e.g. "M3.2.0/2").
-        // M - Month . WeekNumber . DayOfWddk / Hour
-        // Month = [1 - 12]
-        // WeekNumber = [1 - 5] (5 == last week of month)
-        // DayOfWeek = [0 - 6] (0 == Sunday)
-        // Hour = [0 - 23]
-        charsSoFar += snprintf(pBuf + charsSoFar, size, ",M%d.%d.%d/%d",
-            GetDstStartMonth(), GetDstStartWk(), GetDstStartDow(), GetDstStartHour());
-        size = bufSize - charsSoFar;
-
-        // Form the DST end data (e.g. "M11.1.0/2").
-        snprintf(pBuf + charsSoFar, size, ",M%d.%d.%d/%d",
-            GetDstEndMonth(), GetDstEndWk(), GetDstEndDow(), GetDstEndHour());
+        case scStartPortal:
+            if (!getConfigPortalActive())
+            {
+                startConfigPortal(m_pApName, m_pApPassword);
+                m_ConnState = csOffline;
+            }
+            break;
+
+        case scSave:
+            Save();
+            break;
+
+        case scSyncNtp:
+            ForceSntpSync();
+            break;
+
+        case scSyncRtc:
+            m_RtcSyncPending = false;
+            GetUtcTimeT(true);
+            break;
+
+        case scConnect:
+            ConnectNow(m_pApName, m_pApPassword);
+            m_ConnectPending = false;
+            break;
+
+        case scSetRtc:
+            SetUtcDevice(rMsg.m_Time);
+            break;
+
+        default:
+            break;
     }
-
-    return pBuffer;
-} // End GetTimezoneString().
+} // End HandleServiceMsg().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// UpdateTimezoneRules()
+// ServiceTask()
 //
-// Update our DST timezone rules.  Should be called any time timezone or DST
-// data changes.
+// The service task.  Handles commands from the queue, and runs process()
+// every SERVICE_POLL_MS milliseconds.
+//
+// Arguments:
+//   pArg - Pointer to our instance.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::UpdateTimezoneRules()
+void WiFiTimeManager::ServiceTask(void *pArg)
 {
-    const uint32_t MAX_TZ_STR_LEN = 64;
-    char tzBuf[MAX_TZ_STR_LEN];
+    WiFiTimeManager *pWtm = static_cast<WiFiTimeManager *>(pArg);
+    ServiceMsg msg;
 
-    // Get the timezone string.
-    GetTimezoneString(tzBuf, sizeof(tzBuf));
-
-    // Actually update the system timezone.
-    configTime(0, 0, GetNtpAddr());
-    setenv("TZ", tzBuf, 1);
-    tzset();
+    while (true)
+    {
+        // Wait for a command, but no longer than our poll period so that the
+        // config portal stays responsive.
+        if (xQueueReceive(pWtm->m_ServiceQueue, &msg,
+                          pdMS_TO_TICKS(SERVICE_POLL_MS)) == pdTRUE)
+        {
+            pWtm->HandleServiceMsg(msg);
+        }
+        pWtm->ProcessNow();
+    }
+} // End ServiceTask().
 
-    // Display debug info if debug display is enabled.
-    WTMPrint(PL_DEBUG_BP, tzBuf);
-} // End UpdateTimezoneRules().
 
+/////////////////////////////////////////////////////////////////////////////
+// process()
+//
+// Overrides the WiFiManager process() method.
+// This method handles the non-blocking WiFi manager completion.
+//
+// Returns:
+//    Returns a bool indicating whether or not the network is now connected.
+//    A 'true' value indicates connected, while a 'false' value
+//    indicates not connected.
+//
+// NOTE: The time will be updated immediately after a new connection is
+//       established.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::process()
+{
+    // In service task mode, the service task does the processing.
+    if (DeferToServiceTask())
+    {
+        return IsConnected();
+    }
+    return ProcessNow();
+} // End process().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// UpdateWebPage()
+// GetMetrics()
 //
-// Update our custom Setup page based on current timezone, DST, and NTP settings.
+// Returns a copy of the counters and histograms collected since Init() or
+// the last ResetMetrics().  See WtmMetrics in Metrics.h.  Collection may be
+// compiled out with WTM_ENABLE_METRICS (see WiFiTimeManagerConfig.h).
+//
+// Arguments:
+//   pMetrics - Pointer to where the metrics are returned.
+//
+// Returns:
+//   Returns true if successful, or false if metrics are compiled out, in
+//   which case *pMetrics is all zeros.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::UpdateWebPage()
+bool WiFiTimeManager::GetMetrics(WtmMetrics *pMetrics) const
 {
-    // Start with our basic web page.
-    String WebPageString(TZ_SELECT_STR);
-
-    // Create our JSON document containing all of our user settable parameters.
-    DynamicJsonDocument doc(MAX_JSON_SIZE);
-    doc["TIMEZONE"] = GetTzOfst();
-    doc["USE_DST"] = GetUseDst();
-    doc["DST_START_WEEK"] = GetDstStartWk();
-    doc["DST_START_DOW"] = GetDstStartDow();
-    doc["DST_START_MONTH"] = GetDstStartMonth();
-    doc["DST_START_HOUR"] = GetDstStartHour();
-    doc["DST_START_OFFSET"] = GetDstOfst();
-    doc["DST_END_WEEK"] = GetDstEndWk();
-    doc["DST_END_DOW"] = GetDstEndDow();
-    doc["DST_END_MONTH"] = GetDstEndMonth();
-    doc["DST_END_HOUR"] = GetDstEndHour();
-    doc["TZ_ABBREVIATION"] = GetTzAbbrev();
-    doc["DST_ABBREVIATION"] = GetDstAbbrev();
-    doc["NTP_ADDRESS"] = GetNtpAddr();
-
-    // Convert the JSON document to a String.
-    String JsonStr;
-    serializeJson(doc, JsonStr);
-    WTMPrint(PL_DEBUG_BP, JsonStr);
-
-    // Update our web page with our user settable parameters in JSON form.
-    WebPageString.replace("*PUT_TZ_JSON_DATA_HERE*", JsonStr);
+#if WTM_ENABLE_METRICS
+    portENTER_CRITICAL(&m_MetricsMux);
+    *pMetrics = m_Metrics;
+    portEXIT_CRITICAL(&m_MetricsMux);
+    pMetrics->m_LocalTimeCalls = m_LocalTimeCalls.load(std::memory_order_relaxed);
+    return true;
+#else
+    *pMetrics = WtmMetrics();
+    return false;
+#endif
+} // End GetMetrics().
 
-    // If selected, call back to let user code add HTML and/or java script.
-    if (m_pUpdateWebPageCallback != NULL)
-    {
-        m_pUpdateWebPageCallback(WebPageString, MAX_WEB_PAGE_SIZE - 1);
-    }
 
-    // Save our (possibly modified) web page for later use.
-    strncpy(WebPageBuffer, WebPageString.c_str(), MAX_WEB_PAGE_SIZE - 1);
-} // End UpdateWebPage().
+/////////////////////////////////////////////////////////////////////////////
+// ResetMetrics()
+//
+// Clears all of the metrics.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::ResetMetrics()
+{
+#if WTM_ENABLE_METRICS
+    WtmMetrics empty = WtmMetrics();
+    empty.m_SinceMs = millis();
+    portENTER_CRITICAL(&m_MetricsMux);
+    m_Metrics = empty;
+    portEXIT_CRITICAL(&m_MetricsMux);
+    m_LocalTimeCalls.store(0, std::memory_order_relaxed);
+#endif
+} // End ResetMetrics().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// SaveParamCallback()
+// ProcessNow()
 //
-// Static method that is called when the WiFiManager user saves the time
-// configuration.  Updates all time parameters, then updates the timezone
-// rules based on the (possibly) new timezone values.  Finally, it updates
-// the web page so that its values will be up to date the next time it is
-// displayed.
+// Does the work of process() in the calling task.
+//
+// Returns:
+//    Returns true if connected, or false otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::SaveParamCallback()
+bool WiFiTimeManager::ProcessNow()
 {
-    // Since this is a static method, we need to point to the singleton instance.
-    WiFiTimeManager *pWtm = Instance();
+    uint32_t startUs = micros();
 
-    pWtm->WTMPrint(PL_INFO_BP, "SaveParamCallback\n");
-    // Stuff the (possibly) new values into our local data.
-    char buf[TimeParameters::MAX_NTP_ADDR];
-    int tzOfst = pWtm->GetParamInt("timezoneOffset");
-    int dstOfst = pWtm->GetParamInt("dstOffset");
-    pWtm->SetTzOfst(tzOfst);
-    pWtm->SetTzAbbrev(pWtm->GetParamChars("dstEndString", buf, sizeof(buf)));
-    pWtm->SetUseDst(!strcmp(pWtm->GetParamChars("useDstField", buf, sizeof(buf)), "true"));
-    pWtm->SetDstOfst(dstOfst);
-    pWtm->SetDstAbbrev(pWtm->GetParamChars("dstStartString", buf, sizeof(buf)));
-    pWtm->SetDstStartWk(pWtm->GetParamInt("weekNumber1"));
-    pWtm->SetDstStartDow(pWtm->GetParamInt("dayOfWeek1"));
-    pWtm->SetDstStartMonth(pWtm->GetParamInt("month1"));
-    pWtm->SetDstStartHour(pWtm->GetParamInt("hour1"));
-    pWtm->SetDstStartOfst(tzOfst + dstOfst);
-    pWtm->SetDstEndWk(pWtm->GetParamInt("weekNumber2"));
-    pWtm->SetDstEndDow(pWtm->GetParamInt("dayOfWeek2"));
-    pWtm->SetDstEndMonth(pWtm->GetParamInt("month2"));
-    pWtm->SetDstEndHour(pWtm->GetParamInt("hour2"));
-    pWtm->SetDstEndOfst(tzOfst);
-    pWtm->SetNtpAddr(pWtm->GetParamChars("ntpServerAddr", buf, sizeof(buf)));
-
-    // Save the (possibly) new values in NVS for later use.
-    pWtm->Save();
-
-    // Update the timezone rules and web page values.
-    pWtm->UpdateTimezoneRules();
-    pWtm->UpdateWebPage();
+    // Catch up with the WiFi.
+    HandleWiFiEvents();
 
-    // Call back the user's save parameter handler if any was specified.
-    if (pWtm->m_pSaveParamsCallback != NULL)
+    // If we're not yet connected, then call the WiFi manager to see if a
+    // connection was recently made.  Otherwise, run the next step of bringing
+    // up network time, if any.  Note whether this call has done any work.
+    bool busy = false;
+    if (m_ConnState == csOffline)
     {
-        pWtm->m_pSaveParamsCallback();
+        busy = ProcessPortal();
+    }
+    else
+    {
+        busy = StepConnection();
+
+        // Serve the REST API.
+        if (m_pRest != NULL)
+        {
+            busy = ProcessRest() || busy;
+        }
+    }
+
+    // Checkpoint the time now and then, and do any save that is due.  Both
+    // write flash, so only one of them runs per call, and only in a call that
+    // has done nothing else.  Either one just waits for a later call.
+    if (!busy && !CheckpointTime())
+    {
+        PollSave();
+    }
+
+    // Keep track of our worst case latency, flash writes included.
+    uint32_t elapsedUs = micros() - startUs;
+    if (elapsedUs > m_MaxProcessUs)
+    {
+        m_MaxProcessUs = elapsedUs;
     }
-} // End SaveParamCallback(),
+
+    // Return an indication of the network connection status.
+    return IsConnected();
+} // End ProcessNow().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetParamString()
+// ProcessPortal()
 //
-// Returns the last value read of the specified Setup parameter.
-//
-// Arguments:
-//   name - String containing the name of the argument whose value is to be
-//          returned.
+// Runs the WiFiManager's process(), and starts bringing up network time if
+// it just connected.
 //
 // Returns:
-//    Always returns the String value of the specified argument if successful,
-//    or an empty String on failure.
+//    Returns true if the WiFiManager connected or served a request, or false
+//    otherwise.  The WiFiManager doesn't say whether it served a request, so
+//    a call that took at least PORTAL_BUSY_US is taken to have done so.
 //
 /////////////////////////////////////////////////////////////////////////////
-String WiFiTimeManager::GetParamString(String name)
+bool WiFiTimeManager::ProcessPortal()
 {
-    // Read the parameter that was returned from server.
-    String value;
-    if(server->hasArg(name))
+    uint32_t startUs = micros();
+    if (WiFiManager::process())
     {
-        value = server->arg(name);
+        // We must have just connected.  Start bringing up network time on the
+        // following calls.
+        StartNewConnection();
+        return true;
     }
-    return value;
-} // End GetParamString().
+    return micros() - startUs >= PORTAL_BUSY_US;
+} // End ProcessPortal().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetParamChars()
+// ProcessRest()
 //
-// Returns the last value read of the specified Setup parameter.
-//
-// Arguments:
-//   name - String containing the name of the argument whose value is to be
-//          returned.
-//   pBuf - Pointer to the buffer in which the parameter's value is to be
-//          returned.
-//   size - Size of the buffer pointed to by pBuf.
+// Serves any REST API request that is waiting.
 //
 // Returns:
-//    Returns the value passed as pBuf.  The returned buffer will contain the
-//    value of the specified parameter if successful, or an empty buffer on failure.
+//    Returns true if a request was served, or false otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
-char *WiFiTimeManager::GetParamChars(String name, char *pBuf, size_t size)
+bool WiFiTimeManager::ProcessRest()
 {
-    GetParamString(name).toCharArray(pBuf, size);
-    return pBuf;
-} // End GetParamChars().
+    uint32_t startUs = micros();
+    m_pRest->m_Server.handleClient();
+    return micros() - startUs >= PORTAL_BUSY_US;
+} // End ProcessRest().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetParamInt()
+// HandleWiFiEvents()
 //
-// Returns the last value read of the specified timezone parameter as an
-// integer.
+// Updates our connection state from any WiFi events posted since the last
+// call.  Losing the connection takes us offline.  Getting an IP address
+// while offline starts bringing up network time, which also covers the
+// WiFi reconnecting by itself without help from the config portal.
 //
-// Arguments:
-//   name - String containing the name of the argument whose value is to be
-//          returned.
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleWiFiEvents()
+{
+    uint32_t events = m_WiFiEvents.exchange(0, std::memory_order_acq_rel);
+
+    if (events & WIFI_EV_LOST)
+    {
+        m_ConnState = csOffline;
+    }
+    if ((events & WIFI_EV_GOT_IP) && (m_ConnState == csOffline) &&
+        (WiFi.status() == WL_CONNECTED))
+    {
+        StartNewConnection();
+    }
+} // End HandleWiFiEvents().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// StartNewConnection()
 //
-// Returns:
-//    Returns the int value of the specified Setup parameter.
+// This method is called on a transition from WiFi not connected to WiFi
+// connected.  It starts the steps that initialize SNTP, update timezone
+// rules, and read UTC time to prime the internal clock.  The steps are
+// then run by StepConnection().  Also stops the web portal.  The REST API
+// has a server of its own.
 //
 /////////////////////////////////////////////////////////////////////////////
-int WiFiTimeManager::GetParamInt(String name)
+void WiFiTimeManager::StartNewConnection()
 {
-    return GetParamString(name).toInt();
-} // End GetParamInt().
+    m_ConnState = csStartSntp;
+
+    // Make sure the WiFi manager stops.
+    stopWebPortal();
+    ReleasePortal();
+} // End StartNewConnection().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetUtcTimeT()
-//
-// This method returns UTC time in UNIX time (time_t).  If a user
-// UTC get callback has been specified, and it has been a while since an
-// NTP or user update has occurred, then the user code (if any) is called
-// to update the clock time.  Otherwise, the ESP32 time is returned.
+// StepConnection()
 //
-// Arguments:
-//   force - Forces update from user callback if present.  This argument
-//           is ptional, and defaults to false.
+// Runs the next step of bringing up network time, if any.  None of the steps
+// wait for the network.
 //
 // Returns:
-//   Always returns the current UTC time as kept by the internal Unix time
-//   library or the user specified device if present.
+//    Returns true if a step was run, or false if there was nothing to do.
 //
 /////////////////////////////////////////////////////////////////////////////
-time_t WiFiTimeManager::GetUtcTimeT(bool force)
+bool WiFiTimeManager::StepConnection()
 {
-    time_t timeNow = 0;
-    uint32_t millisNow = millis();
-    bool updateTimedOut = (millisNow - m_LastUpdateMs) >= 4 * m_MinNtpRateMs;
-
-    // If a user callback exists and we're forced, or it has been a long time
-    // since an NTP update, get the current time from the user device.
-    if (m_pUtcGetCallback && (force || updateTimedOut))
-    {
-        // Get the time from user code.
-        timeNow = m_pUtcGetCallback();
-        // Set the ESP32 time based on returned callback value.
-        timeval tv = { .tv_sec = timeNow };
-        settimeofday(&tv, NULL);
-
-        // Reset our last update time.
-        m_LastUpdateMs = millisNow;
-    }
-    else
+    switch (m_ConnState)
     {
-        timeNow = time(&timeNow);
+        case csStartSntp:
+            InitSntpTime();
+            m_ConnState = csSetTimezone;
+            break;
+
+        case csSetTimezone:
+            // Update timezone rules to be sure that they are current.
+            SetTimezoneEnv();
+            m_ConnState = csSyncTime;
+            break;
+
+        case csSyncTime:
+            // A delayed start asks for a sync itself.
+            if (!m_NtpStartPending)
+            {
+                ForceSntpSync();
+            }
+            m_ConnState = csPrimeClock;
+            break;
+
+        case csPrimeClock:
+            // Prime the clock.
+            m_ConnState = csOnline;
+            GetUtcTimeT();
+            StartRestServer();
+            break;
+
+        default:
+            return false;
     }
+    return true;
+} // End StepConnection().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WiFiEventCallback()
+//
+// This static method is called from the WiFi event task.  It just posts
+// the events that we care about for process() to handle.
+//
+// Arguments:
+//   event - The WiFi event.
+//   info  - Event details.  Not used.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::WiFiEventCallback(arduino_event_id_t event,
+                                        arduino_event_info_t info)
+{
+    switch (event)
+    {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            Instance()->m_WiFiEvents.fetch_or(WIFI_EV_GOT_IP, std::memory_order_acq_rel);
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            Instance()->m_WiFiEvents.fetch_or(WIFI_EV_LOST, std::memory_order_acq_rel);
+            break;
+
+        default:
+            break;
+    }
+} // End WiFiEventCallback().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ResetData()
+//
+// This method resets/clears any saved network connection credentials
+// (network SSID and password) and all timezone and NTP data that may have
+// been previously saved.  The next reboot will cause the WiFi Manager access
+// point to execute and new set of network credentials will be needed.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::ResetData()
+{
+    // Clear the WiFiManager network data.
+    resetSettings();
+
+    // Clear our timezone/DST state data.
+    Preferences prefs;
+    prefs.begin(m_pName);
+    prefs.clear();
+    prefs.end();
+    m_SavedCrcValid = false;
+} // End ResetData().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Save()
+//
+// Saves our current state to NVS.  This includes all timezone and NTP data.
+// A CRC of the state last saved or restored is kept in RAM, and if the
+// state still matches it, NVS is neither read nor written.
+//
+// Returns:
+//    Returns 'true' if successful, or 'false' otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::Save() const
+{
+    // Assume that the save will fail.
+    bool saved = false;
+
+    // A fixed zone keeps nothing in NVS.
+    if (IsFixedZone())
+    {
+        return saved;
+    }
+    WTM_LOG_INFO(this, "Saving Data.\n");
+
+    // If our state hasn't changed since it was last saved or restored, then
+    // don't bother to do the save in order to conserve writes to NVS.  The
+    // CRC saves reading the old state back as well.
+    uint32_t crc = ParamsCrc();
+    if (m_SavedCrcValid && (crc == m_SavedCrc))
+    {
+        // Data has not changed.  Do nothing.
+        WTM_LOG_INFO(this, "\nTimeSettings - not saving to NVS.\n");
+        m_SavePending = false;
+        return true;
+    }
+
+    // Data has changed so go ahead and save it.
+    WTM_LOG_INFO(this, "\nTimeSettings - saving to NVS.\n");
+    WTM_METRIC_START(startUs);
+    Preferences prefs;
+    prefs.begin(m_pName);
+    saved =
+      (prefs.putBytes(pPrefSavedStateLabel, &m_Params, sizeof(TimeParameters)) ==
+          sizeof(TimeParameters));
+    prefs.end();
+    WTM_METRIC(this, m_NvsWriteUs.Add(micros() - startUs));
+    WTM_METRIC(this, m_NvsWrites++);
+
+    if (saved)
+    {
+        m_SavedCrc      = crc;
+        m_SavedCrcValid = true;
+        m_SavePending   = false;
+    }
+
+    // Let the caller know if we succeeded or failed.
+    return saved;
+ } // End Save().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ScheduleSave()
+//
+// Schedules a Save() to be done by process() (or the service task) after
+// the specified delay.  Calling it again before then pushes the save out,
+// so a burst of changes results in a single NVS write.
+//
+// Arguments:
+//    delayMs - Milliseconds to wait before saving.  Defaults to
+//              DFLT_SAVE_DELAY_MS.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::ScheduleSave(uint32_t delayMs)
+{
+    m_SaveDueMs   = millis() + delayMs;
+    m_SavePending = true;
+} // End ScheduleSave().
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// Restore()
+//
+// Restores our state from NVS.  This includes all timezone and NTP data.
+// State saved by an earlier version of the TimeParameters structure is
+// migrated rather than thrown away.
+//
+// Returns:
+//    Returns 'true' if successful, or 'false' otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::Restore()
+{
+    // Assume we're gonna fail.
+    bool succeeded = false;
+    bool migrated  = false;
+
+    // A fixed zone keeps nothing in NVS.
+    if (IsFixedZone())
+    {
+        return succeeded;
+    }
+    WTM_LOG_INFO(this, "Restoring Saved Data.\n");
+
+    // Restore our state data to a temporary buffer big enough for any
+    // version that we know how to read.
+    uint8_t cachedState[sizeof(TimeParameters) > sizeof(TimeParametersV7) ?
+                        sizeof(TimeParameters) : sizeof(TimeParametersV7)];
+    Preferences prefs;
+    prefs.begin(m_pName);
+    size_t nvsSize  = prefs.getBytesLength(pPrefSavedStateLabel);
+    size_t restored = 0;
+    if ((nvsSize > 0) && (nvsSize <= sizeof(cachedState)))
+    {
+        restored = prefs.getBytes(pPrefSavedStateLabel, cachedState, nvsSize);
+    }
+    prefs.end();
+
+    // Save the restored values only if the get was successful.
+    uint32_t version = 0;
+    if (restored >= sizeof(version))
+    {
+        memcpy(&version, cachedState, sizeof(version));
+    }
+    if ((restored == sizeof(TimeParameters)) && (version == TP_VERSION))
+    {
+        memcpy(&m_Params, cachedState, sizeof(TimeParameters));
+        succeeded = true;
+    }
+    else if ((restored > 0) && (restored == nvsSize))
+    {
+        succeeded = migrated = MigrateParams(cachedState, restored);
+    }
+
+    if (succeeded)
+    {
+        BuildDstTable();
+        if (migrated)
+        {
+            // Write the converted state back so that it is only done once.
+            WTM_LOG_INFO(this, "Migrated saved data to version %u.\n", TP_VERSION);
+            m_SavedCrcValid = false;
+            Save();
+        }
+        else
+        {
+            m_SavedCrc      = ParamsCrc();
+            m_SavedCrcValid = true;
+        }
+    }
+
+    // Let the caller know if we succeeded or failed.
+    return succeeded;
+ } // End Restore().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Reset()
+//
+// Reset our state info in NVS.  This includes all timezone and NTP data.
+// WiFi credential information is not affected.
+//
+// Returns:
+//    Returns 'true' if successful, or 'false' otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::Reset()
+{
+    bool status = false;
+
+    // Erase all the stored information in the WiFiManager.
+    ResetData();
+
+    // Remove our state data from NVS.
+    Preferences prefs;
+    prefs.begin(m_pName);
+    status = prefs.remove(pPrefSavedStateLabel);
+    prefs.end();
+
+    // Let the user know if we succeeded or failed.
+    return status;
+} // End Reset().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetTimezoneString()
+//
+// Returns a string that represents the user selected timezone information
+// in a form that is compliant with the POSIX TZ environment variable.
+// See https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html .
+//
+// Arguments:
+//   rParams - The settings to be described.
+//   pBuffer - A pointer to the buffer in which the TZ string will be returned.
+//   bufSize - The size, in chars, of the buffer pointed to by pBuffer.
+//             Should be at least 64 chars.
+//
+// Returns:
+//   Returns the TZ string in pBuffer, and a pointer to pBuffer.
+//
+/////////////////////////////////////////////////////////////////////////////
+char *WiFiTimeManager::GetTimezoneString(const TimeParameters &rParams, char *pBuffer, size_t bufSize)
+{
+    char *pBuf = pBuffer;
+    size_t size = bufSize;
+
+    // A fixed zone's TZ string was formed at compile time.
+    if (IsFixedZone())
+    {
+        strncpy(pBuf, m_pFixedTz, size - 1);
+        pBuf[size - 1] = '\0';
+        return pBuffer;
+    }
+
+    // Start by forming the standard timezone information (e.g. "EST+5:0").
+    // Abbreviation - OffsetHour : OffsetMinute
+    size_t charsSoFar = snprintf(pBuf, size, "%s%+01d:%01d", rParams.m_DstEndRule.abbrev,
+        0 - rParams.m_TzOfst / 60, abs(rParams.m_TzOfst) % 60);
+
+    // If DST is observed, then we need more data...
+    if (rParams.m_UseDst)
+    {
+        // Form the timzone DST abbreviation and its offset (e.g. "EDT+4:0").
+        // Abbreviation - OffsetHour : OffsetMinute
+        size -= charsSoFar;
+        int32_t dstOfst = rParams.m_TzOfst + rParams.m_DstOfst;
+        charsSoFar += snprintf(pBuf + charsSoFar, size, "%s%+01d:%01d",
+            rParams.m_DstStartRule.abbrev, 0 - dstOfst / 60, abs(dstOfst) % 60);
+        size = bufSize - charsSoFar;
+
+        // Form the DST start data (e.g. "M3.2.0/2").
+        // M - Month . WeekNumber . DayOfWddk / Hour
+        // Month = [1 - 12]
+        // WeekNumber = [1 - 5] (5 == last week of month)
+        // DayOfWeek = [0 - 6] (0 == Sunday)
+        // Hour = [0 - 23]
+        charsSoFar += snprintf(pBuf + charsSoFar, size, ",M%d.%d.%d/%d",
+            rParams.m_DstStartRule.month, rParams.m_DstStartRule.week, rParams.m_DstStartRule.dow, rParams.m_DstStartRule.hour);
+        size = bufSize - charsSoFar;
+
+        // Form the DST end data (e.g. "M11.1.0/2").
+        snprintf(pBuf + charsSoFar, size, ",M%d.%d.%d/%d",
+            rParams.m_DstEndRule.month, rParams.m_DstEndRule.week, rParams.m_DstEndRule.dow, rParams.m_DstEndRule.hour);
+    }
+
+    return pBuffer;
+} // End GetTimezoneString().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// UpdateTimezoneRules()
+//
+// Update our DST timezone rules.  Should be called any time timezone or DST
+// data changes.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::UpdateTimezoneRules()
+{
+    // Let other tasks see the new settings, all at once (see GetParams()).
+    m_AppliedParams.Write(m_Params);
+
+    // Restarting SNTP throws away a sync in progress, so only do it if the
+    // servers changed.  Before SNTP has been started, or while its start is
+    // still delayed, leave it alone: handing over the servers would start it
+    // polling right away, and undo the start delay (see InitSntpTime()).
+    // The servers are handed over when it does start.
+    if (m_NtpApplied && !m_NtpStartPending && NtpServersChanged())
+    {
+        ConfigSntpServers();
+    }
+
+    // Only update the system timezone if it changed.
+    char tzBuf[MAX_TZ_STR_LEN];
+    const char *pTz = IsFixedZone() ? m_pFixedTz : GetTimezoneString(m_Params, tzBuf, sizeof(tzBuf));
+    if (strncmp(pTz, m_AppliedTz, sizeof(m_AppliedTz)) != 0)
+    {
+        SetTimezoneEnv();
+    }
+    else
+    {
+        WTM_LOG_DEBUG(this, "Timezone unchanged.\n");
+    }
+} // End UpdateTimezoneRules().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// BeginUpdate()
+//
+// Starts a batch of setter calls.  The setters may then be called in any
+// order, and nothing takes effect until CommitUpdate() is called.  Calls
+// don't nest; a BeginUpdate() during an update is ignored.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::BeginUpdate()
+{
+    if (!m_Updating)
+    {
+        m_UpdateBase = m_Params;
+        m_Updating   = true;
+    }
+} // End BeginUpdate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CommitUpdate()
+//
+// Ends a batch of setter calls.  The new settings are checked, and if they
+// are good, they are saved and then applied all at once (see
+// UpdateTimezoneRules()).  If they are rejected, or can't be saved, the
+// settings from BeginUpdate() are put back, and nothing changes.
+//
+// Arguments:
+//    save - true to save the new settings to NVS (the default), or false
+//           to leave NVS alone.
+//
+// Returns:
+//    Returns true if the new settings were applied, or false if they were
+//    rejected or could not be saved.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::CommitUpdate(bool save)
+{
+    if (!ValidateParams())
+    {
+        WTM_LOG_WARN(this, "Update rejected.\n");
+        AbortUpdate();
+        return false;
+    }
+
+    // Save before applying, so that settings that can't be kept never take
+    // effect.
+    if (save && !IsFixedZone() && !Save())
+    {
+        WTM_LOG_WARN(this, "Update not saved.\n");
+        AbortUpdate();
+        return false;
+    }
+    m_Updating = false;
+
+    UpdateTimezoneRules();
+    return true;
+} // End CommitUpdate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// AbortUpdate()
+//
+// Ends a batch of setter calls, putting back the settings from
+// BeginUpdate().
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::AbortUpdate()
+{
+    if (m_Updating)
+    {
+        m_Params   = m_UpdateBase;
+        m_Updating = false;
+    }
+} // End AbortUpdate().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetTimezoneEnv()
+//
+// Sets the TZ environment variable from our current timezone settings and
+// rebuilds the DST transition table.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SetTimezoneEnv()
+{
+    char tzBuf[MAX_TZ_STR_LEN];
+    const char *pTz = m_pFixedTz;
+
+    // Get the timezone string.  A fixed zone's string and transitions were
+    // formed at compile time, so simply use them.
+    if (!IsFixedZone())
+    {
+        pTz = GetTimezoneString(m_Params, tzBuf, sizeof(tzBuf));
+    }
+
+    // Actually update the system timezone.  We don't need it ourselves, but
+    // it keeps the C library time functions in agreement with us.
+    setenv("TZ", pTz, 1);
+    tzset();
+    BuildDstTable();
+    strncpy(m_AppliedTz, pTz, sizeof(m_AppliedTz) - 1);
+
+    // Display debug info if debug display is enabled.
+    WTM_LOG_DEBUG(this, "%s\n", pTz);
+} // End SetTimezoneEnv().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// TableFirstYear()
+//
+// Returns the first year to hold in a table of DST transitions.  Tables
+// start the year before the current one so that times set a little in the
+// past are still covered.  If the clock has not been set yet, they start
+// where our default time does.  Times outside of a table are still
+// converted correctly, just a little slower.
+/////////////////////////////////////////////////////////////////////////////
+static int32_t TableFirstYear()
+{
+    const int32_t MIN_TABLE_YEAR = 2022;
+    int32_t firstYear = TimeMath::YearOf(time(NULL)) - 1;
+    return firstYear < MIN_TABLE_YEAR ? MIN_TABLE_YEAR : firstYear;
+} // End TableFirstYear().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetDstRules()
+//
+// Extracts the DST start and end rules from a set of time parameters.
+//
+// Arguments:
+//   rParams - The time parameters.
+//   pStart  - Pointer to where the DST start rule is returned.
+//   pEnd    - Pointer to where the DST end rule is returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+static void GetDstRules(const TimeParameters &rParams, DstRule *pStart, DstRule *pEnd)
+{
+    const TimeChangeInfo &rS = rParams.m_DstStartRule;
+    const TimeChangeInfo &rE = rParams.m_DstEndRule;
+    DstRule startRule = { rS.month, rS.week, rS.dow, rS.hour };
+    DstRule endRule   = { rE.month, rE.week, rE.dow, rE.hour };
+    *pStart = startRule;
+    *pEnd   = endRule;
+} // End GetDstRules().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// BuildDstTable()
+//
+// Rebuilds the zone in effect, with its DST transition table, from our
+// current timezone settings, publishes it and the settings to other tasks,
+// and flushes the local time cache.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::BuildDstTable()
+{
+    m_AppliedParams.Write(m_Params);
+
+    // A fixed zone's transitions were computed at compile time.
+    if (IsFixedZone())
+    {
+        FlushLocalTimeCache();
+        return;
+    }
+
+    // Tasks converting times meanwhile keep using the old zone until the new
+    // one is complete.  MakeZone() uses the same offsets as
+    // GetTimezoneString(), so the zone always agrees with the TZ environment
+    // variable.
+    MakeZone(m_Params, &m_Zone.BeginWrite());
+    m_Zone.Commit();
+    FlushLocalTimeCache();
+    m_Alarms.Recompute();
+} // End BuildDstTable().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// InstallFixedZone()
+//
+// Does the work of SetFixedZone().  Copies the compile time zone data into
+// our timezone settings so that the getters report it, and attaches the
+// compile time transitions.
+//
+// Arguments:
+//   pTz          - The POSIX TZ string.
+//   stdOfst      - Standard time offset from UTC in minutes.
+//   useDst       - true if DST is observed.
+//   dstOfst      - DST offset from UTC in minutes.
+//   pStdAbbrev   - Standard time abbreviation.
+//   pDstAbbrev   - DST abbreviation.
+//   rStart       - DST start rule.
+//   rEnd         - DST end rule.
+//   pTransitions - The compile time transitions.
+//   count        - The number of transitions pointed to by pTransitions.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::InstallFixedZone(const char *pTz, int32_t stdOfst,
+                                       bool useDst, int32_t dstOfst,
+                                       const char *pStdAbbrev,
+                                       const char *pDstAbbrev,
+                                       const DstRule &rStart, const DstRule &rEnd,
+                                       const DstTransition *pTransitions,
+                                       size_t count)
+{
+    m_pFixedTz = pTz;
+
+    // The setters constrain their values to what the Setup page allows, so
+    // fill in the fields directly.
+    m_Params.m_TzOfst  = stdOfst;
+    m_Params.m_UseDst  = useDst;
+    m_Params.m_DstOfst = dstOfst - stdOfst;
+    strncpy(m_Params.m_DstEndRule.abbrev, pStdAbbrev, sizeof(m_Params.m_DstEndRule.abbrev) - 1);
+    strncpy(m_Params.m_DstStartRule.abbrev, pDstAbbrev, sizeof(m_Params.m_DstStartRule.abbrev) - 1);
+    m_Params.m_DstStartRule.week   = rStart.week;
+    m_Params.m_DstStartRule.dow    = rStart.dow;
+    m_Params.m_DstStartRule.month  = rStart.month;
+    m_Params.m_DstStartRule.hour   = rStart.hour;
+    m_Params.m_DstStartRule.offset = dstOfst;
+    m_Params.m_DstEndRule.week     = rEnd.week;
+    m_Params.m_DstEndRule.dow      = rEnd.dow;
+    m_Params.m_DstEndRule.month    = rEnd.month;
+    m_Params.m_DstEndRule.hour     = rEnd.hour;
+    m_Params.m_DstEndRule.offset   = stdOfst;
+
+    m_Zone.BeginWrite().Attach(stdOfst, useDst, dstOfst, rStart, rEnd,
+                               pStdAbbrev, pDstAbbrev, pTransitions, count);
+    m_Zone.Commit();
+    m_AppliedParams.Write(m_Params);
+    FlushLocalTimeCache();
+    m_Alarms.Recompute();
+} // End InstallFixedZone().
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// UpdateWebPage()
+//
+// Update our custom Setup page based on current timezone, DST, and NTP settings.
+// Only used in wpmBuffered mode.  In wpmStreamed mode the page is rendered
+// each time it is requested.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::UpdateWebPage()
+{
+    if (m_WebPageMode == wpmStreamed)
+    {
+        return;
+    }
+
+    WTM_METRIC_START(startUs);
+
+    // Allocate our web page buffer on first use.
+    size_t bufSize = WebPageBufferSize();
+    if (m_pWebPageBuffer == NULL)
+    {
+        m_pWebPageBuffer = new char[bufSize];
+    }
+
+    // Render the page, with our settings spliced in, directly into the buffer.
+    WebPageWriter writer(m_pWebPageBuffer, bufSize);
+    RenderWebPage(writer);
+
+    // If selected, call back to let user code add HTML and/or java script.
+    if (m_pUpdateWebPageCallback != NULL)
+    {
+        String WebPageString(m_pWebPageBuffer);
+        m_pUpdateWebPageCallback(WebPageString, bufSize - 1);
+
+        // Save our (possibly modified) web page for later use.
+        strncpy(m_pWebPageBuffer, WebPageString.c_str(), bufSize - 1);
+        m_pWebPageBuffer[bufSize - 1] = '\0';
+    }
+    m_WebPageCrc   = ParamsCrc();
+    m_WebPageValid = true;
+    WTM_METRIC(this, m_PageBuildUs.Add(micros() - startUs));
+} // End UpdateWebPage().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetWebPage()
+//
+// Returns a pointer to the web page buffer.  The page is built first if it
+// hasn't been, or if the settings that it shows have changed since.
+// Returns an empty page in wpmStreamed mode.
+//
+/////////////////////////////////////////////////////////////////////////////
+const char *WiFiTimeManager::GetWebPage()
+{
+    if (m_WebPageMode == wpmStreamed)
+    {
+        return "";
+    }
+
+    // The settings may be changed in many ways (the Setup page, the REST
+    // API, the setters, or a wake from deep sleep), so rather than have each
+    // of them rebuild the page, compare the settings that it was built with.
+    if ((m_pWebPageBuffer == NULL) || !m_WebPageValid || (ParamsCrc() != m_WebPageCrc))
+    {
+        UpdateWebPage();
+    }
+    return m_pWebPageBuffer;
+} // End GetWebPage().
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ReleasePortal()
+//
+// In provisioned mode, frees the Setup page buffer and the WiFiManager web
+// and DNS servers.  Called from StartNewConnection() after the web portal
+// stops.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::ReleasePortal()
+{
+    if (!m_Provisioned || m_PortalReleased)
+    {
+        return;
+    }
+
+    uint32_t freeHeap = ESP.getFreeHeap();
+
+    // The WiFiManager keeps a pointer to our parameter, so it stays.  The
+    // page is built again when it is next served (see GetWebPage()).
+    delete [] m_pWebPageBuffer;
+    m_pWebPageBuffer = NULL;
+
+    // Stopping the portal (see StartNewConnection()) frees the web and DNS
+    // servers.
+    m_PortalReleased = true;
+
+    WTM_LOG_INFO(this, "Portal released, %u bytes freed.\n",
+                 ESP.getFreeHeap() - freeHeap);
+} // End ReleasePortal().
+
+
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// RenderWebPage()
+//
+// Render our custom Setup page into the specified Print object.  The
+// current settings are spliced in at the JSON marker, and the user stream
+// web page callback (if any) is invoked at each of the comment markers.
+//
+// Arguments:
+//   rOut - The Print object that receives the page.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::RenderWebPage(Print &rOut)
+{
+    // Build our list of markers.  The JSON marker is always first.
+    const size_t NUM_COMMENT_MARKERS =
+        sizeof(WEB_PAGE_MARKERS) / sizeof(WEB_PAGE_MARKERS[0]);
+    const size_t NUM_MARKERS = NUM_COMMENT_MARKERS + 1;
+    const char *pMarkers[NUM_MARKERS];
+    const char *pNext[NUM_MARKERS];
+    pMarkers[0] = TZ_JSON_MARKER;
+    for (size_t i = 0; i < NUM_COMMENT_MARKERS; i++)
+    {
+        pMarkers[i + 1] = WEB_PAGE_MARKERS[i];
+    }
+
+    // Find the first occurrence of each marker.
+    const char *pPos = WebPageSource();
+    for (size_t i = 0; i < NUM_MARKERS; i++)
+    {
+        pNext[i] = strstr(pPos, pMarkers[i]);
+    }
+
+    while (true)
+    {
+        // Find the marker that comes next in the page.
+        size_t hit = NUM_MARKERS;
+        for (size_t i = 0; i < NUM_MARKERS; i++)
+        {
+            if ((pNext[i] != NULL) && ((hit == NUM_MARKERS) || (pNext[i] < pNext[hit])))
+            {
+                hit = i;
+            }
+        }
+
+        // Send the rest of the page if there are no more markers.
+        if (hit == NUM_MARKERS)
+        {
+            rOut.print(pPos);
+            break;
+        }
+
+        // Send everything up to the marker.
+        rOut.write(pPos, pNext[hit] - pPos);
+
+        if (hit == 0)
+        {
+            // Replace the JSON marker with our user settable parameters.
+            StaticJsonDocument<MAX_JSON_SIZE> doc;
+            FillSettingsJson(this, doc);
+            serializeJson(doc, rOut);
+        }
+        else
+        {
+            // Let user code add HTML and/or java script, then keep the marker.
+            if (m_pStreamWebPageCallback != NULL)
+            {
+                m_pStreamWebPageCallback(pMarkers[hit], rOut);
+            }
+            rOut.print(pMarkers[hit]);
+        }
+
+        // Move past the marker and find its next occurrence.
+        pPos = pNext[hit] + strlen(pMarkers[hit]);
+        pNext[hit] = strstr(pPos, pMarkers[hit]);
+    }
+} // End RenderWebPage().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleStreamedSetupPage()
+//
+// Web server handler that streams the complete Setup page to the client.
+// Used in place of the WiFiManager "/param" handler in wpmStreamed mode.
+// The page is framed by the same WiFiManager templates that the WiFiManager
+// uses for its own param page.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleStreamedSetupPage()
+{
+    WTM_LOG_DEBUG(this, "Streaming Setup page.\n");
+
+    // Send the header now, and the body in chunks as it is rendered.
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "text/html", "");
+
+    {
+        WebPageWriter writer(server.get());
+        StreamTemplate(writer, HTTP_HEAD_START, "{v}", "Setup");
+        writer.print(HTTP_SCRIPT);
+        writer.print(HTTP_STYLE);
+        StreamTemplate(writer, HTTP_HEAD_END, "{c}", m_BodyClass.c_str());
+        StreamTemplate(writer, HTTP_FORM_START, "{v}", "paramsave");
+        RenderWebPage(writer);
+        StreamTemplate(writer, HTTP_FORM_END, "{v}", "Save");
+        writer.print(HTTP_BACKBTN);
+        writer.print(HTTP_END);
+        writer.Flush();
+    }
+
+    // An empty chunk ends the response.
+    server->sendContent("");
+} // End HandleStreamedSetupPage().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleSetupScript()
+//
+// Web server handler that sends the gzipped Setup page script in the
+// wpmCached mode.  The script's URL changes along with the script, so it
+// may be cached for good.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleSetupScript()
+{
+    static const char ETAG[] = "\"" WTM_SETUP_JS_ETAG "\"";
+    server->sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+    server->sendHeader("ETag", ETAG);
+
+    // The browser already has it.
+    if (server->header("If-None-Match") == ETAG)
+    {
+        WTM_LOG_DEBUG(this, "Setup script not modified.\n");
+        server->send(304);
+        return;
+    }
+
+    WTM_LOG_DEBUG(this, "Sending setup script.\n");
+    server->sendHeader("Content-Encoding", "gzip");
+    server->send_P(200, "application/javascript", (PGM_P)WTM_SETUP_JS_GZ,
+                   sizeof(WTM_SETUP_JS_GZ));
+} // End HandleSetupScript().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleConfigJson()
+//
+// Web server handler that sends our current settings as JSON in the
+// wpmCached mode.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleConfigJson()
+{
+    StaticJsonDocument<MAX_JSON_SIZE> doc;
+    FillSettingsJson(this, doc);
+    SendJson(*server, 200, doc);
+} // End HandleConfigJson().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ApplySettingsJson()
+//
+// Sets any of our user settable parameters that are present in a JSON
+// document.  Uses the same names as FillSettingsJson().  Meant to be
+// called between BeginUpdate() and CommitUpdate().
+//
+// Arguments:
+//   rDoc  - Reference to the JSON document.
+//
+// Returns:
+//   Returns false if any value present has the wrong type, or true otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::ApplySettingsJson(const JsonDocument &rDoc)
+{
+    // The integer settings, and their setters.
+    typedef void (WiFiTimeManager::*IntSetter)(uint32_t);
+    static const struct { const char *pName; IntSetter setter; } RULE_FIELDS[] =
+    {
+        { "DST_START_WEEK",  &WiFiTimeManager::SetDstStartWk },
+        { "DST_START_DOW",   &WiFiTimeManager::SetDstStartDow },
+        { "DST_START_MONTH", &WiFiTimeManager::SetDstStartMonth },
+        { "DST_START_HOUR",  &WiFiTimeManager::SetDstStartHour },
+        { "DST_END_WEEK",    &WiFiTimeManager::SetDstEndWk },
+        { "DST_END_DOW",     &WiFiTimeManager::SetDstEndDow },
+        { "DST_END_MONTH",   &WiFiTimeManager::SetDstEndMonth },
+        { "DST_END_HOUR",    &WiFiTimeManager::SetDstEndHour },
+    };
+    static const char *NTP_FIELDS[TimeParameters::MAX_NTP_SERVERS] =
+        { "NTP_ADDRESS", "NTP_ADDRESS2", "NTP_ADDRESS3", "NTP_ADDRESS4" };
+
+    for (size_t i = 0; i < sizeof(RULE_FIELDS) / sizeof(RULE_FIELDS[0]); i++)
+    {
+        JsonVariantConst v = rDoc[RULE_FIELDS[i].pName];
+        if (!v.isNull())
+        {
+            if (!v.is<uint32_t>())
+            {
+                return false;
+            }
+            (this->*RULE_FIELDS[i].setter)(v.as<uint32_t>());
+        }
+    }
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
+    {
+        JsonVariantConst v = rDoc[NTP_FIELDS[i]];
+        if (!v.isNull())
+        {
+            if (!v.is<const char *>())
+            {
+                return false;
+            }
+            SetNtpAddr(i, v.as<const char *>());
+        }
+    }
+
+    JsonVariantConst tz     = rDoc["TIMEZONE"];
+    JsonVariantConst dst    = rDoc["DST_START_OFFSET"];
+    JsonVariantConst useDst = rDoc["USE_DST"];
+    JsonVariantConst tzAbbr = rDoc["TZ_ABBREVIATION"];
+    JsonVariantConst dstAbb = rDoc["DST_ABBREVIATION"];
+    if ((!tz.isNull() && !tz.is<int32_t>()) || (!dst.isNull() && !dst.is<int32_t>()) ||
+        (!useDst.isNull() && !useDst.is<bool>()) ||
+        (!tzAbbr.isNull() && !tzAbbr.is<const char *>()) ||
+        (!dstAbb.isNull() && !dstAbb.is<const char *>()))
+    {
+        return false;
+    }
+    if (!tz.isNull())     { SetTzOfst(tz.as<int32_t>()); }
+    if (!dst.isNull())    { SetDstOfst(dst.as<int32_t>()); }
+    if (!useDst.isNull()) { SetUseDst(useDst.as<bool>()); }
+    if (!tzAbbr.isNull()) { SetTzAbbrev(tzAbbr.as<const char *>()); }
+    if (!dstAbb.isNull()) { SetDstAbbrev(dstAbb.as<const char *>()); }
+
+    // The rule offsets follow from the others, as edited.
+    SetDstStartOfst(m_Params.m_TzOfst + m_Params.m_DstOfst);
+    SetDstEndOfst(m_Params.m_TzOfst);
+    return true;
+} // End ApplySettingsJson().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleRestConfigGet()
+//
+// REST API handler that sends our current settings as JSON.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleRestConfigGet()
+{
+    JsonDocument &out = m_pRest->m_Out;
+    out.clear();
+    FillSettingsJson(this, out);
+    SendJson(m_pRest->m_Server, 200, out);
+} // End HandleRestConfigGet().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleRestConfigPut()
+//
+// REST API handler that changes our settings from a JSON request body.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleRestConfigPut()
+{
+    // The WebServer keeps the body as the "plain" argument, but only hands
+    // out String copies of it, so the body costs one heap allocation.  It is
+    // parsed in place (ArduinoJson's zero-copy mode), so that its strings
+    // aren't copied again into the document.  A missing body reads as empty,
+    // which the parser rejects.
+    WebServer &rServer = m_pRest->m_Server;
+    JsonDocument &in = m_pRest->m_In;
+    JsonDocument &out = m_pRest->m_Out;
+    String body = rServer.arg(BODY_ARG);
+    DeserializationError err = deserializeJson(in, body.begin());
+
+    out.clear();
+    if (err)
+    {
+        out["ERROR"] = err.c_str();
+        SendJson(rServer, 400, out);
+        return;
+    }
+
+    // Apply all of the changes at once, or none of them.  Bad settings are
+    // the client's fault, but a failed save is ours.
+    BeginUpdate();
+    if (!ApplySettingsJson(in) || !ValidateParams())
+    {
+        AbortUpdate();
+        out["ERROR"] = "Settings rejected";
+        SendJson(rServer, 400, out);
+        return;
+    }
+    if (!CommitUpdate())
+    {
+        out["ERROR"] = "Settings not saved";
+        SendJson(rServer, 500, out);
+        return;
+    }
+    WTM_LOG_INFO(this, "Settings changed by REST API.\n");
+
+    FillSettingsJson(this, out);
+    SendJson(rServer, 200, out);
+} // End HandleRestConfigPut().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleRestStatus()
+//
+// REST API handler that sends our time and sync status as JSON.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleRestStatus()
+{
+    static const char *QUALITY[] = { "NONE", "ESTIMATED", "CACHED", "USER_DEVICE", "NETWORK", "PPS" };
+
+    time_t utc = ClockTimeT();
+    JsonDocument &doc = m_pRest->m_Out;
+    doc.clear();
+    doc["UTC"]                = utc;
+    doc["UTC_MICROS"]         = GetUtcMicros();
+    doc["CONNECTED"]          = IsConnected();
+    doc["USING_NETWORK_TIME"] = UsingNetworkTime();
+    doc["TIME_QUALITY"]       = QUALITY[m_TimeQuality];
+    doc["TIME_SOURCE"]        = QUALITY[m_Arbiter.GetSource()];
+    if (m_TimeQuality >= tqUserDevice)
+    {
+        doc["LAST_SYNC"]      = utc - (time_t)((millis() - m_LastUpdateMs) / 1000);
+    }
+    doc["NTP_RATE_SEC"]       = GetNtpRateSec();
+    doc["DRIFT_PPM"]          = GetDriftPpm();
+    doc["EXPECTED_ERROR_US"]  = GetExpectedErrorUs();
+    doc["CLOCK_STEPS"]        = GetClockStepCount();
+    if (m_PpsPin >= 0)
+    {
+        doc["PPS_LOCKED"]     = m_Pps.IsLocked();
+        doc["PPS_RATE_PPB"]   = m_Pps.GetRatePpb();
+    }
+    doc["UPTIME_SEC"]         = millis() / 1000;
+    doc["MAX_PROCESS_US"]     = GetMaxProcessMicros();
+    SendJson(m_pRest->m_Server, 200, doc);
+} // End HandleRestStatus().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// HandleRestMetrics()
+//
+// REST API handler that sends a summary of our metrics as JSON.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::HandleRestMetrics()
+{
+#if WTM_ENABLE_METRICS
+    JsonDocument &doc = m_pRest->m_Out;
+    WtmMetrics &metrics = m_pRest->m_Metrics;
+    doc.clear();
+    GetMetrics(&metrics);
+
+    uint32_t elapsedSec = (millis() - metrics.m_SinceMs) / 1000;
+    doc["ELAPSED_SEC"]       = elapsedSec;
+    doc["SYNCS"]             = metrics.m_Syncs;
+    doc["FORCED_SYNCS"]      = metrics.m_ForcedSyncs;
+    doc["LAST_OFFSET_US"]    = metrics.m_LastOffsetUs;
+    doc["NVS_WRITES"]        = metrics.m_NvsWrites;
+    doc["LOCAL_TIME_CALLS"]  = metrics.m_LocalTimeCalls;
+    doc["LOCAL_TIME_PER_SEC"] =
+        elapsedSec != 0 ? (float)metrics.m_LocalTimeCalls / elapsedSec : 0.0f;
+    doc["PPS_EDGES"]         = metrics.m_PpsEdges;
+    doc["PPS_IGNORED"]       = metrics.m_PpsIgnored;
+    doc["PPS_LOCK_LOSSES"]   = metrics.m_PpsLockLosses;
+    FillHistogramJson(doc.createNestedObject("SYNC_OFFSET_US"),    metrics.m_SyncOffsetUs);
+    FillHistogramJson(doc.createNestedObject("SYNC_DELAY_US"),     metrics.m_SyncDelayUs);
+    FillHistogramJson(doc.createNestedObject("SYNC_INTERVAL_SEC"), metrics.m_SyncIntervalSec);
+    FillHistogramJson(doc.createNestedObject("RTC_READ_US"),       metrics.m_RtcReadUs);
+    FillHistogramJson(doc.createNestedObject("NVS_WRITE_US"),      metrics.m_NvsWriteUs);
+    FillHistogramJson(doc.createNestedObject("PAGE_BUILD_US"),     metrics.m_PageBuildUs);
+    FillHistogramJson(doc.createNestedObject("PPS_ERR_US"),        metrics.m_PpsErrUs);
+    SendJson(m_pRest->m_Server, 200, doc);
+#else
+    m_pRest->m_Server.send(404, "application/json", "{\"ERROR\":\"Metrics disabled\"}");
+#endif
+} // End HandleRestMetrics().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// RestAuthorized()
+//
+// Checks a REST request's token, and if it is bad, sends an error reply.
+//
+// Returns:
+//   Returns true if the request may be served, or false otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::RestAuthorized()
+{
+    // Expect "Bearer <token>".  Every character of the token is compared,
+    // whatever the header holds, so that the time taken doesn't tell a
+    // client how much of a guess was right.  A header of the wrong length
+    // is compared against the token itself, and fails on its length.
+    static const char BEARER[] = "Bearer ";
+    static const size_t BEARER_LEN = sizeof(BEARER) - 1;
+    WebServer &rServer = m_pRest->m_Server;
+    String auth = rServer.header(AUTH_HEADER);
+    size_t tokenLen = strlen(m_pRestToken);
+    bool lengthOk = auth.length() == BEARER_LEN + tokenLen;
+    const char *pGiven = lengthOk ? auth.c_str() + BEARER_LEN : m_pRestToken;
+    uint8_t diff = !lengthOk || (strncmp(auth.c_str(), BEARER, BEARER_LEN) != 0);
+    for (size_t i = 0; i < tokenLen; i++)
+    {
+        diff |= (uint8_t)(pGiven[i] ^ m_pRestToken[i]);
+    }
+    if (diff == 0)
+    {
+        return true;
+    }
+
+    WTM_LOG_WARN(this, "REST request refused.\n");
+    rServer.send(401, "application/json", "{\"ERROR\":\"Unauthorized\"}");
+    return false;
+} // End RestAuthorized().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SendJson()
+//
+// Sends a JSON document as the reply to the current request.  The document
+// is streamed to the client rather than serialized into a buffer first.
+//
+// Arguments:
+//   rServer - The web server that is handling the request.
+//   code    - The HTTP status code.
+//   rDoc    - The document to send.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SendJson(WebServer &rServer, int code, const JsonDocument &rDoc)
+{
+    rServer.sendHeader("Cache-Control", "no-store");
+    rServer.setContentLength(measureJson(rDoc));
+    rServer.send(code, "application/json", "");
+
+    // WebServer::client() returns the client by value in the 2.x core.
+    WiFiClient client = rServer.client();
+    JsonClientWriter writer(client);
+    serializeJson(rDoc, writer);
+} // End SendJson().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// InitRest()
+//
+// Allocates the REST API's web server and documents, and installs the
+// API's handlers.  Called from Init() if the API is enabled.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::InitRest()
+{
+    if (m_pRest != NULL)
+    {
+        return;
+    }
+    m_pRest = new RestState(m_RestPort);
+
+    // Every request must present the token.  The WebServer only keeps the
+    // headers that it is asked to.
+    WebServer &rServer = m_pRest->m_Server;
+    rServer.collectHeaders(REST_HEADERS, sizeof(REST_HEADERS) / sizeof(REST_HEADERS[0]));
+    rServer.on("/wtm/api/config", HTTP_GET, [this]()
+        { if (RestAuthorized()) { HandleRestConfigGet(); } });
+    rServer.on("/wtm/api/config", HTTP_PUT, [this]()
+        { if (RestAuthorized()) { HandleRestConfigPut(); } });
+    rServer.on("/wtm/api/status", HTTP_GET, [this]()
+        { if (RestAuthorized()) { HandleRestStatus(); } });
+    rServer.on("/wtm/api/metrics", HTTP_GET, [this]()
+        { if (RestAuthorized()) { HandleRestMetrics(); } });
+} // End InitRest().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// StartRestServer()
+//
+// Starts the REST API's web server, if the API is enabled and the server
+// isn't already running.  Called once the network connects.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::StartRestServer()
+{
+    if ((m_pRest != NULL) && !m_pRest->m_Started)
+    {
+        WTM_LOG_INFO(this, "Starting REST API server on port %u.\n", m_RestPort);
+        m_pRest->m_Server.begin();
+        m_pRest->m_Started = true;
+    }
+} // End StartRestServer().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WebServerCallback()
+//
+// Static method that is called by the WiFiManager just after its web server
+// is created, and before it installs its own handlers.  Since the web server
+// uses the first handler that matches a request, any handlers installed here
+// take precedence over those of the WiFiManager.  Installs any of our
+// handlers, then calls the user's web server callback, if any.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::WebServerCallback()
+{
+    // Since this is a static method, we need to point to the singleton instance.
+    WiFiTimeManager *pWtm = Instance();
+
+    // In provisioned mode, the Setup page may have been freed.  It is built
+    // again as it is served.
+    pWtm->m_PortalReleased = false;
+
+    // In streamed mode, serve the Setup page ourselves.  A fixed zone has no
+    // Setup page.
+    if ((pWtm->m_WebPageMode == wpmStreamed) && !pWtm->IsFixedZone())
+    {
+        pWtm->server->on("/param", HTTP_GET,
+            std::bind(&WiFiTimeManager::HandleStreamedSetupPage, pWtm));
+    }
+
+    // The WebServer only keeps the headers that it is asked to.
+    pWtm->server->collectHeaders(WEB_HEADERS, sizeof(WEB_HEADERS) / sizeof(WEB_HEADERS[0]));
+
+    // In cached mode, serve the Setup page script and our settings.
+    if ((pWtm->m_WebPageMode == wpmCached) && !pWtm->IsFixedZone())
+    {
+        pWtm->server->on("/wtm/setup.js", HTTP_GET,
+            std::bind(&WiFiTimeManager::HandleSetupScript, pWtm));
+        pWtm->server->on("/wtm/config", HTTP_GET,
+            std::bind(&WiFiTimeManager::HandleConfigJson, pWtm));
+    }
+
+    // Call back the user's web server handler if any was specified.
+    if (pWtm->m_pWebServerCallback != NULL)
+    {
+        pWtm->m_pWebServerCallback();
+    }
+} // End WebServerCallback().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SaveParamCallback()
+//
+// Static method that is called when the WiFiManager user saves the time
+// configuration.  Updates all time parameters, then updates the timezone
+// rules based on the (possibly) new timezone values.  Finally, it updates
+// the web page so that its values will be up to date the next time it is
+// displayed.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SaveParamCallback()
+{
+    // Since this is a static method, we need to point to the singleton instance.
+    WiFiTimeManager *pWtm = Instance();
+
+    WTM_LOG_INFO(pWtm, "SaveParamCallback\n");
+    // Stuff the (possibly) new values into our local data.  They all take
+    // effect together when the update is committed.
+    pWtm->BeginUpdate();
+    pWtm->DecodeSetupForm();
+
+    // The DST offset is rounded to one of its two values, and the rule
+    // offsets follow from the others.
+    TimeParameters &rParams = pWtm->m_Params;
+    pWtm->SetDstOfst(rParams.m_DstOfst);
+    pWtm->SetDstStartOfst(rParams.m_TzOfst + rParams.m_DstOfst);
+    pWtm->SetDstEndOfst(rParams.m_TzOfst);
+
+    // A renamed NTP server starts its statistics over.
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
+    {
+        if (strcmp(rParams.m_NtpAddr[i], pWtm->m_UpdateBase.m_NtpAddr[i]) != 0)
+        {
+            pWtm->m_NtpProbe.ResetStats(i);
+        }
+    }
+
+    // Apply the (possibly) new values and save them in NVS for later use.
+    // Bad values are thrown out, and the old ones kept.
+    if (!pWtm->CommitUpdate())
+    {
+        WTM_LOG_WARN(pWtm, "Setup page values not saved.\n");
+    }
+
+    // Call back the user's save parameter handler if any was specified.
+    if (pWtm->m_pSaveParamsCallback != NULL)
+    {
+        pWtm->m_pSaveParamsCallback();
+    }
+} // End SaveParamCallback(),
+
+
+/////////////////////////////////////////////////////////////////////////////
+// DecodeSetupForm()
+//
+// Stores each of our Setup page fields straight into m_Params.  Fields
+// missing from the form are left alone, except for the DST checkbox, which
+// a browser leaves out when it is unchecked.
+//
+// Each field costs one lookup, through a name String built once by Init().
+// A missing field reads as empty, which is all the numbers and the checkbox
+// need, so hasArg() is only asked about an empty text field, which clears
+// the text if it was sent.  WebServer has no way to read a value in place:
+// arg() always returns a String copy, and the 2.x core copies the name too.
+// Names and values short enough for String's inline buffer (10 characters
+// on the ESP32), which covers every name and every value but the NTP
+// addresses, cost no allocation.  A longer NTP address costs one.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::DecodeSetupForm()
+{
+    uint8_t *pParams = (uint8_t *)&m_Params;
+    m_Params.m_UseDst = false;
+
+    for (size_t f = 0; f < FORM_FIELD_COUNT; f++)
+    {
+        const FormField *pField = &FORM_FIELDS[f];
+        String value = server->arg(s_FormNames[f]);
+        if (value.isEmpty() &&
+            ((pField->type != fftText) || !server->hasArg(s_FormNames[f])))
+        {
+            continue;
+        }
+
+        // Store its value.  Numbers that don't parse are ignored, and the rest
+        // are kept within their field's range.
+        const char *pValue = value.c_str();
+        uint8_t *pDest = pParams + pField->offset;
+        char *pEnd = NULL;
+        long number = (pField->type == fftInt) || (pField->type == fftByte) ?
+                      strtol(pValue, &pEnd, 10) : 0;
+        switch (pField->type)
+        {
+            case fftInt:
+                if (pEnd != pValue)
+                {
+                    *(int32_t *)pDest = (int32_t)constrain(number, (long)pField->min, (long)pField->max);
+                }
+                break;
+
+            case fftByte:
+                if (pEnd != pValue)
+                {
+                    *pDest = (uint8_t)constrain(number, pField->min, pField->max);
+                }
+                break;
+
+            case fftCheckbox:
+                *(bool *)pDest = strcmp(pValue, "true") == 0;
+                break;
+
+            case fftText:
+                strncpy((char *)pDest, pValue, pField->max - 1);
+                pDest[pField->max - 1] = '\0';
+                break;
+        }
+    }
+} // End DecodeSetupForm().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetParamString()
+//
+// Returns the last value read of the specified Setup parameter.
+//
+// Arguments:
+//   name - String containing the name of the argument whose value is to be
+//          returned.
+//
+// Returns:
+//    Always returns the String value of the specified argument if successful,
+//    or an empty String on failure.
+//
+/////////////////////////////////////////////////////////////////////////////
+String WiFiTimeManager::GetParamString(String name)
+{
+    // Read the parameter that was returned from server.
+    String value;
+    if(server->hasArg(name))
+    {
+        value = server->arg(name);
+    }
+    return value;
+} // End GetParamString().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetParamChars()
+//
+// Returns the last value read of the specified Setup parameter.
+//
+// Arguments:
+//   name - String containing the name of the argument whose value is to be
+//          returned.
+//   pBuf - Pointer to the buffer in which the parameter's value is to be
+//          returned.
+//   size - Size of the buffer pointed to by pBuf.
+//
+// Returns:
+//    Returns the value passed as pBuf.  The returned buffer will contain the
+//    value of the specified parameter if successful, or an empty buffer on failure.
+//
+/////////////////////////////////////////////////////////////////////////////
+char *WiFiTimeManager::GetParamChars(String name, char *pBuf, size_t size)
+{
+    GetParamString(name).toCharArray(pBuf, size);
+    return pBuf;
+} // End GetParamChars().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetParamInt()
+//
+// Returns the last value read of the specified timezone parameter as an
+// integer.
+//
+// Arguments:
+//   name - String containing the name of the argument whose value is to be
+//          returned.
+//
+// Returns:
+//    Returns the int value of the specified Setup parameter.
+//
+/////////////////////////////////////////////////////////////////////////////
+int WiFiTimeManager::GetParamInt(String name)
+{
+    return GetParamString(name).toInt();
+} // End GetParamInt().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUtcTimeT()
+//
+// This method returns UTC time in UNIX time (time_t).  If a user
+// UTC get callback has been specified, and its time would now be better
+// than the clock's (see GetTimeSource()), then the user code is called
+// to update the clock time.  The time returned is always that of the
+// precision clock (see GetUtcMicros()), which NTP, the user device, and
+// any PPS signal all correct.
+//
+// Arguments:
+//   force - Forces a read of the user callback if present.  Its time is
+//           still only used if it is better than the clock's.  This
+//           argument is ptional, and defaults to false.
+//
+// Returns:
+//   Always returns the current UTC time, in whole seconds, as kept by the
+//   precision clock.
+//
+/////////////////////////////////////////////////////////////////////////////
+time_t WiFiTimeManager::GetUtcTimeT(bool force)
+{
+    time_t timeNow = 0;
+    uint32_t millisNow = millis();
+    bool updateTimedOut = (millisNow - m_LastUpdateMs) >= 4 * m_NtpRateMs;
+
+    // If a user callback exists and we're forced, or its time would be
+    // better than the clock's, get the current time from the user device.
+    // The RTC backend's time is cached, so it is never deferred.  The device
+    // is checked for first, so that without one, the arbiter isn't asked.
+    int64_t monoUs = esp_timer_get_time();
+    bool useDevice = UtcDeviceReady() &&
+                     (force || m_Arbiter.IsBetter(tqUserDevice, monoUs, UTC_DEVICE_READ_ERR_US));
+    if (useDevice && (m_pRtcBackend == NULL) && DeferToServiceTask())
+    {
+        // Have the service task read the user device.  Only ask once until it
+        // gets around to it.
+        if (!m_RtcSyncPending.exchange(true) && !SendServiceMsg(scSyncRtc, 0, 0))
+        {
+            m_RtcSyncPending = false;
+        }
+        timeNow = ClockTimeT();
+    }
+    else if (useDevice)
+    {
+        // Get the time from user code.
+        WTM_METRIC_START(startUs);
+        {
+            UtcGetGuard func(m_pUtcGetCallback);
+            timeNow = *func ? (*func)() : time(NULL);
+        }
+        WTM_METRIC(this, m_RtcReadUs.Add(micros() - startUs));
+
+        // The device only keeps whole seconds, so the time is somewhere in
+        // the second that it reads.  Take the middle of it, and only use it
+        // if that is better than the clock, or the clock must be wrong.
+        // Then, since it is better, the clock may be slewed or stepped to it.
+        timeval tv = { .tv_sec = timeNow, .tv_usec = PrecisionClock::USECS_PER_SEC / 2 };
+        int64_t deviceUs = (int64_t)timeNow * PrecisionClock::USECS_PER_SEC + tv.tv_usec;
+        int64_t offsetUs = deviceUs - m_PrecisionClock.GetUtcMicros(monoUs);
+        if (m_Arbiter.Offer(tqUserDevice, monoUs, UTC_DEVICE_READ_ERR_US, offsetUs))
+        {
+            // Set the ESP32 time based on returned callback value.
+            settimeofday(&tv, NULL);
+            m_PrecisionClock.Sync(deviceUs, monoUs, true);
+            m_Alarms.Rearm();
+            m_TimeQuality = tqUserDevice;
+            SaveRtcCheckpoint(timeNow);
+
+            // Reset our last update time.
+            m_LastUpdateMs = millisNow;
+        }
+        else
+        {
+            timeNow = ClockTimeT();
+        }
+    }
+    else
+    {
+        timeNow = ClockTimeT();
+    }
+
+    // Remember if we are not getting NTP time, and try for it again, backing
+    // off while it fails.
+    if (updateTimedOut)
+    {
+        m_UsingNetworkTime = false;
+        if (m_TimeQuality == tqNetwork)
+        {
+            m_TimeQuality = tqCached;
+        }
+        if (IsConnected() && NtpRetryDue())
+        {
+            if (DeferToServiceTask())
+            {
+                SendServiceMsg(scSyncNtp, 0, 0);
+            }
+            else
+            {
+                ForceSntpSync();
+            }
+        }
+    }
+
+    return timeNow;
+} // End GetUtcTimeT().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetUtcTime()
+//
+// This method returns UTC broken-down time.  It uses GetUtcTimeT() to
+// fetch the UTC time.
+//
+// Arguments:
+//   pTm - A pointer to the tm structure into which the UTC time will be
+//         saved.
+//
+// Returns:
+//   Always returns the value passed in as pTm.
+//
+/////////////////////////////////////////////////////////////////////////////
+tm *WiFiTimeManager::GetUtcTime(tm *pTm)
+{
+    time_t utc = GetUtcTimeT();
+    return gmtime_r(&utc, pTm);
+} // End GetUtcTime().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetLocalTime()
+//
+// Returns the best known value for local time.  Converts the best known
+// UTC time to the broken-down local time and returns its pointer.
+// See GetUtcTimeT().
+//
+// Arguments:
+//   pTm - A pointer to the tm structure into which the local time data will
+//         be returned.
+//
+// Returns:
+//   Returns the best known value for the current local time in the
+//   structure pointed to by pTm.  Also returns pTm.
+//
+/////////////////////////////////////////////////////////////////////////////
+tm *WiFiTimeManager::GetLocalTime(tm *pTm)
+{
+#if WTM_ENABLE_METRICS
+    m_LocalTimeCalls.fetch_add(1, std::memory_order_relaxed);
+#endif
+    time_t utc = GetUtcTimeT();
+    return UtcToLocal(utc, pTm);
+} // End GetLocalTime();
+
+
+/////////////////////////////////////////////////////////////////////////////
+// UtcToLocal()
+//
+// Converts a UTC time to broken-down local time using our own timezone
+// settings.  The offset comes from a table of DST transitions that is
+// computed whenever the timezone settings change, so the conversion does
+// not depend on the TZ environment variable.  The most recent result
+// is cached, and is shared lock-free between all tasks on both cores.
+// Requests for the same second, or a later second within the same minute,
+// are served from the cache without any conversion at all.  Since DST
+// transitions always fall on a minute boundary, these can never cross one.
+//
+// Arguments:
+//   utc - The UTC time to be converted.
+//   pTm - A pointer to the tm structure into which the local time data will
+//         be returned.
+//
+// Returns:
+//   Returns the local time in the structure pointed to by pTm.  Also
+//   returns pTm.
+//
+/////////////////////////////////////////////////////////////////////////////
+tm *WiFiTimeManager::UtcToLocal(time_t utc, tm *pTm)
+{
+    LocalTimeCache cache;
+    uint32_t tzGeneration = m_TzGeneration.load(std::memory_order_acquire);
+
+    // Try the fast path first.  Only the seconds can differ from the cached
+    // value if we are still within the same minute.
+    if (m_LocalTimeCache.TryRead(&cache) &&
+        (cache.m_TzGeneration == tzGeneration) && (utc >= cache.m_Utc) &&
+        (utc - cache.m_Utc < 60 - cache.m_Local.tm_sec))
+    {
+        *pTm = cache.m_Local;
+        pTm->tm_sec += utc - cache.m_Utc;
+        return pTm;
+    }
+
+    // Do the full conversion and publish it for everyone else.  If another
+    // task is publishing at the same time, then we simply don't bother.
+    Rcu<Zone>::ReadGuard(m_Zone)->ToLocal(utc, pTm);
+    cache.m_Utc = utc;
+    cache.m_TzGeneration = tzGeneration;
+    cache.m_Local = *pTm;
+    m_LocalTimeCache.TryWrite(cache);
+    return pTm;
+} // End UtcToLocal().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// FlushLocalTimeCache()
+//
+// Discards the cached local time used by UtcToLocal() and GetLocalTime().
+// This is done automatically whenever WiFiTimeManager changes the
+// timezone.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::FlushLocalTimeCache()
+{
+    // Bumping the generation makes any cached value stale, even one that is
+    // being published right now by a task that converted with the old rules.
+    // The cache itself is left alone, so that this never waits on a writer.
+    m_TzGeneration.fetch_add(1, std::memory_order_acq_rel);
+} // End FlushLocalTimeCache().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// MakeZone()
+//
+// Builds a Zone from a set of time parameters, such as those of another
+// site.  Only the timezone and DST fields are used.  The zone converts
+// without the TZ environment variable, so many zones may be used at once.
+//
+// Arguments:
+//   rParams - The time parameters.
+//   pZone   - Pointer to the zone to be built.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::MakeZone(const TimeParameters &rParams, Zone *pZone)
+{
+    DstRule startRule;
+    DstRule endRule;
+    GetDstRules(rParams, &startRule, &endRule);
+    pZone->Build(rParams.m_TzOfst, rParams.m_UseDst, rParams.m_TzOfst + rParams.m_DstOfst,
+                 startRule, endRule, rParams.m_DstEndRule.abbrev,
+                 rParams.m_DstStartRule.abbrev, TableFirstYear());
+} // End MakeZone().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetDateTimeString
+//
+// Format a UNIX broken-down tm time value.  Uses the TimeFormat::DATE_TIME
+// format, which gives the same string as the strftime() format
+// "%A, %B %d %Y %r %Z Day of Year: %j", without strftime()'s locale
+// handling.  %Z is our own DST or standard abbreviation, per tm_isdst.
+//
+// Arguments:
+//   pBuf  - Pointer to a buffer that will receive the time string.  Must be at
+//           least 64 characters long to receive the full string.  If the buffer
+//           is shorter than 64 characters, the time string will be truncated.
+//   size  - The size, in bytes, of the buffer pointed to by pBuf.
+//   pTime - Pointer to the tm time structure containing the time to be
+//           converted.
+//
+// Returns:
+//   Always returns the number of characters in the time string minus the
+//   terminating NULL.
+//
+/////////////////////////////////////////////////////////////////////////////
+int WiFiTimeManager::GetDateTimeString(char *pBuf, int size, tm *pTime)
+{
+    static const TimeFormat dateTime(TimeFormat::DATE_TIME);
+    bool isDst = pTime->tm_isdst > 0;
+    Rcu<Zone>::ReadGuard zone(m_Zone);
+    return (int)dateTime.Format(pBuf, size > 0 ? (size_t)size : 0, pTime, 0,
+                                isDst ? zone->GetDstOffset() : zone->GetStdOffset(),
+                                isDst ? zone->GetDstAbbrev() : zone->GetStdAbbrev());
+} // End GetDateTimeString().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// FormatTime
+//
+// Formats the current time, with milliseconds, without any heap use.
+// Meant for stamping log lines.  See TimeFormat.
+//
+// Arguments:
+//   rFormat - The format (e.g. one built from TimeFormat::RFC_3339_MS).
+//   pBuf    - Pointer to the buffer that receives the NULL terminated
+//             string.  The string is truncated if it doesn't fit.
+//   size    - The size, in bytes, of the buffer pointed to by pBuf.
+//   utc     - true to format UTC time, or false for local time.
+//
+// Returns:
+//   Returns the number of characters written, not counting the
+//   terminating NULL.
+//
+/////////////////////////////////////////////////////////////////////////////
+size_t WiFiTimeManager::FormatTime(const TimeFormat &rFormat, char *pBuf, size_t size, bool utc)
+{
+    int64_t us  = GetUtcMicros();
+    int64_t sec = TimeMath::FloorDiv(us, PrecisionClock::USECS_PER_SEC);
+    uint32_t ms = (uint32_t)((us - sec * PrecisionClock::USECS_PER_SEC) / 1000);
+
+    tm t;
+    if (utc)
+    {
+        TimeMath::SecsToTm(sec, &t);
+        return rFormat.Format(pBuf, size, &t, ms, 0, "UTC");
+    }
+    UtcToLocal((time_t)sec, &t);
+    Rcu<Zone>::ReadGuard zone(m_Zone);
+    bool isDst = t.tm_isdst > 0;
+    return rFormat.Format(pBuf, size, &t, ms,
+                          isDst ? zone->GetDstOffset() : zone->GetStdOffset(),
+                          isDst ? zone->GetDstAbbrev() : zone->GetStdAbbrev());
+} // End FormatTime().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// PrintDateTime
+//
+// Format and print a UNIX broken-down tm time value.
+//
+// Arguments:
+//   pTime - Pointer to the tm time structure containing the time to be
+//           displayed.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::PrintDateTime(tm *pTime)
+{
+    const int MAX_TIME_STRING = 64;
+    char buf[MAX_TIME_STRING];
+
+    // Get the time string and print it.
+    GetDateTimeString(buf, MAX_TIME_STRING, pTime);
+    Serial.println(buf);
+} // End PrintDateTime().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetLocalTimezoneString()
+//
+// Returns a pointer to the abbreviation of the timezone currently in effect
+// (e.g. "EST" or "EDT"), from the settings being edited.  Meant for the task
+// that makes changes.
+//
+/////////////////////////////////////////////////////////////////////////////
+const char *WiFiTimeManager::GetLocalTimezoneString()
+{
+    tm localTime;
+    GetLocalTime(&localTime);
+    return localTime.tm_isdst > 0 ? GetDstAbbrev() : GetTzAbbrev();
+} // End GetLocalTimezoneString().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetLocalTimezoneString()
+//
+// Copies the abbreviation of the timezone currently in effect (e.g. "EST"
+// or "EDT") into the caller's buffer.  The abbreviation comes from the zone
+// in effect, so it always agrees with GetLocalTime().
+//
+// Arguments:
+//   pBuf - Pointer to the buffer that receives the abbreviation.
+//   size - The size, in bytes, of the buffer pointed to by pBuf.
+//
+// Returns:
+//   Returns pBuf.
+//
+/////////////////////////////////////////////////////////////////////////////
+char *WiFiTimeManager::GetLocalTimezoneString(char *pBuf, size_t size)
+{
+    tm localTime;
+    GetLocalTime(&localTime);
+    Rcu<Zone>::ReadGuard zone(m_Zone);
+    return CopyString(pBuf, size, localTime.tm_isdst > 0 ? zone->GetDstAbbrev() :
+                                                           zone->GetStdAbbrev());
+} // End GetLocalTimezoneString().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WTMPrint()
+//
+// Print the specified data if the selected level matches the m_PrintLevel
+// that was set via SetPrintLevel().  Note that this method is overloaded
+// to work with NULL terminated strings, and String objects.  Once Init()
+// has started the log task, the message is queued for it rather than
+// written to Serial by the caller.  Formatted messages longer than
+// LOG_LINE_SIZE are truncated.
+//
+// Arguments:
+//   level - The bit pattern of the types of data that may be printed.
+//   fmt   - The printf() style format string.
+//   ...   - Arguments to the fmt string.
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::WTMPrint(uint32_t level, const char *fmt...) const
+{
+#if WTM_LOG_LEVEL > 0
+    if (m_PrintLevel & level)
+    {
+        // Format the message.  Long messages are truncated.
+        char line[LOG_LINE_SIZE];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(line, sizeof(line), fmt, args);
+        va_end(args);
+        len = len < 0 ? 0 : len < (int)sizeof(line) ? len : (int)sizeof(line) - 1;
+
+        // Print the message, prepended with our ID.
+        if (!m_Log.Write("[WTM] ", line, len))
+        {
+            Serial.print("[WTM] ");
+            Serial.write((const uint8_t *)line, len);
+        }
+    }
+#endif
+} // End WTMPrint().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WTMPrint()
+//
+// Print the specified data if the selected level matches the m_PrintLevel
+// that was set via SetPrintLevel().  Note that this method is overloaded
+// to work with NULL terminated strings, and String objects.
+//
+// Arguments:
+//   level - The bit pattern of the types of data that may be printed.
+//   str   - String instance to print.
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::WTMPrint(uint32_t level, const String &str) const
+{
+#if WTM_LOG_LEVEL > 0
+    if ((m_PrintLevel & level) && !m_Log.Write("[WTM] ", str.c_str(), str.length()))
+    {
+        // Print the message, prepended with our ID.
+        Serial.print("[WTM] ");
+        Serial.print(str);
+    }
+#endif
+} // End WTMPrint().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// UtcSetCallback()
+//
+// This static method is called when UTC time is received from NTP.  The
+// time is offered to the arbiter, and only if it is accepted does it set
+// the clock, the system clock, and the user device (via the user's
+// callback, if any).  Otherwise the system clock, which the SNTP library
+// has already stepped, is put back.
+//
+// Arguments:
+//   pTvt -  Pointer to the timeval struct containing the UTC time in seconds
+//           since January 1, 1970 in its tv_sec member.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::UtcSetCallback(timeval *pTv)
+{
+    // Since we're a static method, point to our singleton instance.
+    WiFiTimeManager *pWtm = WiFiTimeManager::Instance();
 
-    // Remember if we are not getting NTP time.
-    if (updateTimedOut)
+    int64_t utcUs = (int64_t)pTv->tv_sec * PrecisionClock::USECS_PER_SEC + pTv->tv_usec;
+    int64_t monoUs = esp_timer_get_time();
+    int64_t offsetUs = utcUs - pWtm->m_PrecisionClock.GetUtcMicros(monoUs);
+
+    // Syncs from our NTP probe know their error.  Those from the SNTP
+    // library don't.
+    uint32_t syncErrUs = pWtm->m_SyncErrUs.exchange(SNTP_SYNC_ERR_US);
+
+    // While locked to a PPS signal, NTP only checks that the seconds are
+    // labelled right, since it is far less accurate than the PPS.
+    bool ppsHeld = pWtm->m_Pps.IsLocked() &&
+                   (offsetUs < PrecisionClock::USECS_PER_SEC / 2) &&
+                   (offsetUs > -PrecisionClock::USECS_PER_SEC / 2);
+#if WTM_ENABLE_METRICS
+    // The previous sync is read in the same critical section that records
+    // this one, so that other tasks never see half of an update.
+    uint32_t millisNow = millis();
+    portENTER_CRITICAL(&pWtm->m_MetricsMux);
+    WtmMetrics &rMetrics = pWtm->m_Metrics;
+    rMetrics.m_LastOffsetUs = offsetUs;
+    rMetrics.m_SyncOffsetUs.Add(offsetUs < 0 ? (uint32_t)-offsetUs : (uint32_t)offsetUs);
+    if (rMetrics.m_Syncs != 0)
+    {
+        rMetrics.m_SyncIntervalSec.Add((millisNow - rMetrics.m_LastSyncMs) / 1000);
+    }
+    rMetrics.m_LastSyncMs = millisNow;
+    rMetrics.m_Syncs++;
+    portEXIT_CRITICAL(&pWtm->m_MetricsMux);
+#endif
+
+    // Correct the precision clock if NTP is the better time, or the clock
+    // must be wrong.  If the PPS edges were labelled with the wrong seconds,
+    // start them over.  Otherwise, undo the SNTP library's step of the
+    // system clock.
+    bool accepted = !ppsHeld &&
+                    pWtm->m_Arbiter.Offer(tqNetwork, monoUs, syncErrUs, offsetUs);
+    if (accepted)
+    {
+        // Remember that we've successfully received NTP time.
+        pWtm->m_UsingNetworkTime = true;
+        pWtm->m_TimeQuality = tqNetwork;
+        settimeofday(pTv, NULL);
+        pWtm->m_PrecisionClock.Sync(utcUs, monoUs, true);
+        pWtm->m_Alarms.Rearm();
+        SaveRtcCheckpoint(pTv->tv_sec);
+        if (pWtm->m_Pps.IsLocked())
+        {
+            pWtm->m_Pps.Reset();
+        }
+    }
+    else
+    {
+        pWtm->SteerSystemClock();
+    }
+
+    // Track the drift, and adapt the NTP rate to it if asked to.
+    pWtm->m_Drift.AddSample(utcUs, monoUs, syncErrUs);
+    pWtm->m_Arbiter.SetLocalDriftPpm(pWtm->m_Drift.GetWorstPpm());
+    if (pWtm->m_NtpTargetErrUs != 0)
+    {
+        pWtm->m_NtpRateMs = 1000 * pWtm->m_Drift.GetIntervalSec(pWtm->m_NtpTargetErrUs,
+                                                                pWtm->m_MinNtpRateMs / 1000,
+                                                                MAX_ADAPTIVE_NTP_SEC);
+        pWtm->ApplyNtpRate();
+    }
+
+    // If a callback was specified, then call it to update user hardware.
+    // In service task mode, the service task calls it rather than the SNTP
+    // task.  The RTC backend rewrites the RTC if it is off by more than
+    // RtcClock::MAX_ERR_US.  Other devices are set to the whole second.
+    if (accepted && *UtcSetGuard(pWtm->m_pUtcSetCallback))
+    {
+        pWtm->m_Arbiter.Calibrate(tqUserDevice, monoUs, syncErrUs +
+                                  (pWtm->m_pRtcBackend != NULL ? (uint32_t)RtcClock::MAX_ERR_US
+                                                               : UTC_DEVICE_READ_ERR_US));
+        if (pWtm->m_ServiceTask != NULL)
+        {
+            pWtm->SendServiceMsg(scSetRtc, pTv->tv_sec, 0);
+        }
+        else
+        {
+            pWtm->SetUtcDevice(pTv->tv_sec);
+        }
+    }
+
+    // Remember when we got updated for later use.  Any backoff is over.
+    pWtm->m_LastUpdateMs = millis();
+    pWtm->m_NtpPending   = false;
+    pWtm->m_NtpFailures  = 0;
+} // End UtcSetCallback().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetUtcDevice()
+//
+// Calls the UTC set callback, if there is one.  The callback may be changed
+// by another task at any time, so it is read just once.
+//
+// Arguments:
+//   utc - The UTC time to be set.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SetUtcDevice(time_t utc)
+{
+    UtcSetGuard func(m_pUtcSetCallback);
+    if (*func)
+    {
+        (*func)(utc);
+    }
+} // End SetUtcDevice().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetMinNtpRateSec()
+//
+// Sets the minimum time, in seconds, between NTP updates.  Enforces a minimum
+// value of MIN_NTP_UPDATE_MS.
+//
+// Arguments:
+//    rate - The minimum time, in seconds, between NTP updates.  Will be
+//           limited to a value no less than MIN_NTP_UPDATE_MS.
+//
+// Returns:
+//   Returns an indication of true if successful, or false on failure.
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::SetMinNtpRateSec(uint32_t rate)
+{
+    // Limit the frequency of NTP updates.
+    m_MinNtpRateMs = max(rate * 1000, MIN_NTP_UPDATE_MS);
+
+    // Set the new NTP rate.  In adaptive mode it may be slower.
+    m_NtpRateMs = (m_NtpTargetErrUs != 0) ? max(m_NtpRateMs, m_MinNtpRateMs) : m_MinNtpRateMs;
+    ApplyNtpRate();
+
+    // Return an indication of success of failure.
+    return sntp_restart();
+} // End SetMinNtpRateSec().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetNtpTargetErrorMs()
+//
+// Selects adaptive NTP polling.  The drift of the local oscillator is
+// estimated from successive NTP syncs, and after each sync the NTP poll
+// interval is set to the time it takes the clock to drift by the target
+// error.  The interval is never shorter than the minimum NTP rate (see
+// SetMinNtpRateSec()), and never longer than MAX_ADAPTIVE_NTP_SEC.  Until
+// the drift is known, a conservative estimate is used, so the interval
+// starts short and stretches as syncs come in.
+//
+// Arguments:
+//    targetMs - The error, in milliseconds, to be held.  0 selects fixed
+//               polling at the minimum NTP rate, which is the default.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SetNtpTargetErrorMs(uint32_t targetMs)
+{
+    // Multiply in 64 bits, since a target over about 71 minutes doesn't fit
+    // in 32 bits of microseconds.  Any target that large already gives the
+    // longest interval, so it is simply held at the most that fits.
+    uint64_t targetUs = (uint64_t)targetMs * 1000;
+    m_NtpTargetErrUs = targetUs > UINT32_MAX ? UINT32_MAX : (uint32_t)targetUs;
+    m_NtpRateMs = (m_NtpTargetErrUs == 0) ? m_MinNtpRateMs :
+                  1000 * m_Drift.GetIntervalSec(m_NtpTargetErrUs, m_MinNtpRateMs / 1000,
+                                                MAX_ADAPTIVE_NTP_SEC);
+    ApplyNtpRate();
+} // End SetNtpTargetErrorMs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SetNtpJitter()
+//
+// Spreads out the NTP traffic of devices that start together (e.g. after
+// a power cut).  Each device waits a start delay of its own after the
+// network connects before it sends its first NTP request, and stretches
+// its poll interval by an amount of its own, so that devices that start
+// together drift apart.  Both are derived from the device's MAC address,
+// so they stay the same from boot to boot.  While syncs fail, the wait
+// between sync attempts doubles, from 15 seconds up to
+// MAX_NTP_BACKOFF_SEC, stretched by the same amount.
+//
+// Arguments:
+//    startMs - The longest start delay, in milliseconds, up to
+//              MAX_NTP_START_JITTER_MS.  0 sends the first request right
+//              away.  Defaults to DFLT_NTP_START_JITTER_MS.
+//    pollPct - The most that the poll interval is stretched, in percent,
+//              up to MAX_NTP_POLL_JITTER_PCT.  The interval is never
+//              shortened.  Defaults to DFLT_NTP_POLL_JITTER_PCT.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SetNtpJitter(uint32_t startMs, uint32_t pollPct)
+{
+    m_NtpStartJitterMs = min(startMs, (uint32_t)MAX_NTP_START_JITTER_MS);
+    m_NtpPollJitterPct = min(pollPct, (uint32_t)MAX_NTP_POLL_JITTER_PCT);
+    ApplyNtpRate();
+} // End SetNtpJitter().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// NtpBackoffMs()
+//
+// Returns how long to wait after an NTP sync attempt that hasn't been
+// answered before making another.  Doubles with each failure.
+//
+/////////////////////////////////////////////////////////////////////////////
+uint32_t WiFiTimeManager::NtpBackoffMs() const
+{
+    uint32_t failures = min(m_NtpFailures.load(), (uint32_t)16);
+    uint64_t backoffMs = (uint64_t)MIN_NTP_UPDATE_MS << failures;
+    return Jitter((uint32_t)min(backoffMs, (uint64_t)MAX_NTP_BACKOFF_SEC * 1000));
+} // End NtpBackoffMs().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// autoConnect()
+//
+// Overrides the WiFiManager autoConnect() method in order to return the
+// status of the WiFi connection.  Automatically connects to the saved WiFi
+// network, or starts the config portal on failure.
+//
+// This method is overloaded.  The version with no arguments uses the
+// AP name and password values that were passed to Init().  The other version
+// uses the specified access point name and password, but should not normally
+// be used.
+//
+// Arguments:
+//   pApName     - Pointer to a NULL terminated string representing the name
+//                 to be used for the access point.  This argument is optional.
+//                 If not present, then the value passed to Init() is used.
+//   pApPassword - Pointer to to a NULL terminated string representing the
+//                 password to be used by the access point.  This argument
+//                 is optional.  If not present, then the value passed to
+//                 Init() is used.  If a password is used, it should be
+//                 8 to 63 characters.
+//
+// Returns:
+//    Returns 'true' if the network was successfully connected.  Returns
+//    'false' otherwise.
+//
+/////////////////////////////////////////////////////////////////////////////
+boolean WiFiTimeManager::autoConnect()
+{
+    return autoConnect(m_pApName, m_pApPassword);
+} // End autoConnect().
+
+boolean WiFiTimeManager::autoConnect(char const *pApName, char const *pApPassword)
+{
+    // In service task mode, have the service task do the connecting.  Wait for
+    // it if we are in blocking mode.
+    if (DeferToServiceTask())
+    {
+        m_pApName = pApName;
+        m_pApPassword = pApPassword;
+        m_ConnectPending = true;
+        if (!SendServiceMsg(scConnect, 0, portMAX_DELAY))
+        {
+            m_ConnectPending = false;
+        }
+        while (m_PortalBlocking && !IsConnected() &&
+               (m_ConnectPending || getConfigPortalActive() || (m_ConnState != csOffline)))
+        {
+            vTaskDelay(pdMS_TO_TICKS(SERVICE_POLL_MS));
+        }
+        return IsConnected();
+    }
+    return ConnectNow(pApName, pApPassword);
+} // End autoConnect().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ConnectNow()
+//
+// Does the work of autoConnect() in the calling task.  In service task mode
+// the config portal never blocks (see Init()).
+//
+/////////////////////////////////////////////////////////////////////////////
+bool WiFiTimeManager::ConnectNow(char const *pApName, char const *pApPassword)
+{
+    // Any events that come in while the WiFiManager connects are handled here.
+    bool connected = WiFiManager::autoConnect(pApName, pApPassword);
+    m_WiFiEvents.store(0, std::memory_order_release);
+    if (connected)
+    {
+        // Init SNTP and current time.  None of the steps wait, so simply run
+        // them all now.
+        StartNewConnection();
+        while (StepConnection())
+        {
+        }
+    }
+    else
+    {
+        m_ConnState = csOffline;
+    }
+    return IsConnected();
+} // End ConnectNow().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// InitSntpTime()
+//
+// Initializes the SNTP code with NTP address, update rate, and our sync
+// callback.  Does not wait for a sync.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::InitSntpTime()
+{
+    // Setup our callback for NTP updates.  We call any user specified handler
+    // from within our callback.
+    sntp_set_time_sync_notification_cb(UtcSetCallback);
+
+    // Init our update rate.
+    ApplyNtpRate();
+
+    // Handing over the servers starts the SNTP library polling, so wait out
+    // our start delay first (see StartDelayedSntp()).
+    uint32_t delayMs = GetNtpStartDelayMs();
+    if ((delayMs != 0) && (m_NtpStartTimer != NULL))
+    {
+        sntp_stop();
+        m_NtpStartPending = true;
+        esp_timer_stop(m_NtpStartTimer);
+        esp_timer_start_once(m_NtpStartTimer, (uint64_t)delayMs * 1000);
+        return;
+    }
+    StartSntp();
+} // End InitSntpTime().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// StartSntp()
+//
+// Hands our NTP servers to the SNTP library, which starts it polling.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::StartSntp()
+{
+    ConfigSntpServers();
+    sntp_restart();
+} // End StartSntp().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// StartDelayedSntp()
+//
+// Starts SNTP, and asks for a sync, once this device's start delay is up.
+// Called from the esp_timer task by m_NtpStartTimer, whether or not
+// process() is being called.
+//
+// Arguments:
+//   pArg - Pointer to our instance.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::StartDelayedSntp(void *pArg)
+{
+    WiFiTimeManager *pWtm = static_cast<WiFiTimeManager *>(pArg);
+    if (pWtm->m_NtpStartPending.exchange(false))
+    {
+        pWtm->StartSntp();
+        pWtm->ForceSntpSync();
+    }
+} // End StartDelayedSntp().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ForceSntpSync()
+//
+// Asks for an NTP sync as soon as possible.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::ForceSntpSync()
+{
+    // Force an NTP sync only if we are currently conntcted, and not waiting
+    // out our start delay or a backoff.
+    if ((WiFi.status() != WL_CONNECTED) || !NtpRetryDue())
+    {
+        return;
+    }
+
+    // An attempt that is still unanswered failed, so the next wait is longer.
+    if (m_NtpPending.exchange(true))
+    {
+        m_NtpFailures++;
+        WTM_LOG_WARN(this, "NTP sync failed %u times.  Backing off %u ms.\n",
+                     m_NtpFailures.load(), NtpBackoffMs());
+    }
+    m_NtpAttemptMs = millis();
+    WTM_METRIC(this, m_ForcedSyncs++);
+
+    // Query all of the servers at once if we can.  Otherwise, leave it to
+    // the SNTP library.
+    if (!StartNtpProbe())
+    {
+        // This is necessary since without it, the nextNTP  sync is often far into
+        // the future.  We do this by getting the current time, and passing it
+        // to sntp_sync_time() which will force an NTP sync message to be sent.
+        // Use the real microseconds so that the clock is not disturbed.
+        timeval tv;
+        gettimeofday(&tv, NULL);
+        sntp_sync_time(&tv);
+    }
+} // End ForceSntpSync().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// WarmStart()
+//
+// Starts the clock from the best cached time available.  See
+// TimeQuality_t.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::WarmStart()
+{
+    const time_t UTC_2023_START = 1672531200;
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t monoUs = esp_timer_get_time();
+
+    if ((s_RtcCheckpoint.m_Magic == RTC_CHECKPOINT_MAGIC) &&
+        (s_RtcCheckpoint.m_Check == s_RtcCheckpoint.Compute()) &&
+        (tv.tv_sec >= s_RtcCheckpoint.m_UtcSec))
+    {
+        // The system clock kept running since a good sync.  Keep it.  After
+        // a deep sleep, the drift estimate knows its error.  Otherwise, the
+        // checkpoint doesn't say how good the sync was, so allow a second,
+        // growing at the local drift since then.
+        WTM_LOG_INFO(this, "Warm start from running clock.\n");
+        m_TimeQuality = tqCached;
+        if (m_Drift.IsErrorKnown())
+        {
+            m_Arbiter.Set(tqCached, monoUs, m_Drift.GetExpectedErrorUs(monoUs));
+        }
+        else
+        {
+            m_Arbiter.Set(tqCached,
+                          monoUs - (tv.tv_sec - s_RtcCheckpoint.m_UtcSec) * PrecisionClock::USECS_PER_SEC,
+                          2 * UTC_DEVICE_READ_ERR_US);
+        }
+    }
+    else
+    {
+        // Start from the NVS checkpoint if there is one, or the start of 2023
+        // otherwise.
+        int64_t nvsUtc = 0;
+        if (m_CheckpointMs != 0)
+        {
+            Preferences prefs;
+            prefs.begin(m_pName, true);
+            nvsUtc = prefs.getLong64(pPrefCheckpointLabel, 0);
+            prefs.end();
+        }
+        m_TimeQuality = (nvsUtc > UTC_2023_START) ? tqEstimated : tqNone;
+        m_Arbiter.Set(m_TimeQuality, monoUs, TimeSourceArbiter::UNKNOWN_ERR_US);
+        tv.tv_sec  = (nvsUtc > UTC_2023_START) ? (time_t)nvsUtc : UTC_2023_START;
+        tv.tv_usec = 0;
+        settimeofday(&tv, NULL);
+        WTM_LOG_INFO(this, "Cold start from %s.\n",
+                 m_TimeQuality == tqEstimated ? "NVS checkpoint" : "default time");
+    }
+    m_PrecisionClock.Sync((int64_t)tv.tv_sec * PrecisionClock::USECS_PER_SEC + tv.tv_usec,
+                          false);
+    m_Alarms.Rearm();
+} // End WarmStart().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SaveRtcCheckpoint()
+//
+// Remembers the time of a good sync in RTC memory.
+//
+// Arguments:
+//   utc - The UTC time of the sync.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SaveRtcCheckpoint(time_t utc)
+{
+    s_RtcCheckpoint.m_Magic  = RTC_CHECKPOINT_MAGIC;
+    s_RtcCheckpoint.m_UtcSec = utc;
+    s_RtcCheckpoint.m_Check  = s_RtcCheckpoint.Compute();
+} // End SaveRtcCheckpoint().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ClockTimeT()
+//
+// Returns the precision clock's UTC time in whole seconds.
+/////////////////////////////////////////////////////////////////////////////
+time_t WiFiTimeManager::ClockTimeT() const
+{
+    return (time_t)TimeMath::FloorDiv(m_PrecisionClock.GetUtcMicros(),
+                                      PrecisionClock::USECS_PER_SEC);
+} // End ClockTimeT().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// SteerSystemClock()
+//
+// Sets the system clock, as used by time() and the SNTP library, to the
+// precision clock if they differ by more than SYSTEM_CLOCK_TOL_US.  The
+// precision clock is the one that PPS edges and arbitrated syncs correct,
+// so without this, time() would drift away from it between NTP updates.
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::SteerSystemClock()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t sysUs   = (int64_t)tv.tv_sec * PrecisionClock::USECS_PER_SEC + tv.tv_usec;
+    int64_t clockUs = m_PrecisionClock.GetUtcMicros();
+    int64_t deltaUs = clockUs - sysUs;
+    if ((deltaUs <= SYSTEM_CLOCK_TOL_US) && (deltaUs >= -SYSTEM_CLOCK_TOL_US))
+    {
+        return;
+    }
+
+    int64_t sec = TimeMath::FloorDiv(clockUs, PrecisionClock::USECS_PER_SEC);
+    tv.tv_sec  = (time_t)sec;
+    tv.tv_usec = (suseconds_t)(clockUs - sec * PrecisionClock::USECS_PER_SEC);
+    settimeofday(&tv, NULL);
+} // End SteerSystemClock().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// PrepareForSleep()
+//
+// Keeps our state in RTC memory for the next wake from deep sleep.
+// This includes all timezone and NTP data, the drift estimate, and the
+// expected error of the clock.  On wake, Init() takes them from there
+// instead of NVS, and the clock carries on without WiFi.  Any scheduled
+// save is done first.  Called by SleepUntilUtc() and SleepUntilLocal(),
+// or may be called just before the application starts the deep sleep
+// itself.  Alarms do not survive the sleep.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::PrepareForSleep()
+{
+    if (m_SavePending && !Save())
     {
-        m_UsingNetworkTime = false;
+        WTM_LOG_WARN(this, "Save before sleep failed.\n");
     }
 
-    return timeNow;
-} // End GetUtcTimeT().
+    s_SleepRecord.m_Magic         = SLEEP_RECORD_MAGIC;
+    memcpy(s_SleepRecord.m_Params, &m_Params, sizeof(m_Params));
+    s_SleepRecord.m_SavedCrc      = m_SavedCrc;
+    s_SleepRecord.m_SavedCrcValid = m_SavedCrcValid;
+    s_SleepRecord.m_ErrorKnown    = m_Drift.IsErrorKnown();
+    m_Drift.GetState(&s_SleepRecord.m_Drift);
+    s_SleepRecord.m_ErrUs         = GetExpectedErrorUs();
+    s_SleepRecord.m_UtcSec        = GetUtcTimeT();
+    s_SleepRecord.m_Check         = s_SleepRecord.Compute();
+} // End PrepareForSleep().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetUtcTime()
+// SleepUntilUtc()
 //
-// This method returns UTC broken-down time.  It uses GetUtcTimeT() to
-// fetch the UTC time.
+// Enters deep sleep until the specified UTC time.  The wake time is as
+// good as the clock during the sleep.  See SetSleepDriftPpm().
 //
 // Arguments:
-//   pTm - A pointer to the tm structure into which the UTC time will be
-//         saved.
+//   utc - The UTC time at which to wake.
 //
 // Returns:
-//   Always returns the value passed in as pTm.
+//   Does not return if successful.  Returns false if the time has
+//   already passed.
 //
 /////////////////////////////////////////////////////////////////////////////
-tm *WiFiTimeManager::GetUtcTime(tm *pTm)
+bool WiFiTimeManager::SleepUntilUtc(time_t utc)
 {
-    time_t utc = GetUtcTimeT();
-    return gmtime_r(&utc, pTm);
-} // End GetUtcTime().
+    int64_t sleepUs = (int64_t)utc * PrecisionClock::USECS_PER_SEC -
+                      m_PrecisionClock.GetUtcMicros();
+    if (sleepUs <= 0)
+    {
+        return false;
+    }
+
+    WTM_LOG_INFO(this, "Sleeping for %lld seconds.\n",
+                 (long long)(sleepUs / PrecisionClock::USECS_PER_SEC));
+    PrepareForSleep();
+    esp_sleep_enable_timer_wakeup((uint64_t)sleepUs);
+    esp_deep_sleep_start();
+    return true;
+} // End SleepUntilUtc().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetLocalTime()
+// IsResyncNeeded()
 //
-// Returns the best known value for local time.  Converts the best known
-// UTC time to the broken-down local time and returns its pointer.
-// See GetUtcTimeT().
+// Decides whether the clock needs a network sync to be within the
+// specified error.  Typically called after Init() on a wake from deep
+// sleep, to skip connecting to WiFi when the clock is still good enough.
+// The expected error is the error of the last NTP sync plus the drift
+// since then, both awake and asleep.  See GetExpectedErrorUs().
 //
 // Arguments:
-//   pTm - A pointer to the tm structure into which the local time data will
-//         be returned.
+//   maxErrMs - The largest acceptable error in milliseconds.
 //
 // Returns:
-//   Returns the best known value for the current local time in the
-//   structure pointed to by pTm.  Also returns pTm.
+//   Returns true if the clock has never been set by NTP (since the last
+//   power up), or its expected error exceeds maxErrMs.  Returns false
+//   otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
-tm *WiFiTimeManager::GetLocalTime(tm *pTm)
+bool WiFiTimeManager::IsResyncNeeded(uint32_t maxErrMs) const
 {
-    time_t utc = GetUtcTimeT();
-    return localtime_r(&utc, pTm);
-} // End GetLocalTime();
+    return !m_Pps.IsLocked() &&
+           ((m_TimeQuality < tqCached) || !m_Drift.IsErrorKnown() ||
+            ((uint64_t)GetExpectedErrorUs() > (uint64_t)maxErrMs * 1000));
+} // End IsResyncNeeded().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetDateTimeString
+// GetTimeSource()
 //
-// Format and print a unix time_t value.  Uses strftime() to do the conversion.
-// See https://linux.die.net/man/3/strftime for information on formatting the
-// date time string using strftime().
+// Returns the source that last set the clock, and a bound on the clock's
+// error right now.  Each source's error grows with the time since it was
+// last set and with its drift, and the clock is only set from a source
+// whose error is lower than the clock's own.  See TimeSourceArbiter.h.
 //
 // Arguments:
-//   pBuf  - Pointer to a buffer that will receive the time string.  Must be at
-//           least 64 characters long to receive the full string.  If the buffer
-//           is shorter than 64 characters, the time string will be truncated.
-//   size  - The size, in bytes, of the buffer pointed to by pBuf.
-//   pTime - Pointer to the tm time structure containing the time to be
-//           converted.
+//   pStatus - Pointer to where the status is returned.
+//
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::GetTimeSource(TimeSourceStatus *pStatus) const
+{
+    int64_t monoUs = esp_timer_get_time();
+    int64_t ageUs  = monoUs - m_Arbiter.GetSetMonoUs();
+    pStatus->m_Source  = (TimeQuality_t)m_Arbiter.GetSource();
+    pStatus->m_ErrorUs = m_Arbiter.GetErrorUs(monoUs);
+    pStatus->m_AgeSec  = ageUs > 0 ? (uint32_t)(ageUs / PrecisionClock::USECS_PER_SEC) : 0;
+} // End GetTimeSource().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// RestoreSleepState()
+//
+// Restores the state kept by PrepareForSleep() on a wake from deep
+// sleep.  The record is used only once.  The system clock kept running
+// through the sleep, so only its expected error needs to grow by the
+// sleep drift.
 //
 // Returns:
-//   Always returns the number of characters in the time string minus the
-//   terminating NULL.
+//    Returns 'true' if successful, or 'false' otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
-int WiFiTimeManager::GetDateTimeString(char *pBuf, int size, tm *pTime)
+bool WiFiTimeManager::RestoreSleepState()
 {
-    return strftime(pBuf, size, "%A, %B %d %Y %r %Z Day of Year: %j", pTime);
-} // End GetDateTimeString().
+    uint32_t version = 0;
+    memcpy(&version, s_SleepRecord.m_Params, sizeof(version));
+    bool valid = (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED) &&
+                 (s_SleepRecord.m_Magic == SLEEP_RECORD_MAGIC) &&
+                 (s_SleepRecord.m_Check == s_SleepRecord.Compute()) &&
+                 (version == TP_VERSION);
+    s_SleepRecord.m_Magic = 0;
+    if (!valid)
+    {
+        return false;
+    }
+
+    // A fixed zone was set at compile time, so it keeps its own parameters.
+    if (!IsFixedZone())
+    {
+        memcpy(&m_Params, s_SleepRecord.m_Params, sizeof(m_Params));
+        m_SavedCrc      = s_SleepRecord.m_SavedCrc;
+        m_SavedCrcValid = s_SleepRecord.m_SavedCrcValid;
+        BuildDstTable();
+    }
+
+    // The error grows by the sleep drift over the time asleep.
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t sleptSec = (int64_t)tv.tv_sec - s_SleepRecord.m_UtcSec;
+    float   errUs    = (float)s_SleepRecord.m_ErrUs +
+                       (float)m_SleepDriftPpm * (float)(sleptSec > 0 ? sleptSec : 0);
+    if (s_SleepRecord.m_ErrorKnown)
+    {
+        m_Drift.Restore(s_SleepRecord.m_Drift, esp_timer_get_time(),
+                        errUs < 4.0e9f ? (uint32_t)errUs : UINT32_MAX);
+    }
+    WTM_LOG_INFO(this, "Restored state after %lld seconds of sleep.\n", (long long)sleptSec);
+    return true;
+} // End RestoreSleepState().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// PrintDateTime
+// CheckpointTime()
 //
-// Format and print a UNIX broken-down tm time value.
+// Saves the current UTC time to NVS if good time is in use and it has
+// been a while since the last NVS checkpoint.  Only called from process()
+// (or the service task), so that reading the time never writes flash.
 //
-// Arguments:
-//   pTime - Pointer to the tm time structure containing the time to be
-//           displayed.
+// Returns:
+//   Returns true if the time was written to NVS, or false otherwise.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::PrintDateTime(tm *pTime)
+bool WiFiTimeManager::CheckpointTime()
 {
-    const int MAX_TIME_STRING = 64;
-    char buf[MAX_TIME_STRING];
+    uint32_t millisNow = millis();
+    if ((m_CheckpointMs == 0) || (m_TimeQuality < tqUserDevice) ||
+        (m_Checkpointed && (millisNow - m_LastCheckpointMs < m_CheckpointMs)))
+    {
+        return false;
+    }
 
-    // Get the time string and print it.
-    GetDateTimeString(buf, MAX_TIME_STRING, pTime);
-    Serial.println(buf);
-} // End PrintDateTime().
+    m_Checkpointed = true;
+    m_LastCheckpointMs = millisNow;
+    time_t timeNow = ClockTimeT();
+    Preferences prefs;
+    prefs.begin(m_pName);
+    prefs.putLong64(pPrefCheckpointLabel, (int64_t)timeNow);
+    prefs.end();
+    WTM_LOG_DEBUG(this, "Checkpointed time %ld.\n", (long)timeNow);
+    return true;
+} // End CheckpointTime().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// GetLocalTimezoneString()
+// ConfigSntpServers()
 //
-// Returns a pointer to the currently active timezone string, or NULL on error.
-// (e.g. "EST").
+// Hands the NTP servers to the SNTP library, best first.
 //
 /////////////////////////////////////////////////////////////////////////////
-const char *WiFiTimeManager::GetLocalTimezoneString()
+void WiFiTimeManager::ConfigSntpServers()
 {
-    tm localTime;
-    GetLocalTime(&localTime);
-    const char *pStr = NULL;
-    if (localTime.tm_isdst)
+    const char *pNames[TimeParameters::MAX_NTP_SERVERS];
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
     {
-        pStr = GetDstAbbrev();
+        pNames[i] = m_Params.m_NtpAddr[i];
     }
-    else
+
+    // The SNTP library fails over from one server to the next, and takes at
+    // most three of them.  Rank them so that a failing server is tried last.
+    size_t order[TimeParameters::MAX_NTP_SERVERS];
+    size_t count = m_NtpProbe.GetRanking(pNames, TimeParameters::MAX_NTP_SERVERS, order);
+    const char *pSntp[3] = { NULL, NULL, NULL };
+    for (size_t i = 0; (i < count) && (i < 3); i++)
     {
-        pStr = GetTzAbbrev();
+        pSntp[i] = pNames[order[i]];
     }
-    return pStr;
-} // End GetLocalTimezoneString().
+    configTime(0, 0, pSntp[0] != NULL ? pSntp[0] : DFLT_NTP_ADDR, pSntp[1], pSntp[2]);
+
+    // Remember what we handed over, so that unchanged servers aren't handed
+    // over again.
+    memcpy(m_AppliedNtp, m_Params.m_NtpAddr, sizeof(m_AppliedNtp));
+    m_NtpApplied = true;
+} // End ConfigSntpServers().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// WTMPrint()
+// ValidateParams()
 //
-// Print the specified data if the selected level matches the m_PrintLevel
-// that was set via SetPrintLevel().  Note that this method is overloaded
-// to work with NULL terminated strings, and String objects.
+// Checks our timezone and NTP data for values that the setters can't
+// catch by themselves.
+//
+// Returns:
+//   Returns true if the data is usable, or false otherwise.
 //
-// Arguments:
-//   level - The bit pattern of the types of data that may be printed.
-//   fmt   - The printf() style format string.
-//   ...   - Arguments to the fmt string.
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::WTMPrint(uint32_t level, const char *fmt...) const
+bool WiFiTimeManager::ValidateParams() const
 {
-    if (m_PrintLevel & level)
+    // POSIX TZ abbreviations need at least three characters.  The DST one
+    // only matters if DST is used.
+    if ((m_Params.m_TzOfst < TZ_OFST_MIN) || (m_Params.m_TzOfst > TZ_OFST_MAX) ||
+        (strlen(m_Params.m_DstEndRule.abbrev) < 3) ||
+        (m_Params.m_UseDst && (strlen(m_Params.m_DstStartRule.abbrev) < 3)))
     {
-        // Set up our variable argument list.
-        va_list args;
-        va_start(args, fmt);
+        return false;
+    }
 
-        // Print the message, prepended with our ID.
-        Serial.print("[WTM] ");
-        Serial.printf(fmt, args);
+    // The SNTP library needs at least one server.
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
+    {
+        if (m_Params.m_NtpAddr[i][0] != '\0')
+        {
+            return true;
+        }
     }
-} // End WTMPrint().
+    return false;
+} // End ValidateParams().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// WTMPrint()
-//
-// Print the specified data if the selected level matches the m_PrintLevel
-// that was set via SetPrintLevel().  Note that this method is overloaded
-// to work with NULL terminated strings, and String objects.
+// NtpServersChanged()
 //
-// Arguments:
-//   level - The bit pattern of the types of data that may be printed.
-//   str   - String instance to print.
+// Returns true if our NTP servers differ from those last handed to the
+// SNTP library.
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::WTMPrint(uint32_t level, String &str) const
+bool WiFiTimeManager::NtpServersChanged() const
 {
-    if (m_PrintLevel & level)
+    if (!m_NtpApplied)
     {
-        // Print the message, prepended with our ID.
-        Serial.print("[WTM] ");
-        Serial.print(str);
+        return true;
     }
-} // End WTMPrint().
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
+    {
+        if (strncmp(m_Params.m_NtpAddr[i], m_AppliedNtp[i], TimeParameters::MAX_NTP_ADDR) != 0)
+        {
+            return true;
+        }
+    }
+    return false;
+} // End NtpServersChanged().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// UtcSetCallback()
+// StartNtpProbe()
 //
-// This static method sets UTC time as kept by the Unix time library.
-// It is called when UTC time updated from NTP network time.  If the user
-// has specified a callback, then it is called.
+// Starts a task that queries all of the NTP servers in parallel and sets
+// the clock from the best reply.  See NtpProbe.
 //
-// Arguments:
-//   pTvt -  Pointer to the timeval struct containing the UTC time in seconds
-//           since January 1, 1970 in its tv_sec member.
+// Returns:
+//   Returns true if the probe was started or is already running, or false
+//   if the task could not be created.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::UtcSetCallback(timeval *pTv)
+bool WiFiTimeManager::StartNtpProbe()
 {
-    // Since we're a static method, point to our singleton instance.
-    WiFiTimeManager *pWtm = WiFiTimeManager::Instance();
-
-    // Remember that we've successfully received NTP time.
-    pWtm->m_UsingNetworkTime = true;
-
-    // If a callback was specified, then call it to update user hardware.
-    if (pWtm->m_pUtcSetCallback)
+    // Only one probe at a time.
+    if (m_ProbeRunning.exchange(true))
     {
-        pWtm->m_pUtcSetCallback(pTv->tv_sec);
+        return true;
     }
 
-    // Remember when we got updated for later use.
-    pWtm->m_LastUpdateMs = millis();
-} // End UtcSetCallback().
+    if (xTaskCreatePinnedToCore(NtpProbeTask, "WTM NTP", NTP_PROBE_STACK, this,
+                                NTP_PROBE_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS)
+    {
+        WTM_LOG_WARN(this, "NTP probe task start failed.\n");
+        m_ProbeRunning = false;
+        return false;
+    }
+    return true;
+} // End StartNtpProbe().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// SetMinNtpRateSec()
+// NtpProbeTask()
 //
-// Sets the minimum time, in seconds, between NTP updates.  Enforces a minimum
-// value of MIN_NTP_UPDATE_MS.
+// The body of the task started by StartNtpProbe().  Runs one probe, sets
+// the clock, reorders the SNTP servers, and deletes itself.
 //
 // Arguments:
-//    rate - The minimum time, in seconds, between NTP updates.  Will be
-//           limited to a value no less than MIN_NTP_UPDATE_MS.
-//
-// Returns:
-//   Returns an indication of true if successful, or false on failure.
+//   pArg - Pointer to our instance.
 //
 /////////////////////////////////////////////////////////////////////////////
-bool WiFiTimeManager::SetMinNtpRateSec(uint32_t rate)
+void WiFiTimeManager::NtpProbeTask(void *pArg)
 {
-    // Limit the frequency of NTP updates.
-    m_MinNtpRateMs = max(rate * 1000, MIN_NTP_UPDATE_MS);
+    WiFiTimeManager *pWtm = static_cast<WiFiTimeManager *>(pArg);
+
+    // The servers may be changed while we run, so work from a copy.
+    TimeParameters params;
+    pWtm->GetParams(&params);
+    const char *pNames[TimeParameters::MAX_NTP_SERVERS];
+    for (size_t i = 0; i < TimeParameters::MAX_NTP_SERVERS; i++)
+    {
+        pNames[i] = params.m_NtpAddr[i];
+    }
 
-    // Set the new NTP rate.
-    sntp_set_sync_interval(m_MinNtpRateMs);
+    NtpProbe::Result result;
+    if (pWtm->m_NtpProbe.Run(pNames, TimeParameters::MAX_NTP_SERVERS, &result))
+    {
+        // Handle it just like an SNTP library update, which sets the clock
+        // only if the arbiter accepts it.
+        int64_t utcUs = result.m_UtcUs + (esp_timer_get_time() - result.m_MonoUs);
+        timeval tv = { .tv_sec  = (time_t)(utcUs / PrecisionClock::USECS_PER_SEC),
+                       .tv_usec = (suseconds_t)(utcUs % PrecisionClock::USECS_PER_SEC) };
+        const NtpServerStats *pWinner = pWtm->m_NtpProbe.GetStats(result.m_Server);
+        pWtm->m_SyncErrUs = (uint32_t)pWinner->m_LastDistanceUs;
+        WTM_METRIC(pWtm, m_SyncDelayUs.Add((uint32_t)pWinner->m_LastDelayUs));
+        UtcSetCallback(&tv);
+
+        WTM_LOG_INFO(pWtm, "NTP probe won by %s, delay %d us, distance %d us.\n",
+                       pNames[result.m_Server], pWinner->m_LastDelayUs,
+                       pWinner->m_LastDistanceUs);
+
+        // Let the SNTP library keep up with the best server from now on.
+        pWtm->ConfigSntpServers();
+    }
+    else
+    {
+        WTM_LOG_WARN(pWtm, "NTP probe got no replies.\n");
+    }
 
-    // Return an indication of success of failure.
-    return sntp_restart();
-} // End SetMinNtpRateSec().
+    pWtm->m_ProbeRunning = false;
+    vTaskDelete(NULL);
+} // End NtpProbeTask().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// autoConnect()
-//
-// Overrides the WiFiManager autoConnect() method in order to return the
-// status of the WiFi connection.  Automatically connects to the saved WiFi
-// network, or starts the config portal on failure.
+// SetNtpAddr()
 //
-// This method is overloaded.  The version with no arguments uses the
-// AP name and password values that were passed to Init().  The other version
-// uses the specified access point name and password, but should not normally
-// be used.
+// Sets the address of one of the NTP servers.  The server's statistics are
+// cleared if its address changes.
 //
 // Arguments:
-//   pApName     - Pointer to a NULL terminated string representing the name
-//                 to be used for the access point.  This argument is optional.
-//                 If not present, then the value passed to Init() is used.
-//   pApPassword - Pointer to to a NULL terminated string representing the
-//                 password to be used by the access point.  This argument
-//                 is optional.  If not present, then the value passed to
-//                 Init() is used.  If a password is used, it should be
-//                 8 to 63 characters.
-//
-// Returns:
-//    Returns 'true' if the network was successfully connected.  Returns
-//    'false' otherwise.
+//   i - The index (0 - 3) of the server.
+//   v - The server's address, or an empty string for none.
 //
 /////////////////////////////////////////////////////////////////////////////
-boolean WiFiTimeManager::autoConnect()
+void WiFiTimeManager::SetNtpAddr(size_t i, const char *v)
 {
-    WiFiManager::autoConnect(m_pApName, m_pApPassword);
-    bool connected = IsConnected();
-    if (connected)
+    if ((i >= TimeParameters::MAX_NTP_SERVERS) || (v == NULL))
     {
-        // Init SNTP and current time.
-        StartNewConnection();
+        return;
     }
-    return connected;
-} // End autoConnect().
-
-boolean WiFiTimeManager::autoConnect(char const *pApName, char const *pApPassword)
-{
-    WiFiManager::autoConnect(pApName, pApPassword);
-    bool connected = IsConnected();
-    if (connected)
+    if (strncmp(m_Params.m_NtpAddr[i], v, TimeParameters::MAX_NTP_ADDR - 1) != 0)
     {
-        // Init SNTP and current time.
-        StartNewConnection();
+        CopyString(m_Params.m_NtpAddr[i], sizeof(m_Params.m_NtpAddr[i]), v);
+        m_NtpProbe.ResetStats(i);
     }
-    return connected;
-} // End autoConnect().
+} // End SetNtpAddr().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// InitSntpTime()
+// GetAppliedTzAbbrev(), GetAppliedDstAbbrev(), GetAppliedNtpAddr()
+//
+// Copy one of the string settings in effect into the caller's buffer.  The
+// string is truncated if it doesn't fit.  Safe to call from any task.
+//
+// Arguments:
+//   i    - The NTP server index (0 - 3).
+//   pBuf - Pointer to the buffer that receives the string.
+//   size - The size, in bytes, of the buffer pointed to by pBuf.
 //
-// Initializes the SNTP code with NTP address, update rate, timezone info,
-// and force an NTP sync.
+// Returns:
+//   Returns pBuf.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::InitSntpTime()
+char *WiFiTimeManager::GetAppliedTzAbbrev(char *pBuf, size_t size) const
 {
-    // Init our NTP address.
-    configTime(0, 0, GetNtpAddr());
-
-    tm timeInfo;
-    getLocalTime(&timeInfo);
+    ParamsGuard params(m_AppliedParams);
+    return CopyString(pBuf, size, params->m_DstEndRule.abbrev);
+} // End GetAppliedTzAbbrev().
 
-    // Setup our callback for NTP updates.  We call any user specified handler
-    // from within our callback.
-    sntp_set_time_sync_notification_cb(UtcSetCallback);
+char *WiFiTimeManager::GetAppliedDstAbbrev(char *pBuf, size_t size) const
+{
+    ParamsGuard params(m_AppliedParams);
+    return CopyString(pBuf, size, params->m_DstStartRule.abbrev);
+} // End GetAppliedDstAbbrev().
 
-    // Init our update rate.
-    sntp_set_sync_interval(m_MinNtpRateMs);
-    sntp_restart();
+char *WiFiTimeManager::GetAppliedNtpAddr(size_t i, char *pBuf, size_t size) const
+{
+    ParamsGuard params(m_AppliedParams);
+    return CopyString(pBuf, size,
+                      params->m_NtpAddr[min(i, TimeParameters::MAX_NTP_SERVERS - 1)]);
+} // End GetAppliedNtpAddr().
 
-    // Init our timezone information.
-    const uint32_t MAX_TZ_STR_LEN = 64;
-    char tzBuf[MAX_TZ_STR_LEN];
-    GetTimezoneString(tzBuf, sizeof(tzBuf));
-    setenv("TZ", tzBuf, 1);
-    tzset();
 
-    // Force an NTP sync only if we are currently conntcted.
-    if (IsConnected())
+/////////////////////////////////////////////////////////////////////////////
+// ParamsCrc()
+//
+// Returns the CRC of our timezone and NTP data.  The fields are hashed one
+// by one, so that the padding between them, which struct copies needn't
+// keep, can't change the result.
+/////////////////////////////////////////////////////////////////////////////
+uint32_t WiFiTimeManager::ParamsCrc() const
+{
+    #define CRC_FIELD(f) crc = esp_rom_crc32_le(crc, (const uint8_t *)&(f), sizeof(f))
+    uint32_t crc = 0;
+    CRC_FIELD(m_Params.m_Version);
+    CRC_FIELD(m_Params.m_TzOfst);
+    CRC_FIELD(m_Params.m_UseDst);
+    CRC_FIELD(m_Params.m_DstOfst);
+    CRC_FIELD(m_Params.m_NtpAddr);
+    const TimeChangeInfo *pRules[] = { &m_Params.m_DstStartRule, &m_Params.m_DstEndRule };
+    for (size_t i = 0; i < sizeof(pRules) / sizeof(pRules[0]); i++)
     {
-        // This is necessary since without it, the nextNTP  sync is often far into
-        // the future.  We do this by getting the current time, adding half a
-        // second to account for latency, then pass the time to sntp_sync_time()
-        // which will force an NTP sync message to be sent.
-        const suseconds_t HALF_SECOND_IN_MICROS = 500000;
-        time_t timeNow = time(&timeNow);
-        timeval tv = { .tv_sec = timeNow, .tv_usec = HALF_SECOND_IN_MICROS };
-        sntp_sync_time(&tv);
+        CRC_FIELD(pRules[i]->abbrev);
+        CRC_FIELD(pRules[i]->week);
+        CRC_FIELD(pRules[i]->dow);
+        CRC_FIELD(pRules[i]->month);
+        CRC_FIELD(pRules[i]->hour);
+        CRC_FIELD(pRules[i]->offset);
     }
-} // End InitSntpTime().
+    #undef CRC_FIELD
+    return crc;
+} // End ParamsCrc().
 
 
 /////////////////////////////////////////////////////////////////////////////
-// StartNewConnection()
+// MigrateParams()
 //
-// This method is called on a transition from WiFi not connected to WiFi
-// connected.  It initializes SNTP, updates timezone rules, and reads UTC
-// time to prime the internal clock.
+// Converts state saved by an earlier version of TimeParameters.
+//
+// Arguments:
+//   pBlob - Pointer to the saved state.
+//   size  - The size of the saved state in bytes.
+//
+// Returns:
+//   Returns true if the state was converted into m_Params, or false if
+//   its version is unknown.
 //
 /////////////////////////////////////////////////////////////////////////////
-void WiFiTimeManager::StartNewConnection()
+bool WiFiTimeManager::MigrateParams(const uint8_t *pBlob, size_t size)
 {
-    // Init SNTP and current time.
-    delay(100);
-    InitSntpTime();
+    uint32_t version = 0;
+    if (size < sizeof(version))
+    {
+        return false;
+    }
+    memcpy(&version, pBlob, sizeof(version));
 
-    // Update timezone rules to be sure that they are current.
-    UpdateTimezoneRules();
-    delay(100);
+    // Version 7 had one NTP server.  Keep our default extra servers.
+    if ((version == 7) && (size == sizeof(TimeParametersV7)))
+    {
+        TimeParametersV7 old;
+        memcpy(&old, pBlob, sizeof(old));
+        TimeParameters params;
+        params.m_TzOfst       = old.m_TzOfst;
+        params.m_UseDst       = old.m_UseDst;
+        params.m_DstOfst      = old.m_DstOfst;
+        params.m_DstStartRule = old.m_DstStartRule;
+        params.m_DstEndRule   = old.m_DstEndRule;
+        CopyString(params.m_NtpAddr[0], sizeof(params.m_NtpAddr[0]), old.m_NtpAddr);
+        m_Params = params;
+        return true;
+    }
 
-    // Prime the clock.
-    GetUtcTimeT();
-} // End StartNewConnection().
+    WTM_LOG_WARN(this, "Unknown saved data version %u.\n", version);
+    return false;
+} // End MigrateParams().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// PollSave()
+//
+// Does any scheduled or automatic save that is due.  Called by process().
+/////////////////////////////////////////////////////////////////////////////
+void WiFiTimeManager::PollSave()
+{
+    uint32_t millisNow = millis();
+
+    // Automatic saving.  Look for changes now and then, and each time our
+    // state is seen to have changed again, push the save out.
+    if ((m_AutoSaveMs != 0) && (millisNow - m_AutoCheckMs >= AUTO_SAVE_CHECK_MS))
+    {
+        m_AutoCheckMs = millisNow;
+        uint32_t crc = ParamsCrc();
+        if ((!m_SavedCrcValid || (crc != m_SavedCrc)) &&
+            (!m_SavePending || (crc != m_PendingCrc)))
+        {
+            m_PendingCrc = crc;
+            ScheduleSave(m_AutoSaveMs);
+        }
+    }
+
+    // Do a scheduled save once it is due.  A failed save is retried later.
+    if (m_SavePending && ((int32_t)(millisNow - m_SaveDueMs) >= 0))
+    {
+        if (!Save())
+        {
+            WTM_LOG_WARN(this, "Scheduled save failed.\n");
+            ScheduleSave();
+        }
+    }
+} // End PollSave().
@@ -46,9 +46,31 @@
 #if !defined WIFITIMEMANAGER_H
 #define WIFITIMEMANAGER_H
 
+#include "WiFiTimeManagerConfig.h" // For compile time options.
 #include <WiFiManager.h>        // Manage connection. https://github.com/tzapu/WiFiManager
+#include <ArduinoJson.h>        // For JsonDocument.
 #include <string.h>             // For strncpy().
 #include <esp_sntp.h>           // For ESP32 SNTP library.
+#include <atomic>               // For std::atomic.
+#include <freertos/FreeRTOS.h>  // For FreeRTOS types.
+#include <freertos/task.h>      // For the service task.
+#include <freertos/queue.h>     // For the service task command queue.
+#include <esp_timer.h>          // For the NTP start delay timer.
+#include "SeqLock.h"            // For lock-free local time cache.
+#include "Rcu.h"                // For lock-free settings and zone.
+#include "DstTable.h"           // For precomputed DST transitions.
+#include "Zone.h"               // For reentrant timezone conversions.
+#include "TimeFormat.h"         // For fast date/time formatting.
+#include "FixedZone.h"          // For compile time fixed timezones.
+#include "PrecisionClock.h"     // For sub-second UTC time.
+#include "NtpProbe.h"           // For parallel multi-server NTP queries.
+#include "DriftEstimator.h"     // For adaptive NTP polling.
+#include "Metrics.h"            // For counters and histograms.
+#include "LogBuffer.h"          // For non-blocking status messages.
+#include "AlarmScheduler.h"     // For scheduled callbacks.
+#include "RtcClock.h"           // For cached hardware RTC time.
+#include "PpsDiscipline.h"      // For PPS disciplined time.
+#include "TimeSourceArbiter.h"  // For time source selection and error bounds.
 #include "WebPages.h"          // To define MAX_WEB_PAGE_SIZE which depends onTZ_SELECT_STR.
 
 
@@ -75,6 +97,73 @@ enum Month_t
 };
 
 
+/////////////////////////////////////////////////////////////////////////////////
+// WebPageMode_t enumerates the ways in which the Setup web page may be
+// rendered:
+// - wpmBuffered - The whole page is built in a RAM buffer that is handed
+//                 to the WiFiManager.  This is the default.
+// - wpmStreamed - The page is sent directly from flash in chunks each time it
+//                 is requested.  No page buffer is ever allocated.
+// - wpmCached   - A small page is buffered, and the rest of the page comes
+//                 from a gzipped script that the browser caches.  The current
+//                 settings are fetched as JSON.
+/////////////////////////////////////////////////////////////////////////////////
+enum WebPageMode_t
+{
+    wpmBuffered = 0, wpmStreamed, wpmCached
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// ServiceCmd_t enumerates the commands that the application may send to the
+// time service task (see WiFiTimeManager::SetServiceTask()) via
+// WiFiTimeManager::PostServiceCommand():
+// - scStartPortal - Start the config portal (non-blocking).
+// - scSave        - Save the timezone and NTP data to NVS.
+// - scSyncNtp     - Request an NTP sync as soon as possible.
+// - scSyncRtc     - Read UTC time via the UtcGetCallback and set the clock.
+// The remaining commands are used internally.
+/////////////////////////////////////////////////////////////////////////////////
+enum ServiceCmd_t
+{
+    scStartPortal = 0, scSave, scSyncNtp, scSyncRtc,
+    scConnect, scSetRtc
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TimeQuality_t enumerates where the current time came from, from worst to
+// best (see WiFiTimeManager::GetTimeQuality()):
+// - tqNone       - No idea.  The clock started at the beginning of 2023.
+// - tqEstimated  - The clock started at the last saved NVS checkpoint.  The
+//                  real time is later by however long the power was off.
+// - tqCached     - The clock kept running since the last good sync (e.g.
+//                  across a soft reset or deep sleep), or network time has
+//                  timed out.  Off only by the drift since then.
+// - tqUserDevice - The clock was set via the UtcGetCallback (e.g. an RTC).
+// - tqNetwork    - The clock was set via NTP.
+// - tqPps        - The clock is locked to a PPS signal (see SetPpsSource()).
+/////////////////////////////////////////////////////////////////////////////////
+enum TimeQuality_t
+{
+    tqNone = 0, tqEstimated, tqCached, tqUserDevice, tqNetwork, tqPps
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// TimeSourceStatus
+//
+// Structure that is used to return the source of the current time and a
+// bound on its error.  See WiFiTimeManager::GetTimeSource().
+/////////////////////////////////////////////////////////////////////////////////
+struct TimeSourceStatus
+{
+    TimeQuality_t m_Source;     // The source that last set the clock.
+    uint32_t      m_ErrorUs;    // Bound on the clock's error, or UINT32_MAX.
+    uint32_t      m_AgeSec;     // Seconds since the source set the clock.
+};
+
+
 /////////////////////////////////////////////////////////////////////////////////
 // TimeChangeInfo
 //
@@ -98,7 +187,7 @@ struct TimeChangeInfo
 // startup.  The TP_VERSION value should be bumped any time a change is made
 // to the structure.
 //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-static const uint32_t TP_VERSION           = 7;       // Struct version.  Bump on changes.
+static const uint32_t TP_VERSION           = 8;       // Struct version.  Bump on changes.
 static const int32_t  DFLT_TZ_OFST         = -300;    // Eastern time (5 hrs behind).
 static const char    *DFLT_TZ_ABBREV       = "EST";   // DST end rule abbreviation.
 static const bool     DFLT_USE_DST         = true;    // true to use DST.
@@ -114,12 +203,17 @@ static const uint32_t DFLT_DST_END_MONTH   = mNov;    //    of November
 static const uint32_t DFLT_DST_END_HOUR    = 2;       //    at 2 AM.
 static const char    *DFLT_NTP_ADDR        = "time.nist.gov";
                                                       // NTP server
+static const char    *DFLT_NTP_ADDR_2      = "pool.ntp.org";
+                                                      // 2nd NTP server
+static const char    *DFLT_NTP_ADDR_3      = "time.google.com";
+                                                      // 3rd NTP server
+static const char    *DFLT_NTP_ADDR_4      = "";      // 4th NTP server (none)
 
 
 /////////////////////////////////////////////////////////////////////////////////
 // TimeParameters structure
 //
-// Holds timezone offset and DST start/end times, and NTP address.
+// Holds timezone offset and DST start/end times, and NTP addresses.
 //
 /////////////////////////////////////////////////////////////////////////////////
 struct TimeParameters
@@ -141,25 +235,75 @@ struct TimeParameters
                      DFLT_DST_END_HOUR,
                      DFLT_TZ_OFST}
     {
-        strncpy(m_NtpAddr, DFLT_NTP_ADDR, MAX_NTP_ADDR - 1);
+        memset(m_NtpAddr, 0, sizeof(m_NtpAddr));
+        strncpy(m_NtpAddr[0], DFLT_NTP_ADDR, MAX_NTP_ADDR - 1);
+        strncpy(m_NtpAddr[1], DFLT_NTP_ADDR_2, MAX_NTP_ADDR - 1);
+        strncpy(m_NtpAddr[2], DFLT_NTP_ADDR_3, MAX_NTP_ADDR - 1);
+        strncpy(m_NtpAddr[3], DFLT_NTP_ADDR_4, MAX_NTP_ADDR - 1);
         strncpy(m_DstStartRule.abbrev, DFLT_DST_START_ABBREV, sizeof(m_DstStartRule.abbrev) - 1);
         strncpy(m_DstEndRule.abbrev, DFLT_TZ_ABBREV, sizeof(m_DstStartRule.abbrev) - 1);
     }
 
     static const size_t MAX_NTP_ADDR = 26; // Maximum size of the NTP address string.
+    static const size_t MAX_NTP_SERVERS = NtpProbe::MAX_SERVERS;
+                                           // Maximum number of NTP servers.
 
     // Time related fields.
     uint32_t       m_Version;              // Struct version.  Bump on changes.
     int32_t        m_TzOfst;               // Timezone offset in minutes.
     bool           m_UseDst;               // true to use DST.
     int32_t        m_DstOfst;              // 30 or 60 minute DST offset.
-    char           m_NtpAddr[MAX_NTP_ADDR];// NTP server address.
+    char           m_NtpAddr[MAX_NTP_SERVERS][MAX_NTP_ADDR];
+                                           // NTP server addresses.  Unused
+                                           // entries are empty strings.
     TimeChangeInfo m_DstStartRule;         // Rule for starting DST.
     TimeChangeInfo m_DstEndRule;           // Rule for ending DST.
 
 }; // End struct TimeParameters.
 
 
+/////////////////////////////////////////////////////////////////////////////////
+// WebPageWriter class
+//
+// A Print derived class that receives the rendered Setup web page.  It either
+// fills a caller supplied buffer (truncating if needed), or collects the page
+// into a small chunk buffer and sends each full chunk to the web server client.
+// User code receives a reference to one of these (as a Print) in the stream
+// web page callback, and may use any Print method to add to the page.
+//
+/////////////////////////////////////////////////////////////////////////////////
+class WebPageWriter : public Print
+{
+public:
+    // Constructors.  One sends to a web server, the other fills a buffer.
+    WebPageWriter(WebServer *pServer);
+    WebPageWriter(char *pBuf, size_t size);
+    ~WebPageWriter() { Flush(); }
+
+    // Print interface.
+    using Print::write;
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *pData, size_t size);
+
+    // Send any buffered data to the web server client.
+    void Flush();
+
+    // Return the total number of bytes written so far.
+    size_t GetBytesWritten() const { return m_Written; }
+
+private:
+    static const size_t CHUNK_SIZE = 512;  // Size of chunks sent to the client.
+
+    WebServer *m_pServer;                  // Server to send to, or NULL.
+    char      *m_pBuf;                     // Buffer being filled.
+    size_t     m_Size;                     // Size of the buffer being filled.
+    size_t     m_Used;                     // Chars currently in m_pBuf.
+    size_t     m_Written;                  // Total bytes written.
+    char       m_Chunk[CHUNK_SIZE];        // Chunk buffer for server output.
+
+}; // End class WebPageWriter.
+
+
 /////////////////////////////////////////////////////////////////////////////////
 // WiFiTimeManager class
 //
@@ -169,6 +313,53 @@ struct TimeParameters
 class WiFiTimeManager : public WiFiManager
 {
 public:
+    // Service task defaults.  See SetServiceTask().  The Setup page handlers
+    // put a 512 byte JSON document (MAX_JSON_SIZE) on the stack while they
+    // build or serve the page.  The REST API's documents are allocated along
+    // with its server (see SetRestApi()), so they take no stack.
+    static const BaseType_t  DFLT_SERVICE_CORE     = 0;
+    static const UBaseType_t DFLT_SERVICE_PRIORITY = 1;
+    static const uint32_t    DFLT_SERVICE_STACK    = 6144;
+
+    // Longest adaptive NTP poll interval.  See SetNtpTargetErrorMs().
+    static const uint32_t    MAX_ADAPTIVE_NTP_SEC  = 24 * 60 * 60;
+
+    // NTP poll interval while locked to a PPS signal.  See SetPpsSource().
+    static const uint32_t    PPS_NTP_RATE_SEC      = 24 * 60 * 60;
+
+    // NTP start delay and poll jitter defaults and limits.  See SetNtpJitter().
+    static const uint32_t    DFLT_NTP_START_JITTER_MS = 10000;
+    static const uint32_t    MAX_NTP_START_JITTER_MS  = 5 * 60 * 1000;
+    static const uint32_t    DFLT_NTP_POLL_JITTER_PCT = 10;
+
+    // Default REST API port.  See SetRestApi().
+    static const uint16_t    DFLT_REST_PORT = 8080;
+
+    // Default room left in the Setup page buffer.  See SetWebPageHeadroom().
+    static const size_t      DFLT_WEB_PAGE_HEADROOM = 1024;
+    static const uint32_t    MAX_NTP_POLL_JITTER_PCT  = 50;
+
+    // Longest wait between NTP sync attempts while they fail.  See
+    // SetNtpJitter().
+    static const uint32_t    MAX_NTP_BACKOFF_SEC   = 60 * 60;
+
+    // Default time between NVS time checkpoints.  See SetCheckpointIntervalSec().
+    static const uint32_t    DFLT_CHECKPOINT_SEC   = 6 * 60 * 60;
+
+    // Default drift of the clock during deep sleep, in ppm.  See
+    // SetSleepDriftPpm().  The internal 150 kHz RC oscillator that keeps
+    // time in deep sleep is only good to a few percent, but after its
+    // calibration at boot it holds to roughly this.
+    static const uint32_t    DFLT_SLEEP_DRIFT_PPM  = 500;
+
+    // Default drift of the UtcGetCallback device (e.g. an RTC), in ppm.  See
+    // SetUtcDeviceDriftPpm().
+    static const uint32_t    DFLT_UTC_DEVICE_DRIFT_PPM = 20;
+
+    // Default delay of a scheduled save.  See ScheduleSave().
+    static const uint32_t    DFLT_SAVE_DELAY_MS    = 2000;
+
+
     /////////////////////////////////////////////////////////////////////////////
     // Instance()
     //
@@ -217,20 +408,82 @@ public:
     // process()
     //
     // Overrides the WiFiManager process() method.
-    // This method handles the non-blocking WiFi manager completion.
+    // This method handles the non-blocking WiFi manager completion, and brings
+    // up network time after a connection is made.  It is a state machine that
+    // is driven by WiFi events.  Each call does at most one short step of
+    // work and never waits, so it may safely be called from a loop with tight
+    // timing.  The longest time spent in any call is available from
+    // GetMaxProcessMicros().
     //
     // Returns:
     //    Returns a bool indicating whether or not the network is now connected.
     //    A 'true' value indicates connected, while a 'false' value
-    //    indicates not connected.
+    //    indicates not connected.  See IsConnected().
     //
-    // NOTE: The time will be updated immediately after a new connection is
-    //       established.
+    // NOTE: The time will be updated over the next few calls after a new
+    //       connection is established.  process() should be called until
+    //       it returns true.
     //
     /////////////////////////////////////////////////////////////////////////////
     bool process();
 
 
+    /////////////////////////////////////////////////////////////////////////////
+    // GetMaxProcessMicros()
+    //
+    // Returns the longest time, in microseconds, spent in any single call to
+    // process() since Init() or the last ResetMaxProcessMicros().  While the
+    // config portal is active, this includes the time taken by the WiFiManager
+    // to serve its web pages.
+    //
+    // Each call does at most one deferrable item of work: a step of bringing
+    // up network time, a time checkpoint, or a save of the settings.  The last
+    // two write flash, so they only run in a call in which the WiFiManager
+    // neither connected nor spent PORTAL_BUSY_US (1 ms) serving a request,
+    // and otherwise wait for a later call.  So the longest call is about the
+    // longer of the WiFiManager's slowest page and one NVS write (see
+    // m_NvsWriteUs in GetMetrics()), never their sum or two writes.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetMaxProcessMicros() const { return m_MaxProcessUs; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ResetMaxProcessMicros()
+    //
+    // Resets the value returned by GetMaxProcessMicros() to zero.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ResetMaxProcessMicros() { m_MaxProcessUs = 0; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetMetrics()
+    //
+    // Returns a copy of the counters and histograms collected since Init() or
+    // the last ResetMetrics().  See WtmMetrics in Metrics.h.  Collection may be
+    // compiled out with WTM_ENABLE_METRICS (see WiFiTimeManagerConfig.h).
+    //
+    // Arguments:
+    //   pMetrics - Pointer to where the metrics are returned.
+    //
+    // Returns:
+    //   Returns true if successful, or false if metrics are compiled out, in
+    //   which case *pMetrics is all zeros.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetMetrics(WtmMetrics *pMetrics) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ResetMetrics()
+    //
+    // Clears all of the metrics.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ResetMetrics();
+
+
     /////////////////////////////////////////////////////////////////////////////
     // autoConnect()
     //
@@ -262,6 +515,129 @@ public:
     boolean autoConnect(char const *pApName, char const *pApPassword = NULL);
 
 
+    /////////////////////////////////////////////////////////////////////////////
+    // SetServiceTask()
+    //
+    // Selects the opt-in service task mode.  Must be called before Init().
+    // In this mode, Init() starts a small time service task pinned to the
+    // specified core.  That task runs the config portal, SNTP bring up,
+    // the UtcGetCallback and UtcSetCallback (e.g. RTC reads and writes), and
+    // NVS saves, which keeps WiFi and flash stalls away from the application's
+    // tasks.  The application talks to it via PostServiceCommand().
+    //
+    // In this mode:
+    //   - autoConnect() asks the service task to connect.  In blocking mode it
+    //     waits for the outcome, otherwise it returns right away.
+    //   - process() may still be called, but only reports IsConnected().
+    //   - GetUtcTimeT() never calls the UtcGetCallback itself.  It asks the
+    //     service task to do so instead, and returns the current clock time.
+    //
+    // Arguments:
+    //   core      - The core (0 or 1) to pin the task to.  WiFi runs on core 0
+    //               and the Arduino loop() on core 1.
+    //   priority  - The FreeRTOS priority of the task.
+    //   stackSize - The task's stack size in bytes.
+    //
+    // Returns:
+    //   Returns true if successful, or false if Init() has already been called.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SetServiceTask(BaseType_t core = DFLT_SERVICE_CORE,
+                        UBaseType_t priority = DFLT_SERVICE_PRIORITY,
+                        uint32_t stackSize = DFLT_SERVICE_STACK);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetRestApi()
+    //
+    // Enables a JSON REST API, served on the device's own IP address once the
+    // network connects.  The API has a web server of its own that serves
+    // nothing else, so the WiFiManager pages are not reachable through it.
+    // Init() allocates the server and the JSON documents it uses, about
+    // 3.5KB, only if the API is enabled.  Must be called before Init().
+    // process() must still be called (or the service task used) to serve
+    // requests.  The API is:
+    //    GET /wtm/api/config  - Returns the timezone, DST, and NTP settings.
+    //    PUT /wtm/api/config  - Changes any of the settings given in the JSON
+    //                           body, then saves them.  Returns the settings.
+    //    GET /wtm/api/status  - Returns the time and sync status.
+    //    GET /wtm/api/metrics - Returns a summary of GetMetrics().
+    //
+    // Arguments:
+    //   enable - true to enable the API.
+    //   pToken - Pointer to a token that requests must present in an
+    //            "Authorization: Bearer <token>" header.  Required to enable
+    //            the API, since a PUT changes and saves the settings.  The
+    //            token string must stay valid.
+    //   port   - The TCP port to serve the API on.  Defaults to
+    //            DFLT_REST_PORT, which leaves port 80 to the WiFiManager's
+    //            portal.
+    //
+    // Returns:
+    //   Returns false, and leaves the API disabled, if it is enabled without a
+    //   token.  Otherwise returns true.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SetRestApi(bool enable, const char *pToken = NULL, uint16_t port = DFLT_REST_PORT)
+    {
+        bool tokenOk = (pToken != NULL) && (*pToken != '\0');
+        m_RestApi    = enable && tokenOk;
+        m_pRestToken = tokenOk ? pToken : NULL;
+        m_RestPort   = port;
+        return !enable || tokenOk;
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // UsingServiceTask()
+    //
+    // Returns true if the service task is running.
+    /////////////////////////////////////////////////////////////////////////////
+    bool UsingServiceTask() const { return m_ServiceTask != NULL; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // PostServiceCommand()
+    //
+    // Sends a command to the service task.  See ServiceCmd_t.  If the service
+    // task is not being used, then the command is carried out immediately by
+    // the calling task.
+    //
+    // Arguments:
+    //   cmd    - The command to send.
+    //   waitMs - The longest time, in milliseconds, to wait for room in the
+    //            command queue.  The default is not to wait.
+    //
+    // Returns:
+    //   Returns true if the command was sent (or carried out), or false if the
+    //   queue was full.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool PostServiceCommand(ServiceCmd_t cmd, uint32_t waitMs = 0);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // setConfigPortalBlocking()
+    //
+    // Overrides the WiFiManager setConfigPortalBlocking() method in order to
+    // remember the setting.  In service task mode, Init() puts the WiFiManager
+    // in non-blocking mode for good, since the service task runs the portal,
+    // and the setting only decides whether autoConnect() waits.
+    //
+    // Arguments:
+    //   shouldBlock - true to block, false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void setConfigPortalBlocking(boolean shouldBlock)
+    {
+        m_PortalBlocking = shouldBlock;
+        if (m_ServiceTask == NULL)
+        {
+            WiFiManager::setConfigPortalBlocking(shouldBlock);
+        }
+    }
+
+
     /////////////////////////////////////////////////////////////////////////////
     // SetSaveParamsCallback()
     //
@@ -285,21 +661,25 @@ public:
     // Can be used to read time from a hardware real timme clock or other time
     // source.
     //
+    // May be called at any time, from any task.  A call already in progress
+    // on another task finishes with the old callback.
+    //
     // Arguments:
     //   func - Pointer to the callback function that will return UTC time in
     //          seconds since Januar 1, 1970 (Unix time).
     //
     /////////////////////////////////////////////////////////////////////////////
     void SetUtcGetCallback(std::function<time_t()> func)
-        { m_pUtcGetCallback = func; }
+        { m_pUtcGetCallback.Write(func); }
 
 
     /////////////////////////////////////////////////////////////////////////////
     // SetUtcSetCallback()
     //
     // Sets a callback that will be invoked when a NTP UTC time update has been
-    // received.  Can be used to set the time of a hardware real time clock or
-    // other time source.
+    // received and used to set the clock.  Can be used to set the time of a hardware real time clock or
+    // other time source.  May be called at any time, from any task.  A call
+    // already in progress on another task finishes with the old callback.
     //
     // Arguments:
     //   func - Pointer to the function to be called to set UTC time.  The
@@ -308,7 +688,80 @@ public:
     //
     /////////////////////////////////////////////////////////////////////////////
     void SetUtcSetCallback(std::function<void(time_t t)> func)
-        { m_pUtcSetCallback = func; }
+        { m_pUtcSetCallback.Write(func); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetRtcBackend()
+    //
+    // Uses a hardware real time clock (RTC) driver (e.g. Ds3231Rtc or
+    // Pcf8563Rtc) as the non-NTP time source, in place of the UTC get and set
+    // callbacks.  Init() starts a task that reads the RTC once per second, so
+    // getting the time never waits on the I2C bus.  After each NTP update,
+    // the RTC is rewritten if it is off by more than a quarter second, and its
+    // aging offset (if any) is trimmed to cancel its measured drift.  Must be
+    // called before Init(), after the I2C bus has been started.
+    //
+    // Arguments:
+    //   pRtc   - Pointer to the RTC driver.  It must outlive the
+    //            WiFiTimeManager, and must not be used by anything else.
+    //   sqwPin - The GPIO pin connected to the RTC's 1 Hz square wave output,
+    //            or -1 to poll the RTC instead.  Polling only keeps the time
+    //            to within a second, and can't trim the drift.  This
+    //            argument is optional, and defaults to -1.
+    //
+    // Returns:
+    //   Returns true if successful, or false if Init() has already been
+    //   called.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SetRtcBackend(RtcBackend *pRtc, int sqwPin = -1);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetRtcClock()
+    //
+    // Returns the RtcClock that reads the RTC set with SetRtcBackend(), for
+    // its error, drift, and aging offset.
+    /////////////////////////////////////////////////////////////////////////////
+    const RtcClock &GetRtcClock() const { return m_RtcClock; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetPpsSource()
+    //
+    // Disciplines the clock to a one pulse per second (PPS) signal, such as
+    // that from a GPS module or a DS3231's SQW pin, for microsecond class
+    // GetUtcMicros() and GetUtcTimespec() times.  Init() attaches an interrupt
+    // to the pin.  NTP is still needed to get the clock to within half a
+    // second, so that each pulse can be labelled with its UTC second, but
+    // once the clock is locked, NTP is only polled every PPS_NTP_RATE_SEC.
+    // While locked, GetTimeQuality() returns tqPps.  Must be called before
+    // Init().
+    //
+    // Arguments:
+    //   pin  - The GPIO pin that the PPS signal is connected to.  Must not be
+    //          the pin passed to SetRtcBackend().
+    //   edge - The edge of the signal that marks the start of a second
+    //          (RISING or FALLING).  This argument is optional, and defaults
+    //          to RISING, as used by most GPS modules.  Use FALLING for a
+    //          DS3231.
+    //
+    // Returns:
+    //   Returns true if successful, or false if Init() has already been
+    //   called or the pin is the RTC's SQW pin.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SetPpsSource(int pin, int edge = RISING);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetPps()
+    //
+    // Returns the PpsDiscipline that locks the clock to the PPS signal set
+    // with SetPpsSource(), for its lock state, error, and rate correction.
+    /////////////////////////////////////////////////////////////////////////////
+    const PpsDiscipline &GetPps() const { return m_Pps; }
 
 
     /////////////////////////////////////////////////////////////////////////////
@@ -316,7 +769,9 @@ public:
     //
     // Sets a callback that will be invoked when when the Setup web page is
     // updated.  The user can use this callback to monitor or modify the
-    // contents of the Setup web page.
+    // contents of the Setup web page.  The page is built the first time it is
+    // served, and again when the settings that it shows have changed (see
+    // InvalidateWebPage()), so the callback is not invoked from Init().
     //
     // Arguments:
     //   func - Pointer to the function to be called any time the Setup web
@@ -359,7 +814,144 @@ public:
     /////////////////////////////////////////////////////////////////////////////
     void SetUpdateWebPageCallback(
         std::function<void(String &rWebPage, uint32_t maxSize)> func)
-        { m_pUpdateWebPageCallback = func; }
+        { m_pUpdateWebPageCallback = func; m_WebPageValid = false; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetStreamWebPageCallback()
+    //
+    // Sets a callback that will be invoked at each of the marker comments (see
+    // SetUpdateWebPageCallback() above) as the Setup web page is rendered.
+    // Unlike the update web page callback, the page is never held in a String,
+    // so this callback works with both the wpmBuffered and wpmStreamed web
+    // page modes (see SetWebPageMode()).
+    //
+    // Arguments:
+    //   func - Pointer to the function to be called at each marker.  A NULL
+    //          value is acceptable.
+    //
+    // Note: The pMarker argument of the callback points to the marker string
+    //       that was reached (e.g. "<!-- HTML END -->").  Anything written to
+    //       rOut is inserted into the page just before the marker.  The marker
+    //       itself is sent after the callback returns.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetStreamWebPageCallback(
+        std::function<void(const char *pMarker, Print &rOut)> func)
+        { m_pStreamWebPageCallback = func; m_WebPageValid = false; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // InvalidateWebPage()
+    //
+    // Makes the buffered Setup page be rebuilt the next time it is served.
+    // Changes to the settings are noticed without this, so it is only needed
+    // when a web page callback (see above) would add something different.
+    /////////////////////////////////////////////////////////////////////////////
+    void InvalidateWebPage() { m_WebPageValid = false; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetWebPageMode()
+    //
+    // Selects how the Setup web page is rendered.  Must be called before Init().
+    //
+    // Arguments:
+    //   mode - wpmBuffered (the default) builds the whole page in a RAM buffer
+    //          that stays allocated, the first time it is served, and again
+    //          when the settings change.  wpmStreamed sends the page directly from
+    //          flash, in chunks, each time it is requested, splicing in the
+    //          current settings as it goes.  The wpmStreamed mode requires that
+    //          Init() be called with setupButton set to true.  Otherwise the
+    //          wpmBuffered mode will be used.  wpmCached buffers only a small
+    //          page.  The rest is a gzipped script, served from flash at
+    //          /wtm/setup.js, that the browser caches, and the current settings
+    //          are fetched from /wtm/config.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetWebPageMode(WebPageMode_t mode) { m_WebPageMode = mode; }
+    WebPageMode_t GetWebPageMode() const    { return m_WebPageMode; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetWebPageHeadroom()
+    //
+    // Sets how many bytes the Setup page buffer (wpmBuffered and wpmCached
+    // modes) holds beyond the page itself and its settings, for HTML and/or
+    // java script added by the web page callbacks (see above).  The update
+    // web page callback is passed the resulting maxSize.  Must be called
+    // before Init().
+    //
+    // Arguments:
+    //   size - Number of bytes of room.  Defaults to DFLT_WEB_PAGE_HEADROOM.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetWebPageHeadroom(size_t size) { m_WebPageHeadroom = size; }
+    size_t GetWebPageHeadroom() const    { return m_WebPageHeadroom; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetProvisionedMode()
+    //
+    // Selects whether the web portal's memory is given back to the heap once
+    // the network connects.  Must be called before Init().
+    //
+    // Arguments:
+    //   enable - true to free the Setup page buffer, and the WiFiManager web
+    //            and DNS servers, each time the network connects.  They are
+    //            rebuilt when the portal next starts (e.g. from
+    //            startConfigPortal() or the scStartPortal service command),
+    //            so the first page takes a little longer.  The REST API
+    //            (see SetRestApi()) has a server of its own, which is kept.
+    //            false (the default) keeps the Setup page, once built, for
+    //            the life of the program.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetProvisionedMode(bool enable) { m_Provisioned = enable; }
+    bool GetProvisionedMode() const      { return m_Provisioned; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsPortalReleased()
+    //
+    // Returns true if the web portal's memory has been freed in provisioned
+    // mode, and not yet rebuilt.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsPortalReleased() const { return m_PortalReleased; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // setWebServerCallback()
+    //
+    // Overrides the WiFiManager setWebServerCallback() method.  We need the
+    // WiFiManager callback for ourselves, so the user's callback is saved and
+    // invoked from within ours.  The WiFiManager method isn't virtual, so this
+    // must be called on a WiFiTimeManager.  Called through a WiFiManager
+    // pointer or reference, it would replace our callback with the user's.
+    //
+    // Arguments:
+    //   func - Pointer to the function to be called after the web server has
+    //          been created.  A NULL value is acceptable.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void setWebServerCallback(std::function<void()> func)
+        { m_pWebServerCallback = func; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // setClass()
+    //
+    // Overrides the WiFiManager setClass() method in order to remember the web
+    // page body class for use by the streamed Setup web page.  The WiFiManager
+    // method isn't virtual, so this must be called on a WiFiTimeManager.
+    // Called through a WiFiManager pointer or reference, the streamed Setup
+    // page would keep the old class.
+    //
+    // Arguments:
+    //   str - The body class (e.g. "invert" for the dark theme).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void setClass(String str) { m_BodyClass = str; WiFiManager::setClass(str); }
 
 
     /////////////////////////////////////////////////////////////////////////////
@@ -378,6 +970,8 @@ public:
     // Save()
     //
     // Saves our current state to NVS.  This includes all timezone and NTP data.
+    // A CRC of the state last saved or restored is kept in RAM, and if the
+    // state still matches it, NVS is neither read nor written.
     //
     // Returns:
     //    Returns 'true' if successful, or 'false' otherwise.
@@ -386,10 +980,51 @@ public:
     bool Save() const;
 
 
+    /////////////////////////////////////////////////////////////////////////////
+    // ScheduleSave()
+    //
+    // Schedules a Save() to be done by process() (or the service task) after
+    // the specified delay.  Calling it again before then pushes the save out,
+    // so a burst of changes results in a single NVS write.
+    //
+    // Arguments:
+    //    delayMs - Milliseconds to wait before saving.  Defaults to
+    //              DFLT_SAVE_DELAY_MS.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ScheduleSave(uint32_t delayMs = DFLT_SAVE_DELAY_MS);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetAutoSaveMs()
+    //
+    // Selects automatic saving.  process() (or the service task) checks the
+    // CRC of our state about once a second, and once it has changed and then
+    // stayed the same for the specified time, saves it.  This lets code simply
+    // call the setters, without having to call Save().
+    //
+    // Arguments:
+    //    quietMs - Milliseconds that the state must stay unchanged before it
+    //              is saved, or 0 to turn automatic saving off (the default).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetAutoSaveMs(uint32_t quietMs) { m_AutoSaveMs = quietMs; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsSavePending()
+    //
+    // Returns true if a scheduled save has not been done yet.
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsSavePending() const { return m_SavePending; }
+
+
     /////////////////////////////////////////////////////////////////////////////
     // Restore()
     //
     // Restores our state from NVS.  This includes all timezone and NTP data.
+    // State saved by an earlier version of the TimeParameters structure is
+    // migrated rather than thrown away.
     //
     // Returns:
     //    Returns 'true' if successful, or 'false' otherwise.
@@ -415,17 +1050,20 @@ public:
     // GetUtcTimeT()
     //
     // This method returns UTC time in UNIX time (time_t).  If a user
-    // UTC get callback has been specified, and it has been a while since an
-    // NTP or user update has occurred, then the user code (if any) is called
-    // to update the clock time.  Otherwise, the ESP32 time is returned.
+    // UTC get callback has been specified, and its time would now be better
+    // than the clock's (see GetTimeSource()), then the user code is called
+    // to update the clock time.  The time returned is always that of the
+    // precision clock (see GetUtcMicros()), which NTP, the user device, and
+    // any PPS signal all correct.
     //
     // Arguments:
-    //   force - Forces update from user callback if present.  This argument
-    //           is optional, and defaults to false.
+    //   force - Forces a read of the user callback if present.  Its time is
+    //           still only used if it is better than the clock's.  This
+    //           argument is optional, and defaults to false.
     //
     // Returns:
-    //   Always returns the current UTC time as kept by the internal Unix time
-    //   library or the user specified device if present.
+    //   Always returns the current UTC time, in whole seconds, as kept by the
+    //   precision clock.
     //
     /////////////////////////////////////////////////////////////////////////////
     time_t GetUtcTimeT(bool force = false);
@@ -449,31 +1087,423 @@ public:
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetLocalTime()
+    // GetUtcMicros()
     //
-    // Returns the best known value for local time.  Converts the best known
-    // UTC time to local time and returns its value.  See GetUtcTime().
+    // Returns UTC time in microseconds since January 1, 1970.  The time is
+    // interpolated from the ESP32 esp_timer between syncs, so it has
+    // microsecond resolution, and it never goes backwards.  Small NTP
+    // corrections are slewed in rather than stepped.  It never calls the
+    // UtcGetCallback, never blocks, and does no allocation, so it is suitable
+    // for high rate timestamping.  See PrecisionClock.h for details.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t GetUtcMicros() const { return m_PrecisionClock.GetUtcMicros(); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetUtcTimespec()
+    //
+    // Same as GetUtcMicros(), but returns the time as a timespec.
     //
     // Arguments:
-    //   pTm - A pointer to the tm structure into which the local time data will
-    //         be returned.
+    //   pTs - A pointer to the timespec structure into which the UTC time will
+    //         be saved.
     //
     // Returns:
-    //   Returns the best known value for the current local time in the
-    //   structure pointed to by pTm.  Also returns pTm.
+    //   Always returns the value passed in as pTs.
     //
     /////////////////////////////////////////////////////////////////////////////
-    tm *GetLocalTime(tm *pTm);
+    timespec *GetUtcTimespec(timespec *pTs) const
+        { m_PrecisionClock.GetUtcTimespec(pTs); return pTs; }
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetDateTimeString
+    // GetClockStepCount()
     //
-    // Format and print a UNIX time_t value.  Uses strftime() to do the conversion.
-    // See https://linux.die.net/man/3/strftime for information on formatting the
-    // date time string using strftime().
-    //
-    // Arguments:
+    // Returns the number of times, since the first NTP sync, that the time
+    // returned by GetUtcMicros() had to be stepped backwards because the
+    // correction was too large to slew or hold.  Normally 0.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetClockStepCount() const { return m_PrecisionClock.GetStepCount(); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetLocalTime()
+    //
+    // Returns the best known value for local time.  Converts the best known
+    // UTC time to local time and returns its value.  See GetUtcTime() and
+    // UtcToLocal().
+    //
+    // Arguments:
+    //   pTm - A pointer to the tm structure into which the local time data will
+    //         be returned.
+    //
+    // Returns:
+    //   Returns the best known value for the current local time in the
+    //   structure pointed to by pTm.  Also returns pTm.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    tm *GetLocalTime(tm *pTm);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // UtcToLocal()
+    //
+    // Converts a UTC time to broken-down local time using our own timezone
+    // settings.  The offset comes from a table of DST transitions that is
+    // computed whenever the timezone settings change, so the conversion does
+    // not depend on the TZ environment variable.  The most recent result
+    // is cached, and is shared lock-free between all tasks on both cores.
+    // Requests for the same second, or a later second within the same minute,
+    // are served from the cache without any conversion at all.  Since DST
+    // transitions always fall on a minute boundary, these can never cross one.
+    //
+    // Arguments:
+    //   utc - The UTC time to be converted.
+    //   pTm - A pointer to the tm structure into which the local time data will
+    //         be returned.
+    //
+    // Returns:
+    //   Returns the local time in the structure pointed to by pTm.  Also
+    //   returns pTm.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    tm *UtcToLocal(time_t utc, tm *pTm);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // MakeZone()
+    //
+    // Builds a Zone from a set of time parameters, such as those of another
+    // site.  Only the timezone and DST fields are used.  The zone converts
+    // without the TZ environment variable, so many zones may be used at once.
+    //
+    // Arguments:
+    //   rParams - The time parameters.
+    //   pZone   - Pointer to the zone to be built.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void MakeZone(const TimeParameters &rParams, Zone *pZone);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetZone()
+    //
+    // Copies the zone in effect, as of the last time that the timezone
+    // settings were applied (e.g. by UpdateTimezoneRules()).  The zone is a
+    // copy, so it is not affected by later changes to our settings.  Never
+    // blocks, and safe to call from any task.
+    //
+    // Arguments:
+    //   pZone - Pointer to where the zone is copied.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void GetZone(Zone *pZone) const { m_Zone.Read(pZone); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetParams()
+    //
+    // Copies the timezone, DST, and NTP settings in effect, as of the last
+    // time that they were applied (e.g. by UpdateTimezoneRules() or
+    // CommitUpdate()).  The timezone, DST, and NTP getters below return the
+    // same settings one at a time.  Use this to get them all at once, since
+    // the copy is never part way through a change.  Never blocks, and safe to
+    // call from any task.
+    //
+    // Arguments:
+    //   pParams - Pointer to where the settings are copied.
+    //
+    // Returns:
+    //   Returns the number of times that settings have been applied.  Each
+    //   change gives a new, higher number.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t GetParams(TimeParameters *pParams) const
+        { return m_AppliedParams.Read(pParams); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // FlushLocalTimeCache()
+    //
+    // Discards the cached local time used by UtcToLocal() and GetLocalTime().
+    // This is done automatically whenever WiFiTimeManager changes the
+    // timezone.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void FlushLocalTimeCache();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetFixedZone()
+    //
+    // Fixes the timezone at compile time.  The TZ string, abbreviations, and
+    // DST transitions of the FixedZone are all computed by the compiler.  When
+    // a fixed zone is used, Init() neither restores nor saves timezone data in
+    // NVS, and the Setup page (and its button) is not created.  Save() and
+    // Restore() do nothing and return false.  Must be called before Init().
+    // See FixedZone.h.  For example:
+    //     typedef FixedZone<-300, -240,
+    //                       ZoneRule<mMar, wkSecond, dowSun, 2>,
+    //                       ZoneRule<mNov, wkFirst,  dowSun, 2> > EasternZone;
+    //     pWtm->SetFixedZone<EasternZone>();
+    //
+    // Template arguments:
+    //   Zone - A FixedZone type.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    template <typename Zone>
+    void SetFixedZone()
+    {
+        InstallFixedZone(Zone::GetTzString(), Zone::STD_OFST, Zone::USE_DST,
+                         Zone::DST_OFST, Zone::GetStdAbbrev(), Zone::GetDstAbbrev(),
+                         Zone::GetStartRule(), Zone::GetEndRule(),
+                         Zone::GetTransitions(), Zone::NUM_TRANSITIONS);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsFixedZone()
+    //
+    // Returns true if the timezone was fixed via SetFixedZone().
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsFixedZone() const { return m_pFixedTz != NULL; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetNextTransition()
+    //
+    // Returns the next DST transition.  This allows scheduled work to be set
+    // up ahead of a DST change rather than polling tm_isdst.
+    //
+    // Arguments:
+    //   utc   - The UTC time after which the transition is wanted.  If not
+    //           specified, the current UTC time is used.
+    //   pNext - Pointer to where the transition is returned.  m_Utc holds the
+    //           UTC time of the transition, m_Ofst holds the offset from UTC in
+    //           minutes from then on, and m_IsDst holds true if DST is in
+    //           effect from then on.
+    //
+    // Returns:
+    //   Returns true if a transition was found, or false if DST is not used.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetNextTransition(DstTransition *pNext)
+        { return GetNextTransition(GetUtcTimeT(), pNext); }
+    bool GetNextTransition(time_t utc, DstTransition *pNext) const
+        { Rcu<Zone>::ReadGuard zone(m_Zone); return zone->GetNextTransition(utc, pNext); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AddAlarm()
+    //
+    // Schedules a function to be called once at the specified UTC time.  A
+    // time that has already passed is called right away.  Alarms are called
+    // from the esp_timer task, so they should be short and must not block.
+    // See AlarmScheduler.h.
+    //
+    // Arguments:
+    //   utc  - The UTC time at which to call func.
+    //   func - The function to call.  It is passed the alarm's ID.
+    //
+    // Returns:
+    //   Returns the alarm's ID (greater than 0), or 0 if there was no room
+    //   (see AlarmScheduler::MAX_ALARMS).
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t AddAlarm(time_t utc, std::function<void(int32_t id)> func)
+        { return m_Alarms.AddAt(utc, func); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AddDailyAlarm()
+    //
+    // Schedules a function to be called every day at the specified local
+    // time, until cancelled.  DST changes and timezone changes are followed.
+    // A local time skipped at the start of DST is called when DST starts, and
+    // a local time repeated at the end of DST is called only the first time.
+    // If the clock is stepped forward past an alarm by more than
+    // AlarmScheduler::LATE_LIMIT_SEC, that day's call is skipped.
+    //
+    // Arguments:
+    //   hour   - The local hour (0 - 23).
+    //   minute - The local minute (0 - 59).
+    //   func   - The function to call.  It is passed the alarm's ID.
+    //
+    // Returns:
+    //   Returns the alarm's ID (greater than 0), or 0 if there was no room or
+    //   the time was out of range.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t AddDailyAlarm(uint32_t hour, uint32_t minute, std::function<void(int32_t id)> func)
+        { return (hour < 24) && (minute < 60) ?
+                 m_Alarms.AddDaily((int32_t)(hour * 3600 + minute * 60), func) : 0; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // CancelAlarm()
+    //
+    // Cancels an alarm.  An alarm that is being called finishes, but is not
+    // called again.
+    //
+    // Arguments:
+    //   id - The ID returned by AddAlarm() or AddDailyAlarm().
+    //
+    // Returns:
+    //   Returns true if the alarm was pending, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool CancelAlarm(int32_t id) { return m_Alarms.Cancel(id); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetNextAlarm()
+    //
+    // Returns the UTC time of the next alarm.
+    //
+    // Arguments:
+    //   pUtc - Pointer to where the time is returned.
+    //
+    // Returns:
+    //   Returns true if an alarm is pending, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetNextAlarm(time_t *pUtc) const { return m_Alarms.GetNext(pUtc); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // PrepareForSleep()
+    //
+    // Keeps our state in RTC memory for the next wake from deep sleep.
+    // This includes all timezone and NTP data, the drift estimate, and the
+    // expected error of the clock.  On wake, Init() takes them from there
+    // instead of NVS, and the clock carries on without WiFi.  Any scheduled
+    // save is done first.  Called by SleepUntilUtc() and SleepUntilLocal(),
+    // or may be called just before the application starts the deep sleep
+    // itself.  Alarms do not survive the sleep.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void PrepareForSleep();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SleepUntilUtc()
+    //
+    // Enters deep sleep until the specified UTC time.  The wake time is as
+    // good as the clock during the sleep.  See SetSleepDriftPpm().
+    //
+    // Arguments:
+    //   utc - The UTC time at which to wake.
+    //
+    // Returns:
+    //   Does not return if successful.  Returns false if the time has
+    //   already passed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SleepUntilUtc(time_t utc);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SleepUntilLocal()
+    //
+    // Enters deep sleep until the specified local time.  DST is taken into
+    // account, so a sleep across a DST change wakes at the right local time.
+    // A local time skipped at the start of DST wakes when DST starts, and a
+    // local time repeated at the end of DST wakes the first time.
+    //
+    // Arguments:
+    //   pLocal - The local time at which to wake.  tm_isdst, tm_wday, and
+    //            tm_yday are ignored, and out of range fields are
+    //            normalized (e.g. tm_mday + 1 for tomorrow).
+    //
+    // Returns:
+    //   Does not return if successful.  Returns false if the time has
+    //   already passed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SleepUntilLocal(const tm *pLocal)
+    {
+        time_t utc = (time_t)Rcu<Zone>::ReadGuard(m_Zone)->ToUtc(pLocal);
+        return SleepUntilUtc(utc);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsResyncNeeded()
+    //
+    // Decides whether the clock needs a network sync to be within the
+    // specified error.  Typically called after Init() on a wake from deep
+    // sleep, to skip connecting to WiFi when the clock is still good enough.
+    // The expected error is the error of the last NTP sync plus the drift
+    // since then, both awake and asleep.  See GetExpectedErrorUs().
+    //
+    // Arguments:
+    //   maxErrMs - The largest acceptable error in milliseconds.
+    //
+    // Returns:
+    //   Returns true if the clock has never been set by NTP (since the last
+    //   power up), or its expected error exceeds maxErrMs.  Returns false
+    //   otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsResyncNeeded(uint32_t maxErrMs) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetSleepDriftPpm()
+    //
+    // Sets the drift of the clock during deep sleep, as used by
+    // IsResyncNeeded().  Use about 20 with an external 32 kHz crystal.
+    //
+    // Arguments:
+    //    ppm - The drift in parts per million.  Defaults to
+    //          DFLT_SLEEP_DRIFT_PPM.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetSleepDriftPpm(uint32_t ppm) { m_SleepDriftPpm = ppm; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetUtcDeviceDriftPpm()
+    //
+    // Sets the most that the UtcGetCallback device (e.g. an RTC) is expected
+    // to drift between NTP updates.  Together with the device's whole second
+    // resolution, this bounds the error of its time, and so decides when the
+    // device is read rather than letting the clock run on.  See
+    // GetTimeSource().  SetRtcBackend() sets this from the RTC driver.
+    //
+    // Arguments:
+    //    ppm - The drift in parts per million.  Defaults to
+    //          DFLT_UTC_DEVICE_DRIFT_PPM.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetUtcDeviceDriftPpm(float ppm) { m_Arbiter.SetDriftPpm(tqUserDevice, ppm); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetTimeSource()
+    //
+    // Returns the source that last set the clock, and a bound on the clock's
+    // error right now.  Each source's error grows with the time since it was
+    // last set and with its drift, and the clock is only set from a source
+    // whose error is lower than the clock's own.  See TimeSourceArbiter.h.
+    //
+    // Arguments:
+    //   pStatus - Pointer to where the status is returned.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void GetTimeSource(TimeSourceStatus *pStatus) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetDateTimeString
+    //
+    // Format a UNIX broken-down tm time value.  Uses the TimeFormat::DATE_TIME
+    // format, which gives the same string as the strftime() format
+    // "%A, %B %d %Y %r %Z Day of Year: %j", without strftime()'s locale
+    // handling.  %Z is our own DST or standard abbreviation, per tm_isdst.
+    //
+    // Arguments:
     //   pBuf  - Pointer to a buffer that will receive the time string.  Must be at
     //           least 64 characters long to receive the full string.  If the buffer
     //           is shorter than 64 characters, the time string will be truncated.
@@ -486,277 +1516,1078 @@ public:
     //   terminating NULL.
     //
     /////////////////////////////////////////////////////////////////////////////
-    int GetDateTimeString(char *pBuf, int size, tm *pTime);
+    int GetDateTimeString(char *pBuf, int size, tm *pTime);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // FormatTime
+    //
+    // Formats the current time, with milliseconds, without any heap use.
+    // Meant for stamping log lines.  See TimeFormat.
+    //
+    // Arguments:
+    //   rFormat - The format (e.g. one built from TimeFormat::RFC_3339_MS).
+    //   pBuf    - Pointer to the buffer that receives the NULL terminated
+    //             string.  The string is truncated if it doesn't fit.
+    //   size    - The size, in bytes, of the buffer pointed to by pBuf.
+    //   utc     - true to format UTC time, or false for local time.
+    //
+    // Returns:
+    //   Returns the number of characters written, not counting the
+    //   terminating NULL.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    size_t FormatTime(const TimeFormat &rFormat, char *pBuf, size_t size, bool utc = false);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // PrintDateTime
+    //
+    // Format and print a UNIX broken-down tm time value.
+    //
+    // Arguments:
+    //   pTime - Pointer to the tm time structure containing the time to be
+    //           displayed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void PrintDateTime(tm *pTime);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetLocalTimezoneString()
+    //
+    // Returns the abbreviation of the timezone currently in effect (e.g. "EST"
+    // or "EDT").  Without arguments, returns a pointer to the abbreviation in
+    // the settings being edited (see GetTzAbbrev()), which belongs to the
+    // task that makes changes.  With a buffer, copies the abbreviation of the
+    // zone in effect into it instead, which is safe from any task.
+    //
+    // Arguments:
+    //   pBuf - Pointer to the buffer that receives the abbreviation.  Should
+    //          hold ABBREV_SIZE chars.  The abbreviation is truncated if it
+    //          doesn't fit.
+    //   size - The size, in bytes, of the buffer pointed to by pBuf.
+    //
+    // Returns:
+    //   Returns a pointer to the abbreviation, or pBuf.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    const char *GetLocalTimezoneString();
+    char *GetLocalTimezoneString(char *pBuf, size_t size);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetParamString()
+    //
+    // Returns the last value read of the specified Setup parameter.
+    //
+    // Arguments:
+    //   name - String containing the name of the argument whose value is to be
+    //          returned.
+    //
+    // Returns:
+    //    Always returns the String value of the specified argument if successful,
+    //    or an empty String on failure.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    String GetParamString(String name);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetParamChars()
+    //
+    // Returns the last value read of the specified Setup parameter.
+    //
+    // Arguments:
+    //   name - String containing the name of the argument whose value is to be
+    //          returned.
+    //   pBuf - Pointer to the buffer in which the parameter's value is to be
+    //          returned.
+    //   size - Size of the buffer pointed to by pBuf.
+    //
+    // Returns:
+    //    Returns the value in pBuf.  The returned buffer will contain the
+    //    value of the specified parameter if successful, or an empty buffer on
+    //    failure.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    char  *GetParamChars(String name, char *buf, size_t size);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetParamInt()
+    //
+    // Returns the last value read of the specified timezone parameter as an
+    // integer.
+    //
+    // Arguments:
+    //   name - String containing the name of the argument whose value is to be
+    //          returned.
+    //
+    // Returns:
+    //    Returns the int value of the specified Setup parameter.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int    GetParamInt(String name);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // UpdateTimezoneRules()
+    //
+    // Update our DST timezone rules.  Should be called any time timezone or DST
+    // data changes.  The TZ environment variable is only set (and tzset()
+    // called) if the timezone actually changed, and the SNTP library is only
+    // restarted if the NTP servers actually changed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void UpdateTimezoneRules();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // BeginUpdate()
+    //
+    // Starts a batch of setter calls.  The setters may then be called in any
+    // order, and nothing takes effect until CommitUpdate() is called.  Calls
+    // don't nest; a BeginUpdate() during an update is ignored.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void BeginUpdate();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // CommitUpdate()
+    //
+    // Ends a batch of setter calls.  The new settings are checked, and if they
+    // are good, they are saved and then applied all at once (see
+    // UpdateTimezoneRules()).  If they are rejected, or can't be saved, the
+    // settings from BeginUpdate() are put back, and nothing changes.
+    //
+    // Arguments:
+    //    save - true to save the new settings to NVS (the default), or false
+    //           to leave NVS alone.
+    //
+    // Returns:
+    //    Returns true if the new settings were applied, or false if they were
+    //    rejected or could not be saved.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool CommitUpdate(bool save = true);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // AbortUpdate()
+    //
+    // Ends a batch of setter calls, putting back the settings from
+    // BeginUpdate().
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void AbortUpdate();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // IsUpdating()
+    //
+    // Returns true between BeginUpdate() and CommitUpdate() or AbortUpdate().
+    /////////////////////////////////////////////////////////////////////////////
+    bool IsUpdating() const { return m_Updating; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetMinNtpRateSec()
+    //
+    // Sets the minimum time, in seconds, between NTP updates.  Enforces a minimum
+    // value of MIN_NTP_UPDATE_MS.
+    //
+    // Arguments:
+    //    rate - The minimum time, in seconds, between NTP updates.  Will be
+    //           limited to a value no less than MIN_NTP_UPDATE_MS.
+    //
+    // Returns:
+    //   Returns an indication of true if successful, or false on failure.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool SetMinNtpRateSec(uint32_t rate);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetNtpTargetErrorMs()
+    //
+    // Selects adaptive NTP polling.  The drift of the local oscillator is
+    // estimated from successive NTP syncs, and after each sync the NTP poll
+    // interval is set to the time it takes the clock to drift by the target
+    // error.  The interval is never shorter than the minimum NTP rate (see
+    // SetMinNtpRateSec()), and never longer than MAX_ADAPTIVE_NTP_SEC.  Until
+    // the drift is known, a conservative estimate is used, so the interval
+    // starts short and stretches as syncs come in.
+    //
+    // Arguments:
+    //    targetMs - The error, in milliseconds, to be held.  0 selects fixed
+    //               polling at the minimum NTP rate, which is the default.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetNtpTargetErrorMs(uint32_t targetMs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetNtpJitter()
+    //
+    // Spreads out the NTP traffic of devices that start together (e.g. after
+    // a power cut).  Each device waits a start delay of its own after the
+    // network connects before it sends its first NTP request, and stretches
+    // its poll interval by an amount of its own, so that devices that start
+    // together drift apart.  Both are derived from the device's MAC address,
+    // so they stay the same from boot to boot.  While syncs fail, the wait
+    // between sync attempts doubles, from 15 seconds up to
+    // MAX_NTP_BACKOFF_SEC, stretched by the same amount.
+    //
+    // Arguments:
+    //    startMs - The longest start delay, in milliseconds, up to
+    //              MAX_NTP_START_JITTER_MS.  0 sends the first request right
+    //              away.  Defaults to DFLT_NTP_START_JITTER_MS.
+    //    pollPct - The most that the poll interval is stretched, in percent,
+    //              up to MAX_NTP_POLL_JITTER_PCT.  The interval is never
+    //              shortened.  Defaults to DFLT_NTP_POLL_JITTER_PCT.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetNtpJitter(uint32_t startMs, uint32_t pollPct);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetCheckpointIntervalSec()
+    //
+    // Sets how often the current UTC time is checkpointed to NVS while good
+    // time (network or user device) is in use.  After a power cycle, Init()
+    // starts the clock at the checkpoint rather than at the start of 2023.
+    // The checkpoint kept in RTC memory across soft resets and deep sleep is
+    // not affected.  Should be called before Init().
+    //
+    // Arguments:
+    //    sec - Seconds between NVS checkpoints, or 0 to turn them off.
+    //          Defaults to DFLT_CHECKPOINT_SEC.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetCheckpointIntervalSec(uint32_t sec) { m_CheckpointMs = sec * 1000; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Getters and setters.  The timezone, DST, and NTP setters change the
+    // settings being edited, which take effect once applied (see BeginUpdate()
+    // and UpdateTimezoneRules()).  Their getters read the same settings, so a
+    // value reads back as soon as it is set, even before it is applied.  Both
+    // belong to the task that makes the changes, and the strings they point
+    // to may change under any other task.  Other tasks should read the
+    // settings in effect with GetParams(), or with the GetApplied...()
+    // getters, which copy a string into the caller's buffer (ABBREV_SIZE
+    // chars for an abbreviation, or TimeParameters::MAX_NTP_ADDR for an NTP
+    // address) and return a pointer to it.
+    /////////////////////////////////////////////////////////////////////////////
+    bool     IsConnected()      const { return m_ConnState == csOnline; }
+    int32_t  GetTzOfst()        const { return m_Params.m_TzOfst; }
+    char    *GetTzAbbrev()            { return m_Params.m_DstEndRule.abbrev; }
+    bool     GetUseDst()        const { return m_Params.m_UseDst; }
+    int32_t  GetDstOfst()       const { return m_Params.m_DstOfst; }
+    char    *GetDstAbbrev()           { return m_Params.m_DstStartRule.abbrev; }
+    uint32_t GetDstStartWk()    const { return m_Params.m_DstStartRule.week; }
+    uint32_t GetDstStartDow()   const { return m_Params.m_DstStartRule.dow; }
+    uint32_t GetDstStartMonth() const { return m_Params.m_DstStartRule.month; }
+    uint32_t GetDstStartHour()  const { return m_Params.m_DstStartRule.hour; }
+    int32_t  GetDstStartOfst()  const { return m_Params.m_DstStartRule.offset; }
+    uint32_t GetDstEndWk()      const { return m_Params.m_DstEndRule.week; }
+    uint32_t GetDstEndDow()     const { return m_Params.m_DstEndRule.dow; }
+    uint32_t GetDstEndMonth()   const { return m_Params.m_DstEndRule.month; }
+    uint32_t GetDstEndHour()    const { return m_Params.m_DstEndRule.hour; }
+    int32_t  GetDstEndOfst()    const { return m_Params.m_DstEndRule.offset; }
+    char    *GetNtpAddr()             { return m_Params.m_NtpAddr[0]; }
+    char    *GetNtpAddr(size_t i)     { return m_Params.m_NtpAddr[min(i, TimeParameters::MAX_NTP_SERVERS - 1)]; }
+    char    *GetAppliedTzAbbrev(char *pBuf, size_t size) const;
+    char    *GetAppliedDstAbbrev(char *pBuf, size_t size) const;
+    char    *GetAppliedNtpAddr(size_t i, char *pBuf, size_t size) const;
+    const NtpServerStats *GetNtpServerStats(size_t i) const { return m_NtpProbe.GetStats(i); }
+    bool     UsingNetworkTime() const { return m_UsingNetworkTime; }
+    TimeQuality_t GetTimeQuality() const { return m_TimeQuality; }
+    uint32_t GetCheckpointIntervalSec() const { return m_CheckpointMs / 1000; }
+    uint32_t GetMinNtpRateSec() const { return m_MinNtpRateMs / 1000; }
+    uint32_t GetNtpRateSec()    const { return m_NtpRateMs / 1000; }
+    uint32_t GetNtpTargetErrorMs() const { return m_NtpTargetErrUs / 1000; }
+    uint32_t GetNtpStartJitterMs() const { return m_NtpStartJitterMs; }
+    uint32_t GetNtpPollJitterPct() const { return m_NtpPollJitterPct; }
+    uint32_t GetNtpStartDelayMs() const
+        { return (uint32_t)((uint64_t)m_NtpStartJitterMs * (m_DeviceHash & 0xffff) / 0x10000); }
+    uint32_t GetNtpFailures()   const { return m_NtpFailures; }
+    float    GetDriftPpm()      const { return m_Drift.GetDriftPpm(); }
+    float    GetDriftUncertaintyPpm() const { return m_Drift.GetUncertaintyPpm(); }
+    uint32_t GetExpectedErrorUs() const { return m_Arbiter.GetErrorUs(esp_timer_get_time()); }
+    uint32_t GetSleepDriftPpm() const { return m_SleepDriftPpm; }
+    bool     WokeFromSleep()    const { return m_WokeFromSleep; }
+
+    // Min and max constants for selectable fields.
+    static const uint32_t WK_MIN     = wkFirst; // First
+    static const uint32_t WK_MAX     = wkLast;  // Last
+    static const uint32_t DOW_MIN    = dowSun;  // Sunday
+    static const uint32_t DOW_MAX    = dowSat;  // Saturday
+    static const uint32_t MONTH_MIN  = mJan;    // January
+    static const uint32_t MONTH_MAX  = mDec;    // December
+    static const uint32_t HOUR_MIN   = 0;       // Midnight
+    static const uint32_t HOUR_MAX   = 23;      // 11:00 PM
+    static const uint32_t OFFSET_MIN = 30;      // 30 minutes
+    static const uint32_t OFFSET_MAX = 60;      // 60 minutes
+    static const uint32_t OFFSET_MID = (OFFSET_MAX + OFFSET_MIN) / 2; // Middle of offset range.
+    static const int32_t  TZ_OFST_MIN = -12 * 60; // Westernmost timezone.
+    static const int32_t  TZ_OFST_MAX = 14 * 60;  // Easternmost timezone.
+    static const size_t   ABBREV_SIZE = sizeof(TimeChangeInfo::abbrev);
+                                                // Abbreviation buffer size.
+
+    // Print level values.  Use bit patterns to define levels.  The BP(v) macro
+    // below creates a bit pattern based on the given value.  Note that the
+    // BP() macro is only valid for values greater than zero.  The MASK(v) macro
+    // below creates a bit mask that includes its level and all lower levels.
+    // Note that the MASK() macro is valid for values greater than or equal to
+    // zero.
+    #define BP(v)   (1 << ((v) - 1))
+    #define MASK(v) ((1 << (v)) - 1)
+    static const uint32_t PL_NONE  = 0;                   // No status will be printed.
+    static const uint32_t PL_WARN  = 1;                   // Display warnings.
+    static const uint32_t PL_INFO  = 2;                   // Display informational info.
+    static const uint32_t PL_DEBUG = 3;                   // Display debug info.
+    static const uint32_t PL_DFLT  = PL_WARN;             // Default display level = warn.
+
+    static const uint32_t PL_NONE_BP  = 0;                // No status will be printed.
+    static const uint32_t PL_WARN_BP  = BP(PL_WARN);      // Display warnings.
+    static const uint32_t PL_INFO_BP  = BP(PL_INFO);      // Display informational info.
+    static const uint32_t PL_DEBUG_BP = BP(PL_DEBUG);     // Display debug info.
+    static const uint32_t PL_DFLT_BP  = PL_WARN_BP;       // Default display level = warn.
+
+    static const uint32_t PL_NONE_MASK  = 0;              // No status will be printed.
+    static const uint32_t PL_WARN_MASK  = MASK(PL_WARN);  // Display warnings.
+    static const uint32_t PL_INFO_MASK  = MASK(PL_INFO);  // Display informational info.
+    static const uint32_t PL_DEBUG_MASK = MASK(PL_DEBUG); // Display debug info.
+    static const uint32_t PL_DFLT_MASK  = PL_WARN_MASK;   // Default display level = warn.
+
+
+    void SetTzOfst(int32_t v)         { m_Params.m_TzOfst = v; }
+    void SetTzAbbrev(const char *v)   { strncpy(m_Params.m_DstEndRule.abbrev, v, sizeof(m_Params.m_DstStartRule.abbrev) - 1); }
+    void SetUseDst(bool v)            { m_Params.m_UseDst = v; }
+    void SetDstOfst(int32_t v)        { m_Params.m_DstOfst = (v <= OFFSET_MID ? OFFSET_MIN : OFFSET_MAX); }
+    void SetDstAbbrev(const char *v)  { strncpy(m_Params.m_DstStartRule.abbrev, v, sizeof(m_Params.m_DstStartRule.abbrev) - 1); }
+    void SetDstStartWk(uint32_t v)    { m_Params.m_DstStartRule.week = constrain(v, WK_MIN, WK_MAX); }
+    void SetDstStartDow(uint32_t v)   { m_Params.m_DstStartRule.dow = constrain(v, DOW_MIN, DOW_MAX); }
+    void SetDstStartMonth(uint32_t v) { m_Params.m_DstStartRule.month = constrain(v, MONTH_MIN, MONTH_MAX); }
+    void SetDstStartHour(uint32_t v)  { m_Params.m_DstStartRule.hour = constrain(v, HOUR_MIN, HOUR_MAX); }
+    void SetDstStartOfst(int32_t v)   { m_Params.m_DstStartRule.offset = v; }
+    void SetDstEndWk(uint32_t v)      { m_Params.m_DstEndRule.week = constrain(v, WK_MIN, WK_MAX); }
+    void SetDstEndDow(uint32_t v)     { m_Params.m_DstEndRule.dow = constrain(v, DOW_MIN, DOW_MAX); }
+    void SetDstEndMonth(uint32_t v)   { m_Params.m_DstEndRule.month = constrain(v, MONTH_MIN, MONTH_MAX); }
+    void SetDstEndHour(uint32_t v)    { m_Params.m_DstEndRule.hour = constrain(v, HOUR_MIN, HOUR_MAX); }
+    void SetDstEndOfst(int32_t v)     { m_Params.m_DstEndRule.offset = v; }
+    void SetNtpAddr(const char *v)    { SetNtpAddr(0, v); }
+    void SetNtpAddr(size_t i, const char *v);
+    void SetPrintLevel(uint32_t lvl)  { m_PrintLevel = MASK(lvl); }
+
+protected:
+
+
+private:
+    /////////////////////////////////////////////////////////////////////////////
+    // Private methods.
+    /////////////////////////////////////////////////////////////////////////////
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Unimplemented methods.  We don't want users to try to use these.
+    /////////////////////////////////////////////////////////////////////////////
+    WiFiTimeManager(WiFiTimeManager &rCs);
+    WiFiTimeManager &operator=(WiFiTimeManager &rCs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor and destructor.
+    //
+    // Private to enforce singleton behavior.
+    /////////////////////////////////////////////////////////////////////////////
+    WiFiTimeManager();
+    ~WiFiTimeManager() {}
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Override some WiFiManager methods that we don't want our end user to be
+    // able to access since we use them exclusively.
+    /////////////////////////////////////////////////////////////////////////////
+    bool addParameter(WiFiManagerParameter *p) { return WiFiManager::addParameter(p); }
+    void resetSettings() {WiFiManager::resetSettings(); }
+    void setMenu(std::vector<const char*>& menu) {WiFiManager::setMenu(menu); }
+    void setMenu(const char* menu[], uint8_t size) {WiFiManager::setMenu(menu, size); }
+    void setSaveParamsCallback(std::function<void()> func);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ConnState_t enumerates the steps of bringing up network time after a
+    // WiFi connection is made.  Each step is run by a separate call to
+    // StepConnection().
+    // - csOffline     - Not connected.  Waiting for the WiFi.
+    // - csStartSntp   - Start the SNTP client.
+    // - csSetTimezone - Update the timezone rules.
+    // - csSyncTime    - Ask for an immediate NTP sync.
+    // - csPrimeClock  - Read UTC time to prime the internal clock.
+    // - csOnline      - Connected and running.
+    /////////////////////////////////////////////////////////////////////////////
+    enum ConnState_t
+    {
+        csOffline = 0, csStartSntp, csSetTimezone, csSyncTime, csPrimeClock, csOnline
+    };
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // WiFi events of interest, as posted to m_WiFiEvents by WiFiEventCallback().
+    /////////////////////////////////////////////////////////////////////////////
+    static const uint32_t WIFI_EV_GOT_IP = 0x01;  // Station got an IP address.
+    static const uint32_t WIFI_EV_LOST   = 0x02;  // Station lost its connection.
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // InitSntpTime()
+    //
+    // Initializes the SNTP code with NTP address, update rate, and our sync
+    // callback.  Does not wait for a sync.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void InitSntpTime();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // StartSntp()
+    //
+    // Hands our NTP servers to the SNTP library, which starts it polling.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void StartSntp();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // StartDelayedSntp()
+    //
+    // Starts SNTP, and asks for a sync, once this device's start delay is up.
+    // Called from the esp_timer task by m_NtpStartTimer, whether or not
+    // process() is being called.
+    //
+    // Arguments:
+    //   pArg - Pointer to our instance.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void StartDelayedSntp(void *pArg);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ForceSntpSync()
+    //
+    // Asks for an NTP sync as soon as possible.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ForceSntpSync();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // WarmStart()
+    //
+    // Starts the clock from the best cached time available.  See
+    // TimeQuality_t.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void WarmStart();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SaveRtcCheckpoint()
+    //
+    // Remembers the time of a good sync in RTC memory.
+    //
+    // Arguments:
+    //   utc - The UTC time of the sync.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void SaveRtcCheckpoint(time_t utc);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ClockTimeT()
+    //
+    // Returns the precision clock's UTC time in whole seconds.
+    /////////////////////////////////////////////////////////////////////////////
+    time_t ClockTimeT() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SteerSystemClock()
+    //
+    // Sets the system clock, as used by time() and the SNTP library, to the
+    // precision clock if they differ by more than SYSTEM_CLOCK_TOL_US.
+    /////////////////////////////////////////////////////////////////////////////
+    void SteerSystemClock();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // RestoreSleepState()
+    //
+    // Restores the state kept by PrepareForSleep() on a wake from deep
+    // sleep.
+    //
+    // Returns:
+    //    Returns 'true' if successful, or 'false' otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool RestoreSleepState();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // CheckpointTime()
+    //
+    // Saves the current UTC time to NVS if good time is in use and it has
+    // been a while since the last NVS checkpoint.  Only called from process()
+    // (or the service task), so that reading the time never writes flash.
+    //
+    // Returns:
+    //   Returns true if the time was written to NVS, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool CheckpointTime();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ParamsCrc()
+    //
+    // Returns the CRC of our timezone and NTP data.  The fields are hashed one
+    // by one, so that the padding between them, which struct copies needn't
+    // keep, can't change the result.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t ParamsCrc() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // MigrateParams()
+    //
+    // Converts state saved by an earlier version of TimeParameters.
+    //
+    // Arguments:
+    //   pBlob - Pointer to the saved state.
+    //   size  - The size of the saved state in bytes.
+    //
+    // Returns:
+    //   Returns true if the state was converted into m_Params, or false if
+    //   its version is unknown.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool MigrateParams(const uint8_t *pBlob, size_t size);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // PollSave()
+    //
+    // Does any scheduled or automatic save that is due.  Called by process().
+    /////////////////////////////////////////////////////////////////////////////
+    void PollSave();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ConfigSntpServers()
+    //
+    // Hands the NTP servers to the SNTP library, best first.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ConfigSntpServers();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ValidateParams()
+    //
+    // Checks our timezone and NTP data for values that the setters can't
+    // catch by themselves.
+    //
+    // Returns:
+    //   Returns true if the data is usable, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool ValidateParams() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // NtpServersChanged()
+    //
+    // Returns true if our NTP servers differ from those last handed to the
+    // SNTP library.
+    /////////////////////////////////////////////////////////////////////////////
+    bool NtpServersChanged() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // DecodeSetupForm()
+    //
+    // Stores each of our Setup page fields straight into m_Params.  Fields
+    // missing from the form are left alone, except for the DST checkbox, which
+    // a browser leaves out when it is unchecked.
+    //
+    // Each field costs one lookup, through a name String built once by Init().
+    // A missing field reads as empty, which is all the numbers and the checkbox
+    // need, so hasArg() is only asked about an empty text field, which clears
+    // the text if it was sent.  WebServer has no way to read a value in place:
+    // arg() always returns a String copy.  Values short enough for String's
+    // inline buffer (10 characters on the ESP32), which covers every field but
+    // the NTP addresses, cost no allocation.  A longer NTP address costs one.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void DecodeSetupForm();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // StartNtpProbe()
+    //
+    // Starts a task that queries all of the NTP servers in parallel and sets
+    // the clock from the best reply.  See NtpProbe.
+    //
+    // Returns:
+    //   Returns true if the probe was started or is already running, or false
+    //   if the task could not be created.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool StartNtpProbe();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // NtpProbeTask()
+    //
+    // The body of the task started by StartNtpProbe().  Runs one probe, sets
+    // the clock, reorders the SNTP servers, and deletes itself.
+    //
+    // Arguments:
+    //   pArg - Pointer to our instance.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void NtpProbeTask(void *pArg);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // StartNewConnection()
+    //
+    // This method is called on a transition from WiFi not connected to WiFi
+    // connected.  It starts the steps that initialize SNTP, update timezone
+    // rules, and read UTC time to prime the internal clock.  The steps are
+    // then run by StepConnection().  Also stops the web portal, unless it
+    // serves our REST API.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void StartNewConnection();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // StepConnection()
+    //
+    // Runs the next step of bringing up network time, if any.
+    //
+    // Returns:
+    //    Returns true if a step was run, or false if there was nothing to do.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool StepConnection();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // HandleWiFiEvents()
+    //
+    // Updates our connection state from any WiFi events posted since the last
+    // call.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void HandleWiFiEvents();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ProcessNow(), ConnectNow()
+    //
+    // Do the work of process() and autoConnect() in the calling task.  In
+    // service task mode, they are only called by the service task.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool ProcessNow();
+    bool ConnectNow(char const *pApName, char const *pApPassword);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ProcessPortal()
+    //
+    // Runs the WiFiManager's process(), and starts bringing up network time if
+    // it just connected.
+    //
+    // Returns:
+    //    Returns true if the WiFiManager connected or served a request, or
+    //    false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool ProcessPortal();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ProcessRest()
+    //
+    // Serves any REST API request that is waiting.
+    //
+    // Returns:
+    //    Returns true if a request was served, or false otherwise.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool ProcessRest();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // DeferToServiceTask()
+    //
+    // Returns true if the caller should hand its work to the service task;
+    // i.e. the service task is running, and the caller is some other task.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool DeferToServiceTask() const
+        { return (m_ServiceTask != NULL) && (xTaskGetCurrentTaskHandle() != m_ServiceTask); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // UtcDeviceReady()
+    //
+    // Returns true if there is a user device to get UTC time from; i.e. a UTC
+    // get callback is set, and the RTC backend (if any) has a valid time.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool UtcDeviceReady() const
+    {
+        return *UtcGetGuard(m_pUtcGetCallback) &&
+               ((m_pRtcBackend == NULL) || m_RtcClock.IsValid());
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ApplyNtpRate()
+    //
+    // Sets the SNTP library's poll interval to m_NtpRateMs, or to
+    // PPS_NTP_RATE_SEC while locked to a PPS signal, stretched by this
+    // device's poll jitter.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void ApplyNtpRate() const
+        { sntp_set_sync_interval(Jitter(m_Pps.IsLocked() ? PPS_NTP_RATE_SEC * 1000 : m_NtpRateMs)); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Jitter()
+    //
+    // Returns ms stretched by this device's poll jitter (see SetNtpJitter()).
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t Jitter(uint32_t ms) const
+        { return ms + (uint32_t)((uint64_t)ms * m_NtpPollJitterPct * (m_DeviceHash >> 16) /
+                                 (100 * 0x10000)); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // NtpBackoffMs()
+    //
+    // Returns how long to wait after an NTP sync attempt that hasn't been
+    // answered before making another.  Doubles with each failure.
+    /////////////////////////////////////////////////////////////////////////////
+    uint32_t NtpBackoffMs() const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // NtpRetryDue()
+    //
+    // Returns true if an NTP sync attempt may be made now; i.e. this device's
+    // start delay is up, and the last attempt was answered or has been
+    // waited on for NtpBackoffMs().
+    /////////////////////////////////////////////////////////////////////////////
+    bool NtpRetryDue() const
+        { return !m_NtpStartPending &&
+                 (!m_NtpPending || ((millis() - m_NtpAttemptMs) >= NtpBackoffMs())); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // OnPpsEdge()
+    //
+    // Called by the PpsDiscipline after each PPS edge.  Collects metrics, and
+    // handles gaining and losing the lock.
+    //
+    // Arguments:
+    //   good   - true if the edge was used.
+    //   locked - true if the clock is locked.
+    //   errUs  - The clock's error at a good edge.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void OnPpsEdge(bool good, bool locked, int64_t errUs);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ServiceMsg structure
+    //
+    // A message sent to the service task.
+    /////////////////////////////////////////////////////////////////////////////
+    struct ServiceMsg
+    {
+        ServiceCmd_t m_Cmd;               // The command.
+        time_t       m_Time;              // UTC time for scSetRtc.
+    };
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // PrintDateTime
+    // SendServiceMsg()
     //
-    // Format and print a UNIX broken-down tm time value.
+    // Sends a message to the service task.
     //
     // Arguments:
-    //   pTime - Pointer to the tm time structure containing the time to be
-    //           displayed.
+    //   cmd    - The command to send.
+    //   t      - UTC time for the scSetRtc command.
+    //   waitMs - The longest time, in milliseconds, to wait for room.
+    //
+    // Returns:
+    //   Returns true if sent, or false if the queue was full.
     //
     /////////////////////////////////////////////////////////////////////////////
-    void PrintDateTime(tm *pTime);
+    bool SendServiceMsg(ServiceCmd_t cmd, time_t t, uint32_t waitMs);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetLocalTimezoneString()
+    // HandleServiceMsg()
     //
-    // Returns a pointer to the currently active timezone string, or NULL on error
-    // (e.g. "EST").
+    // Carries out a service task command in the calling task.
+    //
+    // Arguments:
+    //   rMsg - The message holding the command.
     //
     /////////////////////////////////////////////////////////////////////////////
-    const char *GetLocalTimezoneString();
+    void HandleServiceMsg(const ServiceMsg &rMsg);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetParamString()
+    // ServiceTask()
     //
-    // Returns the last value read of the specified Setup parameter.
+    // The service task.  Handles commands from the queue, and runs process()
+    // every SERVICE_POLL_MS milliseconds.
     //
     // Arguments:
-    //   name - String containing the name of the argument whose value is to be
-    //          returned.
-    //
-    // Returns:
-    //    Always returns the String value of the specified argument if successful,
-    //    or an empty String on failure.
+    //   pArg - Pointer to our instance.
     //
     /////////////////////////////////////////////////////////////////////////////
-    String GetParamString(String name);
+    static void ServiceTask(void *pArg);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetParamChars()
+    // GetTimezoneString()
     //
-    // Returns the last value read of the specified Setup parameter.
+    // Returns a string that represents the user selected timezone information
+    // in a form that is compliant with the POSIX TZ environment variable.
+    // See https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html .
     //
     // Arguments:
-    //   name - String containing the name of the argument whose value is to be
-    //          returned.
-    //   pBuf - Pointer to the buffer in which the parameter's value is to be
-    //          returned.
-    //   size - Size of the buffer pointed to by pBuf.
+    //   rParams - The settings to be described.
+    //   pBuffer - A pointer to the buffer in which the TZ string will be returned.
+    //   bufSize - The size, in chars, of the buffer pointed to by pBuffer.
+    //             Should be at least 64 chars.
     //
     // Returns:
-    //    Returns the value in pBuf.  The returned buffer will contain the
-    //    value of the specified parameter if successful, or an empty buffer on
-    //    failure.
+    //   Returns the TZ string in pBuffer, and a pointer to pBuffer.
     //
     /////////////////////////////////////////////////////////////////////////////
-    char  *GetParamChars(String name, char *buf, size_t size);
+    char *GetTimezoneString(const TimeParameters &rParams, char *pBuffer, size_t bufSize);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetParamInt()
+    // ApplySettingsJson()
     //
-    // Returns the last value read of the specified timezone parameter as an
-    // integer.
+    // Sets any of our user settable parameters that are present in a JSON
+    // document.  Uses the same names as FillSettingsJson().  Meant to be
+    // called between BeginUpdate() and CommitUpdate().
     //
     // Arguments:
-    //   name - String containing the name of the argument whose value is to be
-    //          returned.
+    //   rDoc  - Reference to the JSON document.
     //
     // Returns:
-    //    Returns the int value of the specified Setup parameter.
+    //   Returns false if any value present has the wrong type, or true otherwise.
     //
     /////////////////////////////////////////////////////////////////////////////
-    int    GetParamInt(String name);
+    bool ApplySettingsJson(const JsonDocument &rDoc);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // UpdateTimezoneRules()
+    // UpdateWebPage()
     //
-    // Update our DST timezone rules.  Should be called any time timezone or DST
-    // data changes.
+    // Update our custom Setup page based on current timezone, DST, and NTP settings.
+    // Only called from GetWebPage().
     //
     /////////////////////////////////////////////////////////////////////////////
-    void UpdateTimezoneRules();
+    void UpdateWebPage();
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // SetMinNtpRateSec()
+    // ReleasePortal()
     //
-    // Sets the minimum time, in seconds, between NTP updates.  Enforces a minimum
-    // value of MIN_NTP_UPDATE_MS.
+    // In provisioned mode, frees the Setup page buffer and the WiFiManager web
+    // and DNS servers.  Called from StartNewConnection() after the web portal
+    // stops.
     //
-    // Arguments:
-    //    rate - The minimum time, in seconds, between NTP updates.  Will be
-    //           limited to a value no less than MIN_NTP_UPDATE_MS.
+    /////////////////////////////////////////////////////////////////////////////
+    void ReleasePortal();
+
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // RenderWebPage()
     //
-    // Returns:
-    //   Returns an indication of true if successful, or false on failure.
+    // Render our custom Setup page into the specified Print object.  The
+    // current settings are spliced in at the JSON marker, and the user stream
+    // web page callback (if any) is invoked at each of the comment markers.
+    //
+    // Arguments:
+    //   rOut - The Print object that receives the page.
     //
     /////////////////////////////////////////////////////////////////////////////
-    bool SetMinNtpRateSec(uint32_t rate);
+    void RenderWebPage(Print &rOut);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // Getters and setters.
+    // HandleStreamedSetupPage()
+    //
+    // Web server handler that streams the complete Setup page to the client.
+    // Used in place of the WiFiManager "/param" handler in wpmStreamed mode.
+    //
     /////////////////////////////////////////////////////////////////////////////
-    bool     IsConnected()            { return getLastConxResult() == WL_CONNECTED; }
-    int32_t  GetTzOfst()        const { return m_Params.m_TzOfst; }
-    char    *GetTzAbbrev()            { return m_Params.m_DstEndRule.abbrev; }
-    bool     GetUseDst()        const { return m_Params.m_UseDst; }
-    int32_t  GetDstOfst()       const { return m_Params.m_DstOfst; }
-    char    *GetDstAbbrev()           { return m_Params.m_DstStartRule.abbrev; }
-    uint32_t GetDstStartWk()    const { return m_Params.m_DstStartRule.week; }
-    uint32_t GetDstStartDow()   const { return m_Params.m_DstStartRule.dow; }
-    uint32_t GetDstStartMonth() const { return m_Params.m_DstStartRule.month; }
-    uint32_t GetDstStartHour()  const { return m_Params.m_DstStartRule.hour; }
-    int32_t  GetDstStartOfst()  const { return m_Params.m_DstStartRule.offset; }
-    uint32_t GetDstEndWk()      const { return m_Params.m_DstEndRule.week; }
-    uint32_t GetDstEndDow()     const { return m_Params.m_DstEndRule.dow; }
-    uint32_t GetDstEndMonth()   const { return m_Params.m_DstEndRule.month; }
-    uint32_t GetDstEndHour()    const { return m_Params.m_DstEndRule.hour; }
-    int32_t  GetDstEndOfst()    const { return m_Params.m_DstEndRule.offset; }
-    char    *GetNtpAddr()             { return m_Params.m_NtpAddr; }
-    bool     UsingNetworkTime() const { return m_UsingNetworkTime; }
-    uint32_t GetMinNtpRateSec() const { return m_MinNtpRateMs; }
-
-    // Min and max constants for selectable fields.
-    static const uint32_t WK_MIN     = wkFirst; // First
-    static const uint32_t WK_MAX     = wkLast;  // Last
-    static const uint32_t DOW_MIN    = dowSun;  // Sunday
-    static const uint32_t DOW_MAX    = dowSat;  // Saturday
-    static const uint32_t MONTH_MIN  = mJan;    // January
-    static const uint32_t MONTH_MAX  = mDec;    // December
-    static const uint32_t HOUR_MIN   = 0;       // Midnight
-    static const uint32_t HOUR_MAX   = 23;      // 11:00 PM
-    static const uint32_t OFFSET_MIN = 30;      // 30 minutes
-    static const uint32_t OFFSET_MAX = 60;      // 60 minutes
-    static const uint32_t OFFSET_MID = (OFFSET_MAX + OFFSET_MIN) / 2; // Middle of offset range.
+    void HandleStreamedSetupPage();
 
-    // Print level values.  Use bit patterns to define levels.  The BP(v) macro
-    // below creates a bit pattern based on the given value.  Note that the
-    // BP() macro is only valid for values greater than zero.  The MASK(v) macro
-    // below creates a bit mask that includes its level and all lower levels.
-    // Note that the MASK() macro is valid for values greater than or equal to
-    // zero.
-    #define BP(v)   (1 << ((v) - 1))
-    #define MASK(v) ((1 << (v)) - 1)
-    static const uint32_t PL_NONE  = 0;                   // No status will be printed.
-    static const uint32_t PL_WARN  = 1;                   // Display warnings.
-    static const uint32_t PL_INFO  = 2;                   // Display informational info.
-    static const uint32_t PL_DEBUG = 3;                   // Display debug info.
-    static const uint32_t PL_DFLT  = PL_WARN;             // Default display level = warn.
 
-    static const uint32_t PL_NONE_BP  = 0;                // No status will be printed.
-    static const uint32_t PL_WARN_BP  = BP(PL_WARN);      // Display warnings.
-    static const uint32_t PL_INFO_BP  = BP(PL_INFO);      // Display informational info.
-    static const uint32_t PL_DEBUG_BP = BP(PL_DEBUG);     // Display debug info.
-    static const uint32_t PL_DFLT_BP  = PL_WARN_BP;       // Default display level = warn.
+    /////////////////////////////////////////////////////////////////////////////
+    // HandleSetupScript()
+    //
+    // Web server handler that sends the gzipped Setup page script in the
+    // wpmCached mode.  The script's URL changes along with the script, so it
+    // may be cached for good.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void HandleSetupScript();
 
-    static const uint32_t PL_NONE_MASK  = 0;              // No status will be printed.
-    static const uint32_t PL_WARN_MASK  = MASK(PL_WARN);  // Display warnings.
-    static const uint32_t PL_INFO_MASK  = MASK(PL_INFO);  // Display informational info.
-    static const uint32_t PL_DEBUG_MASK = MASK(PL_DEBUG); // Display debug info.
-    static const uint32_t PL_DFLT_MASK  = PL_WARN_MASK;   // Default display level = warn.
 
+    /////////////////////////////////////////////////////////////////////////////
+    // HandleConfigJson()
+    //
+    // Web server handler that sends our current settings as JSON in the
+    // wpmCached mode.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void HandleConfigJson();
 
-    void SetTzOfst(int32_t v)         { m_Params.m_TzOfst = v; }
-    void SetTzAbbrev(char *v)         { strncpy(m_Params.m_DstEndRule.abbrev, v, sizeof(m_Params.m_DstStartRule.abbrev) - 1); }
-    void SetUseDst(bool v)            { m_Params.m_UseDst = v; }
-    void SetDstOfst(int32_t v)        { m_Params.m_DstOfst = (v <= OFFSET_MID ? OFFSET_MIN : OFFSET_MAX); }
-    void SetDstAbbrev(char *v)        { strncpy(m_Params.m_DstStartRule.abbrev, v, sizeof(m_Params.m_DstStartRule.abbrev) - 1); }
-    void SetDstStartWk(uint32_t v)    { m_Params.m_DstStartRule.week = constrain(v, WK_MIN, WK_MAX); }
-    void SetDstStartDow(uint32_t v)   { m_Params.m_DstStartRule.dow = constrain(v, DOW_MIN, DOW_MAX); }
-    void SetDstStartMonth(uint32_t v) { m_Params.m_DstStartRule.month = constrain(v, MONTH_MIN, MONTH_MAX); }
-    void SetDstStartHour(uint32_t v)  { m_Params.m_DstStartRule.hour = constrain(v, HOUR_MIN, HOUR_MAX); }
-    void SetDstStartOfst(int32_t v)   { m_Params.m_DstStartRule.offset = v; }
-    void SetDstEndWk(uint32_t v)      { m_Params.m_DstEndRule.week = constrain(v, WK_MIN, WK_MAX); }
-    void SetDstEndDow(uint32_t v)     { m_Params.m_DstEndRule.dow = constrain(v, DOW_MIN, DOW_MAX); }
-    void SetDstEndMonth(uint32_t v)   { m_Params.m_DstEndRule.month = constrain(v, MONTH_MIN, MONTH_MAX); }
-    void SetDstEndHour(uint32_t v)    { m_Params.m_DstEndRule.hour = constrain(v, HOUR_MIN, HOUR_MAX); }
-    void SetDstEndOfst(int32_t v)     { m_Params.m_DstEndRule.offset = v; }
-    void SetNtpAddr(char *v)          { strncpy(m_Params.m_NtpAddr, v, sizeof(m_Params.m_NtpAddr) - 1); }
-    void SetPrintLevel(uint32_t lvl)  { m_PrintLevel = MASK(lvl); }
 
-protected:
+    /////////////////////////////////////////////////////////////////////////////
+    // HandleRestConfigGet()
+    //
+    // REST API handler that sends our current settings as JSON.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void HandleRestConfigGet();
 
 
-private:
     /////////////////////////////////////////////////////////////////////////////
-    // Private methods.
+    // HandleRestConfigPut()
+    //
+    // REST API handler that changes our settings from a JSON request body.
+    // The WebServer only hands out a String copy of the body, so each request
+    // costs one heap allocation.
+    //
     /////////////////////////////////////////////////////////////////////////////
+    void HandleRestConfigPut();
+
 
     /////////////////////////////////////////////////////////////////////////////
-    // Unimplemented methods.  We don't want users to try to use these.
+    // HandleRestStatus()
+    //
+    // REST API handler that sends our time and sync status as JSON.
+    //
     /////////////////////////////////////////////////////////////////////////////
-    WiFiTimeManager(WiFiTimeManager &rCs);
-    WiFiTimeManager &operator=(WiFiTimeManager &rCs);
+    void HandleRestStatus();
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // Constructor and destructor.
+    // HandleRestMetrics()
+    //
+    // REST API handler that sends a summary of our metrics as JSON.
     //
-    // Private to enforce singleton behavior.
     /////////////////////////////////////////////////////////////////////////////
-    WiFiTimeManager();
-    ~WiFiTimeManager() {}
+    void HandleRestMetrics();
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // Override some WiFiManager methods that we don't want our end user to be
-    // able to access since we use them exclusively.
+    // RestAuthorized()
+    //
+    // Checks a REST request's token, and if it is bad, sends an error reply.
+    //
+    // Returns:
+    //   Returns true if the request may be served, or false otherwise.
+    //
     /////////////////////////////////////////////////////////////////////////////
-    bool addParameter(WiFiManagerParameter *p) { return WiFiManager::addParameter(p); }
-    void resetSettings() {WiFiManager::resetSettings(); }
-    void setMenu(std::vector<const char*>& menu) {WiFiManager::setMenu(menu); }
-    void setMenu(const char* menu[], uint8_t size) {WiFiManager::setMenu(menu, size); }
-    void setSaveParamsCallback(std::function<void()> func);
+    bool RestAuthorized();
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // InitSntpTime()
+    // SendJson()
     //
-    // Initializes the SNTP code with NTP address, update rate, timezone info,
-    // and force an NTP sync.
+    // Sends a JSON document as the reply to the current request.  The document
+    // is streamed to the client rather than serialized into a buffer first.
+    //
+    // Arguments:
+    //   rServer - The web server that is handling the request.
+    //   code    - The HTTP status code.
+    //   rDoc    - The document to send.
     //
     /////////////////////////////////////////////////////////////////////////////
-    void InitSntpTime();
+    static void SendJson(WebServer &rServer, int code, const JsonDocument &rDoc);
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // StartNewConnection()
+    // InitRest()
     //
-    // This method is called on a transition from WiFi not connected to WiFi
-    // connected.  It initializes SNTP, updates timezone rules, and reads UTC
-    // time to prime the internal clock.
+    // Allocates the REST API's web server and documents, and installs the
+    // API's handlers.  Called from Init() if the API is enabled.
     //
     /////////////////////////////////////////////////////////////////////////////
-    void StartNewConnection();
+    void InitRest();
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // GetTimezoneString()
+    // StartRestServer()
     //
-    // Returns a string that represents the user selected timezone information
-    // in a form that is compliant with the POSIX TZ environment variable.
-    // See https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html .
+    // Starts the REST API's web server, if the API is enabled and the server
+    // isn't already running.  Called once the network connects.
     //
-    // Arguments:
-    //   pBuffer - A pointer to the buffer in which the TZ string will be returned.
-    //   bufSize - The size, in chars, of the buffer pointed to by pBuffer.
-    //             Should be at least 64 chars.
+    /////////////////////////////////////////////////////////////////////////////
+    void StartRestServer();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // WebPageSource()
     //
-    // Returns:
-    //   Returns the TZ string in pBuffer, and a pointer to pBuffer.
+    // Returns the Setup page for the current web page mode.
+    /////////////////////////////////////////////////////////////////////////////
+    const char *WebPageSource() const
+        { return m_WebPageMode == wpmCached ? TZ_CACHED_STR : TZ_SELECT_STR; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // WebPageBufferSize()
     //
+    // Returns the size of the Setup page buffer for the current web page mode.
     /////////////////////////////////////////////////////////////////////////////
-    char *GetTimezoneString(char *pBuffer, size_t bufSize);
+    size_t WebPageBufferSize() const
+        { return (m_WebPageMode == wpmCached ? MAX_CACHED_PAGE_SIZE : MAX_WEB_PAGE_SIZE) +
+                 m_WebPageHeadroom; }
 
 
     /////////////////////////////////////////////////////////////////////////////
-    // UpdateWebPage()
+    // WebServerCallback()
     //
-    // Update our custom Setup page based on current timezone, DST, and NTP settings.
+    // Static method that is called by the WiFiManager just after its web server
+    // is created, and before it installs its own handlers.  Installs any of our
+    // handlers, then calls the user's web server callback, if any.
     //
     /////////////////////////////////////////////////////////////////////////////
-    void UpdateWebPage();
+    static void WebServerCallback();
 
 
     /////////////////////////////////////////////////////////////////////////////
@@ -775,9 +2606,11 @@ private:
     /////////////////////////////////////////////////////////////////////////////
     // UtcSetCallback()
     //
-    // This static method sets UTC time as kept by the Unix time library.
-    // It is called when UTC time updated from NTP network time.  If the user
-    // has specified a callback, then it is called.
+    // This static method is called when UTC time is received from NTP.  The
+    // time is offered to the arbiter, and only if it is accepted does it set
+    // the clock, the system clock, and the user device (via the user's
+    // callback, if any).  Otherwise the system clock, which the SNTP library
+    // has already stepped, is put back.
     //
     // Arguments:
     //   pTvt -  Pointer to the timeval struct containing the UTC time in seconds
@@ -787,13 +2620,46 @@ private:
     static void UtcSetCallback(timeval *pTv);
 
 
+    /////////////////////////////////////////////////////////////////////////////
+    // SetUtcDevice()
+    //
+    // Calls the UTC set callback, if there is one.
+    //
+    // Arguments:
+    //   utc - The UTC time to be set.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetUtcDevice(time_t utc);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // WiFiEventCallback()
+    //
+    // This static method is called from the WiFi event task.  It just posts
+    // the events that we care about for process() to handle.
+    //
+    // Arguments:
+    //   event - The WiFi event.
+    //   info  - Event details.  Not used.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    static void WiFiEventCallback(arduino_event_id_t event, arduino_event_info_t info);
+
+
     /////////////////////////////////////////////////////////////////////////////
     // GetWebPage()
     //
-    // Returns a pointer to the web page buffer.
+    // Returns a pointer to the web page buffer.  The page is built first if it
+    // hasn't been, or if the settings that it shows have changed since.
+    // Returns an empty page in wpmStreamed mode.
     //
     /////////////////////////////////////////////////////////////////////////////
-    char *GetWebPage() { return WebPageBuffer; }
+    const char *GetWebPage();
+
+
+    // The WiFiManager parameter that holds our Setup page, and gets it with
+    // GetWebPage().  Defined in WiFiTimeManager.cpp.
+    friend class TzSelectParameter;
 
 
     /////////////////////////////////////////////////////////////////////////////
@@ -801,7 +2667,10 @@ private:
     //
     // Print the specified data if the selected level matches the m_PrintLevel
     // that was set via SetPrintLevel().  Note that this method is overloaded
-    // to work with NULL terminated strings, and String objects.
+    // to work with NULL terminated strings, and String objects.  Once Init()
+    // has started the log task, the message is queued for it rather than
+    // written to Serial by the caller.  Formatted messages longer than
+    // LOG_LINE_SIZE are truncated.
     //
     // Arguments:
     //   level - The bit pattern of the types of data that may be printed.
@@ -810,23 +2679,95 @@ private:
     //   str   - String instance to print.
     /////////////////////////////////////////////////////////////////////////////
     void WTMPrint(uint32_t level, const char *fmt...) const;
-    void WTMPrint(uint32_t level, String &str) const;
+    void WTMPrint(uint32_t level, const String &str) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // SetTimezoneEnv()
+    //
+    // Sets the TZ environment variable from our current timezone settings and
+    // flushes the local time cache.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void SetTimezoneEnv();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // BuildDstTable()
+    //
+    // Rebuilds the zone in effect, with its DST transition table, from our
+    // current timezone settings, publishes it and the settings to other tasks,
+    // and flushes the local time cache.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void BuildDstTable();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // InstallFixedZone()
+    //
+    // Does the work of SetFixedZone().
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void InstallFixedZone(const char *pTz, int32_t stdOfst, bool useDst,
+                          int32_t dstOfst, const char *pStdAbbrev,
+                          const char *pDstAbbrev, const DstRule &rStart,
+                          const DstRule &rEnd, const DstTransition *pTransitions,
+                          size_t count);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // The UTC get and set callbacks, and guards for reading them.
+    /////////////////////////////////////////////////////////////////////////////
+    typedef std::function<time_t()>       UtcGetFunc_t;
+    typedef std::function<void(time_t t)> UtcSetFunc_t;
+    typedef Rcu<UtcGetFunc_t>::ReadGuard  UtcGetGuard;
+    typedef Rcu<UtcSetFunc_t>::ReadGuard  UtcSetGuard;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // LocalTimeCache structure
+    //
+    // The most recent UTC to local time conversion, published via a SeqLock.
+    /////////////////////////////////////////////////////////////////////////////
+    struct LocalTimeCache
+    {
+        time_t   m_Utc;                   // UTC time that was converted.
+        uint32_t m_TzGeneration;          // Timezone generation when converted.
+        tm       m_Local;                 // Resulting broken-down local time.
+    };
 
 
     /////////////////////////////////////////////////////////////////////////////
     // Private static constants.
     /////////////////////////////////////////////////////////////////////////////
     static const char    *pPrefSavedStateLabel;       // Label for saving preferences.
+    static const char    *pPrefCheckpointLabel;       // Label for the time checkpoint.
     static const size_t   MAX_NVS_NAME_LEN;           // Maximum NVS preferences name length.
-    static const size_t   MAX_JSON_SIZE     = 350;    // Max web page JSON size.
+    static const size_t   MAX_JSON_SIZE     = 512;    // Max web page JSON size.
     static const char    *m_pName;                    // Preferences name.
     static const uint32_t MIN_NTP_UPDATE_MS = 15000;  // Minimum NTP update rate (milliseconds).
-
-    // Allocate enough space to buffer twice the size of our original web page.
-    // This allows for the user to add HTML and/or java script if needed.
-    // This is wasteful, but easy.  %%%jmc Possibly fix this in the future.
-    static const size_t   MAX_WEB_PAGE_SIZE = 2 * sizeof(TZ_SELECT_STR) + MAX_JSON_SIZE;
-    static char           WebPageBuffer[MAX_WEB_PAGE_SIZE];
+    static const uint32_t SERVICE_POLL_MS   = 10;     // Service task process() period.
+    static const UBaseType_t SERVICE_QUEUE_LEN = 8;   // Service task queue depth.
+    static const uint32_t NTP_PROBE_STACK   = 4096;   // NTP probe task stack size.
+    static const UBaseType_t NTP_PROBE_PRIORITY = 1;  // NTP probe task priority.
+    static const uint32_t SNTP_SYNC_ERR_US  = 25000;  // Assumed SNTP library sync error.
+    static const uint32_t UTC_DEVICE_READ_ERR_US = 500000; // Half a UtcGetCallback second.
+    static const uint32_t UTC_DEVICE_MARGIN_US = 100000; // Least gain to read it.
+    static const int64_t  SYSTEM_CLOCK_TOL_US = 1000; // System clock steering slack.
+    static const uint32_t AUTO_SAVE_CHECK_MS = 1000;  // Automatic save check period.
+    static const size_t   MAX_TZ_STR_LEN    = 64;     // Longest TZ string we form.
+    static const size_t   LOG_LINE_SIZE     = 128;    // Longest formatted status message.
+    static const uint32_t PORTAL_BUSY_US    = 1000;   // WiFiManager call that served a request.
+
+    // The Setup page with its settings spliced in, as built in the page buffer.
+    // The buffer also holds m_WebPageHeadroom more bytes for anything the web
+    // page callbacks add.  Use wpmStreamed mode to avoid the buffer altogether.
+    static const size_t   MAX_WEB_PAGE_SIZE = sizeof(TZ_SELECT_STR) + MAX_JSON_SIZE;
+    static const size_t   MAX_CACHED_PAGE_SIZE = sizeof(TZ_CACHED_STR);
+                                                      // wpmCached page size.
+    static const size_t   MAX_JSON_IN_SIZE  = 1024;   // Max REST request JSON size.
+    static const size_t   MAX_JSON_OUT_SIZE = 1024;   // Max REST reply JSON size.
     static volatile bool  m_UsingNetworkTime;
 
 
@@ -836,16 +2777,103 @@ private:
     const char    *m_pApName;             // Network name for AP.
     const char    *m_pApPassword;         // AP password.
     uint32_t       m_PrintLevel;          // Status print level selection.
+#if WTM_LOG_LEVEL > 0
+    mutable LogBuffer m_Log;              // Status messages awaiting Serial.
+#endif
     TimeParameters m_Params;              // Timezone and DST data.
     uint32_t       m_MinNtpRateMs;        // Minimum milliseconds between NTP updates.
-    uint32_t       m_LastUpdateMs;        // Last ms time of NTP update.
+    std::atomic<uint32_t> m_LastUpdateMs; // Last ms time of NTP update.
+    volatile ConnState_t m_ConnState;     // Network time bring up state.
+    std::atomic<uint32_t> m_WiFiEvents;   // WiFi events not yet handled.
+    uint32_t       m_MaxProcessUs;        // Longest process() call in usecs.
+    bool           m_PortalBlocking;      // true if the config portal blocks.
+    bool           m_ServiceRequested;    // true if SetServiceTask() was called.
+    bool           m_RestApi;             // true if the REST API is enabled.
+    const char    *m_pRestToken;          // REST API token, or NULL.
+    uint16_t       m_RestPort;            // REST API TCP port.
+    struct RestState;
+    RestState     *m_pRest;               // REST API server, or NULL.
+#if WTM_ENABLE_METRICS
+    mutable WtmMetrics m_Metrics;         // Counters and histograms.
+    mutable portMUX_TYPE m_MetricsMux;    // Guards m_Metrics.
+    std::atomic<uint32_t> m_LocalTimeCalls; // GetLocalTime() calls.
+#endif
+    BaseType_t     m_ServiceCore;         // Service task core.
+    UBaseType_t    m_ServicePriority;     // Service task priority.
+    uint32_t       m_ServiceStack;        // Service task stack size in bytes.
+    TaskHandle_t   m_ServiceTask;         // Service task, or NULL.
+    QueueHandle_t  m_ServiceQueue;        // Service task command queue.
+    std::atomic<bool> m_ConnectPending;   // scConnect not yet handled.
+    std::atomic<bool> m_RtcSyncPending;   // scSyncRtc not yet handled.
+    NtpProbe m_NtpProbe;                  // Multi-server NTP queries and stats.
+    std::atomic<bool> m_ProbeRunning;     // true while the NTP probe task runs.
+    DriftEstimator m_Drift;               // Local oscillator drift estimate.
+    TimeSourceArbiter m_Arbiter;          // Picks the source and bounds the error.
+    uint32_t       m_NtpTargetErrUs;      // Adaptive NTP target error.  0 = fixed.
+    uint32_t       m_SleepDriftPpm;       // Clock drift during deep sleep.
+    bool           m_WokeFromSleep;       // true if restored after deep sleep.
+    uint32_t       m_NtpRateMs;           // Current milliseconds between NTP updates.
+    uint32_t       m_DeviceHash;          // Hash of our MAC address, for jitter.
+    uint32_t       m_NtpStartJitterMs;    // Longest NTP start delay.
+    uint32_t       m_NtpPollJitterPct;    // Most NTP poll interval stretch.
+    esp_timer_handle_t m_NtpStartTimer;   // Ends the NTP start delay.
+    std::atomic<bool> m_NtpStartPending;  // true until the NTP start delay is up.
+    std::atomic<bool> m_NtpPending;       // true until a sync attempt is answered.
+    std::atomic<uint32_t> m_NtpAttemptMs; // millis() of the last sync attempt.
+    std::atomic<uint32_t> m_NtpFailures;  // Unanswered sync attempts in a row.
+    std::atomic<uint32_t> m_SyncErrUs;    // Expected error of the sync in progress.
+    volatile TimeQuality_t m_TimeQuality; // Where the current time came from.
+    uint32_t       m_CheckpointMs;        // Milliseconds between NVS checkpoints.
+    uint32_t       m_LastCheckpointMs;    // millis() of the last NVS checkpoint.
+    bool           m_Checkpointed;        // true once checkpointed since boot.
+    mutable uint32_t m_SavedCrc;          // CRC of m_Params as last in NVS.
+    mutable bool   m_SavedCrcValid;       // true if m_SavedCrc is known.
+    mutable volatile bool m_SavePending;  // true if a save is scheduled.
+    uint32_t       m_SaveDueMs;           // millis() at which to save.
+    uint32_t       m_AutoSaveMs;          // Automatic save quiet time.  0 = off.
+    uint32_t       m_AutoCheckMs;         // millis() of the last automatic check.
+    uint32_t       m_PendingCrc;          // CRC of the changes being waited on.
+    bool           m_Updating;            // true between BeginUpdate() and commit.
+    TimeParameters m_UpdateBase;          // Settings at BeginUpdate().
+    char           m_AppliedTz[MAX_TZ_STR_LEN];
+                                          // TZ string last set, or empty.
+    bool           m_NtpApplied;          // true once m_AppliedNtp is valid.
+    char           m_AppliedNtp[TimeParameters::MAX_NTP_SERVERS][TimeParameters::MAX_NTP_ADDR];
+                                          // NTP servers last handed to SNTP.
+    WebPageMode_t  m_WebPageMode;         // How the Setup page is rendered.
+    char          *m_pWebPageBuffer;      // Setup page buffer (wpmBuffered only).
+    size_t         m_WebPageHeadroom;     // Page buffer room for the callbacks.
+    bool           m_Provisioned;         // true to free the portal when connected.
+    bool           m_PortalReleased;      // true while the portal is freed.
+    bool           m_WebPageValid;        // false if the page must be rebuilt.
+    uint32_t       m_WebPageCrc;          // ParamsCrc() when the page was built.
+    String         m_BodyClass;           // Web page body class.
+    const char    *m_pFixedTz;            // Fixed zone TZ string, or NULL.
+    typedef Rcu<TimeParameters>::ReadGuard ParamsGuard;
+    Rcu<TimeParameters> m_AppliedParams;  // m_Params as last applied.
+    Rcu<Zone>      m_Zone;                // Zone in effect, with its transitions.
+    PrecisionClock m_PrecisionClock;      // Sub-second interpolated UTC time.
+    std::atomic<uint32_t> m_TzGeneration; // Bumped on every timezone change.
+    SeqLock<LocalTimeCache> m_LocalTimeCache;
+                                          // Most recent local time conversion.
+    AlarmScheduler m_Alarms;              // Scheduled callbacks.
+    RtcClock       m_RtcClock;            // Cached hardware RTC time.
+    RtcBackend    *m_pRtcBackend;         // The hardware RTC, or NULL.
+    int            m_RtcSqwPin;           // The RTC's SQW pin, or -1.
+    PpsDiscipline  m_Pps;                 // Locks the clock to a PPS signal.
+    int            m_PpsPin;              // The PPS pin, or -1.
+    int            m_PpsEdge;             // The PPS edge (RISING or FALLING).
+    bool           m_PpsWasLocked;        // Lock state at the last PPS edge.
     std::function<void()> m_pSaveParamsCallback;
                                           // Pointer to save params callback.
-    std::function<time_t()> m_pUtcGetCallback;
-                                          // Pointer to get UTC callback.
-    std::function<void(time_t t)> m_pUtcSetCallback; // Pointer to set UTC callback.
+    Rcu<UtcGetFunc_t> m_pUtcGetCallback;  // Pointer to get UTC callback.
+    Rcu<UtcSetFunc_t> m_pUtcSetCallback;  // Pointer to set UTC callback.
     std::function<void(String &rWebPage, uint32_t maxSize)> m_pUpdateWebPageCallback;
                                           // Pointer to update web page callback.
+    std::function<void(const char *pMarker, Print &rOut)> m_pStreamWebPageCallback;
+                                          // Pointer to stream web page callback.
+    std::function<void()> m_pWebServerCallback;
+                                          // Pointer to user web server callback.
 
 }; // End class WiFiTimeManager.
 
@@ -0,0 +1,62 @@
+/////////////////////////////////////////////////////////////////////////////////
+// WiFiTimeManagerConfig.h
+//
+// Compile time options for the WiFiTimeManager library.  Each option may be
+// set here, or defined on the compiler command line (e.g. with build_flags
+// in PlatformIO), which takes precedence.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined WIFITIMEMANAGERCONFIG_H
+#define WIFITIMEMANAGERCONFIG_H
+
+
+// Set to 1 to collect the counters and histograms returned by
+// WiFiTimeManager::GetMetrics(), or to 0 to compile them out.  When compiled
+// out, they take no RAM and no time.
+#if !defined WTM_ENABLE_METRICS
+#define WTM_ENABLE_METRICS 1
+#endif
+
+
+// The highest level of status message compiled in: 0 for none, 1 for
+// warnings, 2 for info, or 3 for debug.  Messages above this level, along
+// with their format strings and arguments, are removed at compile time.
+// SetPrintLevel() still selects which of the remaining levels print.
+#if !defined WTM_LOG_LEVEL
+#define WTM_LOG_LEVEL 3
+#endif
+
+
+// The size, in bytes, of the ring buffer that holds status messages until
+// the log task writes them to Serial.  Messages that don't fit are dropped.
+#if !defined WTM_LOG_BUFFER_SIZE
+#define WTM_LOG_BUFFER_SIZE 1024
+#endif
+
+
+// The FreeRTOS priority of the log task.
+#if !defined WTM_LOG_TASK_PRIORITY
+#define WTM_LOG_TASK_PRIORITY 1
+#endif
+
+
+// The FreeRTOS priority of the task that reads a hardware RTC set with
+// WiFiTimeManager::SetRtcBackend().
+#if !defined WTM_RTC_TASK_PRIORITY
+#define WTM_RTC_TASK_PRIORITY 1
+#endif
+
+
+// The FreeRTOS priority of the task that handles the PPS signal set with
+// WiFiTimeManager::SetPpsSource().  The edges are timestamped in an
+// interrupt, so this only needs to be high enough to get each one handled
+// within the second.
+#if !defined WTM_PPS_TASK_PRIORITY
+#define WTM_PPS_TASK_PRIORITY 2
+#endif
+
+
+#endif // WIFITIMEMANAGERCONFIG_H
@@ -0,0 +1,138 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Zone.cpp
+//
+// This file implements the Zone class.  See Zone.h for details.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#include "Zone.h"               // For Zone class.
+#include <string.h>             // For strncpy().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Constructor.
+//
+// The zone starts out as UTC with no DST.
+/////////////////////////////////////////////////////////////////////////////
+Zone::Zone() : m_Table()
+{
+    CopyAbbrev(m_StdAbbrev, "UTC");
+    CopyAbbrev(m_DstAbbrev, "UTC");
+} // End constructor.
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Build()
+//
+// Sets the zone's rules and computes its transitions.
+//
+// Arguments:
+//   stdOfst    - Standard time offset from UTC in minutes.
+//   useDst     - true if DST is observed.
+//   dstOfst    - DST offset from UTC in minutes (e.g. stdOfst + 60).
+//   rStart     - Rule for starting DST, in standard local time.
+//   rEnd       - Rule for ending DST, in DST local time.
+//   pStdAbbrev - Abbreviation for standard time (e.g. "EST").  May be
+//                NULL.  Truncated to MAX_ABBREV - 1 characters.
+//   pDstAbbrev - Abbreviation for DST (e.g. "EDT").  May be NULL.
+//                Truncated to MAX_ABBREV - 1 characters.
+//   firstYear  - First year (e.g. 2023) of precomputed transitions.
+//                Times outside of DstTable::NUM_YEARS years from then
+//                are still converted correctly, just a bit slower.
+//
+/////////////////////////////////////////////////////////////////////////////
+void Zone::Build(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                 const DstRule &rStart, const DstRule &rEnd,
+                 const char *pStdAbbrev, const char *pDstAbbrev, int32_t firstYear)
+{
+    m_Table.Build(stdOfst, useDst, dstOfst, rStart, rEnd, firstYear);
+    CopyAbbrev(m_StdAbbrev, pStdAbbrev);
+    CopyAbbrev(m_DstAbbrev, pDstAbbrev);
+} // End Build().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Attach()
+//
+// Same as Build(), except that the transitions have already been computed
+// (e.g. at compile time by FixedZone) and are used in place rather than
+// copied.
+//
+// Arguments:
+//   stdOfst      - Standard time offset from UTC in minutes.
+//   useDst       - true if DST is observed.
+//   dstOfst      - DST offset from UTC in minutes (e.g. stdOfst + 60).
+//   rStart       - Rule for starting DST, in standard local time.
+//   rEnd         - Rule for ending DST, in DST local time.
+//   pStdAbbrev   - Abbreviation for standard time.  May be NULL.
+//   pDstAbbrev   - Abbreviation for DST.  May be NULL.
+//   pTransitions - Pointer to the transitions, in time order.  Must remain
+//                  valid for as long as the zone is used.
+//   count        - The number of transitions pointed to by pTransitions.
+//
+/////////////////////////////////////////////////////////////////////////////
+void Zone::Attach(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                  const DstRule &rStart, const DstRule &rEnd,
+                  const char *pStdAbbrev, const char *pDstAbbrev,
+                  const DstTransition *pTransitions, size_t count)
+{
+    m_Table.Attach(stdOfst, useDst, dstOfst, rStart, rEnd, pTransitions, count);
+    CopyAbbrev(m_StdAbbrev, pStdAbbrev);
+    CopyAbbrev(m_DstAbbrev, pDstAbbrev);
+} // End Attach().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// ToLocal()
+//
+// Converts a UTC time to broken-down local time in this zone.  tm_isdst
+// is set according to the zone's rules.
+//
+// Arguments:
+//   utc - The UTC time to be converted.
+//   pTm - Pointer to where the local time is returned.
+//
+// Returns:
+//   Returns pTm.
+//
+/////////////////////////////////////////////////////////////////////////////
+tm *Zone::ToLocal(int64_t utc, tm *pTm) const
+{
+    bool isDst = false;
+    int32_t ofst = m_Table.GetOffset(utc, &isDst);
+    TimeMath::SecsToTm(utc + (int64_t)ofst * TimeMath::SECS_PER_MIN, pTm);
+    pTm->tm_isdst = isDst ? 1 : 0;
+    return pTm;
+} // End ToLocal().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// GetAbbrev()
+//
+// Returns the abbreviation in effect at the specified time (e.g. "EDT").
+//
+// Arguments:
+//   utc - The UTC time of interest.
+//
+/////////////////////////////////////////////////////////////////////////////
+const char *Zone::GetAbbrev(int64_t utc) const
+{
+    bool isDst = false;
+    m_Table.GetOffset(utc, &isDst);
+    return isDst ? m_DstAbbrev : m_StdAbbrev;
+} // End GetAbbrev().
+
+
+/////////////////////////////////////////////////////////////////////////////
+// CopyAbbrev()
+//
+// Copies an abbreviation, truncating it to MAX_ABBREV - 1 characters.  A
+// NULL source gives an empty abbreviation.
+/////////////////////////////////////////////////////////////////////////////
+void Zone::CopyAbbrev(char *pDest, const char *pSrc)
+{
+    strncpy(pDest, pSrc != NULL ? pSrc : "", MAX_ABBREV - 1);
+    pDest[MAX_ABBREV - 1] = '\0';
+} // End CopyAbbrev().
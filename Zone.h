@@ -0,0 +1,214 @@
+/////////////////////////////////////////////////////////////////////////////////
+// Zone.h
+//
+// This file implements the Zone class.  A Zone is a self contained timezone:
+// a set of POSIX style rules, the abbreviations that go with them, and a
+// DstTable of their precomputed transitions.  It converts between UTC and
+// local time without the TZ environment variable, tzset(), or any other
+// global state, so any number of zones may be used at once, from any task.
+//
+// Building a zone writes to it, so it must not be used by another task while
+// it is being built.  After that, all of its methods are const and reentrant.
+//
+// Example:
+//     // US Pacific time.  DST starts the 2nd Sunday of March at 2 AM and
+//     // ends the 1st Sunday of November at 2 AM.
+//     DstRule start = { 3, 2, 0, 2 };
+//     DstRule end   = { 11, 1, 0, 2 };
+//     Zone pacific;
+//     pacific.Build(-480, true, -420, start, end, "PST", "PDT", 2023);
+//
+//     tm local;
+//     pacific.ToLocal(time(NULL), &local);
+//
+// This file has no Arduino dependencies.
+//
+// Copyright (c) 2023, Joseph M. Corbett
+//
+/////////////////////////////////////////////////////////////////////////////////
+
+#if !defined ZONE_H
+#define ZONE_H
+
+#include <stdint.h>             // For integer types.
+#include <stddef.h>             // For size_t.
+#include <time.h>               // For tm.
+#include "TimeMath.h"           // For calendar calculations.
+#include "DstTable.h"           // For the transitions.
+
+
+class Zone
+{
+public:
+    // The size of an abbreviation buffer.  Five chars max.
+    static const size_t MAX_ABBREV = 6;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Constructor.
+    //
+    // The zone starts out as UTC with no DST.
+    /////////////////////////////////////////////////////////////////////////////
+    Zone();
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Build()
+    //
+    // Sets the zone's rules and computes its transitions.
+    //
+    // Arguments:
+    //   stdOfst    - Standard time offset from UTC in minutes.
+    //   useDst     - true if DST is observed.
+    //   dstOfst    - DST offset from UTC in minutes (e.g. stdOfst + 60).
+    //   rStart     - Rule for starting DST, in standard local time.
+    //   rEnd       - Rule for ending DST, in DST local time.
+    //   pStdAbbrev - Abbreviation for standard time (e.g. "EST").  May be
+    //                NULL.  Truncated to MAX_ABBREV - 1 characters.
+    //   pDstAbbrev - Abbreviation for DST (e.g. "EDT").  May be NULL.
+    //                Truncated to MAX_ABBREV - 1 characters.
+    //   firstYear  - First year (e.g. 2023) of precomputed transitions.
+    //                Times outside of DstTable::NUM_YEARS years from then
+    //                are still converted correctly, just a bit slower.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Build(int32_t stdOfst, bool useDst, int32_t dstOfst,
+               const DstRule &rStart, const DstRule &rEnd,
+               const char *pStdAbbrev, const char *pDstAbbrev, int32_t firstYear);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Attach()
+    //
+    // Same as Build(), except that the transitions have already been computed
+    // (e.g. at compile time by FixedZone) and are used in place rather than
+    // copied.
+    //
+    // Arguments:
+    //   stdOfst      - Standard time offset from UTC in minutes.
+    //   useDst       - true if DST is observed.
+    //   dstOfst      - DST offset from UTC in minutes (e.g. stdOfst + 60).
+    //   rStart       - Rule for starting DST, in standard local time.
+    //   rEnd         - Rule for ending DST, in DST local time.
+    //   pStdAbbrev   - Abbreviation for standard time.  May be NULL.
+    //   pDstAbbrev   - Abbreviation for DST.  May be NULL.
+    //   pTransitions - Pointer to the transitions, in time order.  Must remain
+    //                  valid for as long as the zone is used.
+    //   count        - The number of transitions pointed to by pTransitions.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    void Attach(int32_t stdOfst, bool useDst, int32_t dstOfst,
+                const DstRule &rStart, const DstRule &rEnd,
+                const char *pStdAbbrev, const char *pDstAbbrev,
+                const DstTransition *pTransitions, size_t count);
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ToLocal()
+    //
+    // Converts a UTC time to broken-down local time in this zone.  tm_isdst
+    // is set according to the zone's rules.
+    //
+    // Arguments:
+    //   utc - The UTC time to be converted.
+    //   pTm - Pointer to where the local time is returned.
+    //
+    // Returns:
+    //   Returns pTm.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    tm *ToLocal(int64_t utc, tm *pTm) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // ToUtc()
+    //
+    // Converts a broken-down local time in this zone to UTC.  A local time
+    // skipped by the start of DST maps to the start of DST, and a local time
+    // repeated by the end of DST maps to its first occurrence.
+    //
+    // Arguments:
+    //   pLocal - The local time.  tm_isdst, tm_wday, and tm_yday are
+    //            ignored, and out of range fields are normalized.
+    //
+    // Returns:
+    //   Returns the UTC time.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int64_t ToUtc(const tm *pLocal) const
+        { return m_Table.LocalToUtc(TimeMath::TmToSecs(pLocal)); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetOffset()
+    //
+    // Returns the offset from UTC, in minutes, in effect at the specified time.
+    //
+    // Arguments:
+    //   utc    - The UTC time of interest.
+    //   pIsDst - If not NULL, receives true if DST is in effect at utc.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t GetOffset(int64_t utc, bool *pIsDst = NULL) const
+        { return m_Table.GetOffset(utc, pIsDst); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetAbbrev()
+    //
+    // Returns the abbreviation in effect at the specified time (e.g. "EDT").
+    //
+    // Arguments:
+    //   utc - The UTC time of interest.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    const char *GetAbbrev(int64_t utc) const;
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // Offset and abbreviation getters.  Offsets are from UTC in minutes.
+    /////////////////////////////////////////////////////////////////////////////
+    int32_t     GetStdOffset() const { return m_Table.GetStdOfst(); }
+    int32_t     GetDstOffset() const { return m_Table.GetDstOfst(); }
+    const char *GetStdAbbrev() const { return m_StdAbbrev; }
+    const char *GetDstAbbrev() const { return m_DstAbbrev; }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetNextTransition()
+    //
+    // Returns the first transition that takes effect after the specified time.
+    //
+    // Arguments:
+    //   utc   - The UTC time of interest.
+    //   pNext - Pointer to where the transition is returned.
+    //
+    // Returns:
+    //   Returns true if a transition was found, or false if DST is not
+    //   observed.
+    //
+    /////////////////////////////////////////////////////////////////////////////
+    bool GetNextTransition(int64_t utc, DstTransition *pNext) const
+        { return m_Table.GetNextTransition(utc, pNext); }
+
+
+    /////////////////////////////////////////////////////////////////////////////
+    // GetTable()
+    //
+    // Returns the zone's table of transitions.
+    /////////////////////////////////////////////////////////////////////////////
+    const DstTable &GetTable() const { return m_Table; }
+
+
+private:
+    // Copies an abbreviation, truncating it if needed.
+    static void CopyAbbrev(char *pDest, const char *pSrc);
+
+    DstTable m_Table;                   // The zone's transitions.
+    char     m_StdAbbrev[MAX_ABBREV];   // Standard time abbreviation.
+    char     m_DstAbbrev[MAX_ABBREV];   // DST abbreviation.
+
+}; // End class Zone.
+
+
+#endif // ZONE_H